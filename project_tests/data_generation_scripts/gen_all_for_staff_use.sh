@@ -26,5 +26,6 @@ python milestone3.py $TBL_SIZE $RAND_SEED ${OUTPUT_TEST_DIR} ${DOCKER_TEST_DIR}
 
 python milestone4.py $TBL_SIZE $JOIN_DIM1_SIZE $JOIN_DIM2_SIZE $RAND_SEED $ZIPFIAN_PARAM $NUM_UNIQUE_ZIPF ${OUTPUT_TEST_DIR} ${DOCKER_TEST_DIR}
 python milestone5.py $TBL_SIZE $RAND_SEED ${OUTPUT_TEST_DIR} ${DOCKER_TEST_DIR}
+python milestone6.py $TBL_SIZE $RAND_SEED ${OUTPUT_TEST_DIR} ${DOCKER_TEST_DIR}
 
 echo "DATA GENERATION STEP FINISHED ..."
@@ -382,6 +382,218 @@ def createTest30(dataTable, dataSize):
             exp_output_file.write(str(sum_result) + '\n')
     data_gen_utils.closeFileHandles(output_file, exp_output_file)
 
+def createTest44():
+    output_file, exp_output_file = data_gen_utils.openFileHandles(44, TEST_DIR=TEST_BASE_DIR)
+    numInserts = 100
+    # col2 values are distinct so that each one names a single row
+    dataTable = pd.DataFrame({'col1': np.random.randint(0, 50, size=numInserts), 'col2': np.random.permutation(1000)[:numInserts]})
+    output_file.write('-- Test for inserting into a table whose clustered index is created before any data\n')
+    output_file.write('--\n')
+    output_file.write('-- Table tbl6_clustered_insert is kept sorted on col1, with many duplicates.\n')
+    output_file.write('-- The position of a single col2 value tells whether the rows were moved into col1 order.\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl6_clustered_insert",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl6_clustered_insert)\n')
+    output_file.write('create(col,"col2",db1.tbl6_clustered_insert)\n')
+    output_file.write('create(idx,db1.tbl6_clustered_insert.col1,sorted,clustered)\n')
+    for i in range(numInserts):
+        output_file.write('relational_insert(db1.tbl6_clustered_insert,{},{})\n'.format(dataTable['col1'][i], dataTable['col2'][i]))
+    # the table is sorted on col1, rows with the same key stay in insertion order
+    dataTable = dataTable.sort_values('col1', kind='mergesort').reset_index(drop=True)
+    output_file.write('--\n')
+    output_file.write('-- Query in SQL:\n')
+    output_file.write('-- SELECT col2 FROM tbl6_clustered_insert WHERE col1 >= _ and col1 < _;\n')
+    output_file.write('-- SELECT col1 FROM tbl6_clustered_insert WHERE col2 >= _ and col2 < _;\n')
+    output_file.write('--\n')
+    for i in range(3):
+        val1 = np.random.randint(0, 40)
+        val2 = np.random.randint(0, 800)
+        val3 = dataTable['col2'][np.random.randint(0, numInserts)]
+        output_file.write('s{}=select(db1.tbl6_clustered_insert.col1,{},{})\n'.format(i, val1, val1 + 10))
+        output_file.write('f{}=fetch(db1.tbl6_clustered_insert.col2,s{})\n'.format(i, i))
+        output_file.write('print(f{})\n'.format(i))
+        output_file.write('u{}=select(db1.tbl6_clustered_insert.col2,{},{})\n'.format(i, val3, val3 + 1))
+        output_file.write('print(u{})\n'.format(i))
+        output_file.write('t{}=select(db1.tbl6_clustered_insert.col2,{},{})\n'.format(i, val2, val2 + 200))
+        output_file.write('g{}=fetch(db1.tbl6_clustered_insert.col1,t{})\n'.format(i, i))
+        output_file.write('print(g{})\n'.format(i))
+        dfSelectMask1 = (dataTable['col1'] >= val1) & (dataTable['col1'] < (val1 + 10))
+        dfSelectMask2 = (dataTable['col2'] >= val2) & (dataTable['col2'] < (val2 + 200))
+        exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask1]['col2']))
+        exp_output_file.write('\n\n')
+        exp_output_file.write(str(dataTable.index[dataTable['col2'] == val3][0]) + '\n\n')
+        exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask2]['col1']))
+        exp_output_file.write('\n\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def createTest45():
+    output_file, exp_output_file = data_gen_utils.openFileHandles(45, TEST_DIR=TEST_BASE_DIR)
+    dataSize = 1000
+    outputFile = TEST_BASE_DIR + '/' + 'data6_sorted_load.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl6_sorted_load', 3)
+    # col1 and col3 values are distinct so that each one names a single row
+    dataTable = pd.DataFrame({'col1': np.random.permutation(10 * dataSize)[:dataSize], 'col2': np.random.randint(0, 1000, size=dataSize), 'col3': np.random.permutation(dataSize)})
+    dataTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    output_file.write('-- Test for loading data into a table with a sorted clustered index and a sorted unclustered index\n')
+    output_file.write('--\n')
+    output_file.write('-- Loads data from: data6_sorted_load.csv\n')
+    output_file.write('-- The position of a single col3 value tells whether the load moved every column into col1 order.\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl6_sorted_load",db1,3)\n')
+    output_file.write('create(col,"col1",db1.tbl6_sorted_load)\n')
+    output_file.write('create(col,"col2",db1.tbl6_sorted_load)\n')
+    output_file.write('create(col,"col3",db1.tbl6_sorted_load)\n')
+    output_file.write('create(idx,db1.tbl6_sorted_load.col1,sorted,clustered)\n')
+    output_file.write('create(idx,db1.tbl6_sorted_load.col2,sorted,unclustered)\n')
+    output_file.write('load("'+DOCKER_TEST_BASE_DIR+'/data6_sorted_load.csv")\n')
+    dataTable = dataTable.sort_values('col1').reset_index(drop=True)
+    output_file.write('--\n')
+    output_file.write('-- Query in SQL:\n')
+    output_file.write('-- SELECT col3 FROM tbl6_sorted_load WHERE col1 >= _ and col1 < _;\n')
+    output_file.write('-- SELECT sum(col3) FROM tbl6_sorted_load WHERE col2 >= _ and col2 < _;\n')
+    output_file.write('--\n')
+    for i in range(3):
+        val1 = np.random.randint(0, 9 * dataSize)
+        val2 = np.random.randint(0, 900)
+        val3 = np.random.randint(0, dataSize)
+        output_file.write('s{}=select(db1.tbl6_sorted_load.col1,{},{})\n'.format(i, val1, val1 + 200))
+        output_file.write('f{}=fetch(db1.tbl6_sorted_load.col3,s{})\n'.format(i, i))
+        output_file.write('print(f{})\n'.format(i))
+        output_file.write('t{}=select(db1.tbl6_sorted_load.col2,{},{})\n'.format(i, val2, val2 + 100))
+        output_file.write('g{}=fetch(db1.tbl6_sorted_load.col3,t{})\n'.format(i, i))
+        output_file.write('a{}=sum(g{})\n'.format(i, i))
+        output_file.write('print(a{})\n'.format(i))
+        output_file.write('u{}=select(db1.tbl6_sorted_load.col3,{},{})\n'.format(i, val3, val3 + 1))
+        output_file.write('print(u{})\n'.format(i))
+        dfSelectMask1 = (dataTable['col1'] >= val1) & (dataTable['col1'] < (val1 + 200))
+        dfSelectMask2 = (dataTable['col2'] >= val2) & (dataTable['col2'] < (val2 + 100))
+        exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask1]['col3']))
+        exp_output_file.write('\n\n')
+        exp_output_file.write(str(dataTable[dfSelectMask2]['col3'].sum()) + '\n\n')
+        exp_output_file.write(str(dataTable.index[dataTable['col3'] == val3][0]) + '\n\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def writeBtreeQueries(output_file, exp_output_file, dataTable, queries):
+    for (val1, val2, val3) in queries:
+        output_file.write('s1=select(db1.tbl6_btree.col1,{},{})\n'.format(val1, val1 + 300))
+        output_file.write('f1=fetch(db1.tbl6_btree.col3,s1)\n')
+        output_file.write('print(f1)\n')
+        output_file.write('s2=select(db1.tbl6_btree.col2,{},{})\n'.format(val2, val2 + 100))
+        output_file.write('f2=fetch(db1.tbl6_btree.col3,s2)\n')
+        output_file.write('a2=sum(f2)\n')
+        output_file.write('print(a2)\n')
+        output_file.write('s3=select(db1.tbl6_btree.col3,{},{})\n'.format(val3, val3 + 1))
+        output_file.write('print(s3)\n')
+        dfSelectMask1 = (dataTable['col1'] >= val1) & (dataTable['col1'] < (val1 + 300))
+        dfSelectMask2 = (dataTable['col2'] >= val2) & (dataTable['col2'] < (val2 + 100))
+        exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask1]['col3']))
+        exp_output_file.write('\n\n')
+        exp_output_file.write(str(dataTable[dfSelectMask2]['col3'].sum()) + '\n\n')
+        exp_output_file.write(str(dataTable.index[dataTable['col3'] == val3][0]) + '\n\n')
+
+def createTests46And47():
+    output_file46, exp_output_file46 = data_gen_utils.openFileHandles(46, TEST_DIR=TEST_BASE_DIR)
+    output_file47, exp_output_file47 = data_gen_utils.openFileHandles(47, TEST_DIR=TEST_BASE_DIR)
+    dataSize = 1000
+    numInserts = 50
+    numDeletes = 20
+    outputFile = TEST_BASE_DIR + '/' + 'data6_btree.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl6_btree', 3)
+    # col1 and col3 values are distinct, also across the inserted rows, so that each one names a single row
+    keys = np.random.permutation(10 * dataSize)[:dataSize + numInserts]
+    dataTable = pd.DataFrame({'col1': keys[:dataSize], 'col2': np.random.randint(0, 1000, size=dataSize), 'col3': np.arange(dataSize)})
+    dataTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    output_file46.write('-- Test for loading, inserting into and deleting from a table with btree indexes\n')
+    output_file46.write('--\n')
+    output_file46.write('-- Table tbl6_btree has a clustered btree index on col1 and an unclustered btree index on col2.\n')
+    output_file46.write('-- Loads data from: data6_btree.csv\n')
+    output_file46.write('--\n')
+    output_file46.write('create(tbl,"tbl6_btree",db1,3)\n')
+    output_file46.write('create(col,"col1",db1.tbl6_btree)\n')
+    output_file46.write('create(col,"col2",db1.tbl6_btree)\n')
+    output_file46.write('create(col,"col3",db1.tbl6_btree)\n')
+    output_file46.write('create(idx,db1.tbl6_btree.col1,btree,clustered)\n')
+    output_file46.write('create(idx,db1.tbl6_btree.col2,btree,unclustered)\n')
+    output_file46.write('load("'+DOCKER_TEST_BASE_DIR+'/data6_btree.csv")\n')
+    insertTable = pd.DataFrame({'col1': keys[dataSize:], 'col2': np.random.randint(0, 1000, size=numInserts), 'col3': np.arange(dataSize, dataSize + numInserts)})
+    for i in range(numInserts):
+        output_file46.write('relational_insert(db1.tbl6_btree,{},{},{})\n'.format(insertTable['col1'][i], insertTable['col2'][i], insertTable['col3'][i]))
+    dataTable = pd.concat([dataTable, insertTable]).sort_values('col1').reset_index(drop=True)
+    # delete single rows through the unindexed col3
+    deleteVals = np.random.permutation(dataSize + numInserts)[:numDeletes]
+    for val in deleteVals:
+        output_file46.write('d1=select(db1.tbl6_btree.col3,{},{})\n'.format(val, val + 1))
+        output_file46.write('relational_delete(db1.tbl6_btree,d1)\n')
+    dataTable = dataTable[~dataTable['col3'].isin(deleteVals)].reset_index(drop=True)
+    queries = []
+    for i in range(3):
+        val3 = dataTable['col3'][np.random.randint(0, len(dataTable))]
+        queries.append((np.random.randint(0, 9 * dataSize), np.random.randint(0, 900), val3))
+    output_file46.write('--\n')
+    output_file46.write('-- Query in SQL:\n')
+    output_file46.write('-- SELECT col3 FROM tbl6_btree WHERE col1 >= _ and col1 < _;\n')
+    output_file46.write('-- SELECT sum(col3) FROM tbl6_btree WHERE col2 >= _ and col2 < _;\n')
+    output_file46.write('--\n')
+    writeBtreeQueries(output_file46, exp_output_file46, dataTable, queries)
+    output_file46.write('-- Testing that the btrees are durable on disk.\n')
+    output_file46.write('shutdown\n')
+    output_file47.write('-- Test for the btree indexes of tbl6_btree after a server restart\n')
+    output_file47.write('--\n')
+    output_file47.write('-- Runs the queries of test 46 again, then inserts and deletes a few more rows\n')
+    output_file47.write('--\n')
+    writeBtreeQueries(output_file47, exp_output_file47, dataTable, queries)
+    insertTable = pd.DataFrame({'col1': [-1, 10 * dataSize, 5 * dataSize + 1], 'col2': [0, 999, 500], 'col3': np.arange(dataSize + numInserts, dataSize + numInserts + 3)})
+    for i in range(len(insertTable)):
+        output_file47.write('relational_insert(db1.tbl6_btree,{},{},{})\n'.format(insertTable['col1'][i], insertTable['col2'][i], insertTable['col3'][i]))
+    dataTable = pd.concat([dataTable, insertTable]).sort_values('col1').reset_index(drop=True)
+    deleteVals = [dataTable['col3'][0], dataTable['col3'][len(dataTable) - 1], queries[0][2]]
+    for val in deleteVals:
+        output_file47.write('d1=select(db1.tbl6_btree.col3,{},{})\n'.format(val, val + 1))
+        output_file47.write('relational_delete(db1.tbl6_btree,d1)\n')
+    dataTable = dataTable[~dataTable['col3'].isin(deleteVals)].reset_index(drop=True)
+    queries = [(q[0], q[1], dataTable['col3'][np.random.randint(0, len(dataTable))]) for q in queries]
+    writeBtreeQueries(output_file47, exp_output_file47, dataTable, queries)
+    data_gen_utils.closeFileHandles(output_file46, exp_output_file46)
+    data_gen_utils.closeFileHandles(output_file47, exp_output_file47)
+
+def createTest48():
+    output_file, exp_output_file = data_gen_utils.openFileHandles(48, TEST_DIR=TEST_BASE_DIR)
+    numInserts = 200
+    numDeletes = 50
+    dataTable = pd.DataFrame({'col1': np.random.randint(0, 1000, size=numInserts), 'col2': np.arange(numInserts)})
+    output_file.write('-- Test for inserting into and deleting from a table with a sorted unclustered index\n')
+    output_file.write('--\n')
+    output_file.write('-- Table tbl6_sorted_unclustered has a sorted unclustered index on col1, col2 is not indexed.\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl6_sorted_unclustered",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl6_sorted_unclustered)\n')
+    output_file.write('create(col,"col2",db1.tbl6_sorted_unclustered)\n')
+    output_file.write('create(idx,db1.tbl6_sorted_unclustered.col1,sorted,unclustered)\n')
+    for i in range(numInserts):
+        output_file.write('relational_insert(db1.tbl6_sorted_unclustered,{},{})\n'.format(dataTable['col1'][i], dataTable['col2'][i]))
+    # delete single rows through the unindexed col2
+    deleteVals = np.random.permutation(numInserts)[:numDeletes]
+    for val in deleteVals:
+        output_file.write('d1=select(db1.tbl6_sorted_unclustered.col2,{},{})\n'.format(val, val + 1))
+        output_file.write('relational_delete(db1.tbl6_sorted_unclustered,d1)\n')
+    dataTable = dataTable[~dataTable['col2'].isin(deleteVals)].reset_index(drop=True)
+    output_file.write('--\n')
+    output_file.write('-- Query in SQL:\n')
+    output_file.write('-- SELECT col2 FROM tbl6_sorted_unclustered WHERE col1 >= _ and col1 < _;\n')
+    output_file.write('-- SELECT sum(col2) FROM tbl6_sorted_unclustered WHERE col1 >= _ and col1 < _;\n')
+    output_file.write('--\n')
+    for i in range(3):
+        val1 = np.random.randint(0, 900)
+        output_file.write('s{}=select(db1.tbl6_sorted_unclustered.col1,{},{})\n'.format(i, val1, val1 + 100))
+        output_file.write('f{}=fetch(db1.tbl6_sorted_unclustered.col2,s{})\n'.format(i, i))
+        output_file.write('print(f{})\n'.format(i))
+        output_file.write('a{}=sum(f{})\n'.format(i, i))
+        output_file.write('print(a{})\n'.format(i))
+        dfSelectMask = (dataTable['col1'] >= val1) & (dataTable['col1'] < (val1 + 100))
+        exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask]['col2']))
+        exp_output_file.write('\n\n')
+        exp_output_file.write(str(dataTable[dfSelectMask]['col2'].sum()) + '\n\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
 
 def generateMilestoneThreeFiles(dataSize, randomSeed=47):
     np.random.seed(randomSeed)
@@ -396,6 +608,10 @@ def generateMilestoneThreeFiles(dataSize, randomSeed=47):
     createTest28()
     createTest29(dataTable, dataSize)
     createTest30(dataTable, dataSize)
+    createTest44()
+    createTest45()
+    createTests46And47()
+    createTest48()
 
 def main(argv):
     global TEST_BASE_DIR
@@ -34,6 +34,13 @@ def generateDataMilestone5(dataSize):
     return outputTable
     
 
+def generateDataLateIndexes(dataSize):
+    outputFile = TEST_BASE_DIR + '/data6.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl6', 6)
+    outputTable = pd.DataFrame(np.random.randint(0, 10000, size=(dataSize, 6)), columns =['col1', 'col2', 'col3', 'col4', 'col5', 'col6'])
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
 def createTest38(dataTable):
     # prelude
     output_file, exp_output_file = data_gen_utils.openFileHandles(38, TEST_DIR=TEST_BASE_DIR)
@@ -291,6 +298,64 @@ def createTest43(dataTable):
     data_gen_utils.closeFileHandles(output_file, exp_output_file)
 
 
+def createTest49(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(49, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Create indexes on a table that already holds data, then insert into it.\n')
+    output_file.write('--\n')
+    output_file.write('-- The unclustered indexes are built from the loaded data. The clustered ones are rejected,\n')
+    output_file.write('-- the table is not sorted again, so their columns stay unindexed.\n')
+    output_file.write('--\n')
+    output_file.write('-- Create Table\n')
+    output_file.write('create(tbl,"tbl6",db1,6)\n')
+    for c in range(1, 7):
+        output_file.write('create(col,"col{}",db1.tbl6)\n'.format(c))
+    output_file.write('--\n')
+    output_file.write('-- Load data before any index exists\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data6.csv\")\n')
+    output_file.write('--\n')
+    output_file.write('-- Create one index of every type\n')
+    output_file.write('create(idx,db1.tbl6.col1,sorted,clustered)\n')
+    output_file.write('create(idx,db1.tbl6.col2,btree,clustered)\n')
+    output_file.write('create(idx,db1.tbl6.col3,sorted,unclustered)\n')
+    output_file.write('create(idx,db1.tbl6.col4,btree,unclustered)\n')
+    output_file.write('create(idx,db1.tbl6.col5,cracked,unclustered)\n')
+    output_file.write('create(idx,db1.tbl6.col6,imprints,unclustered)\n')
+    output_file.write('--\n')
+    for i in range(10):
+        values = np.random.randint(0, 10000, size=6)
+        output_file.write('relational_insert(db1.tbl6,{})\n'.format(','.join(str(v) for v in values)))
+        dataTable = dataTable.append(dict(zip(dataTable.columns, values)), ignore_index = True)
+    output_file.write('--\n')
+    # a narrow range goes through the index, a wide one is scanned
+    for c in range(1, 7):
+        for offset in [10, 2000]:
+            val1 = np.random.randint(0, 10000 - offset)
+            output_file.write('-- SELECT col1 FROM tbl6 WHERE col{} >= {} AND col{} < {};\n'.format(c, val1, c, val1 + offset))
+            output_file.write('s1=select(db1.tbl6.col{},{},{})\n'.format(c, val1, val1 + offset))
+            output_file.write('f1=fetch(db1.tbl6.col1,s1)\n')
+            output_file.write('a1=sum(f1)\n')
+            output_file.write('print(a1)\n')
+            dfSelectMask = (dataTable['col{}'.format(c)] >= val1) & (dataTable['col{}'.format(c)] < (val1 + offset))
+            exp_output_file.write(str(dataTable[dfSelectMask]['col1'].sum()) + '\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+    return dataTable
+
+def createTest50(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(50, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: A select whose lower bound is not below its upper bound qualifies no row,\n')
+    output_file.write('-- whether it goes through an index or not\n')
+    output_file.write('--\n')
+    for c in range(1, 7):
+        val2 = np.random.randint(0, 9000)
+        val1 = np.random.randint(val2, 10000)
+        output_file.write('-- SELECT sum(col1) FROM tbl6 WHERE col{} >= {} AND col{} < {};\n'.format(c, val1, c, val2))
+        output_file.write('s1=select(db1.tbl6.col{},{},{})\n'.format(c, val1, val2))
+        output_file.write('f1=fetch(db1.tbl6.col1,s1)\n')
+        output_file.write('a1=sum(f1)\n')
+        output_file.write('print(a1)\n')
+        exp_output_file.write('0\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
 
 def generateMilestoneFiveFiles(dataSize,randomSeed=47):
     np.random.seed(randomSeed)
@@ -301,6 +366,9 @@ def generateMilestoneFiveFiles(dataSize,randomSeed=47):
     createTest41(dataTable)
     dataTable = createTest42(dataTable)
     createTest43(dataTable)
+    dataTable = generateDataLateIndexes(dataSize)
+    dataTable = createTest49(dataTable)
+    createTest50(dataTable)
 
 def main(argv):
     global TEST_BASE_DIR
@@ -0,0 +1,1063 @@
+#!/usr/bin/python
+import sys, string
+from random import choice
+import random
+from string import ascii_lowercase
+from scipy.stats import beta, uniform
+import numpy as np
+import struct
+import pandas as pd
+import math
+
+import data_gen_utils
+
+# note this is the base path where we store the data files we generate
+TEST_BASE_DIR = "/cs165/generated_data"
+
+# note this is the base path that _POINTS_ to the data files we generate
+DOCKER_TEST_BASE_DIR = "/cs165/staff_test"
+
+#
+# Example usage:
+#   python milestone6.py 10000 42 ~/repo/cs165-docker-test-runner/test_data /cs165/staff_test
+#
+
+############################################################################
+# Notes: Tests of the operators and access methods added on top of the milestones:
+# column statistics, deferred pipelines, cracking, compression, imprints, conjunctive selects,
+# aggregates, grouping, sorting, expressions, sampling and the join algorithms.
+############################################################################
+
+############################################################################
+# Column statistics, computed the way stats.c does so the expected output is exact
+############################################################################
+HISTOGRAM_BUCKETS = 64
+HLL_PRECISION = 11
+HLL_REGISTERS = 1 << HLL_PRECISION
+STATS_SAMPLE_SIZE = 16384
+UINT64_MASK = (1 << 64) - 1
+
+def hllHash(value):
+    h = ((value & 0xffffffff) + 0x9e3779b97f4a7c15) & UINT64_MASK
+    h = ((h ^ (h >> 30)) * 0xbf58476d1ce4e5b9) & UINT64_MASK
+    h = ((h ^ (h >> 27)) * 0x94d049bb133111eb) & UINT64_MASK
+    return h ^ (h >> 31)
+
+class ColumnStats:
+    def __init__(self):
+        self.bounds = []
+        self.counts = []
+        self.hll = [0] * HLL_REGISTERS
+        self.minVal = 0
+        self.maxVal = 0
+        self.rowCount = 0
+        self.builtRows = 0
+        self.modified = 0
+
+    def hllAdd(self, value):
+        h = hllHash(value)
+        reg = h >> (64 - HLL_PRECISION)
+        rest = (h << HLL_PRECISION) & UINT64_MASK
+        rank = 64 - HLL_PRECISION + 1 if rest == 0 else 64 - rest.bit_length() + 1
+        self.hll[reg] = max(self.hll[reg], rank)
+
+    def bucketOf(self, value):
+        lo = 0
+        hi = len(self.bounds)
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if self.bounds[mid] <= value:
+                lo = mid + 1
+            else:
+                hi = mid
+        return lo - 1 if lo > 0 else 0
+
+    def build(self, values):
+        self.__init__()
+        size = len(values)
+        if size == 0:
+            return
+        sampleNum = min(size, STATS_SAMPLE_SIZE)
+        sample = sorted(values[i * size // sampleNum] for i in range(sampleNum))
+        for b in range(HISTOGRAM_BUCKETS):
+            bound = sample[b * sampleNum // HISTOGRAM_BUCKETS]
+            if len(self.bounds) == 0 or bound > self.bounds[-1]:
+                self.bounds.append(bound)
+        self.counts = [0] * len(self.bounds)
+        for v in values:
+            self.counts[self.bucketOf(v)] += 1
+            self.hllAdd(v)
+        self.minVal = min(values)
+        self.maxVal = max(values)
+        self.bounds[0] = self.minVal
+        self.rowCount = size
+        self.builtRows = size
+        self.modified = 0
+
+    def insert(self, value):
+        if self.rowCount == 0:
+            self.minVal = value
+            self.maxVal = value
+        else:
+            self.minVal = min(self.minVal, value)
+            self.maxVal = max(self.maxVal, value)
+        if len(self.bounds) == 0:
+            self.bounds = [value]
+            self.counts = [0]
+        elif value < self.bounds[0]:
+            self.bounds[0] = value
+        self.counts[self.bucketOf(value)] += 1
+        self.hllAdd(value)
+        self.rowCount += 1
+        self.modified += 1
+
+    def remove(self, value):
+        if self.rowCount == 0:
+            return
+        b = self.bucketOf(value)
+        if self.counts[b] > 0:
+            self.counts[b] -= 1
+        self.rowCount -= 1
+        self.modified += 1
+
+    def refresh(self, values):
+        if self.modified > self.builtRows // 2:
+            self.build(values)
+
+    def distinct(self):
+        if self.rowCount == 0:
+            return 0
+        m = float(HLL_REGISTERS)
+        total = 0.0
+        zeros = 0
+        for r in self.hll:
+            total += 1.0 / float(1 << r)
+            zeros += r == 0
+        estimate = 0.7213 / (1 + 1.079 / m) * m * m / total
+        if estimate <= 2.5 * m and zeros > 0:
+            estimate = m * math.log(m / zeros)
+        return min(int(estimate + 0.5), self.rowCount)
+
+    def output(self):
+        if self.rowCount == 0:
+            return 'rows: 0\ndistinct: 0\nhistogram: 0 buckets\n'
+        lines = ['rows: {}'.format(self.rowCount), 'min: {}'.format(self.minVal), 'max: {}'.format(self.maxVal),
+                 'distinct: ~{}'.format(self.distinct()), 'histogram: {} buckets'.format(len(self.bounds))]
+        for b in range(len(self.bounds)):
+            if b + 1 < len(self.bounds):
+                lines.append('[{}, {}): {}'.format(self.bounds[b], self.bounds[b+1], self.counts[b]))
+            else:
+                lines.append('[{}, {}]: {}'.format(self.bounds[b], self.maxVal, self.counts[b]))
+        return '\n'.join(lines) + '\n'
+
+def generateDataStats(dataSize):
+    outputFile = TEST_BASE_DIR + '/data7_stats.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl7_stats', 2)
+    outputTable = pd.DataFrame(np.random.randint(0, 10000, size=(dataSize, 2)), columns =['col1', 'col2'])
+    # a skewed column, a few values hold most of the rows
+    outputTable['col2'] = np.random.zipf(1.5, size = (dataSize)) % 1000
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def createTests51And52(dataTable):
+    output_file51, exp_output_file51 = data_gen_utils.openFileHandles(51, TEST_DIR=TEST_BASE_DIR)
+    output_file52, exp_output_file52 = data_gen_utils.openFileHandles(52, TEST_DIR=TEST_BASE_DIR)
+    output_file51.write('-- Correctness test: Column statistics after a load, inserts and deletes\n')
+    output_file51.write('--\n')
+    output_file51.write('-- Inserts and deletes adjust the statistics, they are rebuilt when they are read\n')
+    output_file51.write('-- once the changed rows exceed half of the rows they were built from.\n')
+    output_file51.write('--\n')
+    output_file51.write('create(tbl,"tbl7_stats",db1,2)\n')
+    output_file51.write('create(col,"col1",db1.tbl7_stats)\n')
+    output_file51.write('create(col,"col2",db1.tbl7_stats)\n')
+    output_file51.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data7_stats.csv\")\n')
+    stats = [ColumnStats(), ColumnStats()]
+    for c in range(2):
+        stats[c].build(list(dataTable['col{}'.format(c+1)]))
+    output_file51.write('--\n')
+    output_file51.write('-- Statistics of the loaded data\n')
+    for c in range(2):
+        output_file51.write('stats(db1.tbl7_stats.col{})\n'.format(c+1))
+        exp_output_file51.write(stats[c].output())
+    output_file51.write('--\n')
+    output_file51.write('-- A few inserts, out of the range of col1, are counted without a rebuild\n')
+    for i in range(20):
+        values = [np.random.randint(-100, 0) if i % 2 == 0 else np.random.randint(10000, 10100), np.random.randint(0, 1000)]
+        output_file51.write('relational_insert(db1.tbl7_stats,{},{})\n'.format(values[0], values[1]))
+        dataTable = dataTable.append({'col1': values[0], 'col2': values[1]}, ignore_index = True)
+        for c in range(2):
+            stats[c].insert(values[c])
+    for c in range(2):
+        output_file51.write('stats(db1.tbl7_stats.col{})\n'.format(c+1))
+        stats[c].refresh(list(dataTable['col{}'.format(c+1)]))
+        exp_output_file51.write(stats[c].output())
+    output_file51.write('--\n')
+    output_file51.write('-- Deleting most of the rows rebuilds the statistics on the next read\n')
+    deleteVal = np.random.randint(6000, 9000)
+    output_file51.write('-- DELETE FROM tbl7_stats WHERE col1 < {};\n'.format(deleteVal))
+    output_file51.write('d1=select(db1.tbl7_stats.col1,null,{})\n'.format(deleteVal))
+    output_file51.write('relational_delete(db1.tbl7_stats,d1)\n')
+    deleted = dataTable[dataTable['col1'] < deleteVal]
+    for c in range(2):
+        for v in deleted['col{}'.format(c+1)]:
+            stats[c].remove(v)
+    dataTable = dataTable[dataTable['col1'] >= deleteVal]
+    for c in range(2):
+        output_file51.write('stats(db1.tbl7_stats.col{})\n'.format(c+1))
+        stats[c].refresh(list(dataTable['col{}'.format(c+1)]))
+        exp_output_file51.write(stats[c].output())
+    output_file51.write('shutdown\n')
+    output_file52.write('-- Correctness test: Column statistics survive a restart\n')
+    output_file52.write('--\n')
+    for c in range(2):
+        output_file52.write('stats(db1.tbl7_stats.col{})\n'.format(c+1))
+        exp_output_file52.write(stats[c].output())
+    data_gen_utils.closeFileHandles(output_file51, exp_output_file51)
+    data_gen_utils.closeFileHandles(output_file52, exp_output_file52)
+    return dataTable
+
+############################################################################
+# Deferred select -> fetch -> aggregate pipelines
+############################################################################
+def generateDataPipeline(dataSize):
+    outputFile = TEST_BASE_DIR + '/data8_pipeline.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl8_pipeline', 3)
+    outputTable = pd.DataFrame(np.random.randint(-5000, 5000, size=(dataSize, 3)), columns =['col1', 'col2', 'col3'])
+    # nearly sorted, so the zone map excludes or includes whole zones of a range
+    outputTable['col1'] = np.arange(dataSize) + np.random.randint(0, 100, size = (dataSize))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    otherFile = TEST_BASE_DIR + '/data8_other.csv'
+    otherTable = pd.DataFrame(np.random.randint(0, 1000, size=(dataSize, 1)), columns =['col1'])
+    otherTable.to_csv(otherFile, sep=',', index=False, header=data_gen_utils.generateHeaderLine('db1', 'tbl8_other', 1), line_terminator='\n')
+    return outputTable, otherTable
+
+def writeDeferredAggregates(dataTable, selectVal1, selectVal2, output_file, exp_output_file):
+    output_file.write('-- SELECT sum(col2), avg(col2), min(col3), max(col3) FROM tbl8_pipeline WHERE col1 >= {} AND col1 < {};\n'.format(selectVal1, selectVal2))
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,{},{})\n'.format(selectVal1, selectVal2))
+    output_file.write('f2=fetch(db1.tbl8_pipeline.col2,s1)\n')
+    output_file.write('f3=fetch(db1.tbl8_pipeline.col3,s1)\n')
+    output_file.write('a1=sum(f2)\n')
+    output_file.write('a2=avg(f2)\n')
+    output_file.write('a3=min(f3)\n')
+    output_file.write('a4=max(f3)\n')
+    output_file.write('print(a1,a2,a3,a4)\n')
+    dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal2)
+    output = dataTable[dfSelectMask]
+    exp_output_file.write('{},{:0.2f},{},{}\n'.format(output['col2'].sum(), output['col2'].mean(), output['col3'].min(), output['col3'].max()))
+
+def createTest53(dataTable, otherTable):
+    dataSize = len(dataTable)
+    output_file, exp_output_file = data_gen_utils.openFileHandles(53, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Aggregates of a fetch at the positions of a select, fused into one pass\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl8_pipeline",db1,3)\n')
+    output_file.write('create(col,"col1",db1.tbl8_pipeline)\n')
+    output_file.write('create(col,"col2",db1.tbl8_pipeline)\n')
+    output_file.write('create(col,"col3",db1.tbl8_pipeline)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data8_pipeline.csv\")\n')
+    output_file.write('create(tbl,"tbl8_other",db1,1)\n')
+    output_file.write('create(col,"col1",db1.tbl8_other)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data8_other.csv\")\n')
+    output_file.write('--\n')
+    # narrow ranges cross a few zones, wide ones hold whole zones
+    for offset in [50, 500, dataSize // 3]:
+        selectVal1 = np.random.randint(0, dataSize - offset)
+        writeDeferredAggregates(dataTable, selectVal1, selectVal1 + offset, output_file, exp_output_file)
+    output_file.write('-- SELECT sum(col2) FROM tbl8_pipeline WHERE col1 < {};\n'.format(dataSize // 2))
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,null,{})\n'.format(dataSize // 2))
+    output_file.write('f1=fetch(db1.tbl8_pipeline.col2,s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    exp_output_file.write('{}\n'.format(dataTable[dataTable['col1'] < dataSize // 2]['col2'].sum()))
+    output_file.write('-- No qualifying row\n')
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,-10,0)\n')
+    output_file.write('f1=fetch(db1.tbl8_pipeline.col2,s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    exp_output_file.write('0\n')
+    output_file.write('--\n')
+    output_file.write('-- A deferred result that is printed is materialized\n')
+    selectVal1 = np.random.randint(0, dataSize - 10)
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,{},{})\n'.format(selectVal1, selectVal1 + 10))
+    output_file.write('f1=fetch(db1.tbl8_pipeline.col2,s1)\n')
+    output_file.write('print(f1)\n')
+    dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 10)
+    exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask]['col2']) + '\n')
+    output_file.write('--\n')
+    output_file.write('-- Positions of one table fetched from another table of the same size are not fused\n')
+    selectVal1 = np.random.randint(0, dataSize // 2)
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,{},{})\n'.format(selectVal1, selectVal1 + dataSize // 4))
+    output_file.write('f1=fetch(db1.tbl8_other.col1,s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + dataSize // 4)
+    exp_output_file.write('{}\n'.format(otherTable[dfSelectMask]['col1'].sum()))
+    output_file.write('--\n')
+    output_file.write('-- A select answers for the data of its statement, an insert after it does not change it\n')
+    selectVal1 = np.random.randint(0, dataSize - 1000)
+    output_file.write('s1=select(db1.tbl8_pipeline.col1,{},{})\n'.format(selectVal1, selectVal1 + 1000))
+    output_file.write('relational_insert(db1.tbl8_pipeline,{},1000000,0)\n'.format(selectVal1))
+    output_file.write('f1=fetch(db1.tbl8_pipeline.col2,s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 1000)
+    exp_output_file.write('{}\n'.format(dataTable[dfSelectMask]['col2'].sum()))
+    dataTable = dataTable.append({'col1': selectVal1, 'col2': 1000000, 'col3': 0}, ignore_index = True)
+    writeDeferredAggregates(dataTable, selectVal1, selectVal1 + 1000, output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+    return dataTable
+
+############################################################################
+# Compressed columns
+############################################################################
+def generateDataCompressed(dataSize):
+    outputFile = TEST_BASE_DIR + '/data10_compressed.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl10_compressed', 4)
+    outputTable = pd.DataFrame(np.random.randint(-100000000, 100000000, size=(dataSize, 4)), columns =['col1', 'col2', 'col3', 'col4'])
+    # a narrow value range far from zero is stored as frame of reference
+    outputTable['col1'] = np.random.randint(1000000, 1004096, size = (dataSize))
+    # long runs of equal values are run length encoded
+    outputTable['col2'] = np.sort(np.random.randint(0, 100, size = (dataSize)))
+    # a few values spread over a wide range get a dictionary
+    dictionary = np.random.randint(-1000000000, 1000000000, size = (16))
+    outputTable['col3'] = dictionary[np.random.randint(0, 16, size = (dataSize))]
+    # col4 stays plain
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def writeCompressedQueries(dataTable, output_file, exp_output_file):
+    output_file.write('-- Aggregates of whole columns\n')
+    for c in range(1, 5):
+        output_file.write('-- SELECT sum(col{0}), avg(col{0}), min(col{0}), max(col{0}) FROM tbl10_compressed;\n'.format(c))
+        output_file.write('a1=sum(db1.tbl10_compressed.col{})\n'.format(c))
+        output_file.write('a2=avg(db1.tbl10_compressed.col{})\n'.format(c))
+        output_file.write('a3=min(db1.tbl10_compressed.col{})\n'.format(c))
+        output_file.write('a4=max(db1.tbl10_compressed.col{})\n'.format(c))
+        output_file.write('print(a1,a2,a3,a4)\n')
+        column = dataTable['col{}'.format(c)]
+        exp_output_file.write('{},{:0.2f},{},{}\n'.format(column.sum(), column.mean(), column.min(), column.max()))
+    output_file.write('--\n')
+    output_file.write('-- Selects on every encoding, fetching from every other one\n')
+    for c in range(1, 4):
+        column = dataTable['col{}'.format(c)]
+        for quantile in [0.1, 0.5]:
+            selectVal1 = int(column.quantile(quantile))
+            selectVal2 = max(int(column.quantile(quantile + 0.2)), selectVal1 + 1)
+            output_file.write('-- SELECT sum(col1), sum(col2), sum(col3), max(col4) FROM tbl10_compressed WHERE col{} >= {} AND col{} < {};\n'.format(c, selectVal1, c, selectVal2))
+            output_file.write('s1=select(db1.tbl10_compressed.col{},{},{})\n'.format(c, selectVal1, selectVal2))
+            for f in range(1, 5):
+                output_file.write('f{}=fetch(db1.tbl10_compressed.col{},s1)\n'.format(f, f))
+            output_file.write('a1=sum(f1)\n')
+            output_file.write('a2=sum(f2)\n')
+            output_file.write('a3=sum(f3)\n')
+            output_file.write('a4=max(f4)\n')
+            output_file.write('print(a1,a2,a3,a4)\n')
+            output = dataTable[(column >= selectVal1) & (column < selectVal2)]
+            exp_output_file.write('{},{},{},{}\n'.format(output['col1'].sum(), output['col2'].sum(), output['col3'].sum(), output['col4'].max()))
+    output_file.write('-- Values of a narrow select, in position order\n')
+    selectVal1 = np.random.randint(1000000, 1004090)
+    output_file.write('s1=select(db1.tbl10_compressed.col1,{},{})\n'.format(selectVal1, selectVal1 + 2))
+    output_file.write('f2=fetch(db1.tbl10_compressed.col2,s1)\n')
+    output_file.write('f3=fetch(db1.tbl10_compressed.col3,s1)\n')
+    output_file.write('print(f2,f3)\n')
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 2)]
+    for row in output.itertuples():
+        exp_output_file.write('{},{}\n'.format(row.col2, row.col3))
+
+def createTests56And57(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(56, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Selects, fetches and aggregates over compressed columns\n')
+    output_file.write('--\n')
+    output_file.write('-- The load encodes col1 with a frame of reference, col2 with run lengths and col3 with a dictionary.\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl10_compressed",db1,4)\n')
+    for c in range(1, 5):
+        output_file.write('create(col,"col{}",db1.tbl10_compressed)\n'.format(c))
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data10_compressed.csv\")\n')
+    output_file.write('--\n')
+    writeCompressedQueries(dataTable, output_file, exp_output_file)
+    output_file.write('shutdown\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+    output_file, exp_output_file = data_gen_utils.openFileHandles(57, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Compressed columns after a restart, then decoded by an insert\n')
+    output_file.write('--\n')
+    writeCompressedQueries(dataTable, output_file, exp_output_file)
+    output_file.write('--\n')
+    values = [1000000, 50, int(dataTable['col3'][0]), 0]
+    output_file.write('relational_insert(db1.tbl10_compressed,{},{},{},{})\n'.format(values[0], values[1], values[2], values[3]))
+    dataTable = dataTable.append(dict(zip(dataTable.columns, values)), ignore_index = True)
+    writeCompressedQueries(dataTable, output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+    return dataTable
+
+############################################################################
+# Cracking and imprints, maintained across inserts, updates, deletes and a restart
+############################################################################
+def generateDataIndexed(dataSize, fileName, tableName):
+    outputFile = TEST_BASE_DIR + '/' + fileName
+    header_line = data_gen_utils.generateHeaderLine('db1', tableName, 3)
+    outputTable = pd.DataFrame(np.random.randint(0, 10000, size=(dataSize, 3)), columns =['col1', 'col2', 'col3'])
+    outputTable['col2'] = np.random.randint(0, 1000, size = (dataSize))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def writeIndexedSelects(dataTable, tableName, numberOfQueries, output_file, exp_output_file):
+    # narrow and wide ranges, answered through the index
+    for i in range(numberOfQueries):
+        offset = [5, 100, 3000][i % 3]
+        selectVal1 = np.random.randint(-10, 10000 - offset)
+        selectVal2 = selectVal1 + offset
+        output_file.write('-- SELECT sum(col1), sum(col3) FROM {} WHERE col1 >= {} AND col1 < {};\n'.format(tableName, selectVal1, selectVal2))
+        output_file.write('s1=select(db1.{}.col1,{},{})\n'.format(tableName, selectVal1, selectVal2))
+        output_file.write('f1=fetch(db1.{}.col1,s1)\n'.format(tableName))
+        output_file.write('f3=fetch(db1.{}.col3,s1)\n'.format(tableName))
+        output_file.write('a1=sum(f1)\n')
+        output_file.write('a3=sum(f3)\n')
+        output_file.write('print(a1,a3)\n')
+        dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal2)
+        output = dataTable[dfSelectMask]
+        exp_output_file.write('{},{}\n'.format(output['col1'].sum(), output['col3'].sum()))
+
+def writeIndexedChanges(dataTable, tableName, output_file):
+    for i in range(20):
+        values = np.random.randint(0, 10000, size=3)
+        output_file.write('relational_insert(db1.{},{},{},{})\n'.format(tableName, values[0], values[1], values[2]))
+        dataTable = dataTable.append({'col1': values[0], 'col2': values[1], 'col3': values[2]}, ignore_index = True)
+    output_file.write('--\n')
+    for i in range(5):
+        col2Val = np.random.randint(0, 1000)
+        newVal = np.random.randint(0, 10000)
+        output_file.write('-- UPDATE {} SET col1 = {} WHERE col2 = {};\n'.format(tableName, newVal, col2Val))
+        output_file.write('u1=select(db1.{}.col2,{},{})\n'.format(tableName, col2Val, col2Val + 1))
+        output_file.write('relational_update(db1.{}.col1,u1,{})\n'.format(tableName, newVal))
+        dataTable.loc[dataTable['col2'] == col2Val, 'col1'] = newVal
+    output_file.write('--\n')
+    # deletes through the index itself, its positions are not in order
+    for i in range(5):
+        deleteVal = np.random.randint(0, 9950)
+        output_file.write('-- DELETE FROM {} WHERE col1 >= {} AND col1 < {};\n'.format(tableName, deleteVal, deleteVal + 50))
+        output_file.write('d1=select(db1.{}.col1,{},{})\n'.format(tableName, deleteVal, deleteVal + 50))
+        output_file.write('relational_delete(db1.{},d1)\n'.format(tableName))
+        dataTable = dataTable[(dataTable['col1'] < deleteVal) | (dataTable['col1'] >= deleteVal + 50)]
+    output_file.write('--\n')
+    return dataTable
+
+def createIndexMaintenanceTests(dataTable, tableName, dataFile, idxType, testNum):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(testNum, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: A {} index answers selects before and after inserts, updates and deletes\n'.format(idxType))
+    output_file.write('--\n')
+    output_file.write('create(tbl,"{}",db1,3)\n'.format(tableName))
+    output_file.write('create(col,"col1",db1.{})\n'.format(tableName))
+    output_file.write('create(col,"col2",db1.{})\n'.format(tableName))
+    output_file.write('create(col,"col3",db1.{})\n'.format(tableName))
+    output_file.write('create(idx,db1.{}.col1,{},unclustered)\n'.format(tableName, idxType))
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/'+dataFile+'\")\n')
+    output_file.write('--\n')
+    writeIndexedSelects(dataTable, tableName, 12, output_file, exp_output_file)
+    output_file.write('--\n')
+    dataTable = writeIndexedChanges(dataTable, tableName, output_file)
+    writeIndexedSelects(dataTable, tableName, 12, output_file, exp_output_file)
+    output_file.write('shutdown\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+    output_file, exp_output_file = data_gen_utils.openFileHandles(testNum + 1, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: A {} index answers selects after a restart, before and after more changes\n'.format(idxType))
+    output_file.write('--\n')
+    writeIndexedSelects(dataTable, tableName, 6, output_file, exp_output_file)
+    output_file.write('--\n')
+    dataTable = writeIndexedChanges(dataTable, tableName, output_file)
+    writeIndexedSelects(dataTable, tableName, 6, output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+    return dataTable
+
+############################################################################
+# Conjunctive selects
+############################################################################
+def generateDataConjunction(dataSize):
+    outputFile = TEST_BASE_DIR + '/data12_conjunction.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl12_conjunction', 4)
+    outputTable = pd.DataFrame(np.random.randint(0, 1000, size=(dataSize, 4)), columns =['col1', 'col2', 'col3', 'col4'])
+    # correlated with col1
+    outputTable['col2'] = outputTable['col1'] + np.random.randint(0, 100, size = (dataSize))
+    outputTable['col4'] = np.random.randint(-10000, 10000, size = (dataSize))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def createTest60(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(60, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Selects with a conjunction of range predicates over columns of one table\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl12_conjunction",db1,4)\n')
+    for c in range(1, 5):
+        output_file.write('create(col,"col{}",db1.tbl12_conjunction)\n'.format(c))
+    output_file.write('create(idx,db1.tbl12_conjunction.col3,btree,unclustered)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data12_conjunction.csv\")\n')
+    output_file.write('--\n')
+    for predicateNum in [2, 2, 3, 3, 4]:
+        for width in [50, 500]:
+            columns = np.random.choice([1, 2, 3, 4], predicateNum, replace=False)
+            args = []
+            conditions = []
+            dfSelectMask = np.ones(len(dataTable), dtype=bool)
+            for c in columns:
+                column = dataTable['col{}'.format(c)]
+                low = np.random.randint(column.min(), column.max() - width)
+                high = low + width
+                # an open bound now and then
+                if np.random.randint(0, 4) == 0:
+                    args.append('db1.tbl12_conjunction.col{},null,{}'.format(c, high))
+                    conditions.append('col{} < {}'.format(c, high))
+                    dfSelectMask &= column < high
+                else:
+                    args.append('db1.tbl12_conjunction.col{},{},{}'.format(c, low, high))
+                    conditions.append('col{} >= {} AND col{} < {}'.format(c, low, c, high))
+                    dfSelectMask &= (column >= low) & (column < high)
+            output_file.write('-- SELECT sum(col4), sum(col1) FROM tbl12_conjunction WHERE {};\n'.format(' AND '.join(conditions)))
+            output_file.write('s1=select({})\n'.format(','.join(args)))
+            output_file.write('f4=fetch(db1.tbl12_conjunction.col4,s1)\n')
+            output_file.write('f1=fetch(db1.tbl12_conjunction.col1,s1)\n')
+            output_file.write('a4=sum(f4)\n')
+            output_file.write('a1=sum(f1)\n')
+            output_file.write('print(a4,a1)\n')
+            output = dataTable[dfSelectMask]
+            exp_output_file.write('{},{}\n'.format(output['col4'].sum(), output['col1'].sum()))
+    output_file.write('--\n')
+    output_file.write('-- Qualifying values in position order\n')
+    selectVal1 = np.random.randint(0, 900)
+    output_file.write('s1=select(db1.tbl12_conjunction.col1,{},{},db1.tbl12_conjunction.col3,0,20)\n'.format(selectVal1, selectVal1 + 100))
+    output_file.write('f4=fetch(db1.tbl12_conjunction.col4,s1)\n')
+    output_file.write('print(f4)\n')
+    dfSelectMask = (dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 100) & (dataTable['col3'] < 20)
+    exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask]['col4']) + '\n')
+    output_file.write('--\n')
+    output_file.write('-- Columns of different tables are rejected, s1 keeps its value\n')
+    output_file.write('s1=select(db1.tbl12_conjunction.col1,0,500,db1.tbl8_other.col1,0,500)\n')
+    output_file.write('f4=fetch(db1.tbl12_conjunction.col4,s1)\n')
+    output_file.write('print(f4)\n')
+    exp_output_file.write(data_gen_utils.outputPrint(dataTable[dfSelectMask]['col4']) + '\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+############################################################################
+# Position ranges of clustered selects and slices of the fetched columns
+############################################################################
+def generateDataClustered(dataSize):
+    outputFile = TEST_BASE_DIR + '/data13_clustered.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl13_clustered', 3)
+    outputTable = pd.DataFrame(np.random.randint(-1000000000, 1000000000, size=(dataSize, 3)), columns =['col1', 'col2', 'col3'])
+    # distinct keys, so the clustered order is known
+    outputTable['col1'] = np.random.permutation(dataSize) * 3
+    # col2 has too wide a range to be compressed, its fetches are slices of the column, col3 is compressed
+    outputTable['col3'] = np.random.randint(0, 100, size = (dataSize))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable.sort_values('col1').reset_index(drop=True)
+
+def writeRangeAggregates(dataTable, selectVal1, selectVal2, output_file, exp_output_file):
+    output_file.write('-- SELECT sum(col2), avg(col2), min(col2), max(col2), sum(col3) FROM tbl13_clustered WHERE col1 >= {} AND col1 < {};\n'.format(selectVal1, selectVal2))
+    output_file.write('s1=select(db1.tbl13_clustered.col1,{},{})\n'.format(selectVal1, selectVal2))
+    output_file.write('f2=fetch(db1.tbl13_clustered.col2,s1)\n')
+    output_file.write('f3=fetch(db1.tbl13_clustered.col3,s1)\n')
+    output_file.write('a1=sum(f2)\n')
+    output_file.write('a2=avg(f2)\n')
+    output_file.write('a3=min(f2)\n')
+    output_file.write('a4=max(f2)\n')
+    output_file.write('a5=sum(f3)\n')
+    output_file.write('print(a1,a2,a3,a4,a5)\n')
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal2)]
+    exp_output_file.write('{},{:0.2f},{},{},{}\n'.format(output['col2'].sum(), output['col2'].mean(), output['col2'].min(), output['col2'].max(), output['col3'].sum()))
+
+def createTest61(dataTable):
+    dataSize = len(dataTable)
+    keyRange = dataSize * 3
+    output_file, exp_output_file = data_gen_utils.openFileHandles(61, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Selects through a clustered index return position ranges,\n')
+    output_file.write('-- fetches of a plain column at them are slices of the column\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl13_clustered",db1,3)\n')
+    output_file.write('create(col,"col1",db1.tbl13_clustered)\n')
+    output_file.write('create(col,"col2",db1.tbl13_clustered)\n')
+    output_file.write('create(col,"col3",db1.tbl13_clustered)\n')
+    output_file.write('create(idx,db1.tbl13_clustered.col1,sorted,clustered)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data13_clustered.csv\")\n')
+    output_file.write('--\n')
+    for offset in [30, 3000, keyRange // 2]:
+        selectVal1 = np.random.randint(0, keyRange - offset)
+        writeRangeAggregates(dataTable, selectVal1, selectVal1 + offset, output_file, exp_output_file)
+    output_file.write('-- A slice in position order\n')
+    selectVal1 = np.random.randint(0, keyRange - 30)
+    output_file.write('s1=select(db1.tbl13_clustered.col1,{},{})\n'.format(selectVal1, selectVal1 + 30))
+    output_file.write('f2=fetch(db1.tbl13_clustered.col2,s1)\n')
+    output_file.write('f3=fetch(db1.tbl13_clustered.col3,s1)\n')
+    output_file.write('print(f2,f3)\n')
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 30)]
+    for row in output.itertuples():
+        exp_output_file.write('{},{}\n'.format(row.col2, row.col3))
+    output_file.write('-- A select on a slice\n')
+    selectVal1 = np.random.randint(0, keyRange // 2)
+    output_file.write('s1=select(db1.tbl13_clustered.col1,{},{})\n'.format(selectVal1, selectVal1 + keyRange // 2))
+    output_file.write('f2=fetch(db1.tbl13_clustered.col2,s1)\n')
+    output_file.write('s2=select(s1,f2,0,null)\n')
+    output_file.write('f3=fetch(db1.tbl13_clustered.col3,s2)\n')
+    output_file.write('a1=sum(f3)\n')
+    output_file.write('print(a1)\n')
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + keyRange // 2) & (dataTable['col2'] >= 0)]
+    exp_output_file.write('{}\n'.format(output['col3'].sum()))
+    output_file.write('-- No qualifying row\n')
+    output_file.write('s1=select(db1.tbl13_clustered.col1,{},{})\n'.format(keyRange, keyRange + 100))
+    output_file.write('f2=fetch(db1.tbl13_clustered.col2,s1)\n')
+    output_file.write('a1=sum(f2)\n')
+    output_file.write('print(a1)\n')
+    exp_output_file.write('0\n')
+    output_file.write('--\n')
+    output_file.write('-- A slice keeps the values of its statement when the column changes after it\n')
+    selectVal1 = np.random.randint(0, keyRange - 3000)
+    output_file.write('s1=select(db1.tbl13_clustered.col1,{},{})\n'.format(selectVal1, selectVal1 + 3000))
+    output_file.write('f2=fetch(db1.tbl13_clustered.col2,s1)\n')
+    output_file.write('relational_insert(db1.tbl13_clustered,{},1000000000,1)\n'.format(selectVal1 + 1))
+    output_file.write('a1=sum(f2)\n')
+    output_file.write('print(a1)\n')
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 3000)]
+    exp_output_file.write('{}\n'.format(output['col2'].sum()))
+    dataTable = dataTable.append({'col1': selectVal1 + 1, 'col2': 1000000000, 'col3': 1}, ignore_index = True)
+    dataTable = dataTable.sort_values('col1', kind='mergesort').reset_index(drop=True)
+    writeRangeAggregates(dataTable, selectVal1, selectVal1 + 3000, output_file, exp_output_file)
+    output_file.write('--\n')
+    output_file.write('-- Updates and deletes at position ranges\n')
+    selectVal1 = np.random.randint(0, keyRange - 300)
+    output_file.write('-- UPDATE tbl13_clustered SET col3 = 1000 WHERE col1 >= {} AND col1 < {};\n'.format(selectVal1, selectVal1 + 300))
+    output_file.write('u1=select(db1.tbl13_clustered.col1,{},{})\n'.format(selectVal1, selectVal1 + 300))
+    output_file.write('relational_update(db1.tbl13_clustered.col3,u1,1000)\n')
+    dataTable.loc[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 300), 'col3'] = 1000
+    deleteVal = np.random.randint(0, keyRange - 3000)
+    output_file.write('-- DELETE FROM tbl13_clustered WHERE col1 >= {} AND col1 < {};\n'.format(deleteVal, deleteVal + 3000))
+    output_file.write('d1=select(db1.tbl13_clustered.col1,{},{})\n'.format(deleteVal, deleteVal + 3000))
+    output_file.write('relational_delete(db1.tbl13_clustered,d1)\n')
+    dataTable = dataTable[(dataTable['col1'] < deleteVal) | (dataTable['col1'] >= deleteVal + 3000)]
+    for offset in [3000, keyRange // 2]:
+        selectVal1 = np.random.randint(0, keyRange - offset)
+        writeRangeAggregates(dataTable, selectVal1, selectVal1 + offset, output_file, exp_output_file)
+    writeRangeAggregates(dataTable, 0, keyRange, output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+############################################################################
+# aggregates(), group_agg, sort, topk and expr over one table
+############################################################################
+def generateDataOperators(dataSize):
+    outputFile = TEST_BASE_DIR + '/data14_operators.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl14_operators', 4)
+    outputTable = pd.DataFrame(np.random.randint(-1000, 1000, size=(dataSize, 4)), columns =['col1', 'col2', 'col3', 'col4'])
+    # group keys, a few of them much more frequent than the others
+    outputTable['col1'] = np.random.zipf(1.3, size = (dataSize)) % 100
+    # never zero, it divides
+    outputTable['col3'] = np.random.randint(1, 1000, size = (dataSize))
+    outputTable['col4'] = np.random.randint(-1000000, 1000000, size = (dataSize))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def createTest62(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(62, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Several aggregates of a vector computed in one pass with aggregates()\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl14_operators",db1,4)\n')
+    for c in range(1, 5):
+        output_file.write('create(col,"col{}",db1.tbl14_operators)\n'.format(c))
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data14_operators.csv\")\n')
+    output_file.write('--\n')
+    for c in range(1, 5):
+        output_file.write('-- SELECT count(*), sum(col{0}), min(col{0}), max(col{0}), avg(col{0}), var_pop(col{0}) FROM tbl14_operators;\n'.format(c))
+        output_file.write('c1,s1,m1,x1,a1,v1=aggregates(db1.tbl14_operators.col{},count,sum,min,max,avg,var)\n'.format(c))
+        output_file.write('print(c1,s1,m1,x1,a1,v1)\n')
+        column = dataTable['col{}'.format(c)]
+        exp_output_file.write('{},{},{},{},{:0.2f},{:0.2f}\n'.format(len(column), column.sum(), column.min(), column.max(), column.mean(), column.var(ddof=0)))
+    for width in [10, 500]:
+        selectVal1 = np.random.randint(-1000, 1000 - width)
+        output_file.write('-- SELECT max(col4), count(*), avg(col4), min(col4) FROM tbl14_operators WHERE col2 >= {} AND col2 < {};\n'.format(selectVal1, selectVal1 + width))
+        output_file.write('s1=select(db1.tbl14_operators.col2,{},{})\n'.format(selectVal1, selectVal1 + width))
+        output_file.write('f1=fetch(db1.tbl14_operators.col4,s1)\n')
+        output_file.write('x1,c1,a1,m1=aggregates(f1,max,count,avg,min)\n')
+        output_file.write('print(x1,c1,a1,m1)\n')
+        column = dataTable[(dataTable['col2'] >= selectVal1) & (dataTable['col2'] < selectVal1 + width)]['col4']
+        exp_output_file.write('{},{},{:0.2f},{}\n'.format(column.max(), len(column), column.mean(), column.min()))
+    output_file.write('-- Aggregates of a vector of longs\n')
+    output_file.write('d1=add(db1.tbl14_operators.col4,db1.tbl14_operators.col4)\n')
+    output_file.write('s1,a1,v1=aggregates(d1,sum,avg,var)\n')
+    output_file.write('print(s1,a1,v1)\n')
+    column = dataTable['col4'] * 2
+    exp_output_file.write('{},{:0.2f},{:0.2f}\n'.format(column.sum(), column.mean(), column.var(ddof=0)))
+    output_file.write('-- No qualifying row: the count and the sum are 0\n')
+    output_file.write('s1=select(db1.tbl14_operators.col2,5000,6000)\n')
+    output_file.write('f1=fetch(db1.tbl14_operators.col4,s1)\n')
+    output_file.write('c1,s2=aggregates(f1,count,sum)\n')
+    output_file.write('print(c1,s2)\n')
+    exp_output_file.write('0,0\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def createTest63(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(63, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Grouped aggregation with group_agg, groups in ascending key order\n')
+    output_file.write('--\n')
+    groups = dataTable.groupby('col1')['col2']
+    for agg, expected in [('count', groups.count()), ('sum', groups.sum()), ('min', groups.min()), ('max', groups.max())]:
+        output_file.write('-- SELECT col1, {}(col2) FROM tbl14_operators GROUP BY col1 ORDER BY col1;\n'.format(agg))
+        output_file.write('k1,g1=group_agg(db1.tbl14_operators.col1,db1.tbl14_operators.col2,{})\n'.format(agg))
+        output_file.write('print(k1,g1)\n')
+        for key, value in expected.items():
+            exp_output_file.write('{},{}\n'.format(key, value))
+    output_file.write('-- SELECT col1, avg(col3) FROM tbl14_operators GROUP BY col1 ORDER BY col1;\n')
+    output_file.write('k1,g1=group_agg(db1.tbl14_operators.col1,db1.tbl14_operators.col3,avg)\n')
+    output_file.write('print(k1,g1)\n')
+    for key, value in dataTable.groupby('col1')['col3'].mean().items():
+        exp_output_file.write('{},{:0.2f}\n'.format(key, value))
+    output_file.write('--\n')
+    output_file.write('-- Groups of the rows of a select\n')
+    selectVal1 = np.random.randint(-1000, 500)
+    output_file.write('-- SELECT col1, sum(col4) FROM tbl14_operators WHERE col2 >= {} AND col2 < {} GROUP BY col1 ORDER BY col1;\n'.format(selectVal1, selectVal1 + 500))
+    output_file.write('s1=select(db1.tbl14_operators.col2,{},{})\n'.format(selectVal1, selectVal1 + 500))
+    output_file.write('f1=fetch(db1.tbl14_operators.col1,s1)\n')
+    output_file.write('f4=fetch(db1.tbl14_operators.col4,s1)\n')
+    output_file.write('k1,g1=group_agg(f1,f4,sum)\n')
+    output_file.write('print(k1,g1)\n')
+    output = dataTable[(dataTable['col2'] >= selectVal1) & (dataTable['col2'] < selectVal1 + 500)]
+    for key, value in output.groupby('col1')['col4'].sum().items():
+        exp_output_file.write('{},{}\n'.format(key, value))
+    output_file.write('--\n')
+    output_file.write('-- Too many groups for a hash table: the sort based grouping, checked through aggregates of its output\n')
+    output_file.write('-- SELECT count(*), sum(col4), min(col4), max(col4), sum(c), max(c) FROM (SELECT col4, count(*) AS c FROM tbl14_operators GROUP BY col4);\n')
+    output_file.write('k1,g1=group_agg(db1.tbl14_operators.col4,db1.tbl14_operators.col2,count)\n')
+    output_file.write('c1,s1,m1,x1=aggregates(k1,count,sum,min,max)\n')
+    output_file.write('s2,x2=aggregates(g1,sum,max)\n')
+    output_file.write('print(c1,s1,m1,x1,s2,x2)\n')
+    counts = dataTable.groupby('col4')['col2'].count()
+    exp_output_file.write('{},{},{},{},{},{}\n'.format(len(counts), counts.index.values.sum(), counts.index.min(), counts.index.max(), counts.sum(), counts.max()))
+    output_file.write('-- The same groups in key order\n')
+    output_file.write('s1=select(db1.tbl14_operators.col4,0,20000)\n')
+    output_file.write('f4=fetch(db1.tbl14_operators.col4,s1)\n')
+    output_file.write('f2=fetch(db1.tbl14_operators.col2,s1)\n')
+    output_file.write('k1,g1=group_agg(f4,f2,max)\n')
+    output_file.write('print(k1,g1)\n')
+    output = dataTable[(dataTable['col4'] >= 0) & (dataTable['col4'] < 20000)]
+    for key, value in output.groupby('col4')['col2'].max().items():
+        exp_output_file.write('{},{}\n'.format(key, value))
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def writeSortedRows(output, exp_output_file):
+    for row in output.itertuples():
+        exp_output_file.write('{},{},{}\n'.format(row.col4, row.Index, row.col1))
+
+def createTest64(dataTable):
+    dataSize = len(dataTable)
+    output_file, exp_output_file = data_gen_utils.openFileHandles(64, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: sort and topk return values in order with their positions,\n')
+    output_file.write('-- equal values in position order\n')
+    output_file.write('--\n')
+    selectVal1 = np.random.randint(-1000, 900)
+    output = dataTable[(dataTable['col2'] >= selectVal1) & (dataTable['col2'] < selectVal1 + 100)]
+    output_file.write('-- SELECT col4, rowid, col1 FROM tbl14_operators WHERE col2 >= {} AND col2 < {} ORDER BY col4;\n'.format(selectVal1, selectVal1 + 100))
+    output_file.write('s1=select(db1.tbl14_operators.col2,{},{})\n'.format(selectVal1, selectVal1 + 100))
+    output_file.write('f4=fetch(db1.tbl14_operators.col4,s1)\n')
+    output_file.write('v1,p1=sort(s1,f4)\n')
+    output_file.write('f1=fetch(db1.tbl14_operators.col1,p1)\n')
+    output_file.write('print(v1,p1,f1)\n')
+    writeSortedRows(output.sort_values('col4', kind='mergesort'), exp_output_file)
+    output_file.write('-- Many equal values: ORDER BY col3, then position\n')
+    output_file.write('f3=fetch(db1.tbl14_operators.col3,s1)\n')
+    output_file.write('v3,p3=sort(s1,f3)\n')
+    output_file.write('print(v3,p3)\n')
+    for row in output.sort_values('col3', kind='mergesort').itertuples():
+        exp_output_file.write('{},{}\n'.format(row.col3, row.Index))
+    output_file.write('-- A whole column, checked through its smallest and largest values\n')
+    output_file.write('v1,p1=sort(db1.tbl14_operators.col4)\n')
+    output_file.write('c1,m1,x1=aggregates(v1,count,min,max)\n')
+    output_file.write('t1,q1=topk(v1,3)\n')
+    output_file.write('print(c1,m1,x1)\n')
+    output_file.write('print(t1,q1)\n')
+    sortedValues = dataTable['col4'].sort_values(kind='mergesort')
+    exp_output_file.write('{},{},{}\n'.format(dataSize, sortedValues.iloc[0], sortedValues.iloc[-1]))
+    for i in range(3):
+        exp_output_file.write('{},{}\n'.format(sortedValues.iloc[dataSize - 1 - i], dataSize - 1 - i))
+    output_file.write('--\n')
+    for k in [1, 10, 3000]:
+        output_file.write('-- SELECT col4, rowid, col1 FROM tbl14_operators ORDER BY col4 DESC LIMIT {};\n'.format(k))
+        output_file.write('t1,q1=topk(db1.tbl14_operators.col4,{})\n'.format(k))
+        output_file.write('f1=fetch(db1.tbl14_operators.col1,q1)\n')
+        output_file.write('print(t1,q1,f1)\n')
+        # descending, equal values by ascending position
+        writeSortedRows(dataTable.iloc[::-1].sort_values('col4', kind='mergesort').iloc[::-1].head(k), exp_output_file)
+    output_file.write('-- Largest values of a select, positions taken from the select\n')
+    output_file.write('t1,q1=topk(s1,f4,5)\n')
+    output_file.write('f1=fetch(db1.tbl14_operators.col1,q1)\n')
+    output_file.write('print(t1,q1,f1)\n')
+    writeSortedRows(output.iloc[::-1].sort_values('col4', kind='mergesort').iloc[::-1].head(5), exp_output_file)
+    output_file.write('-- k larger than the vector returns all of it\n')
+    selectVal1 = np.random.randint(0, 900000)
+    output = dataTable[(dataTable['col4'] >= selectVal1) & (dataTable['col4'] < selectVal1 + 200)]
+    output_file.write('s2=select(db1.tbl14_operators.col4,{},{})\n'.format(selectVal1, selectVal1 + 200))
+    output_file.write('f2=fetch(db1.tbl14_operators.col4,s2)\n')
+    output_file.write('t1,q1=topk(s2,f2,{})\n'.format(dataSize))
+    output_file.write('f1=fetch(db1.tbl14_operators.col1,q1)\n')
+    output_file.write('print(t1,q1,f1)\n')
+    writeSortedRows(output.iloc[::-1].sort_values('col4', kind='mergesort').iloc[::-1], exp_output_file)
+    output_file.write('-- k = 0 returns nothing\n')
+    output_file.write('t1,q1=topk(db1.tbl14_operators.col4,0)\n')
+    output_file.write('c1=aggregates(t1,count)\n')
+    output_file.write('print(c1)\n')
+    exp_output_file.write('0\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def createTest65(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(65, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Arithmetic expressions over vectors with expr()\n')
+    output_file.write('--\n')
+    output_file.write('-- Without a division or a decimal constant the result is a vector of longs, else of doubles\n')
+    output_file.write('--\n')
+    selectVal1 = np.random.randint(-1000, 950)
+    output = dataTable[(dataTable['col2'] >= selectVal1) & (dataTable['col2'] < selectVal1 + 50)]
+    f2 = output['col2'].values.astype(np.int64)
+    f3 = output['col3'].values.astype(np.int64)
+    f4 = output['col4'].values.astype(np.int64)
+    output_file.write('s1=select(db1.tbl14_operators.col2,{},{})\n'.format(selectVal1, selectVal1 + 50))
+    output_file.write('f2=fetch(db1.tbl14_operators.col2,s1)\n')
+    output_file.write('f3=fetch(db1.tbl14_operators.col3,s1)\n')
+    output_file.write('f4=fetch(db1.tbl14_operators.col4,s1)\n')
+    expressions = [
+        ('f2+f4*3-7', f2 + f4 * 3 - 7, False),
+        ('((f2+f4)*(f3-(2-f2)))-(-f4)', ((f2 + f4) * (f3 - (2 - f2))) - (0 - f4), False),
+        ('-(f3-f2)*(1+2)', (0 - (f3 - f2)) * 3, False),
+        ('(f2+f4)/f3', (f2.astype(float) + f4) / f3, True),
+        ('f4/(f3*2)+f2/3', f4 / (f3 * 2.0) + f2 / 3.0, True),
+        ('(f3-(f2/(f3+1)))*2', (f3 - (f2 / (f3 + 1.0))) * 2.0, True),
+        ('f3*2.5+1', f3 * 2.5 + 1.0, True),
+    ]
+    for expression, values, isFloat in expressions:
+        output_file.write('e1=expr({})\n'.format(expression))
+        output_file.write('print(e1)\n')
+        for v in values:
+            exp_output_file.write(('{:0.2f}\n' if isFloat else '{}\n').format(v))
+    output_file.write('--\n')
+    output_file.write('-- Whole columns, checked through their aggregates\n')
+    output_file.write('e1=expr(db1.tbl14_operators.col4*db1.tbl14_operators.col3-db1.tbl14_operators.col2)\n')
+    output_file.write('c1,s2,m1,x1=aggregates(e1,count,sum,min,max)\n')
+    output_file.write('print(c1,s2,m1,x1)\n')
+    values = dataTable['col4'].values.astype(np.int64) * dataTable['col3'].values - dataTable['col2'].values
+    exp_output_file.write('{},{},{},{}\n'.format(len(values), values.sum(), values.min(), values.max()))
+    output_file.write('e1=expr(db1.tbl14_operators.col4/db1.tbl14_operators.col3)\n')
+    output_file.write('c1,m1,x1=aggregates(e1,count,min,max)\n')
+    output_file.write('print(c1,m1,x1)\n')
+    values = dataTable['col4'].values.astype(float) / dataTable['col3'].values
+    exp_output_file.write('{},{:0.2f},{:0.2f}\n'.format(len(values), values.min(), values.max()))
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+############################################################################
+# Approximate aggregates over the sample of a table
+############################################################################
+# smaller than the sample (TABLE_SAMPLE_SIZE in sample.h), so the whole table is sampled
+SMALL_TABLE_SIZE = 5000
+
+def generateDataSampled():
+    outputFile = TEST_BASE_DIR + '/data15_sampled.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl15_sampled', 2)
+    outputTable = pd.DataFrame(np.random.randint(-1000, 1000, size=(SMALL_TABLE_SIZE, 2)), columns =['col1', 'col2'])
+    outputTable['col1'] = np.random.randint(0, 100, size = (SMALL_TABLE_SIZE))
+    outputTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return outputTable
+
+def writeExactApproximates(dataTable, output_file, exp_output_file):
+    selectVal1 = np.random.randint(0, 50)
+    output = dataTable[(dataTable['col1'] >= selectVal1) & (dataTable['col1'] < selectVal1 + 50)]
+    queries = [
+        ('approx_count(db1.tbl15_sampled.col1)', 'count(*)', '', len(dataTable)),
+        ('approx_sum(db1.tbl15_sampled.col2)', 'sum(col2)', '', dataTable['col2'].sum()),
+        ('approx_avg(db1.tbl15_sampled.col2)', 'avg(col2)', '', dataTable['col2'].mean()),
+        ('approx_count(db1.tbl15_sampled.col1,{},{})'.format(selectVal1, selectVal1 + 50), 'count(*)', ' WHERE col1 >= {} AND col1 < {}'.format(selectVal1, selectVal1 + 50), len(output)),
+        ('approx_sum(db1.tbl15_sampled.col2,db1.tbl15_sampled.col1,{},{})'.format(selectVal1, selectVal1 + 50), 'sum(col2)', ' WHERE col1 >= {} AND col1 < {}'.format(selectVal1, selectVal1 + 50), output['col2'].sum()),
+        ('approx_avg(db1.tbl15_sampled.col2,db1.tbl15_sampled.col1,{},null)'.format(selectVal1), 'avg(col2)', ' WHERE col1 >= {}'.format(selectVal1), dataTable[dataTable['col1'] >= selectVal1]['col2'].mean()),
+    ]
+    for query, aggregate, condition, expected in queries:
+        output_file.write('-- SELECT {} FROM tbl15_sampled{};\n'.format(aggregate, condition))
+        output_file.write('e1,l1,h1={}\n'.format(query))
+        output_file.write('print(e1,l1,h1)\n')
+        exp_output_file.write('{0:0.2f},{0:0.2f},{0:0.2f}\n'.format(float(expected)))
+
+def createTest66(dataTable, smallTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(66, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Approximate count, sum and avg from the sample of a table\n')
+    output_file.write('--\n')
+    output_file.write('-- A table smaller than the sample is sampled whole: the estimates are exact, their intervals empty\n')
+    output_file.write('create(tbl,"tbl15_sampled",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl15_sampled)\n')
+    output_file.write('create(col,"col2",db1.tbl15_sampled)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data15_sampled.csv\")\n')
+    writeExactApproximates(smallTable, output_file, exp_output_file)
+    output_file.write('-- and stay exact after inserts and deletes\n')
+    for i in range(10):
+        values = [np.random.randint(0, 100), np.random.randint(-1000, 1000)]
+        output_file.write('relational_insert(db1.tbl15_sampled,{},{})\n'.format(values[0], values[1]))
+        smallTable = smallTable.append({'col1': values[0], 'col2': values[1]}, ignore_index = True)
+    deleteVal = np.random.randint(0, 90)
+    output_file.write('d1=select(db1.tbl15_sampled.col1,{},{})\n'.format(deleteVal, deleteVal + 10))
+    output_file.write('relational_delete(db1.tbl15_sampled,d1)\n')
+    smallTable = smallTable[(smallTable['col1'] < deleteVal) | (smallTable['col1'] >= deleteVal + 10)]
+    writeExactApproximates(smallTable, output_file, exp_output_file)
+    output_file.write('-- An average over no qualifying row is empty\n')
+    output_file.write('e1=approx_avg(db1.tbl15_sampled.col2,db1.tbl15_sampled.col1,1000,2000)\n')
+    output_file.write('print(e1)\n')
+    output_file.write('--\n')
+    output_file.write('-- A larger table is estimated from a sample: the ratio of the estimate to the exact answer\n')
+    output_file.write('-- is printed divided by 20, which prints 0.05 for any ratio within about 10% of 1\n')
+    selectVal1 = np.random.randint(-1000, 0)
+    output = dataTable[(dataTable['col2'] >= selectVal1) & (dataTable['col2'] < selectVal1 + 1000)]
+    queries = [
+        ('approx_count(db1.tbl14_operators.col2,{},{})'.format(selectVal1, selectVal1 + 1000), 'count(*)', ' WHERE col2 >= {} AND col2 < {}'.format(selectVal1, selectVal1 + 1000), len(output)),
+        ('approx_sum(db1.tbl14_operators.col3)', 'sum(col3)', '', dataTable['col3'].sum()),
+        ('approx_sum(db1.tbl14_operators.col3,db1.tbl14_operators.col2,{},{})'.format(selectVal1, selectVal1 + 1000), 'sum(col3)', ' WHERE col2 >= {} AND col2 < {}'.format(selectVal1, selectVal1 + 1000), output['col3'].sum()),
+        ('approx_avg(db1.tbl14_operators.col3,db1.tbl14_operators.col2,{},{})'.format(selectVal1, selectVal1 + 1000), 'avg(col3)', ' WHERE col2 >= {} AND col2 < {}'.format(selectVal1, selectVal1 + 1000), output['col3'].mean()),
+    ]
+    for query, aggregate, condition, expected in queries:
+        output_file.write('-- SELECT {} FROM tbl14_operators{};\n'.format(aggregate, condition))
+        output_file.write('e1,l1,h1={}\n'.format(query))
+        output_file.write('r1=expr(e1/{:0.4f})\n'.format(float(expected) * 20))
+        output_file.write('print(r1)\n')
+        exp_output_file.write('0.05\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+############################################################################
+# Radix, parallel hash and grace joins, checked against the nested loop join
+############################################################################
+JOIN_DIM_SIZE = 20000
+# the server of test_milestone.sh runs with JOIN_MEMORY_BUDGET=131072: a grace join spills build sides
+# of more than 4096 tuples (JOIN_BUILD_TUPLE_BYTES=32 each), which every join of test 69 but the empty one has
+JOIN_MEMORY_BUDGET = 131072
+
+def generateDataJoin(dataSize):
+    outputFile = TEST_BASE_DIR + '/data16_fact.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl16_fact', 3)
+    factTable = pd.DataFrame(np.random.randint(0, 1000, size=(dataSize, 3)), columns =['col1', 'col2', 'col3'])
+    # skewed keys, many to many with tbl16_dim.col2
+    factTable['col1'] = np.random.zipf(1.3, size = (dataSize)) % 1000
+    # foreign keys of tbl16_dim.col1, negative ones included and some without a match
+    factTable['col2'] = np.random.randint(-JOIN_DIM_SIZE // 2 - 100, JOIN_DIM_SIZE // 2 + 100, size = (dataSize))
+    factTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    outputFile = TEST_BASE_DIR + '/data16_dim.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl16_dim', 3)
+    dimTable = pd.DataFrame(np.random.randint(0, 1000, size=(JOIN_DIM_SIZE, 3)), columns =['col1', 'col2', 'col3'])
+    dimTable['col1'] = np.random.permutation(np.arange(-JOIN_DIM_SIZE // 2, JOIN_DIM_SIZE // 2))
+    dimTable['col2'] = np.random.zipf(1.3, size = (JOIN_DIM_SIZE)) % 1000
+    dimTable.to_csv(outputFile, sep=',', index=False, header=header_line, line_terminator='\n')
+    return factTable, dimTable
+
+def writeJoin(factTable, dimTable, factCol, dimCol, factMax, dimMax, joinTypes, output_file, exp_output_file):
+    # tbl16_fact.col3 < factMax and tbl16_dim.col3 < dimMax, null for the whole table
+    output_file.write('-- SELECT count(*), sum(tbl16_fact.col3), sum(tbl16_fact.col3*tbl16_dim.col3) FROM tbl16_fact,tbl16_dim WHERE tbl16_fact.{}=tbl16_dim.{}'.format(factCol, dimCol))
+    output_file.write(' AND tbl16_fact.col3 < {}'.format(factMax) if factMax is not None else '')
+    output_file.write(' AND tbl16_dim.col3 < {};\n'.format(dimMax) if dimMax is not None else ';\n')
+    output_file.write('p1=select(db1.tbl16_fact.col3,null,{})\n'.format('null' if factMax is None else factMax))
+    output_file.write('p2=select(db1.tbl16_dim.col3,null,{})\n'.format('null' if dimMax is None else dimMax))
+    output_file.write('f1=fetch(db1.tbl16_fact.{},p1)\n'.format(factCol))
+    output_file.write('f2=fetch(db1.tbl16_dim.{},p2)\n'.format(dimCol))
+    preJoinFact = factTable if factMax is None else factTable[factTable['col3'] < factMax]
+    preJoinDim = dimTable if dimMax is None else dimTable[dimTable['col3'] < dimMax]
+    joinedTable = preJoinFact.merge(preJoinDim, left_on = factCol, right_on = dimCol, suffixes=('','_right'))
+    products = joinedTable['col3'].values.astype(np.int64) * joinedTable['col3_right'].values
+    for joinType in joinTypes:
+        output_file.write('t1,t2=join(f1,p1,f2,p2,{})\n'.format(joinType))
+        if len(joinedTable) == 0:
+            output_file.write('c1=aggregates(t1,count)\n')
+            output_file.write('print(c1)\n')
+            exp_output_file.write('0\n')
+            continue
+        # the product pairs the values of both sides, so a mismatched pair of positions changes its sum
+        output_file.write('j1=fetch(db1.tbl16_fact.col3,t1)\n')
+        output_file.write('j2=fetch(db1.tbl16_dim.col3,t2)\n')
+        output_file.write('e1=expr(j1*j2)\n')
+        output_file.write('c1,s1=aggregates(j1,count,sum)\n')
+        output_file.write('s2=sum(e1)\n')
+        output_file.write('print(c1,s1,s2)\n')
+        exp_output_file.write('{},{},{}\n'.format(len(joinedTable), joinedTable['col3'].sum(), products.sum()))
+
+def writeJoinTests(factTable, dimTable, joinType, output_file, exp_output_file):
+    output_file.write('-- Whole tables, one match at most per fact row\n')
+    writeJoin(factTable, dimTable, 'col2', 'col1', None, None, [joinType], output_file, exp_output_file)
+    output_file.write('-- Selected rows, one match at most per fact row, and the same join nested-loop\n')
+    writeJoin(factTable, dimTable, 'col2', 'col1', 100, 500, [joinType, 'nested-loop'], output_file, exp_output_file)
+    output_file.write('-- Selected rows, skewed keys many to many, and the same join nested-loop\n')
+    writeJoin(factTable, dimTable, 'col1', 'col2', 50, 250, [joinType, 'nested-loop'], output_file, exp_output_file)
+    output_file.write('-- An empty side\n')
+    writeJoin(factTable, dimTable, 'col1', 'col2', 0, None, [joinType, 'nested-loop'], output_file, exp_output_file)
+
+def createTest67(factTable, dimTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(67, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Radix join, against the nested loop join\n')
+    output_file.write('--\n')
+    for tableName, fileName in [('tbl16_fact', 'data16_fact.csv'), ('tbl16_dim', 'data16_dim.csv')]:
+        output_file.write('create(tbl,"{}",db1,3)\n'.format(tableName))
+        for c in range(1, 4):
+            output_file.write('create(col,"col{}",db1.{})\n'.format(c, tableName))
+        output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/'+fileName+'\")\n')
+    output_file.write('--\n')
+    writeJoinTests(factTable, dimTable, 'radix', output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def createTest68(factTable, dimTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(68, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Parallel hash join, against the nested loop join\n')
+    output_file.write('--\n')
+    writeJoinTests(factTable, dimTable, 'parallel-hash', output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def createTest69(factTable, dimTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(69, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: Grace join, against the nested loop join\n')
+    output_file.write('--\n')
+    output_file.write('-- With the JOIN_MEMORY_BUDGET={} of test_milestone.sh every join with more than {} build tuples\n'.format(JOIN_MEMORY_BUDGET, JOIN_MEMORY_BUDGET // 32))
+    output_file.write('-- spills its inputs to partitioned files, probed in chunks\n')
+    output_file.write('--\n')
+    writeJoinTests(factTable, dimTable, 'grace', output_file, exp_output_file)
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+def generateMilestoneSixFiles(dataSize, randomSeed=48):
+    np.random.seed(randomSeed)
+    dataTable = generateDataStats(dataSize)
+    createTests51And52(dataTable)
+    dataTable, otherTable = generateDataPipeline(dataSize)
+    createTest53(dataTable, otherTable)
+    dataTable = generateDataIndexed(dataSize, 'data9_cracked.csv', 'tbl9_cracked')
+    createIndexMaintenanceTests(dataTable, 'tbl9_cracked', 'data9_cracked.csv', 'cracked', 54)
+    dataTable = generateDataCompressed(dataSize)
+    createTests56And57(dataTable)
+    dataTable = generateDataIndexed(dataSize, 'data11_imprints.csv', 'tbl11_imprints')
+    createIndexMaintenanceTests(dataTable, 'tbl11_imprints', 'data11_imprints.csv', 'imprints', 58)
+    dataTable = generateDataConjunction(dataSize)
+    createTest60(dataTable)
+    dataTable = generateDataClustered(dataSize)
+    createTest61(dataTable)
+    dataTable = generateDataOperators(dataSize)
+    createTest62(dataTable)
+    createTest63(dataTable)
+    createTest64(dataTable)
+    createTest65(dataTable)
+    smallTable = generateDataSampled()
+    createTest66(dataTable, smallTable)
+    factTable, dimTable = generateDataJoin(dataSize)
+    createTest67(factTable, dimTable)
+    createTest68(factTable, dimTable)
+    createTest69(factTable, dimTable)
+
+def main(argv):
+    global TEST_BASE_DIR
+    global DOCKER_TEST_BASE_DIR
+    dataSize = int(argv[0])
+    if len(argv) > 1:
+        randomSeed = int(argv[1])
+    else:
+        randomSeed = 48
+
+    if len(argv) > 2:
+        TEST_BASE_DIR = argv[2]
+        if len(argv) > 3:
+            DOCKER_TEST_BASE_DIR = argv[3]
+
+    generateMilestoneSixFiles(dataSize, randomSeed=randomSeed)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,493 @@
+#include "cs165_api.h"
+#include "aggregate.h"
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AGG_HAS_X86 1
+#else
+#define AGG_HAS_X86 0
+#endif
+
+/*
+ * scalar kernels: independent accumulators and selects the compiler turns into cmov
+ */
+static long sum_int_scalar(int* val_vec, size_t tuples_num){
+    long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for(;i+4<=tuples_num;i+=4){
+        s0 += val_vec[i];
+        s1 += val_vec[i+1];
+        s2 += val_vec[i+2];
+        s3 += val_vec[i+3];
+    }
+    for(;i<tuples_num;i++){
+        s0 += val_vec[i];
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+static long sum_long_scalar(long* val_vec, size_t tuples_num){
+    long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for(;i+4<=tuples_num;i+=4){
+        s0 += val_vec[i];
+        s1 += val_vec[i+1];
+        s2 += val_vec[i+2];
+        s3 += val_vec[i+3];
+    }
+    for(;i<tuples_num;i++){
+        s0 += val_vec[i];
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+static int min_max_int_scalar(int* val_vec, size_t tuples_num, AggregateType t){
+    int v = val_vec[0];
+    if(t == MIN){
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] < v ? val_vec[i] : v;
+        }
+    }else{
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] > v ? val_vec[i] : v;
+        }
+    }
+    return v;
+}
+
+static long min_max_long_scalar(long* val_vec, size_t tuples_num, AggregateType t){
+    long v = val_vec[0];
+    if(t == MIN){
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] < v ? val_vec[i] : v;
+        }
+    }else{
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] > v ? val_vec[i] : v;
+        }
+    }
+    return v;
+}
+
+static double min_max_double_scalar(double* val_vec, size_t tuples_num, AggregateType t){
+    double v = val_vec[0];
+    if(t == MIN){
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] < v ? val_vec[i] : v;
+        }
+    }else{
+        for(size_t i=1;i<tuples_num;i++){
+            v = val_vec[i] > v ? val_vec[i] : v;
+        }
+    }
+    return v;
+}
+
+#if AGG_HAS_X86
+/*
+ * avx2 kernels: two accumulators of 4 or 8 lanes, reduced once at the end
+ */
+__attribute__((target("avx2")))
+static inline long hsum_epi64(__m256i v){
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1);
+}
+
+__attribute__((target("avx2")))
+static long sum_int_avx2(int* val_vec, size_t tuples_num){
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i v;
+    size_t i = 0;
+    for(;i+8<=tuples_num;i+=8){
+        //widened to 64 bits before adding, 8 ints never overflow a lane
+        v = _mm256_loadu_si256((__m256i*) (val_vec + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    return hsum_epi64(_mm256_add_epi64(acc0, acc1)) + sum_int_scalar(val_vec + i, tuples_num - i);
+}
+
+__attribute__((target("avx2")))
+static long sum_long_avx2(long* val_vec, size_t tuples_num){
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(;i+8<=tuples_num;i+=8){
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((__m256i*) (val_vec + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((__m256i*) (val_vec + i + 4)));
+    }
+    return hsum_epi64(_mm256_add_epi64(acc0, acc1)) + sum_long_scalar(val_vec + i, tuples_num - i);
+}
+
+__attribute__((target("avx2")))
+static int min_max_int_avx2(int* val_vec, size_t tuples_num, AggregateType t){
+    if(tuples_num < 16){
+        return min_max_int_scalar(val_vec, tuples_num, t);
+    }
+    __m256i acc0 = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i acc1 = _mm256_loadu_si256((__m256i*) (val_vec + 8));
+    size_t i = 16;
+    if(t == MIN){
+        for(;i+16<=tuples_num;i+=16){
+            acc0 = _mm256_min_epi32(acc0, _mm256_loadu_si256((__m256i*) (val_vec + i)));
+            acc1 = _mm256_min_epi32(acc1, _mm256_loadu_si256((__m256i*) (val_vec + i + 8)));
+        }
+        acc0 = _mm256_min_epi32(acc0, acc1);
+    }else{
+        for(;i+16<=tuples_num;i+=16){
+            acc0 = _mm256_max_epi32(acc0, _mm256_loadu_si256((__m256i*) (val_vec + i)));
+            acc1 = _mm256_max_epi32(acc1, _mm256_loadu_si256((__m256i*) (val_vec + i + 8)));
+        }
+        acc0 = _mm256_max_epi32(acc0, acc1);
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc0);
+    int v = min_max_int_scalar(lanes, 8, t);
+    if(i < tuples_num){
+        int rest = min_max_int_scalar(val_vec + i, tuples_num - i, t);
+        v = t == MIN ? (rest < v ? rest : v) : (rest > v ? rest : v);
+    }
+    return v;
+}
+
+__attribute__((target("avx2")))
+static long min_max_long_avx2(long* val_vec, size_t tuples_num, AggregateType t){
+    if(tuples_num < 8){
+        return min_max_long_scalar(val_vec, tuples_num, t);
+    }
+    //no 64 bit min/max in avx2: compare, then blend the winning lanes
+    __m256i acc0 = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i acc1 = _mm256_loadu_si256((__m256i*) (val_vec + 4));
+    __m256i v0, v1;
+    size_t i = 8;
+    if(t == MIN){
+        for(;i+8<=tuples_num;i+=8){
+            v0 = _mm256_loadu_si256((__m256i*) (val_vec + i));
+            v1 = _mm256_loadu_si256((__m256i*) (val_vec + i + 4));
+            acc0 = _mm256_blendv_epi8(acc0, v0, _mm256_cmpgt_epi64(acc0, v0));
+            acc1 = _mm256_blendv_epi8(acc1, v1, _mm256_cmpgt_epi64(acc1, v1));
+        }
+    }else{
+        for(;i+8<=tuples_num;i+=8){
+            v0 = _mm256_loadu_si256((__m256i*) (val_vec + i));
+            v1 = _mm256_loadu_si256((__m256i*) (val_vec + i + 4));
+            acc0 = _mm256_blendv_epi8(acc0, v0, _mm256_cmpgt_epi64(v0, acc0));
+            acc1 = _mm256_blendv_epi8(acc1, v1, _mm256_cmpgt_epi64(v1, acc1));
+        }
+    }
+    long lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc0);
+    _mm256_storeu_si256((__m256i*) (lanes + 4), acc1);
+    long v = min_max_long_scalar(lanes, 8, t);
+    if(i < tuples_num){
+        long rest = min_max_long_scalar(val_vec + i, tuples_num - i, t);
+        v = t == MIN ? (rest < v ? rest : v) : (rest > v ? rest : v);
+    }
+    return v;
+}
+
+__attribute__((target("avx2")))
+static double min_max_double_avx2(double* val_vec, size_t tuples_num, AggregateType t){
+    if(tuples_num < 8){
+        return min_max_double_scalar(val_vec, tuples_num, t);
+    }
+    __m256d acc0 = _mm256_loadu_pd(val_vec);
+    __m256d acc1 = _mm256_loadu_pd(val_vec + 4);
+    size_t i = 8;
+    if(t == MIN){
+        for(;i+8<=tuples_num;i+=8){
+            acc0 = _mm256_min_pd(acc0, _mm256_loadu_pd(val_vec + i));
+            acc1 = _mm256_min_pd(acc1, _mm256_loadu_pd(val_vec + i + 4));
+        }
+    }else{
+        for(;i+8<=tuples_num;i+=8){
+            acc0 = _mm256_max_pd(acc0, _mm256_loadu_pd(val_vec + i));
+            acc1 = _mm256_max_pd(acc1, _mm256_loadu_pd(val_vec + i + 4));
+        }
+    }
+    double lanes[8];
+    _mm256_storeu_pd(lanes, acc0);
+    _mm256_storeu_pd(lanes + 4, acc1);
+    double v = min_max_double_scalar(lanes, 8, t);
+    if(i < tuples_num){
+        double rest = min_max_double_scalar(val_vec + i, tuples_num - i, t);
+        v = t == MIN ? (rest < v ? rest : v) : (rest > v ? rest : v);
+    }
+    return v;
+}
+#endif
+
+static inline int use_avx2(){
+#if AGG_HAS_X86
+    return scan_current_kernel() == SCAN_KERNEL_AVX2;
+#else
+    return 0;
+#endif
+}
+
+long agg_sum_int(int* val_vec, size_t tuples_num){
+#if AGG_HAS_X86
+    if(use_avx2()){
+        return sum_int_avx2(val_vec, tuples_num);
+    }
+#endif
+    return sum_int_scalar(val_vec, tuples_num);
+}
+
+long agg_sum_long(long* val_vec, size_t tuples_num){
+#if AGG_HAS_X86
+    if(use_avx2()){
+        return sum_long_avx2(val_vec, tuples_num);
+    }
+#endif
+    return sum_long_scalar(val_vec, tuples_num);
+}
+
+int agg_min_max_int(int* val_vec, size_t tuples_num, AggregateType t){
+#if AGG_HAS_X86
+    if(use_avx2()){
+        return min_max_int_avx2(val_vec, tuples_num, t);
+    }
+#endif
+    return min_max_int_scalar(val_vec, tuples_num, t);
+}
+
+long agg_min_max_long(long* val_vec, size_t tuples_num, AggregateType t){
+#if AGG_HAS_X86
+    if(use_avx2()){
+        return min_max_long_avx2(val_vec, tuples_num, t);
+    }
+#endif
+    return min_max_long_scalar(val_vec, tuples_num, t);
+}
+
+double agg_min_max_double(double* val_vec, size_t tuples_num, AggregateType t){
+#if AGG_HAS_X86
+    if(use_avx2()){
+        return min_max_double_avx2(val_vec, tuples_num, t);
+    }
+#endif
+    return min_max_double_scalar(val_vec, tuples_num, t);
+}
+
+size_t agg_arg_min_max_int(int* val_vec, size_t tuples_num, AggregateType t){
+    //vectorized min or max first, then the first value equal to it
+    int v = agg_min_max_int(val_vec, tuples_num, t);
+    size_t i = 0;
+    while(val_vec[i] != v){
+        i++;
+    }
+    return i;
+}
+
+size_t agg_arg_min_max_long(long* val_vec, size_t tuples_num, AggregateType t){
+    //vectorized min or max first, then the first value equal to it
+    long v = agg_min_max_long(val_vec, tuples_num, t);
+    size_t i = 0;
+    while(val_vec[i] != v){
+        i++;
+    }
+    return i;
+}
+
+size_t agg_arg_min_max_double(double* val_vec, size_t tuples_num, AggregateType t){
+    //vectorized min or max first, then the first value equal to it
+    double v = agg_min_max_double(val_vec, tuples_num, t);
+    size_t i = 0;
+    while(val_vec[i] != v){
+        i++;
+    }
+    return i;
+}
+
+/*
+ * stats: sum, min and max fused in one loop, m2 in a second loop around the mean
+ */
+static void stats_int_scalar(int* val_vec, size_t tuples_num, AggStats* stats){
+    long s = 0;
+    int mn = val_vec[0], mx = val_vec[0];
+    for(size_t i=0;i<tuples_num;i++){
+        s += val_vec[i];
+        mn = val_vec[i] < mn ? val_vec[i] : mn;
+        mx = val_vec[i] > mx ? val_vec[i] : mx;
+    }
+    stats->sum = s;
+    stats->min = mn;
+    stats->max = mx;
+}
+
+static void stats_long_scalar(long* val_vec, size_t tuples_num, AggStats* stats){
+    long s = 0;
+    long mn = val_vec[0], mx = val_vec[0];
+    for(size_t i=0;i<tuples_num;i++){
+        s += val_vec[i];
+        mn = val_vec[i] < mn ? val_vec[i] : mn;
+        mx = val_vec[i] > mx ? val_vec[i] : mx;
+    }
+    stats->sum = s;
+    stats->min = mn;
+    stats->max = mx;
+}
+
+#if AGG_HAS_X86
+__attribute__((target("avx2")))
+static void stats_int_avx2(int* val_vec, size_t tuples_num, AggStats* stats){
+    if(tuples_num < 8){
+        stats_int_scalar(val_vec, tuples_num, stats);
+        return;
+    }
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i mn = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i mx = mn;
+    __m256i v;
+    size_t i = 0;
+    for(;i+8<=tuples_num;i+=8){
+        v = _mm256_loadu_si256((__m256i*) (val_vec + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        mn = _mm256_min_epi32(mn, v);
+        mx = _mm256_max_epi32(mx, v);
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, mn);
+    int m = min_max_int_scalar(lanes, 8, MIN);
+    _mm256_storeu_si256((__m256i*) lanes, mx);
+    int n = min_max_int_scalar(lanes, 8, MAX);
+    long s = hsum_epi64(_mm256_add_epi64(acc0, acc1));
+    for(;i<tuples_num;i++){
+        s += val_vec[i];
+        m = val_vec[i] < m ? val_vec[i] : m;
+        n = val_vec[i] > n ? val_vec[i] : n;
+    }
+    stats->sum = s;
+    stats->min = m;
+    stats->max = n;
+}
+
+__attribute__((target("avx2")))
+static void stats_long_avx2(long* val_vec, size_t tuples_num, AggStats* stats){
+    if(tuples_num < 4){
+        stats_long_scalar(val_vec, tuples_num, stats);
+        return;
+    }
+    __m256i acc = _mm256_setzero_si256();
+    __m256i mn = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i mx = mn;
+    __m256i v;
+    size_t i = 0;
+    for(;i+4<=tuples_num;i+=4){
+        v = _mm256_loadu_si256((__m256i*) (val_vec + i));
+        acc = _mm256_add_epi64(acc, v);
+        mn = _mm256_blendv_epi8(mn, v, _mm256_cmpgt_epi64(mn, v));
+        mx = _mm256_blendv_epi8(mx, v, _mm256_cmpgt_epi64(v, mx));
+    }
+    long lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, mn);
+    long m = min_max_long_scalar(lanes, 4, MIN);
+    _mm256_storeu_si256((__m256i*) lanes, mx);
+    long n = min_max_long_scalar(lanes, 4, MAX);
+    long s = hsum_epi64(acc);
+    for(;i<tuples_num;i++){
+        s += val_vec[i];
+        m = val_vec[i] < m ? val_vec[i] : m;
+        n = val_vec[i] > n ? val_vec[i] : n;
+    }
+    stats->sum = s;
+    stats->min = m;
+    stats->max = n;
+}
+#endif
+
+void agg_stats_int(int* val_vec, size_t tuples_num, int with_m2, AggStats* stats){
+    stats->count = tuples_num;
+#if AGG_HAS_X86
+    if(use_avx2()){
+        stats_int_avx2(val_vec, tuples_num, stats);
+    }else{
+        stats_int_scalar(val_vec, tuples_num, stats);
+    }
+#else
+    stats_int_scalar(val_vec, tuples_num, stats);
+#endif
+    stats->m2 = 0;
+    if(with_m2){
+        double mean = (double) stats->sum / (double) tuples_num;
+        double d;
+        for(size_t i=0;i<tuples_num;i++){
+            d = (double) val_vec[i] - mean;
+            stats->m2 += d * d;
+        }
+    }
+}
+
+void agg_stats_long(long* val_vec, size_t tuples_num, int with_m2, AggStats* stats){
+    stats->count = tuples_num;
+#if AGG_HAS_X86
+    if(use_avx2()){
+        stats_long_avx2(val_vec, tuples_num, stats);
+    }else{
+        stats_long_scalar(val_vec, tuples_num, stats);
+    }
+#else
+    stats_long_scalar(val_vec, tuples_num, stats);
+#endif
+    stats->m2 = 0;
+    if(with_m2){
+        double mean = (double) stats->sum / (double) tuples_num;
+        double d;
+        for(size_t i=0;i<tuples_num;i++){
+            d = (double) val_vec[i] - mean;
+            stats->m2 += d * d;
+        }
+    }
+}
+
+void agg_stats_double(double* val_vec, size_t tuples_num, int with_m2, AggStats* stats){
+    stats->count = tuples_num;
+    //in order, so that the sum is the one of sum()
+    double s = 0;
+    for(size_t i=0;i<tuples_num;i++){
+        s += val_vec[i];
+    }
+    stats->double_sum = s;
+    stats->double_min = agg_min_max_double(val_vec, tuples_num, MIN);
+    stats->double_max = agg_min_max_double(val_vec, tuples_num, MAX);
+    stats->m2 = 0;
+    if(with_m2){
+        double mean = s / (double) tuples_num;
+        double d;
+        for(size_t i=0;i<tuples_num;i++){
+            d = val_vec[i] - mean;
+            stats->m2 += d * d;
+        }
+    }
+}
+
+void agg_stats_merge(AggStats* stats, AggStats* part, DataType dt){
+    if(part->count == 0){
+        return;
+    }
+    if(stats->count == 0){
+        *stats = *part;
+        return;
+    }
+    double n1 = (double) stats->count;
+    double n2 = (double) part->count;
+    double delta;
+    if(dt == FLOAT){
+        delta = part->double_sum / n2 - stats->double_sum / n1;
+        stats->double_sum += part->double_sum;
+        stats->double_min = part->double_min < stats->double_min ? part->double_min : stats->double_min;
+        stats->double_max = part->double_max > stats->double_max ? part->double_max : stats->double_max;
+    }else{
+        delta = (double) part->sum / n2 - (double) stats->sum / n1;
+        stats->sum += part->sum;
+        stats->min = part->min < stats->min ? part->min : stats->min;
+        stats->max = part->max > stats->max ? part->max : stats->max;
+    }
+    stats->m2 += part->m2 + delta * delta * n1 * n2 / (n1 + n2);
+    stats->count += part->count;
+}
@@ -48,7 +48,10 @@ void insert_context(ContextTable* ct, char* context_name, void* context_p, Conte
                 GCHandle* gch = (GCHandle*) cur->p;
                 if(gch->type == RESULT){
                     Result* res = gch->p.result;
-                    free(res->payload);
+                    if(res->format != SLICE){
+                        free(res->payload);
+                    }
+                    free(res->deferred);
                     free(res);
                 }
                 free(gch);
@@ -114,7 +117,10 @@ void clean_context_table(ContextTable* ct){
                     // check for memory leakage here later
                     result = gch->p.result;
                     cs165_log(stdout, "working with gch\n");
-                    free(result->payload);
+                    if(result->format != SLICE){
+                        free(result->payload);
+                    }
+                    free(result->deferred);
                     free(result);
                 }
                 cs165_log(stdout, "before freeing this gch handle \n");
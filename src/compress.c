@@ -0,0 +1,595 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "compress.h"
+#include "morsel.h"
+#include "stats.h"
+#include "utils.h"
+#include "zonemap.h"
+
+static const char* encoding_name(ColumnEncoding encoding){
+    if(encoding == FOR_BITPACKED){
+        return "frame of reference";
+    }else if(encoding == RLE){
+        return "run length";
+    }else if(encoding == DICTIONARY){
+        return "dictionary";
+    }
+    return "plain";
+}
+
+//bits needed to store every code in [0, range]
+static unsigned int bits_needed(unsigned long range){
+    return range == 0 ? 0 : 64 - __builtin_clzl(range);
+}
+
+//one spare word so that a code never reads past the end
+static size_t packed_words_for(size_t size, unsigned int bit_width){
+    return (size * bit_width + 63) / 64 + 1;
+}
+
+static inline void pack(uint64_t* packed, unsigned int bit_width, size_t i, uint64_t code){
+    if(bit_width == 0){
+        return;
+    }
+    size_t bit = i * bit_width;
+    unsigned int offset = bit & 63;
+    packed[bit >> 6] |= code << offset;
+    if(offset + bit_width > 64){
+        packed[(bit >> 6) + 1] |= code >> (64 - offset);
+    }
+}
+
+static inline uint64_t unpack(uint64_t* packed, unsigned int bit_width, size_t i){
+    if(bit_width == 0){
+        return 0;
+    }
+    size_t bit = i * bit_width;
+    unsigned int offset = bit & 63;
+    uint64_t code = packed[bit >> 6] >> offset;
+    if(offset + bit_width > 64){
+        code |= packed[(bit >> 6) + 1] << (64 - offset);
+    }
+    return code & ((UINT64_C(1) << bit_width) - 1);
+}
+
+//codes of the count <= 64 values from first on. first is a multiple of 64, so the block starts on a word
+//that is read once into a buffer, codes are shifted out of the buffer and the next word is only read when it runs out.
+static void unpack_block(uint64_t* packed, unsigned int bit_width, size_t first, size_t count, uint32_t* codes){
+    uint64_t* words = packed + (first >> 6) * bit_width;
+    uint64_t mask = (UINT64_C(1) << bit_width) - 1;
+    uint64_t buffer = words[0];
+    uint64_t next;
+    unsigned int available = 64;
+    size_t w = 1;
+    for(size_t k=0;k<count;k++){
+        if(available >= bit_width){
+            codes[k] = buffer & mask;
+            buffer >>= bit_width;
+            available -= bit_width;
+        }else{
+            //the code straddles two words
+            next = words[w++];
+            codes[k] = (buffer | (next << available)) & mask;
+            buffer = next >> (bit_width - available);
+            available = 64 - (bit_width - available);
+        }
+    }
+}
+
+//number of values of vec[0, n) that are < value
+static size_t lower_bound(int* vec, size_t n, long value){
+    size_t lo = 0;
+    size_t hi = n;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(vec[mid] < value){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//index of the run holding pos
+static size_t find_run(EncodedColumn* enc, size_t pos){
+    size_t lo = 0;
+    size_t hi = enc->run_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if((size_t) enc->run_ends[mid] <= pos){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int compare_int(const void* a, const void* b){
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * every kernel runs one morsel at a time. A morsel of MORSEL_SIZE codes starts on a word
+ * boundary of packed and of the bitmaps, so morsels never write to the same word.
+ */
+typedef struct EncodedMorselArgs {
+    Column* column;
+    int* data;
+    int* pos_vec;
+    int* res_vec;
+    Comparator* comp;
+    //the qualifying codes as the half open range [low, high)
+    long low;
+    long high;
+    uint64_t* bitmap;
+    size_t* counts;
+    long* values;
+    int with_m2;
+    AggStats* stats;
+} EncodedMorselArgs;
+
+static inline int decode_value(EncodedColumn* enc, ColumnEncoding encoding, size_t i){
+    uint64_t code = unpack(enc->packed, enc->bit_width, i);
+    return encoding == DICTIONARY ? enc->dict[code] : (int) ((long) enc->base + (long) code);
+}
+
+static void pack_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    EncodedColumn* enc = args->column->encoded;
+    int* data = args->data;
+    if(args->column->encoding == DICTIONARY){
+        for(size_t i=start;i<end;i++){
+            pack(enc->packed, enc->bit_width, i, lower_bound(enc->dict, enc->dict_size, data[i]));
+        }
+    }else{
+        for(size_t i=start;i<end;i++){
+            pack(enc->packed, enc->bit_width, i, (uint64_t) ((long) data[i] - enc->base));
+        }
+    }
+}
+
+void encoded_decode(Column* column, size_t start, size_t end, int* res_vec){
+    EncodedColumn* enc = column->encoded;
+    ColumnEncoding encoding = column->encoding;
+    if(encoding == RLE){
+        size_t r = find_run(enc, start);
+        for(size_t i=start;i<end;i++){
+            r += (size_t) enc->run_ends[r] <= i;
+            res_vec[i-start] = enc->run_values[r];
+        }
+    }else{
+        uint32_t codes[64];
+        size_t count;
+        for(size_t i=start;i<end;i+=64){
+            count = i + 64 < end ? 64 : end - i;
+            unpack_block(enc->packed, enc->bit_width, i, count, codes);
+            for(size_t k=0;k<count;k++){
+                res_vec[i-start+k] = encoding == DICTIONARY ? enc->dict[codes[k]] : (int) ((long) enc->base + (long) codes[k]);
+            }
+        }
+    }
+}
+
+static void unpack_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    encoded_decode(args->column, start, end, args->data + start);
+}
+
+void column_encode(Column* column, size_t capacity){
+    size_t size = column->size;
+    int* data = column->data;
+    if(column->encoding != PLAIN || size == 0){
+        return;
+    }
+    int min = data[0];
+    int max = data[0];
+    size_t run_num = 1;
+    for(size_t i=1;i<size;i++){
+        min = data[i] < min ? data[i] : min;
+        max = data[i] > max ? data[i] : max;
+        run_num += data[i] != data[i-1];
+    }
+    size_t plain_bytes = size * sizeof(int);
+    unsigned int for_width = bits_needed((unsigned long) ((long) max - min));
+    size_t for_bytes = packed_words_for(size, for_width) * sizeof(uint64_t);
+    size_t rle_bytes = run_num * 2 * sizeof(int);
+    //a dictionary only pays off when its codes are narrower than the value range
+    int* dict = NULL;
+    size_t dict_size = 0;
+    size_t dict_bytes = SIZE_MAX;
+    stats_refresh(column);
+    if(bits_needed(stats_distinct(&column->stats)) < for_width){
+        dict = malloc(size * sizeof(int));
+        memcpy(dict, data, size * sizeof(int));
+        qsort(dict, size, sizeof(int), compare_int);
+        dict_size = 1;
+        for(size_t i=1;i<size;i++){
+            if(dict[i] != dict[dict_size-1]){
+                dict[dict_size++] = dict[i];
+            }
+        }
+        dict = realloc(dict, dict_size * sizeof(int));
+        dict_bytes = dict_size * sizeof(int) + packed_words_for(size, bits_needed(dict_size - 1)) * sizeof(uint64_t);
+    }
+    ColumnEncoding encoding = FOR_BITPACKED;
+    size_t encoded_bytes = for_bytes;
+    if(rle_bytes < encoded_bytes){
+        encoding = RLE;
+        encoded_bytes = rle_bytes;
+    }
+    if(dict_bytes < encoded_bytes){
+        encoding = DICTIONARY;
+        encoded_bytes = dict_bytes;
+    }
+    if(encoded_bytes * 2 > plain_bytes){
+        free(dict);
+        cs165_log(stdout, "compression: column %s stays plain\n", column->name);
+        return;
+    }
+    EncodedColumn* enc = calloc(1, sizeof(EncodedColumn));
+    enc->size = size;
+    enc->capacity = capacity;
+    column->encoding = encoding;
+    column->encoded = enc;
+    if(encoding == RLE){
+        free(dict);
+        enc->run_values = malloc(run_num * sizeof(int));
+        enc->run_ends = malloc(run_num * sizeof(int));
+        size_t r = 0;
+        for(size_t i=1;i<size;i++){
+            if(data[i] != data[i-1]){
+                enc->run_values[r] = data[i-1];
+                enc->run_ends[r++] = i;
+            }
+        }
+        enc->run_values[r] = data[size-1];
+        enc->run_ends[r] = size;
+        enc->run_num = run_num;
+    }else{
+        if(encoding == DICTIONARY){
+            enc->dict = dict;
+            enc->dict_size = dict_size;
+            enc->bit_width = bits_needed(dict_size - 1);
+        }else{
+            free(dict);
+            enc->base = min;
+            enc->bit_width = for_width;
+        }
+        enc->packed_words = packed_words_for(size, enc->bit_width);
+        enc->packed = calloc(enc->packed_words, sizeof(uint64_t));
+        EncodedMorselArgs args;
+        args.column = column;
+        args.data = data;
+        morsel_run(size, pack_morsel, &args);
+    }
+    free(column->data);
+    column->data = NULL;
+    cs165_log(stdout, "compression: column %s encoded with %s, %zd bytes instead of %zd\n",
+              column->name, encoding_name(encoding), encoded_bytes, plain_bytes);
+}
+
+void encoded_free(EncodedColumn* enc){
+    free(enc->packed);
+    free(enc->dict);
+    free(enc->run_values);
+    free(enc->run_ends);
+    free(enc);
+}
+
+void column_decode(Column* column){
+    if(column->encoding == PLAIN){
+        return;
+    }
+    EncodedColumn* enc = column->encoded;
+    //calloc like create_column
+    column->data = calloc(enc->capacity, sizeof(int));
+    EncodedMorselArgs args;
+    args.column = column;
+    args.data = column->data;
+    morsel_run(enc->size, unpack_morsel, &args);
+    cs165_log(stdout, "compression: column %s decoded\n", column->name);
+    encoded_free(enc);
+    column->encoded = NULL;
+    column->encoding = PLAIN;
+}
+
+//sets the bits of [start, end)
+static void set_bits(uint64_t* bitmap, size_t start, size_t end){
+    while(start < end && (start & 63) != 0){
+        bitmap[start >> 6] |= UINT64_C(1) << (start & 63);
+        start++;
+    }
+    while(start + 64 <= end){
+        bitmap[start >> 6] = ~UINT64_C(0);
+        start += 64;
+    }
+    while(start < end){
+        bitmap[start >> 6] |= UINT64_C(1) << (start & 63);
+        start++;
+    }
+}
+
+static void scan_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    Column* column = args->column;
+    EncodedColumn* enc = column->encoded;
+    uint64_t* bitmap = args->bitmap;
+    memset(bitmap + (start >> 6), 0, bitmap_words(end - start) * sizeof(uint64_t));
+    size_t count = 0;
+    if(column->encoding == RLE){
+        //a run is evaluated once, whatever its length
+        size_t run_start, run_end;
+        long value;
+        for(size_t r=find_run(enc, start);r<enc->run_num;r++){
+            run_start = r > 0 && (size_t) enc->run_ends[r-1] > start ? (size_t) enc->run_ends[r-1] : start;
+            if(run_start >= end){
+                break;
+            }
+            run_end = (size_t) enc->run_ends[r] < end ? (size_t) enc->run_ends[r] : end;
+            value = enc->run_values[r];
+            if(value >= args->low && value < args->high){
+                set_bits(bitmap, run_start, run_end);
+                count += run_end - run_start;
+            }
+        }
+        args->counts[morsel_id] = count;
+        return;
+    }
+    ZoneMap* zm = &column->zone_map;
+    long low = args->low;
+    long high = args->high;
+    size_t zone_start, zone_end, word_end;
+    long code;
+    uint64_t word;
+    uint32_t codes[64];
+    for(zone_start=start;zone_start<end;zone_start+=ZONE_SIZE){
+        zone_end = zone_start + ZONE_SIZE < end ? zone_start + ZONE_SIZE : end;
+        ZoneMatch match = zone_map_match(args->comp, zm->min_vec[zone_start / ZONE_SIZE], zm->max_vec[zone_start / ZONE_SIZE]);
+        if(match == ZONE_ALL){
+            set_bits(bitmap, zone_start, zone_end);
+            count += zone_end - zone_start;
+        }else if(match == ZONE_PARTIAL){
+            //the predicate is evaluated on the codes, 64 of them per bitmap word
+            for(size_t w=zone_start;w<zone_end;w+=64){
+                word = 0;
+                word_end = w + 64 < zone_end ? w + 64 : zone_end;
+                unpack_block(enc->packed, enc->bit_width, w, word_end - w, codes);
+                for(size_t k=0;k<word_end-w;k++){
+                    code = codes[k];
+                    word |= (uint64_t) ((code >= low) & (code < high)) << k;
+                }
+                bitmap[w >> 6] = word;
+                count += __builtin_popcountll(word);
+            }
+        }
+    }
+    args->counts[morsel_id] = count;
+}
+
+size_t encoded_scan_bitmap(Column* column, Comparator* comp, uint64_t* bitmap){
+    EncodedColumn* enc = column->encoded;
+    size_t morsel_num = morsel_count(enc->size);
+    EncodedMorselArgs args;
+    args.column = column;
+    args.comp = comp;
+    args.bitmap = bitmap;
+    args.counts = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(size_t));
+    //the bounds of comp translated to codes, so that values are never decoded
+    if(column->encoding == DICTIONARY){
+        args.low = comp->ct1 != NO_COMPARISON ? (long) lower_bound(enc->dict, enc->dict_size, comp->lowerbound) : 0;
+        args.high = comp->ct2 != NO_COMPARISON ? (long) lower_bound(enc->dict, enc->dict_size, comp->upperbound) : (long) enc->dict_size;
+    }else if(column->encoding == FOR_BITPACKED){
+        args.low = comp->ct1 != NO_COMPARISON ? comp->lowerbound - enc->base : LONG_MIN;
+        args.high = comp->ct2 != NO_COMPARISON ? comp->upperbound - enc->base : LONG_MAX;
+    }else{
+        args.low = comp->ct1 != NO_COMPARISON ? comp->lowerbound : LONG_MIN;
+        args.high = comp->ct2 != NO_COMPARISON ? comp->upperbound : LONG_MAX;
+    }
+    morsel_run(enc->size, scan_morsel, &args);
+    size_t count = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        count += args.counts[m];
+    }
+    free(args.counts);
+    return count;
+}
+
+void encoded_gather(Column* column, int* pos_vec, size_t tuples_num, int* res_vec){
+    EncodedColumn* enc = column->encoded;
+    ColumnEncoding encoding = column->encoding;
+    if(encoding == RLE){
+        //positions usually ascend, the run of the previous one is tried first
+        size_t r = 0;
+        size_t pos;
+        for(size_t i=0;i<tuples_num;i++){
+            pos = pos_vec[i];
+            if(pos >= (size_t) enc->run_ends[r] || (r > 0 && pos < (size_t) enc->run_ends[r-1])){
+                r = find_run(enc, pos);
+            }
+            res_vec[i] = enc->run_values[r];
+        }
+    }else{
+        for(size_t i=0;i<tuples_num;i++){
+            res_vec[i] = decode_value(enc, encoding, pos_vec[i]);
+        }
+    }
+}
+
+static void fetch_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    encoded_gather(args->column, args->pos_vec + start, end - start, args->res_vec + start);
+}
+
+void encoded_fetch(Column* column, int* pos_vec, size_t tuples_num, int* res_vec){
+    EncodedMorselArgs args;
+    args.column = column;
+    args.pos_vec = pos_vec;
+    args.res_vec = res_vec;
+    morsel_run(tuples_num, fetch_morsel, &args);
+}
+
+static void sum_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    EncodedColumn* enc = args->column->encoded;
+    long s = 0;
+    uint32_t codes[64];
+    size_t count;
+    for(size_t i=start;i<end;i+=64){
+        count = i + 64 < end ? 64 : end - i;
+        unpack_block(enc->packed, enc->bit_width, i, count, codes);
+        if(args->column->encoding == DICTIONARY){
+            for(size_t k=0;k<count;k++){
+                s += enc->dict[codes[k]];
+            }
+        }else{
+            for(size_t k=0;k<count;k++){
+                s += codes[k];
+            }
+        }
+    }
+    if(args->column->encoding == FOR_BITPACKED){
+        //the sum of the offsets, plus the base once per value
+        s += (long) (end - start) * enc->base;
+    }
+    args->values[morsel_id] = s;
+}
+
+long encoded_sum(Column* column){
+    EncodedColumn* enc = column->encoded;
+    long s = 0;
+    if(column->encoding == RLE){
+        size_t run_start = 0;
+        for(size_t r=0;r<enc->run_num;r++){
+            s += (long) enc->run_values[r] * (long) (enc->run_ends[r] - run_start);
+            run_start = enc->run_ends[r];
+        }
+        return s;
+    }
+    size_t morsel_num = morsel_count(enc->size);
+    EncodedMorselArgs args;
+    args.column = column;
+    args.values = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(long));
+    morsel_run(enc->size, sum_morsel, &args);
+    for(size_t m=0;m<morsel_num;m++){
+        s += args.values[m];
+    }
+    free(args.values);
+    return s;
+}
+
+static void stats_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    EncodedMorselArgs* args = (EncodedMorselArgs*) a;
+    //decoded a morsel at a time, the column itself stays encoded
+    int* values = malloc((end - start) * sizeof(int));
+    encoded_decode(args->column, start, end, values);
+    agg_stats_int(values, end - start, args->with_m2, &args->stats[morsel_id]);
+    free(values);
+}
+
+void encoded_stats(Column* column, int with_m2, AggStats* stats){
+    EncodedColumn* enc = column->encoded;
+    stats->count = 0;
+    if(enc->size == 0){
+        return;
+    }
+    if(column->encoding == RLE){
+        //every run counts its length times
+        size_t run_start = 0;
+        long len;
+        stats->count = enc->size;
+        stats->sum = 0;
+        stats->min = enc->run_values[0];
+        stats->max = enc->run_values[0];
+        for(size_t r=0;r<enc->run_num;r++){
+            len = (long) (enc->run_ends[r] - run_start);
+            stats->sum += (long) enc->run_values[r] * len;
+            stats->min = enc->run_values[r] < stats->min ? enc->run_values[r] : stats->min;
+            stats->max = enc->run_values[r] > stats->max ? enc->run_values[r] : stats->max;
+            run_start = enc->run_ends[r];
+        }
+        stats->m2 = 0;
+        if(with_m2){
+            double mean = (double) stats->sum / (double) stats->count;
+            double d;
+            run_start = 0;
+            for(size_t r=0;r<enc->run_num;r++){
+                d = (double) enc->run_values[r] - mean;
+                stats->m2 += d * d * (double) (enc->run_ends[r] - run_start);
+                run_start = enc->run_ends[r];
+            }
+        }
+        return;
+    }
+    size_t morsel_num = morsel_count(enc->size);
+    EncodedMorselArgs args;
+    args.column = column;
+    args.with_m2 = with_m2;
+    args.stats = malloc(morsel_num * sizeof(AggStats));
+    morsel_run(enc->size, stats_morsel, &args);
+    for(size_t m=0;m<morsel_num;m++){
+        agg_stats_merge(stats, &args.stats[m], INT);
+    }
+    free(args.stats);
+}
+
+int encoded_min_max(Column* column, AggregateType t){
+    //an encoded column does not change, so the zone map holds its exact min and max
+    ZoneMap* zm = &column->zone_map;
+    int m = t == MIN ? zm->min_vec[0] : zm->max_vec[0];
+    for(size_t z=1;z<zm->zone_num;z++){
+        if(t == MIN){
+            m = zm->min_vec[z] < m ? zm->min_vec[z] : m;
+        }else{
+            m = zm->max_vec[z] > m ? zm->max_vec[z] : m;
+        }
+    }
+    return m;
+}
+
+void encoded_dump(FILE* fd, Column* column){
+    EncodedColumn* enc = column->encoded;
+    fwrite(enc, sizeof(EncodedColumn), 1, fd);
+    if(column->encoding == RLE){
+        fwrite(enc->run_values, sizeof(int), enc->run_num, fd);
+        fwrite(enc->run_ends, sizeof(int), enc->run_num, fd);
+    }else{
+        fwrite(enc->packed, sizeof(uint64_t), enc->packed_words, fd);
+        if(column->encoding == DICTIONARY){
+            fwrite(enc->dict, sizeof(int), enc->dict_size, fd);
+        }
+    }
+}
+
+void encoded_load(FILE* fd, Column* column){
+    EncodedColumn* enc = calloc(1, sizeof(EncodedColumn));
+    fread(enc, sizeof(EncodedColumn), 1, fd);
+    enc->packed = NULL;
+    enc->dict = NULL;
+    enc->run_values = NULL;
+    enc->run_ends = NULL;
+    if(column->encoding == RLE){
+        enc->run_values = malloc(enc->run_num * sizeof(int));
+        enc->run_ends = malloc(enc->run_num * sizeof(int));
+        fread(enc->run_values, sizeof(int), enc->run_num, fd);
+        fread(enc->run_ends, sizeof(int), enc->run_num, fd);
+    }else{
+        enc->packed = malloc(enc->packed_words * sizeof(uint64_t));
+        fread(enc->packed, sizeof(uint64_t), enc->packed_words, fd);
+        if(column->encoding == DICTIONARY){
+            enc->dict = malloc(enc->dict_size * sizeof(int));
+            fread(enc->dict, sizeof(int), enc->dict_size, fd);
+        }
+    }
+    column->encoded = enc;
+}
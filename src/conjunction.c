@@ -0,0 +1,133 @@
+#include <limits.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "conjunction.h"
+#include "compress.h"
+#include "morsel.h"
+#include "stats.h"
+#include "utils.h"
+
+//positions gathered at once from the column of a predicate
+#define REFINE_CHUNK 1024
+
+size_t* conjunction_order(Column** columns, Comparator* comparators, size_t predicate_num){
+    size_t* order = malloc(predicate_num * sizeof(size_t));
+    size_t* estimates = malloc(predicate_num * sizeof(size_t));
+    for(size_t i=0;i<predicate_num;i++){
+        order[i] = i;
+        stats_refresh(columns[i]);
+        estimates[i] = stats_estimate_range(&columns[i]->stats, &comparators[i]);
+        cs165_log(stdout, "conjunction: predicate %zd on %s, %zd rows estimated\n", i, columns[i]->name, estimates[i]);
+    }
+    //insertion sort, there are a handful of predicates and ties keep the query order
+    size_t p, j;
+    for(size_t i=1;i<predicate_num;i++){
+        p = order[i];
+        for(j=i;j>0 && estimates[order[j-1]] > estimates[p];j--){
+            order[j] = order[j-1];
+        }
+        order[j] = p;
+    }
+    free(estimates);
+    return order;
+}
+
+typedef struct RefineMorselArgs {
+    Column* column;
+    //the qualifying values as the half open range [low, high)
+    long low;
+    long high;
+    int* pos_vec;
+    uint64_t* bitmap;
+    size_t* counts;
+} RefineMorselArgs;
+
+static inline void gather_values(Column* column, int* pos_vec, size_t n, int* values){
+    if(column->encoding != PLAIN){
+        encoded_gather(column, pos_vec, n, values);
+        return;
+    }
+    int* data = column->data;
+    for(size_t i=0;i<n;i++){
+        values[i] = data[pos_vec[i]];
+    }
+}
+
+//a morsel compacts the positions it keeps to the front of its own slice [start, end)
+static void refine_vector_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    RefineMorselArgs* args = (RefineMorselArgs*) a;
+    int values[REFINE_CHUNK];
+    int* pos_vec = args->pos_vec;
+    size_t count = start;
+    size_t n;
+    for(size_t chunk=start;chunk<end;chunk+=n){
+        n = end - chunk < REFINE_CHUNK ? end - chunk : REFINE_CHUNK;
+        gather_values(args->column, pos_vec + chunk, n, values);
+        for(size_t i=0;i<n;i++){
+            pos_vec[count] = pos_vec[chunk + i];
+            count += (values[i] >= args->low) & (values[i] < args->high);
+        }
+    }
+    args->counts[morsel_id] = count - start;
+}
+
+//MORSEL_SIZE is a multiple of 64, so a morsel owns the bitmap words of its positions
+static void refine_bitmap_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    RefineMorselArgs* args = (RefineMorselArgs*) a;
+    int positions[64];
+    int values[64];
+    uint64_t* bitmap = args->bitmap;
+    size_t count = 0;
+    size_t n;
+    uint64_t word, kept;
+    for(size_t w=start/64;w<(end+63)/64;w++){
+        word = bitmap[w];
+        n = 0;
+        while(word != 0){
+            positions[n++] = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+        }
+        gather_values(args->column, positions, n, values);
+        kept = 0;
+        for(size_t i=0;i<n;i++){
+            kept |= (uint64_t) ((values[i] >= args->low) & (values[i] < args->high)) << (positions[i] & 63);
+        }
+        bitmap[w] = kept;
+        count += __builtin_popcountll(kept);
+    }
+    args->counts[morsel_id] = count;
+}
+
+void conjunction_refine(Column* column, Comparator* comp, Result* res){
+    RefineMorselArgs args;
+    args.column = column;
+    args.low = comp->ct1 != NO_COMPARISON ? comp->lowerbound : LONG_MIN;
+    args.high = comp->ct2 != NO_COMPARISON ? comp->upperbound : LONG_MAX;
+    if(res->num_tuples == 0 || (comp->ct1 == NO_COMPARISON && comp->ct2 == NO_COMPARISON)){
+        return;
+    }
+    if(res->format == RANGES){
+        //the range of a clustered index is refined as the positions it lists
+        result_materialize_positions(res);
+    }
+    size_t tuples_num = res->format == BITMAP ? res->bitmap_len : res->num_tuples;
+    size_t morsel_num = morsel_count(tuples_num);
+    args.pos_vec = res->format == BITMAP ? NULL : (int*) res->payload;
+    args.bitmap = res->format == BITMAP ? (uint64_t*) res->payload : NULL;
+    args.counts = malloc(morsel_num * sizeof(size_t));
+    morsel_run(tuples_num, res->format == BITMAP ? refine_bitmap_morsel : refine_vector_morsel, &args);
+    size_t index_count = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        if(args.pos_vec != NULL && index_count != m * MORSEL_SIZE){
+            //ordered merge, as in morsel_scan_select
+            memmove(args.pos_vec + index_count, args.pos_vec + m * MORSEL_SIZE, args.counts[m] * sizeof(int));
+        }
+        index_count += args.counts[m];
+    }
+    free(args.counts);
+    cs165_log(stdout, "conjunction: %zd of %zd positions kept on %s\n", index_count, res->num_tuples, column->name);
+    res->num_tuples = index_count;
+    if(res->format == BITMAP && index_count * sizeof(int) < bitmap_words(res->bitmap_len) * sizeof(uint64_t)){
+        result_materialize_positions(res);
+    }
+}
@@ -0,0 +1,234 @@
+#include <limits.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "cracking.h"
+#include "utils.h"
+
+CrackerIndex* cracker_create(size_t capacity){
+    CrackerIndex* ci = calloc(1, sizeof(CrackerIndex));
+    ci->capacity = capacity > 0 ? capacity : 1;
+    ci->key_vec = malloc(ci->capacity * sizeof(int));
+    ci->pos_vec = malloc(ci->capacity * sizeof(int));
+    return ci;
+}
+
+void cracker_free(CrackerIndex* ci){
+    free(ci->key_vec);
+    free(ci->pos_vec);
+    free(ci->crack_keys);
+    free(ci->crack_pos);
+    free(ci);
+}
+
+static void cracker_reserve(CrackerIndex* ci, size_t capacity){
+    if(capacity <= ci->capacity){
+        return;
+    }
+    while(ci->capacity < capacity){
+        ci->capacity *= 2;
+    }
+    ci->key_vec = realloc(ci->key_vec, ci->capacity * sizeof(int));
+    ci->pos_vec = realloc(ci->pos_vec, ci->capacity * sizeof(int));
+}
+
+void cracker_build(CrackerIndex* ci, int* data, size_t size){
+    cracker_reserve(ci, size);
+    memcpy(ci->key_vec, data, size * sizeof(int));
+    for(size_t i=0;i<size;i++){
+        ci->pos_vec[i] = i;
+    }
+    ci->size = size;
+    ci->crack_num = 0;
+}
+
+/**
+ * looks key up among the cracks. *idx is the index of the first crack >= key.
+ * Returns 1 if key is a crack, its position is then *piece_start.
+ * Otherwise [*piece_start, *piece_end) is the piece holding the values around key.
+ **/
+static int crack_find(CrackerIndex* ci, int key, size_t* idx, size_t* piece_start, size_t* piece_end){
+    size_t lo = 0;
+    size_t hi = ci->crack_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(ci->crack_keys[mid] < key){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    *idx = lo;
+    if(lo < ci->crack_num && ci->crack_keys[lo] == key){
+        *piece_start = ci->crack_pos[lo];
+        *piece_end = ci->crack_pos[lo];
+        return 1;
+    }
+    *piece_start = lo > 0 ? ci->crack_pos[lo-1] : 0;
+    *piece_end = lo < ci->crack_num ? ci->crack_pos[lo] : ci->size;
+    return 0;
+}
+
+static void add_crack(CrackerIndex* ci, size_t idx, int key, size_t pos){
+    if(ci->crack_num == ci->crack_capacity){
+        ci->crack_capacity = ci->crack_capacity > 0 ? 2 * ci->crack_capacity : 16;
+        ci->crack_keys = realloc(ci->crack_keys, ci->crack_capacity * sizeof(int));
+        ci->crack_pos = realloc(ci->crack_pos, ci->crack_capacity * sizeof(size_t));
+    }
+    memmove(ci->crack_keys + idx + 1, ci->crack_keys + idx, (ci->crack_num - idx) * sizeof(int));
+    memmove(ci->crack_pos + idx + 1, ci->crack_pos + idx, (ci->crack_num - idx) * sizeof(size_t));
+    ci->crack_keys[idx] = key;
+    ci->crack_pos[idx] = pos;
+    ci->crack_num++;
+}
+
+static void swap_entries(CrackerIndex* ci, size_t i, size_t j){
+    int key = ci->key_vec[i];
+    int pos = ci->pos_vec[i];
+    ci->key_vec[i] = ci->key_vec[j];
+    ci->pos_vec[i] = ci->pos_vec[j];
+    ci->key_vec[j] = key;
+    ci->pos_vec[j] = pos;
+}
+
+//partitions [start, end) into the values < key and the values >= key, returns where the second part starts
+static size_t crack_in_two(CrackerIndex* ci, size_t start, size_t end, int key){
+    size_t i = start;
+    size_t j = end;
+    while(1){
+        while(i < j && ci->key_vec[i] < key){
+            i++;
+        }
+        while(i < j && ci->key_vec[j-1] >= key){
+            j--;
+        }
+        if(i >= j){
+            return i;
+        }
+        swap_entries(ci, i, j-1);
+        i++;
+        j--;
+    }
+}
+
+//partitions [start, end) into the values < low, in [low, high) and >= high, the middle part is [*mid_start, *mid_end)
+static void crack_in_three(CrackerIndex* ci, size_t start, size_t end, int low, int high, size_t* mid_start, size_t* mid_end){
+    size_t lt = start;
+    size_t i = start;
+    size_t gt = end;
+    int key;
+    while(i < gt){
+        key = ci->key_vec[i];
+        if(key < low){
+            swap_entries(ci, lt, i);
+            lt++;
+            i++;
+        }else if(key >= high){
+            gt--;
+            swap_entries(ci, i, gt);
+        }else{
+            i++;
+        }
+    }
+    *mid_start = lt;
+    *mid_end = gt;
+}
+
+void cracker_select(CrackerIndex* ci, Comparator* comp, size_t* start, size_t* end){
+    //the predicate as the half open range [low, high), bounds outside of int need no crack
+    long low = comp->ct1 != NO_COMPARISON ? comp->lowerbound : LONG_MIN;
+    long high = comp->ct2 != NO_COMPARISON ? comp->upperbound : LONG_MAX;
+    if(ci->size == 0 || low >= high || low > INT_MAX || high <= INT_MIN){
+        *start = 0;
+        *end = 0;
+        return;
+    }
+    int has_low = low > INT_MIN;
+    int has_high = high <= INT_MAX;
+    size_t low_idx = 0, low_start = 0, low_end = 0;
+    size_t high_idx = 0, high_start = 0, high_end = 0;
+    int low_found = has_low ? crack_find(ci, (int) low, &low_idx, &low_start, &low_end) : 1;
+    int high_found = has_high ? crack_find(ci, (int) high, &high_idx, &high_start, &high_end) : 1;
+    if(!low_found && !high_found && low_idx == high_idx){
+        //both bounds fall in the same piece, one pass splits it in three
+        size_t mid_start, mid_end;
+        crack_in_three(ci, low_start, low_end, (int) low, (int) high, &mid_start, &mid_end);
+        add_crack(ci, low_idx, (int) low, mid_start);
+        add_crack(ci, low_idx + 1, (int) high, mid_end);
+        cs165_log(stdout, "cracking: piece [%zu, %zu) cracked in three\n", low_start, low_end);
+    }else{
+        if(!low_found){
+            add_crack(ci, low_idx, (int) low, crack_in_two(ci, low_start, low_end, (int) low));
+            cs165_log(stdout, "cracking: piece [%zu, %zu) cracked in two\n", low_start, low_end);
+        }
+        if(!high_found){
+            //the low crack may have moved the index of the high one, not its piece
+            crack_find(ci, (int) high, &high_idx, &high_start, &high_end);
+            add_crack(ci, high_idx, (int) high, crack_in_two(ci, high_start, high_end, (int) high));
+            cs165_log(stdout, "cracking: piece [%zu, %zu) cracked in two\n", high_start, high_end);
+        }
+    }
+    *start = 0;
+    *end = ci->size;
+    if(has_low){
+        crack_find(ci, (int) low, &low_idx, start, &low_end);
+    }
+    if(has_high){
+        crack_find(ci, (int) high, &high_idx, end, &high_end);
+    }
+}
+
+void cracker_insert(CrackerIndex* ci, int key, size_t pos){
+    cracker_reserve(ci, ci->size + 1);
+    if(pos < ci->size){
+        for(size_t i=0;i<ci->size;i++){
+            ci->pos_vec[i] += ci->pos_vec[i] >= (int) pos;
+        }
+    }
+    //from the last piece down to the piece of key, the first value of every piece moves to its end
+    size_t hole = ci->size;
+    size_t c = ci->crack_num;
+    while(c > 0 && key < ci->crack_keys[c-1]){
+        c--;
+        ci->key_vec[hole] = ci->key_vec[ci->crack_pos[c]];
+        ci->pos_vec[hole] = ci->pos_vec[ci->crack_pos[c]];
+        hole = ci->crack_pos[c];
+        ci->crack_pos[c]++;
+    }
+    ci->key_vec[hole] = key;
+    ci->pos_vec[hole] = pos;
+    ci->size++;
+}
+
+void cracker_delete(CrackerIndex* ci, uint64_t* deleted, size_t len){
+    //rank[w]: deleted positions before word w
+    size_t words = bitmap_words(len);
+    size_t* rank = malloc((words + 1) * sizeof(size_t));
+    rank[0] = 0;
+    for(size_t w=0;w<words;w++){
+        rank[w+1] = rank[w] + __builtin_popcountll(deleted[w]);
+    }
+    size_t real_pos = 0;
+    size_t c = 0;
+    size_t pos;
+    for(size_t i=0;i<ci->size;i++){
+        while(c < ci->crack_num && ci->crack_pos[c] == i){
+            ci->crack_pos[c++] = real_pos;
+        }
+        pos = ci->pos_vec[i];
+        if(pos >= len){
+            ci->pos_vec[real_pos] = pos - rank[words];
+        }else if((deleted[pos >> 6] >> (pos & 63)) & 1){
+            continue;
+        }else{
+            ci->pos_vec[real_pos] = pos - rank[pos >> 6] - __builtin_popcountll(deleted[pos >> 6] & ((UINT64_C(1) << (pos & 63)) - 1));
+        }
+        ci->key_vec[real_pos] = ci->key_vec[i];
+        real_pos++;
+    }
+    while(c < ci->crack_num){
+        ci->crack_pos[c++] = real_pos;
+    }
+    ci->size = real_pos;
+    free(rank);
+}
@@ -2,6 +2,12 @@
 #include <sys/socket.h>
 #include "cs165_api.h"
 #include "client_context.h"
+#include "zonemap.h"
+#include "stats.h"
+#include "cracking.h"
+#include "imprints.h"
+#include "sample.h"
+#include "utils.h"
 
 // In this class, there will always be only one active database at a time
 Db *current_db;
@@ -34,6 +40,7 @@ Table* create_table(char* name, size_t col_capacity, Db* db, message* msg) {
     new_table->col_capacity = col_capacity;
     new_table->table_length = 0;
     new_table->table_length_capacity = INITIAL_COLUMN_LENGTH_CAPACITY;
+    sample_init(&new_table->sample);
     current_db->tables_size++;
     insert_context(db_catalog, name, (void*) new_table, TABLE);
 
@@ -74,6 +81,10 @@ Column* create_column(char* name, Db* db, Table* table, message* msg){
     new_column->index_file = NULL;
     new_column->it = NONE;
     new_column->clustered = 0;
+    new_column->encoding = PLAIN;
+    new_column->encoded = NULL;
+    zone_map_init(&new_column->zone_map, table->table_length_capacity);
+    stats_init(&new_column->stats);
     table->col_count++;
     
     GCHandle* gch = malloc(1 * sizeof(GCHandle));
@@ -85,7 +96,31 @@ Column* create_column(char* name, Db* db, Table* table, message* msg){
     return new_column;
 }
 
+/*
+ * returns the table of the current db whose columns include col, NULL if there is none
+ */
+Table* column_table(Column* col){
+    if(current_db == NULL){
+        return NULL;
+    }
+    for(size_t i=0;i<current_db->tables_size;i++){
+        Table* table = &(current_db->tables[i]);
+        for(size_t j=0;j<table->col_count;j++){
+            if(&(table->columns[j]) == col){
+                return table;
+            }
+        }
+    }
+    return NULL;
+}
+
 void create_idx(IndexType it, Table* table, Column* col, message* msg){
+    if((it==SORTED_CLUSTERED || it==BTREE_CLUSTERED) && table->table_length > 0){
+        //the data already loaded would have to be reordered, clustered indexes are only created before the load
+        cs165_log(stdout, "clustered index on %s needs an empty table\n", col->name);
+        msg->status = QUERY_UNSUPPORTED;
+        return;
+    }
     col->it = it;
     if(it==SORTED_CLUSTERED || it==BTREE_CLUSTERED){
         //all columns of a table follow the sort order of a leading column
@@ -97,7 +132,33 @@ void create_idx(IndexType it, Table* table, Column* col, message* msg){
         ColumnIndex* ci = malloc(1 * sizeof(ColumnIndex));
         ci->key_vec = malloc(table->table_length_capacity * sizeof(int));
         ci->pos_vec = malloc(table->table_length_capacity * sizeof(int));
+        //sorted copy of whatever the column holds, as the load builds it
+        IndexPair* ip_vector = malloc(col->size * sizeof(IndexPair));
+        for(size_t i=0;i<col->size;i++){
+            ip_vector[i].key = col->data[i];
+            ip_vector[i].pos = i;
+        }
+        qsort(ip_vector, col->size, sizeof(IndexPair), IndexPairCompare);
+        for(size_t i=0;i<col->size;i++){
+            ci->key_vec[i] = ip_vector[i].key;
+            ci->pos_vec[i] = ip_vector[i].pos;
+        }
+        free(ip_vector);
         col->index_file = (void*) ci;
+    }else if(it==BTREE_UNCLUSTERED){
+        col->index_file = NULL;
+        for(size_t i=0;i<col->size;i++){
+            update_column_index(col, col->data[i], i, 1);
+        }
+    }else if(it==CRACKED){
+        //starts as an uncracked copy of whatever the column holds
+        CrackerIndex* cracker = cracker_create(table->table_length_capacity);
+        cracker_build(cracker, col->data, col->size);
+        col->index_file = (void*) cracker;
+    }else if(it==IMPRINTS){
+        ImprintIndex* ii = imprints_create();
+        imprints_build(ii, col->data, col->size);
+        col->index_file = (void*) ii;
     }
     msg->status = OK_DONE;
 }
@@ -0,0 +1,472 @@
+#include <string.h>
+#include "cs165_api.h"
+#include "expr.h"
+#include "morsel.h"
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXPR_HAS_X86 1
+#else
+#define EXPR_HAS_X86 0
+#endif
+
+typedef struct ExprMorselArgs {
+    ExprProgram* program;
+    int compute_float;
+    void* payloads[EXPR_MAX_VECTORS];
+    DataType dts[EXPR_MAX_VECTORS];
+    void* res_payload;
+} ExprMorselArgs;
+
+/*
+ * tree
+ */
+ExprNode* expr_constant(long l, double d, int is_float){
+    ExprNode* node = calloc(1, sizeof(ExprNode));
+    node->type = EXPR_CONSTANT;
+    node->is_float = is_float;
+    node->l = l;
+    node->d = is_float ? d : (double) l;
+    return node;
+}
+
+ExprNode* expr_vector(GCHandle* gch){
+    ExprNode* node = calloc(1, sizeof(ExprNode));
+    node->type = EXPR_VECTOR;
+    node->gch = gch;
+    return node;
+}
+
+ExprNode* expr_binary(char op, ExprNode* left, ExprNode* right){
+    if(left->type == EXPR_CONSTANT && right->type == EXPR_CONSTANT){
+        if(op == '/' || left->is_float || right->is_float){
+            double x = left->d;
+            double y = right->d;
+            left->d = op == '+' ? x + y : op == '-' ? x - y : op == '*' ? x * y : x / y;
+            left->is_float = 1;
+        }else{
+            long x = left->l;
+            long y = right->l;
+            left->l = op == '+' ? x + y : op == '-' ? x - y : x * y;
+            left->d = (double) left->l;
+        }
+        free(right);
+        return left;
+    }
+    ExprNode* node = calloc(1, sizeof(ExprNode));
+    node->type = EXPR_BINARY;
+    node->op = op;
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+void expr_node_free(ExprNode* node){
+    if(node == NULL){
+        return;
+    }
+    expr_node_free(node->left);
+    expr_node_free(node->right);
+    free(node);
+}
+
+/*
+ * compilation
+ */
+//slots needed to evaluate node, mirrors expr_emit
+static size_t expr_need(ExprNode* node){
+    if(node->type != EXPR_BINARY){
+        return 1;
+    }
+    //constants are never both children, see expr_binary
+    if(node->right->type == EXPR_CONSTANT){
+        return expr_need(node->left);
+    }
+    if(node->left->type == EXPR_CONSTANT){
+        return expr_need(node->right);
+    }
+    if(node->right->type == EXPR_VECTOR){
+        return expr_need(node->left);
+    }
+    if(node->left->type == EXPR_VECTOR){
+        return expr_need(node->right);
+    }
+    size_t left = expr_need(node->left);
+    size_t right = expr_need(node->right);
+    return left == right ? left + 1 : left > right ? left : right;
+}
+
+static ExprOpcode expr_opcode(char op, int reversed){
+    if(op == '+'){
+        return EXPR_ADD;
+    }else if(op == '*'){
+        return EXPR_MUL;
+    }else if(op == '-'){
+        return reversed ? EXPR_RSUB : EXPR_SUB;
+    }
+    return reversed ? EXPR_RDIV : EXPR_DIV;
+}
+
+//index of the vector of gch in the program, -1 if there are too many
+static long expr_vector_index(ExprProgram* program, GCHandle* gch){
+    for(size_t v=0;v<program->gch_num;v++){
+        if(program->gchs[v] == gch){
+            return (long) v;
+        }
+    }
+    if(program->gch_num == EXPR_MAX_VECTORS){
+        return -1;
+    }
+    program->gchs[program->gch_num] = gch;
+    return (long) program->gch_num++;
+}
+
+//appends the instruction combining the top of the stack with operand (a leaf, or NULL for the stack)
+static int expr_append(ExprProgram* program, ExprOpcode op, ExprNode* operand){
+    ExprInstruction* ins = &program->instructions[program->instruction_num++];
+    memset(ins, 0, sizeof(ExprInstruction));
+    ins->op = op;
+    if(operand == NULL){
+        ins->operand = EXPR_ON_STACK;
+    }else if(operand->type == EXPR_CONSTANT){
+        ins->operand = EXPR_ON_CONSTANT;
+        ins->l = operand->l;
+        ins->d = operand->d;
+        program->is_float |= operand->is_float;
+    }else{
+        long v = expr_vector_index(program, operand->gch);
+        if(v < 0){
+            return 0;
+        }
+        ins->operand = EXPR_ON_VECTOR;
+        ins->vector = (size_t) v;
+    }
+    return 1;
+}
+
+static int expr_emit(ExprProgram* program, ExprNode* node){
+    if(node->type == EXPR_VECTOR){
+        return expr_append(program, EXPR_LOAD, node);
+    }
+    program->is_float |= node->op == '/';
+    if(node->right->type == EXPR_CONSTANT){
+        return expr_emit(program, node->left) && expr_append(program, expr_opcode(node->op, 0), node->right);
+    }
+    if(node->left->type == EXPR_CONSTANT){
+        return expr_emit(program, node->right) && expr_append(program, expr_opcode(node->op, 1), node->left);
+    }
+    if(node->right->type == EXPR_VECTOR){
+        return expr_emit(program, node->left) && expr_append(program, expr_opcode(node->op, 0), node->right);
+    }
+    if(node->left->type == EXPR_VECTOR){
+        return expr_emit(program, node->right) && expr_append(program, expr_opcode(node->op, 1), node->left);
+    }
+    //the subtree needing more slots first, while the other one does not hold any yet
+    if(expr_need(node->right) > expr_need(node->left)){
+        return expr_emit(program, node->right) && expr_emit(program, node->left)
+               && expr_append(program, expr_opcode(node->op, 1), NULL);
+    }
+    return expr_emit(program, node->left) && expr_emit(program, node->right)
+           && expr_append(program, expr_opcode(node->op, 0), NULL);
+}
+
+static size_t expr_node_count(ExprNode* node){
+    return node == NULL ? 0 : 1 + expr_node_count(node->left) + expr_node_count(node->right);
+}
+
+ExprProgram* expr_compile(ExprNode* root){
+    if(root->type == EXPR_CONSTANT || expr_need(root) > EXPR_MAX_DEPTH){
+        return NULL;
+    }
+    ExprProgram* program = calloc(1, sizeof(ExprProgram));
+    program->instructions = malloc(expr_node_count(root) * sizeof(ExprInstruction));
+    program->depth = expr_need(root);
+    if(!expr_emit(program, root)){
+        expr_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+void expr_free(ExprProgram* program){
+    if(program != NULL){
+        free(program->instructions);
+        free(program);
+    }
+}
+
+static DataType expr_vector_type(GCHandle* gch){
+    return gch->type == COLUMN ? INT : gch->p.result->data_type;
+}
+
+DataType expr_result_type(ExprProgram* program){
+    if(program->is_float){
+        return FLOAT;
+    }
+    for(size_t v=0;v<program->gch_num;v++){
+        if(expr_vector_type(program->gchs[v]) == FLOAT){
+            return FLOAT;
+        }
+    }
+    return LONG;
+}
+
+/*
+ * scalar kernels: dst = x op y, or x op c when y is NULL, the reversed ops swap x and y (or c)
+ */
+#define EXPR_SCALAR_LOOP(VV, VC) \
+    if(y != NULL){ \
+        for(size_t i=0;i<n;i++){ \
+            dst[i] = VV; \
+        } \
+    }else{ \
+        for(size_t i=0;i<n;i++){ \
+            dst[i] = VC; \
+        } \
+    }
+
+static void long_op_scalar(ExprOpcode op, long* dst, long* x, long* y, long c, size_t n){
+    if(op == EXPR_ADD){
+        EXPR_SCALAR_LOOP(x[i] + y[i], x[i] + c)
+    }else if(op == EXPR_SUB){
+        EXPR_SCALAR_LOOP(x[i] - y[i], x[i] - c)
+    }else if(op == EXPR_RSUB){
+        EXPR_SCALAR_LOOP(y[i] - x[i], c - x[i])
+    }else{
+        EXPR_SCALAR_LOOP(x[i] * y[i], x[i] * c)
+    }
+}
+
+static void double_op_scalar(ExprOpcode op, double* dst, double* x, double* y, double c, size_t n){
+    if(op == EXPR_ADD){
+        EXPR_SCALAR_LOOP(x[i] + y[i], x[i] + c)
+    }else if(op == EXPR_SUB){
+        EXPR_SCALAR_LOOP(x[i] - y[i], x[i] - c)
+    }else if(op == EXPR_RSUB){
+        EXPR_SCALAR_LOOP(y[i] - x[i], c - x[i])
+    }else if(op == EXPR_MUL){
+        EXPR_SCALAR_LOOP(x[i] * y[i], x[i] * c)
+    }else if(op == EXPR_DIV){
+        EXPR_SCALAR_LOOP(x[i] / y[i], x[i] / c)
+    }else{
+        EXPR_SCALAR_LOOP(y[i] / x[i], c / x[i])
+    }
+}
+
+static void int_to_long_scalar(int* src, long* dst, size_t n){
+    for(size_t i=0;i<n;i++){
+        dst[i] = src[i];
+    }
+}
+
+static void int_to_double_scalar(int* src, double* dst, size_t n){
+    for(size_t i=0;i<n;i++){
+        dst[i] = src[i];
+    }
+}
+
+#if EXPR_HAS_X86
+/*
+ * avx2 kernels, 4 lanes of 64 bits. AVX2 has no 64 bit multiplication, long products stay scalar.
+ */
+#define EXPR_LOAD_SI(p) _mm256_loadu_si256((__m256i*) (p))
+#define EXPR_STORE_SI(p, v) _mm256_storeu_si256((__m256i*) (p), v)
+#define EXPR_RSUB_EPI64(a, b) _mm256_sub_epi64(b, a)
+#define EXPR_RSUB_PD(a, b) _mm256_sub_pd(b, a)
+#define EXPR_RDIV_PD(a, b) _mm256_div_pd(b, a)
+
+#define EXPR_AVX2_LOOP(LOAD, STORE, OP) \
+    if(y != NULL){ \
+        for(;i+4<=n;i+=4){ \
+            STORE(dst + i, OP(LOAD(x + i), LOAD(y + i))); \
+        } \
+    }else{ \
+        for(;i+4<=n;i+=4){ \
+            STORE(dst + i, OP(LOAD(x + i), vc)); \
+        } \
+    }
+
+__attribute__((target("avx2")))
+static void long_op_avx2(ExprOpcode op, long* dst, long* x, long* y, long c, size_t n){
+    if(op == EXPR_MUL){
+        long_op_scalar(op, dst, x, y, c, n);
+        return;
+    }
+    __m256i vc = _mm256_set1_epi64x(c);
+    size_t i = 0;
+    if(op == EXPR_ADD){
+        EXPR_AVX2_LOOP(EXPR_LOAD_SI, EXPR_STORE_SI, _mm256_add_epi64)
+    }else if(op == EXPR_SUB){
+        EXPR_AVX2_LOOP(EXPR_LOAD_SI, EXPR_STORE_SI, _mm256_sub_epi64)
+    }else{
+        EXPR_AVX2_LOOP(EXPR_LOAD_SI, EXPR_STORE_SI, EXPR_RSUB_EPI64)
+    }
+    long_op_scalar(op, dst + i, x + i, y != NULL ? y + i : NULL, c, n - i);
+}
+
+__attribute__((target("avx2")))
+static void double_op_avx2(ExprOpcode op, double* dst, double* x, double* y, double c, size_t n){
+    __m256d vc = _mm256_set1_pd(c);
+    size_t i = 0;
+    if(op == EXPR_ADD){
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd)
+    }else if(op == EXPR_SUB){
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd)
+    }else if(op == EXPR_RSUB){
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, EXPR_RSUB_PD)
+    }else if(op == EXPR_MUL){
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd)
+    }else if(op == EXPR_DIV){
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd)
+    }else{
+        EXPR_AVX2_LOOP(_mm256_loadu_pd, _mm256_storeu_pd, EXPR_RDIV_PD)
+    }
+    double_op_scalar(op, dst + i, x + i, y != NULL ? y + i : NULL, c, n - i);
+}
+
+__attribute__((target("avx2")))
+static void int_to_long_avx2(int* src, long* dst, size_t n){
+    size_t i = 0;
+    for(;i+4<=n;i+=4){
+        _mm256_storeu_si256((__m256i*) (dst + i), _mm256_cvtepi32_epi64(_mm_loadu_si128((__m128i*) (src + i))));
+    }
+    int_to_long_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void int_to_double_avx2(int* src, double* dst, size_t n){
+    size_t i = 0;
+    for(;i+4<=n;i+=4){
+        _mm256_storeu_pd(dst + i, _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (src + i))));
+    }
+    int_to_double_scalar(src + i, dst + i, n - i);
+}
+#endif
+
+static inline int use_avx2(){
+#if EXPR_HAS_X86
+    return scan_current_kernel() == SCAN_KERNEL_AVX2;
+#else
+    return 0;
+#endif
+}
+
+static void long_op(ExprOpcode op, long* dst, long* x, long* y, long c, size_t n){
+#if EXPR_HAS_X86
+    if(use_avx2()){
+        long_op_avx2(op, dst, x, y, c, n);
+        return;
+    }
+#endif
+    long_op_scalar(op, dst, x, y, c, n);
+}
+
+static void double_op(ExprOpcode op, double* dst, double* x, double* y, double c, size_t n){
+#if EXPR_HAS_X86
+    if(use_avx2()){
+        double_op_avx2(op, dst, x, y, c, n);
+        return;
+    }
+#endif
+    double_op_scalar(op, dst, x, y, c, n);
+}
+
+//the n values of vector v from start on, of the computed type: in place, or converted into buf
+static void* vector_chunk(ExprMorselArgs* args, size_t v, size_t start, size_t n, void* buf){
+    DataType dt = args->dts[v];
+    void* payload = args->payloads[v];
+    if(args->compute_float){
+        if(dt == FLOAT){
+            return (double*) payload + start;
+        }
+        double* dst = (double*) buf;
+        if(dt == INT){
+#if EXPR_HAS_X86
+            if(use_avx2()){
+                int_to_double_avx2((int*) payload + start, dst, n);
+                return dst;
+            }
+#endif
+            int_to_double_scalar((int*) payload + start, dst, n);
+        }else{
+            //no conversion of 64 bit ints in AVX2
+            for(size_t i=0;i<n;i++){
+                dst[i] = (double) ((long*) payload)[start + i];
+            }
+        }
+        return dst;
+    }
+    if(dt == LONG){
+        return (long*) payload + start;
+    }
+#if EXPR_HAS_X86
+    if(use_avx2()){
+        int_to_long_avx2((int*) payload + start, (long*) buf, n);
+        return buf;
+    }
+#endif
+    int_to_long_scalar((int*) payload + start, (long*) buf, n);
+    return buf;
+}
+
+static void expr_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    ExprMorselArgs* args = (ExprMorselArgs*) a;
+    ExprProgram* program = args->program;
+    //slot 0 is the output, the other slots and the scratch buffer of vector operands are chunks of this morsel
+    char* chunks = malloc(program->depth * EXPR_CHUNK * sizeof(double));
+    void* buf[EXPR_MAX_DEPTH];
+    void* cur[EXPR_MAX_DEPTH];
+    void* scratch = chunks + (program->depth - 1) * EXPR_CHUNK * sizeof(double);
+    for(size_t s=1;s<program->depth;s++){
+        buf[s] = chunks + (s - 1) * EXPR_CHUNK * sizeof(double);
+    }
+    ExprInstruction* ins;
+    size_t sp, n;
+    void* y;
+    for(size_t chunk_start=start;chunk_start<end;chunk_start+=EXPR_CHUNK){
+        n = end - chunk_start < EXPR_CHUNK ? end - chunk_start : EXPR_CHUNK;
+        buf[0] = (char*) args->res_payload + chunk_start * sizeof(double);
+        sp = 0;
+        for(size_t k=0;k<program->instruction_num;k++){
+            ins = &program->instructions[k];
+            if(ins->op == EXPR_LOAD){
+                cur[sp] = vector_chunk(args, ins->vector, chunk_start, n, buf[sp]);
+                sp++;
+                continue;
+            }
+            if(ins->operand == EXPR_ON_STACK){
+                y = cur[--sp];
+            }else if(ins->operand == EXPR_ON_VECTOR){
+                y = vector_chunk(args, ins->vector, chunk_start, n, scratch);
+            }else{
+                y = NULL;
+            }
+            if(args->compute_float){
+                double_op(ins->op, (double*) buf[sp-1], (double*) cur[sp-1], (double*) y, ins->d, n);
+            }else{
+                long_op(ins->op, (long*) buf[sp-1], (long*) cur[sp-1], (long*) y, ins->l, n);
+            }
+            cur[sp-1] = buf[sp-1];
+        }
+        //a lone vector of the computed type is still in place
+        if(cur[0] != buf[0]){
+            memcpy(buf[0], cur[0], n * sizeof(double));
+        }
+    }
+    free(chunks);
+}
+
+void expr_evaluate(ExprProgram* program, size_t tuples_num, void* res_payload){
+    ExprMorselArgs args;
+    args.program = program;
+    args.compute_float = expr_result_type(program) == FLOAT;
+    for(size_t v=0;v<program->gch_num;v++){
+        GCHandle* gch = program->gchs[v];
+        args.payloads[v] = gch->type == COLUMN ? (void*) gch->p.column->data : gch->p.result->payload;
+        args.dts[v] = expr_vector_type(gch);
+    }
+    args.res_payload = res_payload;
+    morsel_run(tuples_num, expr_morsel, &args);
+}
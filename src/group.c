@@ -0,0 +1,472 @@
+#include <string.h>
+#include "cs165_api.h"
+#include "group.h"
+#include "morsel.h"
+#include "threadpool.h"
+#include "utils.h"
+
+// keys looked at to estimate the number of groups when there are no statistics
+#define GROUP_SAMPLE_SIZE 4096
+// a hash chunk holds at least this many tuples per group, so that merging the tables of the
+// chunks costs little next to filling them
+#define GROUP_CHUNK_TUPLES_PER_GROUP 64
+
+typedef union GroupValue {
+    long l;
+    double d;
+} GroupValue;
+
+/*
+ * running aggregate of one group: count tuples folded so far, acc their sum, min or max
+ */
+typedef struct GroupEntry {
+    int key;
+    int used;
+    long count;
+    GroupValue acc;
+} GroupEntry;
+
+/*
+ * open addressing with linear probing, capacity is 1 << bits and stays at least twice the size
+ */
+typedef struct GroupTable {
+    GroupEntry* entries;
+    unsigned int bits;
+    size_t size;
+} GroupTable;
+
+/*
+ * a tuple of the sort based path. Once its partition is aggregated, the first slots hold
+ * its groups instead: key, the count in pos and the aggregate in v.
+ */
+typedef struct GroupTuple {
+    int key;
+    int pos;
+    GroupValue v;
+} GroupTuple;
+
+typedef struct GroupMorselArgs {
+    int* key_vec;
+    void* val_payload;
+    DataType dt;
+    AggregateType t;
+    //hash path
+    size_t estimate;
+    //sort path
+    long min_key;
+    unsigned int shift;
+    size_t* counts;
+    GroupTuple* tuples;
+} GroupMorselArgs;
+
+typedef struct GroupChunkTask {
+    GroupMorselArgs* args;
+    size_t start;
+    size_t end;
+    GroupTable table;
+} GroupChunkTask;
+
+typedef struct GroupPartitionTask {
+    GroupTuple* tuples;
+    size_t tuples_num;
+    //key - min_key of the tuples only differ in their low key_bits bits
+    long min_key;
+    unsigned int key_bits;
+    size_t group_num;
+    int is_double;
+    AggregateType t;
+} GroupPartitionTask;
+
+DataType group_result_type(DataType dt, AggregateType t){
+    if(t == COUNT){
+        return LONG;
+    }else if(t == AVG){
+        return FLOAT;
+    }else if(t == SUM){
+        return dt == FLOAT ? FLOAT : LONG;
+    }
+    return dt;
+}
+
+static inline GroupValue read_value(void* val_payload, DataType dt, size_t i){
+    GroupValue v;
+    if(dt == INT){
+        v.l = ((int*) val_payload)[i];
+    }else if(dt == FLOAT){
+        v.d = ((double*) val_payload)[i];
+    }else{
+        v.l = ((long*) val_payload)[i];
+    }
+    return v;
+}
+
+//folds count tuples aggregated as v into g
+static inline void group_fold(GroupEntry* g, long count, GroupValue v, int is_double, AggregateType t){
+    if(g->count == 0){
+        g->acc = v;
+    }else if(is_double){
+        if(t == MIN){
+            g->acc.d = v.d < g->acc.d ? v.d : g->acc.d;
+        }else if(t == MAX){
+            g->acc.d = v.d > g->acc.d ? v.d : g->acc.d;
+        }else{
+            g->acc.d += v.d;
+        }
+    }else{
+        if(t == MIN){
+            g->acc.l = v.l < g->acc.l ? v.l : g->acc.l;
+        }else if(t == MAX){
+            g->acc.l = v.l > g->acc.l ? v.l : g->acc.l;
+        }else{
+            g->acc.l += v.l;
+        }
+    }
+    g->count += count;
+}
+
+static void group_store(void* res_vals, size_t g, DataType dt, AggregateType t, long count, GroupValue acc){
+    if(t == COUNT){
+        ((long*) res_vals)[g] = count;
+    }else if(t == AVG){
+        ((double*) res_vals)[g] = (dt == FLOAT ? acc.d : (double) acc.l) / (double) count;
+    }else if(dt == FLOAT){
+        ((double*) res_vals)[g] = acc.d;
+    }else if(dt == INT && t != SUM){
+        ((int*) res_vals)[g] = (int) acc.l;
+    }else{
+        ((long*) res_vals)[g] = acc.l;
+    }
+}
+
+static size_t result_size(DataType dt){
+    return dt == INT ? sizeof(int) : dt == FLOAT ? sizeof(double) : sizeof(long);
+}
+
+/*
+ * hash path
+ */
+static inline size_t group_hash(int key, unsigned int bits){
+    //multiplicative hashing, the high bits of the product are the best mixed
+    return (size_t) (((uint32_t) key * UINT32_C(2654435769)) >> (32 - bits));
+}
+
+static void table_init(GroupTable* table, size_t groups){
+    table->bits = 4;
+    while(((size_t) 1 << table->bits) < 2 * groups && table->bits < 31){
+        table->bits++;
+    }
+    table->entries = calloc((size_t) 1 << table->bits, sizeof(GroupEntry));
+    table->size = 0;
+}
+
+static GroupEntry* table_find(GroupTable* table, int key);
+
+static void table_grow(GroupTable* table){
+    GroupEntry* old = table->entries;
+    size_t old_capacity = (size_t) 1 << table->bits;
+    table->bits++;
+    table->entries = calloc((size_t) 1 << table->bits, sizeof(GroupEntry));
+    table->size = 0;
+    GroupEntry* g;
+    for(size_t i=0;i<old_capacity;i++){
+        if(old[i].used){
+            g = table_find(table, old[i].key);
+            g->count = old[i].count;
+            g->acc = old[i].acc;
+        }
+    }
+    free(old);
+}
+
+//entry of key, a new empty one if the key is not there yet
+static GroupEntry* table_find(GroupTable* table, int key){
+    if(2 * (table->size + 1) > ((size_t) 1 << table->bits)){
+        table_grow(table);
+    }
+    size_t mask = ((size_t) 1 << table->bits) - 1;
+    size_t i = group_hash(key, table->bits);
+    GroupEntry* entries = table->entries;
+    while(entries[i].used && entries[i].key != key){
+        i = (i + 1) & mask;
+    }
+    if(!entries[i].used){
+        entries[i].used = 1;
+        entries[i].key = key;
+        entries[i].count = 0;
+        table->size++;
+    }
+    return &entries[i];
+}
+
+static void hash_chunk(void* a){
+    GroupChunkTask* task = (GroupChunkTask*) a;
+    GroupMorselArgs* args = task->args;
+    GroupTable* table = &task->table;
+    table_init(table, args->estimate < task->end - task->start ? args->estimate : task->end - task->start);
+    int is_double = args->dt == FLOAT;
+    for(size_t i=task->start;i<task->end;i++){
+        group_fold(table_find(table, args->key_vec[i]), 1, read_value(args->val_payload, args->dt, i), is_double, args->t);
+    }
+}
+
+static int compare_entry_key(const void* a, const void* b){
+    int x = ((const GroupEntry*) a)->key;
+    int y = ((const GroupEntry*) b)->key;
+    return (x > y) - (x < y);
+}
+
+static size_t group_hash_aggregate(GroupMorselArgs* args, size_t tuples_num, int** res_keys, void** res_vals){
+    //chunks of at least a morsel, sized by the number of groups rather than of workers,
+    //so the results do not depend on the latter
+    size_t chunk_size = args->estimate * GROUP_CHUNK_TUPLES_PER_GROUP;
+    chunk_size = chunk_size < MORSEL_SIZE ? MORSEL_SIZE : chunk_size;
+    size_t chunk_num = (tuples_num + chunk_size - 1) / chunk_size;
+    GroupChunkTask* tasks = malloc(chunk_num * sizeof(GroupChunkTask));
+    TaskGroup task_group;
+    task_group_init(&task_group);
+    for(size_t c=0;c<chunk_num;c++){
+        tasks[c].args = args;
+        tasks[c].start = c * chunk_size;
+        tasks[c].end = c + 1 < chunk_num ? (c + 1) * chunk_size : tuples_num;
+        threadpool_submit(&task_group, hash_chunk, &tasks[c]);
+    }
+    threadpool_wait(&task_group);
+    //the groups of every chunk are folded in chunk order
+    GroupTable table;
+    table_init(&table, args->estimate);
+    int is_double = args->dt == FLOAT;
+    GroupEntry* entries;
+    for(size_t c=0;c<chunk_num;c++){
+        entries = tasks[c].table.entries;
+        for(size_t i=0;i<((size_t) 1 << tasks[c].table.bits);i++){
+            if(entries[i].used){
+                group_fold(table_find(&table, entries[i].key), entries[i].count, entries[i].acc, is_double, args->t);
+            }
+        }
+        free(entries);
+    }
+    free(tasks);
+    //the used entries, by ascending key
+    size_t group_num = 0;
+    for(size_t i=0;i<((size_t) 1 << table.bits);i++){
+        if(table.entries[i].used){
+            table.entries[group_num++] = table.entries[i];
+        }
+    }
+    qsort(table.entries, group_num, sizeof(GroupEntry), compare_entry_key);
+    DataType rdt = group_result_type(args->dt, args->t);
+    *res_keys = malloc(group_num * sizeof(int));
+    *res_vals = malloc(group_num * result_size(rdt));
+    for(size_t g=0;g<group_num;g++){
+        (*res_keys)[g] = table.entries[g].key;
+        group_store(*res_vals, g, args->dt, args->t, table.entries[g].count, table.entries[g].acc);
+    }
+    free(table.entries);
+    return group_num;
+}
+
+/*
+ * sort path
+ */
+static inline size_t partition_of(int key, long min_key, unsigned int shift){
+    return (size_t) ((unsigned long) ((long) key - min_key) >> shift);
+}
+
+static void histogram_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    GroupMorselArgs* args = (GroupMorselArgs*) a;
+    size_t* counts = args->counts + morsel_id * GROUP_PARTITIONS;
+    for(size_t i=start;i<end;i++){
+        counts[partition_of(args->key_vec[i], args->min_key, args->shift)]++;
+    }
+}
+
+//counts hold the offset of the slice of every partition the morsel writes to
+static void scatter_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    GroupMorselArgs* args = (GroupMorselArgs*) a;
+    size_t* offsets = args->counts + morsel_id * GROUP_PARTITIONS;
+    GroupTuple* tuple;
+    for(size_t i=start;i<end;i++){
+        tuple = &args->tuples[offsets[partition_of(args->key_vec[i], args->min_key, args->shift)]++];
+        tuple->key = args->key_vec[i];
+        tuple->pos = (int) i;
+        tuple->v = read_value(args->val_payload, args->dt, i);
+    }
+}
+
+//stable LSD radix sort on the low key_bits bits of key - min_key, 8 bits per pass.
+//The tuples of a partition arrive in position order, so the values of a group keep it.
+static void radix_sort_partition(GroupTuple* tuples, size_t tuples_num, long min_key, unsigned int key_bits){
+    GroupTuple* tmp = malloc(tuples_num * sizeof(GroupTuple));
+    GroupTuple* from = tuples;
+    GroupTuple* to = tmp;
+    GroupTuple* swap;
+    size_t counts[256];
+    size_t offset, count;
+    unsigned int digit;
+    for(unsigned int shift=0;shift<key_bits;shift+=8){
+        memset(counts, 0, sizeof(counts));
+        for(size_t i=0;i<tuples_num;i++){
+            counts[((unsigned long) ((long) from[i].key - min_key) >> shift) & 255]++;
+        }
+        offset = 0;
+        for(size_t d=0;d<256;d++){
+            count = counts[d];
+            counts[d] = offset;
+            offset += count;
+        }
+        for(size_t i=0;i<tuples_num;i++){
+            digit = ((unsigned long) ((long) from[i].key - min_key) >> shift) & 255;
+            to[counts[digit]++] = from[i];
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    if(from != tuples){
+        memcpy(tuples, from, tuples_num * sizeof(GroupTuple));
+    }
+    free(tmp);
+}
+
+static void aggregate_partition(void* a){
+    GroupPartitionTask* task = (GroupPartitionTask*) a;
+    GroupTuple* tuples = task->tuples;
+    radix_sort_partition(tuples, task->tuples_num, task->min_key, task->key_bits);
+    //every run of a key becomes one group, written over the slots already read
+    size_t g = 0;
+    GroupEntry entry;
+    size_t i = 0;
+    while(i < task->tuples_num){
+        entry.key = tuples[i].key;
+        entry.count = 0;
+        entry.acc = tuples[i].v;
+        for(;i<task->tuples_num && tuples[i].key == entry.key;i++){
+            group_fold(&entry, 1, tuples[i].v, task->is_double, task->t);
+        }
+        tuples[g].key = entry.key;
+        tuples[g].pos = (int) entry.count;
+        tuples[g].v = entry.acc;
+        g++;
+    }
+    task->group_num = g;
+}
+
+static size_t group_sort_aggregate(GroupMorselArgs* args, size_t tuples_num, int** res_keys, void** res_vals){
+    //range partitions over [min_key, max_key], so that they hold increasing keys
+    args->min_key = morsel_min_max_int(args->key_vec, tuples_num, MIN);
+    unsigned long range = (unsigned long) ((long) morsel_min_max_int(args->key_vec, tuples_num, MAX) - args->min_key);
+    args->shift = 0;
+    while((range >> args->shift) >= GROUP_PARTITIONS){
+        args->shift++;
+    }
+    size_t morsel_num = morsel_count(tuples_num);
+    args->counts = calloc(morsel_num * GROUP_PARTITIONS, sizeof(size_t));
+    morsel_run(tuples_num, histogram_morsel, args);
+    //partition by partition, the slices of the morsels in morsel order
+    size_t partition_start[GROUP_PARTITIONS + 1];
+    size_t offset = 0;
+    size_t count;
+    for(size_t p=0;p<GROUP_PARTITIONS;p++){
+        partition_start[p] = offset;
+        for(size_t m=0;m<morsel_num;m++){
+            count = args->counts[m * GROUP_PARTITIONS + p];
+            args->counts[m * GROUP_PARTITIONS + p] = offset;
+            offset += count;
+        }
+    }
+    partition_start[GROUP_PARTITIONS] = offset;
+    args->tuples = malloc(tuples_num * sizeof(GroupTuple));
+    morsel_run(tuples_num, scatter_morsel, args);
+    free(args->counts);
+    GroupPartitionTask tasks[GROUP_PARTITIONS];
+    TaskGroup task_group;
+    task_group_init(&task_group);
+    for(size_t p=0;p<GROUP_PARTITIONS;p++){
+        tasks[p].tuples = args->tuples + partition_start[p];
+        tasks[p].tuples_num = partition_start[p+1] - partition_start[p];
+        tasks[p].min_key = args->min_key;
+        tasks[p].key_bits = args->shift;
+        tasks[p].group_num = 0;
+        tasks[p].is_double = args->dt == FLOAT;
+        tasks[p].t = args->t;
+        if(tasks[p].tuples_num > 0){
+            threadpool_submit(&task_group, aggregate_partition, &tasks[p]);
+        }
+    }
+    threadpool_wait(&task_group);
+    size_t group_num = 0;
+    for(size_t p=0;p<GROUP_PARTITIONS;p++){
+        group_num += tasks[p].group_num;
+    }
+    DataType rdt = group_result_type(args->dt, args->t);
+    *res_keys = malloc(group_num * sizeof(int));
+    *res_vals = malloc(group_num * result_size(rdt));
+    size_t g = 0;
+    GroupTuple* tuple;
+    for(size_t p=0;p<GROUP_PARTITIONS;p++){
+        for(size_t k=0;k<tasks[p].group_num;k++){
+            tuple = &tasks[p].tuples[k];
+            (*res_keys)[g] = tuple->key;
+            group_store(*res_vals, g, args->dt, args->t, tuple->pos, tuple->v);
+            g++;
+        }
+    }
+    free(args->tuples);
+    return group_num;
+}
+
+static int compare_int_key(const void* a, const void* b){
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+//distinct keys among GROUP_SAMPLE_SIZE evenly spread ones (all of them if there are fewer)
+static size_t sample_distinct(int* key_vec, size_t tuples_num, size_t* sample_num){
+    size_t n = tuples_num < GROUP_SAMPLE_SIZE ? tuples_num : GROUP_SAMPLE_SIZE;
+    int* sample = malloc(n * sizeof(int));
+    for(size_t i=0;i<n;i++){
+        sample[i] = key_vec[i * (tuples_num / n)];
+    }
+    qsort(sample, n, sizeof(int), compare_int_key);
+    size_t distinct = 1;
+    for(size_t i=1;i<n;i++){
+        distinct += sample[i] != sample[i-1];
+    }
+    free(sample);
+    *sample_num = n;
+    return distinct;
+}
+
+size_t group_aggregate(int* key_vec, void* val_payload, DataType dt, size_t tuples_num, AggregateType t,
+                       size_t distinct_estimate, int** res_keys, void** res_vals){
+    if(tuples_num == 0){
+        *res_keys = NULL;
+        *res_vals = NULL;
+        return 0;
+    }
+    int use_hash;
+    if(distinct_estimate > 0){
+        use_hash = distinct_estimate <= GROUP_HASH_MAX;
+    }else{
+        size_t sample_num;
+        distinct_estimate = sample_distinct(key_vec, tuples_num, &sample_num);
+        if(sample_num == tuples_num){
+            use_hash = distinct_estimate <= GROUP_HASH_MAX;
+        }else{
+            //keys seldom repeating in the sample are many
+            use_hash = 2 * distinct_estimate <= sample_num;
+        }
+    }
+    GroupMorselArgs args;
+    args.key_vec = key_vec;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.t = t;
+    args.estimate = distinct_estimate;
+    cs165_log(stdout, "group_agg: %zu tuples, ~%zu groups, %s based\n", tuples_num, distinct_estimate, use_hash ? "hash" : "sort");
+    if(use_hash){
+        return group_hash_aggregate(&args, tuples_num, res_keys, res_vals);
+    }
+    return group_sort_aggregate(&args, tuples_num, res_keys, res_vals);
+}
@@ -0,0 +1,210 @@
+#include <limits.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "imprints.h"
+#include "utils.h"
+
+#define IMPRINT_SAMPLE 2048 //values sampled to pick the bins
+
+ImprintIndex* imprints_create(){
+    ImprintIndex* ii = calloc(1, sizeof(ImprintIndex));
+    ii->bounds[0] = INT_MIN;
+    ii->bin_num = 1;
+    return ii;
+}
+
+void imprints_free(ImprintIndex* ii){
+    free(ii->imprints);
+    free(ii->dict);
+    free(ii);
+}
+
+static int compare_int(const void* a, const void* b){
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+//the last bin whose lower bound is <= value
+static size_t imprint_bin(ImprintIndex* ii, long value){
+    size_t lo = 0;
+    size_t hi = ii->bin_num;
+    size_t mid;
+    while(hi - lo > 1){
+        mid = (lo + hi) / 2;
+        if(ii->bounds[mid] <= value){
+            lo = mid;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//equi-depth bins over a sorted sample, a value repeated over several bins gets a single one
+static void pick_bins(ImprintIndex* ii, int* data, size_t size){
+    size_t sample_num = size < IMPRINT_SAMPLE ? size : IMPRINT_SAMPLE;
+    ii->bounds[0] = INT_MIN;
+    ii->bin_num = 1;
+    ii->built_size = size;
+    if(sample_num == 0){
+        return;
+    }
+    int* sample = malloc(sample_num * sizeof(int));
+    for(size_t i=0;i<sample_num;i++){
+        sample[i] = data[i * size / sample_num];
+    }
+    qsort(sample, sample_num, sizeof(int), compare_int);
+    int bound;
+    for(size_t b=1;b<IMPRINT_BINS;b++){
+        bound = sample[b * sample_num / IMPRINT_BINS];
+        if(bound > ii->bounds[ii->bin_num-1]){
+            ii->bounds[ii->bin_num++] = bound;
+        }
+    }
+    free(sample);
+}
+
+static uint64_t line_imprint(ImprintIndex* ii, int* data, size_t start, size_t end){
+    uint64_t imprint = 0;
+    for(size_t i=start;i<end;i++){
+        imprint |= UINT64_C(1) << imprint_bin(ii, data[i]);
+    }
+    return imprint;
+}
+
+//adds the imprint of the next cache line, merged with the previous line when they are equal
+static void push_line(ImprintIndex* ii, uint64_t imprint){
+    if(ii->dict_num == ii->dict_capacity){
+        ii->dict_capacity = ii->dict_capacity > 0 ? 2 * ii->dict_capacity : 64;
+        ii->dict = realloc(ii->dict, ii->dict_capacity * sizeof(uint32_t));
+    }
+    if(ii->imprint_num == ii->imprint_capacity){
+        ii->imprint_capacity = ii->imprint_capacity > 0 ? 2 * ii->imprint_capacity : 64;
+        ii->imprints = realloc(ii->imprints, ii->imprint_capacity * sizeof(uint64_t));
+    }
+    uint32_t* last = ii->dict_num > 0 ? &ii->dict[ii->dict_num-1] : NULL;
+    if(last != NULL && ii->imprints[ii->imprint_num-1] == imprint){
+        if(*last & 1){
+            *last += 2;
+            return;
+        }
+        //the previous line leaves its run of distinct imprints and starts a repeated one with this line
+        *last -= 2;
+        if((*last >> 1) == 0){
+            *last = (2 << 1) | 1;
+        }else{
+            ii->dict[ii->dict_num++] = (2 << 1) | 1;
+        }
+        return;
+    }
+    if(last != NULL && !(*last & 1)){
+        *last += 2;
+    }else{
+        ii->dict[ii->dict_num++] = 1 << 1;
+    }
+    ii->imprints[ii->imprint_num++] = imprint;
+}
+
+//removes the last cache line
+static void pop_line(ImprintIndex* ii){
+    uint32_t* last = &ii->dict[ii->dict_num-1];
+    *last -= 2;
+    if(!(*last & 1)){
+        ii->imprint_num--;
+    }
+    if((*last >> 1) == 0){
+        ii->imprint_num -= *last & 1;
+        ii->dict_num--;
+    }
+}
+
+void imprints_build(ImprintIndex* ii, int* data, size_t size){
+    pick_bins(ii, data, size);
+    ii->dict_num = 0;
+    ii->imprint_num = 0;
+    for(size_t start=0;start<size;start+=IMPRINT_LINE){
+        push_line(ii, line_imprint(ii, data, start, start + IMPRINT_LINE < size ? start + IMPRINT_LINE : size));
+    }
+    ii->size = size;
+    cs165_log(stdout, "imprints: %zd bins, %zd imprints and %zd runs for %zd cache lines\n",
+              ii->bin_num, ii->imprint_num, ii->dict_num, (size + IMPRINT_LINE - 1) / IMPRINT_LINE);
+}
+
+void imprints_append(ImprintIndex* ii, int* data, size_t size){
+    if(size > 2 * ii->built_size || ii->size + 1 != size){
+        //bins picked from a column half the size may not split the values well anymore
+        imprints_build(ii, data, size);
+        return;
+    }
+    uint64_t bit = UINT64_C(1) << imprint_bin(ii, data[size-1]);
+    if((size - 1) % IMPRINT_LINE == 0){
+        push_line(ii, bit);
+    }else if((ii->imprints[ii->imprint_num-1] | bit) != ii->imprints[ii->imprint_num-1]){
+        //the imprint of the last cache line changes
+        uint64_t imprint = ii->imprints[ii->imprint_num-1] | bit;
+        pop_line(ii);
+        push_line(ii, imprint);
+    }
+    ii->size = size;
+}
+
+size_t imprints_scan_bitmap(ImprintIndex* ii, int* data, Comparator* comp, uint64_t* bitmap){
+    size_t size = ii->size;
+    memset(bitmap, 0, bitmap_words(size) * sizeof(uint64_t));
+    long low = comp->ct1 != NO_COMPARISON ? comp->lowerbound : LONG_MIN;
+    long high = comp->ct2 != NO_COMPARISON ? comp->upperbound : LONG_MAX;
+    if(size == 0 || low >= high || low > INT_MAX || high <= INT_MIN){
+        return 0;
+    }
+    //mask: bins the range overlaps, inner: bins it covers entirely
+    uint64_t mask = 0;
+    uint64_t inner = 0;
+    long bin_low, bin_high;
+    for(size_t b=imprint_bin(ii, low);b<=imprint_bin(ii, high - 1);b++){
+        mask |= UINT64_C(1) << b;
+        bin_low = ii->bounds[b];
+        bin_high = b + 1 < ii->bin_num ? ii->bounds[b+1] : (long) INT_MAX + 1;
+        if(bin_low >= low && bin_high <= high){
+            inner |= UINT64_C(1) << b;
+        }
+    }
+    size_t count = 0;
+    size_t skipped = 0;
+    size_t emitted = 0;
+    size_t checked = 0;
+    size_t line = 0;
+    size_t next_imprint = 0;
+    size_t lines, start, end;
+    int repeat;
+    uint64_t imprint, word;
+    for(size_t e=0;e<ii->dict_num;e++){
+        lines = ii->dict[e] >> 1;
+        repeat = ii->dict[e] & 1;
+        for(size_t l=0;l<lines;l++){
+            imprint = ii->imprints[repeat ? next_imprint : next_imprint + l];
+            start = (line + l) * IMPRINT_LINE;
+            end = start + IMPRINT_LINE < size ? start + IMPRINT_LINE : size;
+            if((imprint & mask) == 0){
+                skipped++;
+            }else if((imprint & ~inner) == 0){
+                bitmap[start >> 6] |= ((UINT64_C(1) << (end - start)) - 1) << (start & 63);
+                count += end - start;
+                emitted++;
+            }else{
+                //a cache line shares its bitmap word with the 3 others of the word
+                word = 0;
+                for(size_t i=start;i<end;i++){
+                    word |= (uint64_t) ((data[i] >= low) & (data[i] < high)) << (i - start);
+                }
+                bitmap[start >> 6] |= word << (start & 63);
+                count += __builtin_popcountll(word);
+                checked++;
+            }
+        }
+        line += lines;
+        next_imprint += repeat ? 1 : lines;
+    }
+    cs165_log(stdout, "imprints: %zd cache lines skipped, %zd emitted whole, %zd checked\n", skipped, emitted, checked);
+    return count;
+}
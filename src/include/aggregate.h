@@ -0,0 +1,70 @@
+// aggregate.h
+//
+// Reduction kernels of sum, min and max over a vector, and of all of them at once for aggregates(),
+// run by the morsels of morsel.c and compress.c.
+// The hot loops have no data dependent branch: min and max pick their loop once, outside of it.
+// Like the scan kernels, the AVX2 versions are used when the kernel selected by scan_init
+// (or scan_set_kernel) is SCAN_KERNEL_AVX2, scalar ones otherwise. Int sums are accumulated in
+// 64 bit lanes. Double sums keep the scalar, in order loop, so that avg prints the same digits
+// whatever the cpu.
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "cs165_api.h"
+
+/*
+ * count, sum, min and max of a vector, plus the sum of the squared deviations from its mean (m2)
+ * when the variance is asked for. INT and LONG vectors fill sum, min and max, FLOAT ones the double_ fields.
+ */
+typedef struct AggStats {
+    size_t count;
+    long sum;
+    long min;
+    long max;
+    double double_sum;
+    double double_min;
+    double double_max;
+    double m2;
+} AggStats;
+
+long agg_sum_int(int* val_vec, size_t tuples_num);
+
+long agg_sum_long(long* val_vec, size_t tuples_num);
+
+/**
+ * t is MIN or MAX, tuples_num must be > 0
+ **/
+int agg_min_max_int(int* val_vec, size_t tuples_num, AggregateType t);
+
+long agg_min_max_long(long* val_vec, size_t tuples_num, AggregateType t);
+
+double agg_min_max_double(double* val_vec, size_t tuples_num, AggregateType t);
+
+/**
+ * index of the first min or max of val_vec (t is MIN or MAX), tuples_num must be > 0
+ **/
+size_t agg_arg_min_max_int(int* val_vec, size_t tuples_num, AggregateType t);
+
+size_t agg_arg_min_max_long(long* val_vec, size_t tuples_num, AggregateType t);
+
+size_t agg_arg_min_max_double(double* val_vec, size_t tuples_num, AggregateType t);
+
+/**
+ * fills stats with count, sum, min and max of val_vec in one pass, and m2 too if with_m2
+ * (a second pass over the same values, still in cache). tuples_num must be > 0.
+ * The double sum adds the values in order, like morsel_sum_double does within a morsel.
+ **/
+void agg_stats_int(int* val_vec, size_t tuples_num, int with_m2, AggStats* stats);
+
+void agg_stats_long(long* val_vec, size_t tuples_num, int with_m2, AggStats* stats);
+
+void agg_stats_double(double* val_vec, size_t tuples_num, int with_m2, AggStats* stats);
+
+/**
+ * folds the stats of the next part of a vector into stats (m2 with the pairwise update of Chan et al.).
+ * stats->count == 0 means no part yet.
+ **/
+void agg_stats_merge(AggStats* stats, AggStats* part, DataType dt);
+
+#endif /* AGGREGATE_H */
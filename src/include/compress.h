@@ -0,0 +1,73 @@
+// compress.h
+//
+// Lightweight compression of int columns, see ColumnEncoding and EncodedColumn in cs165_api.h.
+// A column without index is encoded at the end of a load, with the encoding that stores it in
+// the fewest bytes: frame of reference bit packing for narrow value ranges, run length encoding
+// for sorted or clustered data, dictionary encoding for few distinct values spread over a wide range.
+// A column stays plain unless the encoding takes at most half of its plain size.
+// Full scans, fetches, sum, avg, min, max and aggregates() run on the encoded values, morsel by morsel,
+// and scans still skip or emit whole zones from the zone map, which is kept.
+// Every other use of the column, and every change to its table, decodes it first
+// (see decode_column_operands in server.c).
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdio.h>
+#include "cs165_api.h"
+#include "aggregate.h"
+
+/**
+ * encodes the size values of column->data if that pays off, data is then freed and NULL.
+ * capacity is the room data gets back when the column is decoded.
+ **/
+void column_encode(Column* column, size_t capacity);
+
+/**
+ * restores column->data from the encoded values and frees them, does nothing for a PLAIN column
+ **/
+void column_decode(Column* column);
+
+void encoded_free(EncodedColumn* enc);
+
+/**
+ * sets the bits of the positions of the encoded column satisfying comp, returns their number.
+ * bitmap has room for bitmap_words(column->size) words.
+ **/
+size_t encoded_scan_bitmap(Column* column, Comparator* comp, uint64_t* bitmap);
+
+/**
+ * res_vec[i] = value at position pos_vec[i] of the encoded column, for i in [0, tuples_num)
+ **/
+void encoded_fetch(Column* column, int* pos_vec, size_t tuples_num, int* res_vec);
+
+/**
+ * same as encoded_fetch on the calling thread, for kernels that already run one morsel at a time
+ **/
+void encoded_gather(Column* column, int* pos_vec, size_t tuples_num, int* res_vec);
+
+/**
+ * res_vec[i - start] = value at position i of the encoded column, for i in [start, end), on the calling thread
+ **/
+void encoded_decode(Column* column, size_t start, size_t end, int* res_vec);
+
+long encoded_sum(Column* column);
+
+/**
+ * same as morsel_stats (see morsel.h) over the values of the encoded column, without decoding all of them at once
+ **/
+void encoded_stats(Column* column, int with_m2, AggStats* stats);
+
+/**
+ * t is MIN or MAX, the column is not empty
+ **/
+int encoded_min_max(Column* column, AggregateType t);
+
+/**
+ * writes and reads back the values of an encoded column, after its metadata (see dump_db)
+ **/
+void encoded_dump(FILE* fd, Column* column);
+
+void encoded_load(FILE* fd, Column* column);
+
+#endif /* COMPRESS_H */
@@ -0,0 +1,26 @@
+// conjunction.h
+//
+// Conjunctive selects: select(<col>,<low>,<high>,<col>,<low>,<high>[,...]) over columns of one table.
+// The predicates are ordered by the number of rows the column statistics estimate they keep
+// (see stats.h). The most selective one is evaluated like a single column select, with its index
+// or a scan, and every following predicate only reads its column at the positions still qualifying,
+// dropping the ones that fail from the result in place. No intermediate result is allocated and
+// the columns of the later predicates are touched at fewer and fewer positions.
+
+#ifndef CONJUNCTION_H
+#define CONJUNCTION_H
+
+#include "cs165_api.h"
+
+/**
+ * order in which the predicate_num predicates are evaluated, most selective first, to be freed by the caller
+ **/
+size_t* conjunction_order(Column** columns, Comparator* comparators, size_t predicate_num);
+
+/**
+ * removes from res (a VECTOR, BITMAP or RANGES of positions of column) the positions whose value fails comp,
+ * one morsel per task. A bitmap that becomes sparse is converted to a position list.
+ **/
+void conjunction_refine(Column* column, Comparator* comp, Result* res);
+
+#endif /* CONJUNCTION_H */
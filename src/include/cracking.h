@@ -0,0 +1,46 @@
+// cracking.h
+//
+// Adaptive indexing (database cracking) of CRACKED columns, see CrackerIndex in cs165_api.h.
+// The cracker copy of a column starts unordered. Every select partitions the pieces of the
+// copy holding its bounds around them, in place, and remembers the cracks: a select whose
+// bounds fall in one piece partitions it in three in a single pass (crack-in-three), otherwise
+// each bound partitions its piece in two (crack-in-two). The qualifying values always end up
+// contiguous in the copy, and the pieces get smaller with every query, so that a column queried
+// often converges to a sorted copy without paying for a sort up front.
+
+#ifndef CRACKING_H
+#define CRACKING_H
+
+#include "cs165_api.h"
+
+/**
+ * empty cracker index, with room for capacity values
+ **/
+CrackerIndex* cracker_create(size_t capacity);
+
+void cracker_free(CrackerIndex* ci);
+
+/**
+ * replaces the cracker copy by data[0, size), without any crack
+ **/
+void cracker_build(CrackerIndex* ci, int* data, size_t size);
+
+/**
+ * cracks the copy on the bounds of comp if they are not cracks yet, and returns the range
+ * [*start, *end) of the copy holding the values satisfying comp.
+ **/
+void cracker_select(CrackerIndex* ci, Comparator* comp, size_t* start, size_t* end);
+
+/**
+ * adds key, inserted at position pos of the column. Positions from pos on move one up.
+ * The pieces after the piece of key give their first value to their end, so the cracks are kept.
+ **/
+void cracker_insert(CrackerIndex* ci, int key, size_t pos);
+
+/**
+ * removes the positions set in deleted[0, len) from the copy in one pass and renumbers the others,
+ * as the column compacts its data. The cracks are kept.
+ **/
+void cracker_delete(CrackerIndex* ci, uint64_t* deleted, size_t len);
+
+#endif /* CRACKING_H */
@@ -28,11 +28,14 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <message.h>
 
 // Limits the size of a name in our database to 64 characters
 #define MAX_SIZE_NAME 64
 #define HANDLE_MAX_SIZE 64
+// handles on the left of '=' of a query, one per output (aggregates() has the most)
+#define MAX_CLIENT_VARIABLES 6
 #define PAGE_SIZE 4096
 #define SAFE_MARGIN 64
 //#define FANOUT ((PAGE_SIZE-2*sizeof(int)-SAFE_MARGIN)/(8+sizeof(int)))//tunes later
@@ -43,6 +46,11 @@ SOFTWARE.
 #define BUCKET_SIZE 32 //tunes later
 #define INITIAL_BIT_LEN 4
 #define INITIAL_POSITIONLIST_LEN 256
+#define ZONE_SIZE 4096 //values per zone map block, a multiple of 64 that divides MORSEL_SIZE
+#define HISTOGRAM_BUCKETS 64 //equi-depth buckets of a column histogram, fewer when values repeat
+#define HLL_PRECISION 11 //2^11 registers per distinct count sketch, ~2.3% standard error
+#define IMPRINT_LINE 16 //values per column imprint, one 64 byte cache line of ints
+#define IMPRINT_BINS 64 //value range bins of a column imprint, one bit each
 /**
  * EXTRA
  * DataType
@@ -93,6 +101,9 @@ typedef enum IndexType {
     SORTED_CLUSTERED,
     SORTED_UNCLUSTERED,
     NONE,
+    // appended so that the values persisted in db_meta keep their meaning
+    CRACKED,
+    IMPRINTS,
 } IndexType;
 
 typedef struct BTreeNode BTreeNode;
@@ -126,6 +137,45 @@ typedef struct ColumnIndex {
 } ColumnIndex;
 
 
+/*
+ * CrackerIndex is the adaptive index of a CRACKED column (see cracking.h).
+ * key_vec, pos_vec: copy of the size values of the column and their positions, reorganized by every select
+ * crack_keys, crack_pos: the crack_num cracks in key order, the values before crack_pos[i] are < crack_keys[i]
+ *                        and the values from crack_pos[i] on are >= crack_keys[i]
+ */
+typedef struct CrackerIndex {
+    int* key_vec;
+    int* pos_vec;
+    size_t size;
+    size_t capacity;
+    int* crack_keys;
+    size_t* crack_pos;
+    size_t crack_num;
+    size_t crack_capacity;
+} CrackerIndex;
+
+/*
+ * ImprintIndex holds the column imprints of an IMPRINTS column (see imprints.h).
+ * bounds, bin_num: bin b holds the values in [bounds[b], bounds[b+1]), bounds[0] is INT_MIN and the last bin ends at INT_MAX
+ * imprints: per cache line of IMPRINT_LINE values, one bit per bin holding one of its values
+ * dict: run length compression of the imprints, entry e covers dict[e] >> 1 cache lines. If dict[e] & 1
+ *       they all share the next imprint, otherwise each of them has its own
+ * size: values covered, the last cache line may be partial
+ * built_size: values covered when the bins were picked
+ */
+typedef struct ImprintIndex {
+    int bounds[IMPRINT_BINS];
+    size_t bin_num;
+    uint64_t* imprints;
+    size_t imprint_num;
+    size_t imprint_capacity;
+    uint32_t* dict;
+    size_t dict_num;
+    size_t dict_capacity;
+    size_t size;
+    size_t built_size;
+} ImprintIndex;
+
 /* Alternative design: does not make much sense though if updates are often
 typedef struct ColumnIndex {
     IndexPair* indexes;
@@ -137,6 +187,77 @@ typedef struct IndexPair {
     int pos;
 } IndexPair;
 
+/*
+ * ZoneMap keeps the min and max value of every block of ZONE_SIZE consecutive values of a column,
+ * so that scans can skip blocks without a qualifying value and emit blocks where every value qualifies.
+ * zone_num: number of blocks holding data, the last one may be partial
+ * zone_capacity: number of blocks min_vec and max_vec have room for
+ */
+typedef struct ZoneMap {
+    int* min_vec;
+    int* max_vec;
+    size_t zone_num;
+    size_t zone_capacity;
+} ZoneMap;
+
+/*
+ * ColumnStats summarizes the values of a column for cardinality estimates (see stats.h).
+ * It has no pointer so that it is dumped and loaded with the rest of the column metadata.
+ * row_count, min, max: of the column, min and max only widen between two builds
+ * bounds, counts: equi-depth histogram, bucket b holds the counts[b] values in [bounds[b], bounds[b+1]),
+ *                 the last bucket the values from bounds[bucket_num-1] up to max
+ * hll: HyperLogLog registers of the values, only grows between two builds
+ * built_rows, modified: rows at the last build and rows inserted or deleted since
+ */
+typedef struct ColumnStats {
+    size_t row_count;
+    int min;
+    int max;
+    size_t bucket_num;
+    int bounds[HISTOGRAM_BUCKETS];
+    size_t counts[HISTOGRAM_BUCKETS];
+    uint8_t hll[1 << HLL_PRECISION];
+    size_t built_rows;
+    size_t modified;
+} ColumnStats;
+
+/*
+ * ColumnEncoding: how the values of a column are stored (see compress.h).
+ * PLAIN: data holds the values
+ * FOR_BITPACKED: frame of reference, every value is stored as value - base in bit_width bits
+ * RLE: runs of equal consecutive values, one value and one end position per run
+ * DICTIONARY: every value is stored as its index in a sorted dictionary, in bit_width bits
+ */
+typedef enum ColumnEncoding {
+    PLAIN,
+    FOR_BITPACKED,
+    RLE,
+    DICTIONARY,
+} ColumnEncoding;
+
+/*
+ * EncodedColumn holds the values of a column that is not PLAIN.
+ * size: number of values
+ * capacity: values the data of the column has room for once decoded
+ * packed, packed_words: bit packed codes, value i takes bits [i * bit_width, (i + 1) * bit_width)
+ * base: frame of reference of FOR_BITPACKED
+ * dict, dict_size: sorted distinct values of DICTIONARY
+ * run_values, run_ends, run_num: run r of RLE holds run_values[r] up to position run_ends[r] (excluded)
+ */
+typedef struct EncodedColumn {
+    size_t size;
+    size_t capacity;
+    uint64_t* packed;
+    size_t packed_words;
+    unsigned int bit_width;
+    int base;
+    int* dict;
+    size_t dict_size;
+    int* run_values;
+    int* run_ends;
+    size_t run_num;
+} EncodedColumn;
+
 typedef struct Column {
     char name[MAX_SIZE_NAME]; 
     int* data;
@@ -145,6 +266,11 @@ typedef struct Column {
     void* index_file;
     IndexType it;
     int clustered;
+    ZoneMap zone_map;
+    ColumnStats stats;
+    // data is NULL while the column is encoded
+    ColumnEncoding encoding;
+    EncodedColumn* encoded;
 } Column;
 
 
@@ -162,6 +288,22 @@ typedef struct Column {
  * - table_length, the size of the columns in the table.
  **/
 
+/*
+ * TableSample is a uniform random sample of the rows of a table, kept as their positions,
+ * that approximate aggregates read instead of whole columns (see sample.h).
+ * positions, size: of the sampled rows, at most TABLE_SAMPLE_SIZE
+ * rng, w, next: state of the reservoir, the next row streamed in that replaces a sampled one
+ * valid: 0 once deletes or updates moved rows, the sample is then drawn again when needed
+ */
+typedef struct TableSample {
+    int* positions;
+    size_t size;
+    uint64_t rng;
+    double w;
+    size_t next;
+    int valid;
+} TableSample;
+
 typedef struct Table {
     char name [MAX_SIZE_NAME];
     Column *columns;
@@ -169,6 +311,7 @@ typedef struct Table {
     size_t col_capacity;
     size_t table_length;
     size_t table_length_capacity;
+    TableSample sample;
 } Table;
 
 /**
@@ -213,6 +356,26 @@ typedef enum ComparatorType {
     GREATER_THAN_OR_EQUAL = 6
 } ComparatorType;
 
+/*
+ * How a result stores its tuples.
+ * VECTOR: payload is an array of num_tuples values of data_type.
+ * BITMAP: payload is a uint64_t bit vector over positions [0, bitmap_len), bit i set means position i qualifies.
+ *         num_tuples is the number of set bits and data_type is INT, so it can be used wherever a pos_vec is expected.
+ * DEFERRED: not computed yet, deferred describes the select (and fetch) producing it, see pipeline.h.
+ *           payload is NULL and num_tuples is unknown until the result is materialized.
+ * RANGES: positions as range_num ascending, disjoint ranges, payload is an int array holding
+ *         [payload[2k], payload[2k+1]) for range k. num_tuples is their total length and data_type is INT.
+ * SLICE: payload points to num_tuples consecutive values of the data of a column, which it does not own.
+ *        It reads like a VECTOR, and is copied into one before the data of the column changes.
+ */
+typedef enum ResultFormat {
+    VECTOR,
+    BITMAP,
+    DEFERRED,
+    RANGES,
+    SLICE,
+} ResultFormat;
+
 /*
  * Declares the type of a result column, 
  which includes the number of tuples in the result, the data type of the result, and a pointer to the result data
@@ -221,6 +384,10 @@ typedef struct Result {
     size_t num_tuples;
     DataType data_type;
     void *payload;
+    ResultFormat format;
+    size_t bitmap_len;
+    size_t range_num;
+    struct DeferredResult* deferred;
 } Result;
 
 /*
@@ -277,6 +444,17 @@ typedef struct Comparator {
     long int upperbound; // used in range compares.
 } Comparator;
 
+/**
+ * DeferredResult
+ * select(select_column, comparator) if fetch_column is NULL,
+ * else fetch(fetch_column, select(select_column, comparator)).
+ **/
+typedef struct DeferredResult {
+    Column* select_column;
+    Comparator comparator;
+    Column* fetch_column;
+} DeferredResult;
+
 /*
  * tells the databaase what type of operator this is
  */
@@ -285,6 +463,11 @@ typedef enum OperatorType {
     INSERT,
     SELECT,
     AGGREGATE,
+    MULTI_AGGREGATE,
+    GROUP_AGGREGATE,
+    SORT,
+    EXPRESSION,
+    APPROX_AGGREGATE,
     FETCH,
     PRINT,
     LOAD,
@@ -292,6 +475,7 @@ typedef enum OperatorType {
     DELETE,
     UPDATE,
     SHUTDOWN,
+    STATS,
     BATCH_MODE_BEGIN,
     BATCH_MODE_EXECUTE,
 } OperatorType;
@@ -335,6 +519,10 @@ typedef struct SelectOperator {
     GCHandle* gch1;
     GCHandle* gch2;
     Comparator comparator;
+    // conjunction of predicate_num > 1 column predicates, the ones of gch1 and comparator come first
+    size_t predicate_num;
+    Column** columns;
+    Comparator* comparators;
 } SelectOperator;
 /*
 * necessary fields for aggregate
@@ -346,6 +534,8 @@ typedef enum AggregateType {
     AVG,
     ADD,
     SUB,
+    COUNT,
+    VAR,
 } AggregateType;
 
 typedef struct AggregateOperator {
@@ -354,6 +544,40 @@ typedef struct AggregateOperator {
     AggregateType type;
 } AggregateOperator;
 /*
+* necessary fields for aggregates: several aggregates of one vector, computed in one pass
+*/
+typedef struct MultiAggregateOperator {
+    GCHandle* gch;
+    AggregateType types[MAX_CLIENT_VARIABLES];
+    size_t type_num;
+} MultiAggregateOperator;
+/*
+* necessary fields for sort and topk, gch1 holds the positions of the values of gch2 or is NULL
+*/
+typedef struct SortOperator {
+    GCHandle* gch1;
+    GCHandle* gch2;
+    int topk;
+    size_t k;
+} SortOperator;
+/*
+* necessary fields for expr: the program the parser compiled the expression into, see expr.h
+*/
+typedef struct ExprOperator {
+    struct ExprProgram* program;
+} ExprOperator;
+/*
+* necessary fields for approx_count, approx_sum and approx_avg: type of val_col over the rows of table
+* where pred_col satisfies comparator, all of them if pred_col is NULL
+*/
+typedef struct ApproxOperator {
+    Table* table;
+    Column* val_col;
+    Column* pred_col;
+    Comparator comparator;
+    AggregateType type;
+} ApproxOperator;
+/*
 * necessary fields for fetch
 */
 typedef struct FetchOperator {
@@ -379,6 +603,9 @@ typedef struct LoadOperator {
 typedef enum JoinType {
     NESTED_LOOP,
     HASH,
+    RADIX_HASH,
+    PARALLEL_HASH,
+    GRACE_HASH,
 } JoinType;
 
 typedef struct JoinOperator {
@@ -410,6 +637,12 @@ typedef struct UpdateOperator {
 typedef struct ShutDownOperator {
     int place_holder; //might want to check if we are shuting the right db later
 } ShutDownOperator;
+/*
+ * necessary fields for stats
+ */
+typedef struct StatsOperator {
+    Column* column;
+} StatsOperator;
 /*
  * union type holding the fields of any operator
  */
@@ -421,10 +654,16 @@ typedef union OperatorFields {
     FetchOperator fetch_operator;
     PrintOperator print_operator;
     AggregateOperator aggregate_operator;
+    MultiAggregateOperator multi_aggregate_operator;
+    AggregateOperator group_aggregate_operator;
+    SortOperator sort_operator;
+    ExprOperator expr_operator;
+    ApproxOperator approx_operator;
     JoinOperator join_operator;
     DeleteOperator delete_operator;
     UpdateOperator update_operator;
     ShutDownOperator shutdown_operator;
+    StatsOperator stats_operator;
 } OperatorFields;
 /*
  * DbOperator holds the following fields:
@@ -438,18 +677,10 @@ typedef struct DbOperator {
     OperatorFields operator_fields;
     int client_fd;
     ContextTable* context_table;
-    char client_variables[2][HANDLE_MAX_SIZE];
+    char client_variables[MAX_CLIENT_VARIABLES][HANDLE_MAX_SIZE];
     size_t client_variables_num;
 } DbOperator;
 
-typedef struct ThreadedScanArgs{
-    size_t thread_id;
-    void* data;
-    size_t start;
-    size_t end;
-    DataType dt;
-} ThreadedScanArgs;
-
 /* 
  * Use this command to see if databases that were persisted start up properly. If files
  * don't load as expected, this can return an error. 
@@ -462,6 +693,8 @@ Table* create_table(char* name, size_t col_capacity, Db* db, message* msg);
 
 Column* create_column(char *name, Db* db, Table* table, message* msg);
 
+Table* column_table(Column* col);
+
 void create_idx(IndexType it, Table* table, Column* col, message* msg);
 
 void shutdown_server(message* msg);
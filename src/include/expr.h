@@ -0,0 +1,117 @@
+// expr.h
+//
+// Arithmetic expressions over vectors and constants: <vec>=expr(<expression>), e.g. expr(a+b-2*c),
+// with + - * /, unary minus and parentheses, every vector of the same length.
+// The parser builds a tree of ExprNode, folding constant subtrees, and expr_compile turns it into a
+// short stack program. A vector or constant right operand is read by the instruction itself, and of two
+// subtrees the one needing more stack slots is evaluated first, so few slots are needed.
+// Every morsel runs the program chunk by chunk, EXPR_CHUNK tuples at a time: the slots are chunk sized
+// buffers that stay in L1, the bottom one is the output itself, and vectors already of the computed type
+// are read in place. No intermediate vector is ever written out whatever the number of operators.
+// Expressions with a FLOAT vector, a decimal constant or a division compute doubles and give a FLOAT
+// vector, the others compute longs and give a LONG one.
+// Like the aggregate kernels, the AVX2 kernels are used when scan_current_kernel() is SCAN_KERNEL_AVX2.
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "cs165_api.h"
+
+// tuples of a chunk
+#define EXPR_CHUNK 1024
+// stack slots of a program, enough for any expression of up to 2^(EXPR_MAX_DEPTH-1) vectors
+#define EXPR_MAX_DEPTH 8
+// distinct vectors of an expression
+#define EXPR_MAX_VECTORS 16
+
+typedef enum ExprNodeType {
+    EXPR_CONSTANT,
+    EXPR_VECTOR,
+    EXPR_BINARY,
+} ExprNodeType;
+
+/*
+ * a node of the tree built by the parser: a constant (is_float tells whether l or d holds it),
+ * a vector or a binary operator ('+', '-', '*' or '/') on left and right
+ */
+typedef struct ExprNode {
+    ExprNodeType type;
+    int is_float;
+    long l;
+    double d;
+    GCHandle* gch;
+    char op;
+    struct ExprNode* left;
+    struct ExprNode* right;
+} ExprNode;
+
+typedef enum ExprOpcode {
+    EXPR_LOAD,
+    EXPR_ADD,
+    EXPR_SUB,
+    //operand - top of the stack
+    EXPR_RSUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    //operand / top of the stack
+    EXPR_RDIV,
+} ExprOpcode;
+
+typedef enum ExprOperand {
+    //the slot below the top of the stack, which is popped
+    EXPR_ON_STACK,
+    EXPR_ON_VECTOR,
+    EXPR_ON_CONSTANT,
+} ExprOperand;
+
+/*
+ * an instruction combines the top of the stack with its operand, in place, or pushes a vector (EXPR_LOAD)
+ */
+typedef struct ExprInstruction {
+    ExprOpcode op;
+    ExprOperand operand;
+    size_t vector;
+    long l;
+    double d;
+} ExprInstruction;
+
+typedef struct ExprProgram {
+    ExprInstruction* instructions;
+    size_t instruction_num;
+    GCHandle* gchs[EXPR_MAX_VECTORS];
+    size_t gch_num;
+    size_t depth;
+    //a decimal constant or a division makes the expression compute doubles
+    int is_float;
+} ExprProgram;
+
+ExprNode* expr_constant(long l, double d, int is_float);
+
+ExprNode* expr_vector(GCHandle* gch);
+
+/**
+ * left op right, computed right away if both are constants (then freed)
+ **/
+ExprNode* expr_binary(char op, ExprNode* left, ExprNode* right);
+
+void expr_node_free(ExprNode* node);
+
+/**
+ * the program of the tree of root, NULL if it holds no vector, too many distinct ones or needs more than
+ * EXPR_MAX_DEPTH slots. The tree still belongs to the caller.
+ **/
+ExprProgram* expr_compile(ExprNode* root);
+
+void expr_free(ExprProgram* program);
+
+/**
+ * FLOAT or LONG, given the current types of the vectors of the program
+ **/
+DataType expr_result_type(ExprProgram* program);
+
+/**
+ * evaluates the program over the tuples_num tuples of its vectors into res_payload, of expr_result_type(program)
+ **/
+void expr_evaluate(ExprProgram* program, size_t tuples_num, void* res_payload);
+
+#endif /* EXPR_H */
@@ -0,0 +1,37 @@
+// group.h
+//
+// Grouped aggregation: <keys>,<aggs>=group_agg(<key_vec>,<val_vec>,<agg>) returns the distinct keys
+// in ascending order and, aligned with them, the aggregate of the values of every key.
+// Up to GROUP_HASH_MAX estimated groups, every chunk of tuples aggregates into its own open addressing
+// hash table, small enough to stay in cache, and the tables are merged in chunk order.
+// Past that, a hash table would miss the cache on every tuple, so the tuples are range partitioned
+// on their key in parallel, and every partition is radix sorted and aggregated run by run by its own task.
+// The partitions hold increasing key ranges, their groups are simply concatenated.
+// Double sums add chunk partials in chunk order (hash) or the values in tuple order (sort),
+// neither depends on the number of workers.
+
+#ifndef GROUP_H
+#define GROUP_H
+
+#include "cs165_api.h"
+
+// groups aggregated with hash tables at most, tables of up to 2 * GROUP_HASH_MAX entries of 24 bytes fit in L2
+#define GROUP_HASH_MAX 16384
+// range partitions of the sort based path
+#define GROUP_PARTITIONS 64
+
+/**
+ * groups the tuples_num values of val_payload (of type dt) by the aligned keys of key_vec, t is
+ * COUNT, SUM, MIN, MAX or AVG. distinct_estimate is the expected number of groups, 0 if unknown
+ * (a sample of the keys is then used). Returns the number of groups and sets *res_keys to their keys,
+ * ascending, and *res_vals to their aggregates, of type group_result_type(dt, t). Both are to be freed by the caller.
+ **/
+size_t group_aggregate(int* key_vec, void* val_payload, DataType dt, size_t tuples_num, AggregateType t,
+                       size_t distinct_estimate, int** res_keys, void** res_vals);
+
+/**
+ * count is LONG, sum LONG (FLOAT over FLOAT values), min and max of the type of the values, avg FLOAT
+ **/
+DataType group_result_type(DataType dt, AggregateType t);
+
+#endif /* GROUP_H */
@@ -0,0 +1,42 @@
+// imprints.h
+//
+// Column imprints of IMPRINTS columns, see ImprintIndex in cs165_api.h.
+// The values of a column are split in up to IMPRINT_BINS value range bins, chosen from a sample
+// of the column. Every cache line of IMPRINT_LINE values gets a 64 bit imprint with the bits of the
+// bins its values fall in, and runs of equal imprints are stored once. A select turns its range into
+// the mask of the bins it overlaps and the mask of the bins it covers entirely: cache lines whose
+// imprint misses the first are skipped, cache lines whose imprint lies within the second qualify
+// entirely, and only the other cache lines have their values compared.
+// The imprints take 8 bytes per 64 bytes of data at worst, much less when they repeat, and
+// are built in one pass over the column.
+
+#ifndef IMPRINTS_H
+#define IMPRINTS_H
+
+#include "cs165_api.h"
+
+/**
+ * empty imprints, without bins
+ **/
+ImprintIndex* imprints_create();
+
+void imprints_free(ImprintIndex* ii);
+
+/**
+ * picks the bins from a sample of data[0, size) and replaces the imprints by the ones of data, in one pass
+ **/
+void imprints_build(ImprintIndex* ii, int* data, size_t size);
+
+/**
+ * data[size-1] has just been appended to the column. The bins are kept until the column has
+ * doubled since they were picked, the imprints are then rebuilt.
+ **/
+void imprints_append(ImprintIndex* ii, int* data, size_t size);
+
+/**
+ * sets the bits of the positions of data[0, ii->size) satisfying comp, returns their number.
+ * bitmap has room for bitmap_words(ii->size) words.
+ **/
+size_t imprints_scan_bitmap(ImprintIndex* ii, int* data, Comparator* comp, uint64_t* bitmap);
+
+#endif /* IMPRINTS_H */
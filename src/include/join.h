@@ -0,0 +1,104 @@
+// join.h
+//
+// Joins of int vectors: <pos1>,<pos2>=join(<val1>,<pos1>,<val2>,<pos2>,nested-loop|hash|radix|parallel-hash|grace).
+// The block nested loop join compares every pair of values a page of each input at a time. The hash join
+// probes one big chained hash table (ExtHashTable), every probe misses the cache a few times.
+//
+// radix:
+// Both inputs are first split on the high bits of the hash of their keys, in at most two passes
+// of at most JOIN_RADIX_PASS_BITS bits so that the partitions written to at once stay within the TLB,
+// until a partition of the smaller (build) input holds about JOIN_PARTITION_TUPLES tuples.
+// Every pair of partitions is then joined on its own with a compact table, bucket heads and a chain of
+// tuple indices, that fits in L2 along with the partition.
+// The first pass runs morsel by morsel, like the radix sort of sort.c. The second pass and the joins
+// are a task per first pass partition, whose matches go to its own buffers, concatenated in partition order.
+//
+// parallel-hash:
+// All the workers build one shared open addressing table with linear probing. An entry packs a key and its
+// position in 64 bits, so a single compare and swap claims an empty slot, no lock is ever taken. Once it is
+// built the probe input is probed morsel by morsel, every morsel into its own buffers, and the buffers are
+// copied out in morsel order, in parallel as well. Equal build keys take the slots in the order the workers
+// got to them, so the matches of a probe tuple come in that order.
+//
+// grace:
+// A radix join whose build side would need more than JOIN_MEMORY_BUDGET bytes (JOIN_BUILD_TUPLE_BYTES per
+// tuple) first spills both inputs to one temporary file each under the spill directory, split into partitions
+// on another hash of their keys so that the build side of a partition takes at most half of the budget.
+// Every partition buffers JOIN_SPILL_BLOCK_TUPLES tuples and writes them as a block, whose offset it keeps.
+// The partitions are then joined one after the other: the build side is read back whole, the probe side
+// in chunks that fit in the other half of the budget, and every chunk is radix joined with the build side.
+// The files are unlinked as soon as they are created, the system removes them whatever happens.
+// A single key holding more than a partition's share of the build side still ends up in one partition.
+// Smaller build sides are radix joined in memory right away.
+
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "cs165_api.h"
+
+// build tuples per partition aimed at: 8 bytes per tuple plus 4 for its chain and 4 for its bucket head
+#define JOIN_PARTITION_TUPLES 8192
+// partitions of a pass, 2^7
+#define JOIN_RADIX_PASS_BITS 7
+// the shared table of parallel-hash has at least this many slots per build tuple
+#define JOIN_TABLE_SLOTS_PER_TUPLE 2
+
+// directory grace joins spill to and bytes a join may take before it does, both set by the Makefile.
+// The environment variables JOIN_SPILL_DIR and JOIN_MEMORY_BUDGET of the server override them.
+#ifndef JOIN_SPILL_DIR
+#define JOIN_SPILL_DIR "/tmp"
+#endif
+#ifndef JOIN_MEMORY_BUDGET
+#define JOIN_MEMORY_BUDGET 268435456
+#endif
+// memory of a radix join per build tuple: value and position, their two partitioned copies, chain and bucket head,
+// and per probe tuple: value and position and their two partitioned copies
+#define JOIN_BUILD_TUPLE_BYTES 32
+#define JOIN_PROBE_TUPLE_BYTES 24
+// tuples a partition writes to its spill file at once, 32KB
+#define JOIN_SPILL_BLOCK_TUPLES 4096
+#define JOIN_GRACE_MAX_PARTITIONS 1024
+
+/**
+ * joins the build_num values of build_vals with the probe_num values of probe_vals. For every pair of
+ * equal values, the positions aligned with them in build_pos and probe_pos are appended to
+ * *res_build_pos and *res_probe_pos, which hold malloced buffers that are reallocated to the
+ * *res_num matches.
+ **/
+void join_radix(int* build_vals, int* build_pos, size_t build_num,
+                int* probe_vals, int* probe_pos, size_t probe_num,
+                int** res_build_pos, int** res_probe_pos, size_t* res_num);
+
+/**
+ * same contract as join_radix
+ **/
+void join_parallel_hash(int* build_vals, int* build_pos, size_t build_num,
+                        int* probe_vals, int* probe_pos, size_t probe_num,
+                        int** res_build_pos, int** res_probe_pos, size_t* res_num);
+
+/**
+ * same contract as join_radix. Returns 0 if a spill file could not be created, written or read back,
+ * *res_build_pos and *res_probe_pos are then still to be freed by the caller. Returns 1 otherwise.
+ **/
+int join_grace(int* build_vals, int* build_pos, size_t build_num,
+               int* probe_vals, int* probe_pos, size_t probe_num,
+               int** res_build_pos, int** res_probe_pos, size_t* res_num);
+
+/**
+ * joins the outer and inner values like join_radix, outer first. *res_outer_pos_vec_p and *res_inner_pos_vec_p
+ * must have room for PAGE_SIZE positions. Only dt INT is supported.
+ **/
+void execute_nested_loop_join(void* outer_val_vec_p, int* outer_pos_vec, size_t outer_tuples_num,
+                              void* inner_val_vec_p, int* inner_pos_vec, size_t inner_tuples_num,
+                              int** res_outer_pos_vec_p, int** res_inner_pos_vec_p,  size_t* res_tuples_num_p,
+                              DataType dt);
+
+/**
+ * same contract as execute_nested_loop_join, the smaller input is the build side
+ **/
+void execute_hash_join(void* smaller_val_vec_p, int* smaller_pos_vec, size_t smaller_tuples_num,
+                       void* larger_val_vec_p, int* larger_pos_vec, size_t larger_tuples_num,
+                       int** res_smaller_pos_vec_p, int** res_larger_pos_vec_p,  size_t* res_tuples_num_p,
+                       DataType dt);
+
+#endif /* JOIN_H */
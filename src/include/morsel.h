@@ -0,0 +1,92 @@
+// morsel.h
+//
+// Morsel-driven parallel execution of single (unbatched) queries.
+// A vector is cut into morsels of MORSEL_SIZE tuples, each submitted as a task to
+// the thread pool. Idle workers steal morsels from busy ones, so a slow morsel only
+// delays the worker that took it instead of a whole static partition.
+// Every morsel writes its partial output into a slot indexed by its morsel id and
+// the operator merges the slots in morsel order. The output is therefore the same
+// whatever the number of workers (same order, same floating point sums).
+
+#ifndef MORSEL_H
+#define MORSEL_H
+
+#include "cs165_api.h"
+#include "aggregate.h"
+
+// 16K tuples: 64KB of ints, 128KB of longs/doubles, fits in L2 with room for the output.
+// Must be a multiple of 64 so that morsels own whole bitmap words.
+#define MORSEL_SIZE 16384
+// vectors with fewer morsels than this are processed by the calling thread only
+#define MORSEL_PARALLEL_MIN 4
+
+typedef void (*MorselFunc)(size_t morsel_id, size_t start, size_t end, void* args);
+
+size_t morsel_count(size_t tuples_num);
+
+/**
+ * calls func(morsel_id, start, end, args) once for every morsel [start, end) of [0, tuples_num)
+ * and returns when all of them are done. Every morsel is a task of the thread pool (see threadpool.h),
+ * the calling thread processes morsels as well.
+ **/
+void morsel_run(size_t tuples_num, MorselFunc func, void* args);
+
+/**
+ * parallel versions of scan_select and scan_bitmap (see scan.h), same contracts.
+ **/
+size_t morsel_scan_select(void* val_payload, int* pos_vec, DataType dt, size_t tuples_num, Comparator* comp, int* qualifying_index);
+
+size_t morsel_scan_bitmap(void* val_payload, DataType dt, size_t tuples_num, Comparator* comp, uint64_t* bitmap);
+
+/**
+ * res_payload[i] = val_payload[pos_vec[i]] for i in [0, tuples_num).
+ * Morsels of consecutive positions are copied with memcpy, the others prefetch the values they gather a few positions ahead.
+ **/
+void morsel_fetch(void* val_payload, DataType dt, int* pos_vec, size_t tuples_num, void* res_payload);
+
+/**
+ * gathers val_payload[pos] for every set bit pos of bitmap, in ascending order, into res_payload
+ **/
+void morsel_bitmap_fetch(void* val_payload, DataType dt, uint64_t* bitmap, size_t bitmap_len, void* res_payload);
+
+long morsel_sum_int(int* val_vec, size_t tuples_num);
+
+long morsel_sum_long(long* val_vec, size_t tuples_num);
+
+double morsel_sum_double(double* val_vec, size_t tuples_num);
+
+/**
+ * t is MIN or MAX, tuples_num must be > 0
+ **/
+int morsel_min_max_int(int* val_vec, size_t tuples_num, AggregateType t);
+
+long morsel_min_max_long(long* val_vec, size_t tuples_num, AggregateType t);
+
+double morsel_min_max_double(double* val_vec, size_t tuples_num, AggregateType t);
+
+/**
+ * count, sum, min, max (and m2 if with_m2) of val_payload in one pass, see AggStats in aggregate.h.
+ * stats->count is 0 for an empty vector.
+ **/
+void morsel_stats(void* val_payload, DataType dt, size_t tuples_num, int with_m2, AggStats* stats);
+
+/**
+ * position and value of the min or max (t is MIN or MAX) of val_payload over the tuples_num positions of pos_vec,
+ * or over the set bits of bitmap when pos_vec is NULL (tuples_num is then the bitmap length).
+ * Ties keep the first position. Returns 0 if there is no position, else 1 with the value written
+ * to res_val as an int, long or double following dt.
+ **/
+int morsel_arg_min_max(void* val_payload, DataType dt, int* pos_vec, uint64_t* bitmap, size_t tuples_num, AggregateType t, int* res_pos, void* res_val);
+
+/**
+ * same as morsel_arg_min_max when the values are aligned with the positions: the value of pos_vec[i] is val_payload[i].
+ **/
+int morsel_arg_min_max_aligned(void* val_payload, DataType dt, int* pos_vec, size_t tuples_num, AggregateType t, int* res_pos, void* res_val);
+
+/**
+ * res_payload[i] = val_vec1[i] +/- val_vec2[i] (t is ADD or SUB).
+ * The result is FLOAT if either side is FLOAT, else LONG if either side is LONG, else INT.
+ **/
+void morsel_add_sub(void* val_vec1, DataType dt1, void* val_vec2, DataType dt2, size_t tuples_num, AggregateType t, void* res_payload);
+
+#endif /* MORSEL_H */
@@ -0,0 +1,27 @@
+// pipeline.h
+//
+// Fused select -> fetch -> aggregate.
+// An unbatched select over a column that would be answered by a scan does not run right away:
+// its result is DEFERRED (see DeferredResult in cs165_api.h), and so is a fetch of another
+// column of the same table at its positions. Aggregating such a fetch with sum, avg, min or max
+// evaluates the predicate and aggregates the fetched values in one pass over both columns,
+// morsel by morsel, without building the positions or the fetched values.
+// Every other use of a deferred result, and every change to the data while one exists,
+// materializes it first (see materialize_deferred_result in server.c), so nothing observes the
+// difference. Results that are only aggregated are never materialized.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "cs165_api.h"
+
+/**
+ * one pass over select_column and fetch_column: aggregates the values of fetch_column at the
+ * positions of select_column satisfying comp, and returns the number of such positions.
+ * t is SUM or AVG (value is the sum) or MIN or MAX (value is left untouched if no position qualifies).
+ * Blocks that the zone map of select_column excludes are skipped, blocks it includes entirely
+ * are aggregated without evaluating the predicate.
+ **/
+size_t pipeline_select_aggregate(Column* select_column, Comparator* comp, Column* fetch_column, AggregateType t, long* value);
+
+#endif /* PIPELINE_H */
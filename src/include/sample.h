@@ -0,0 +1,60 @@
+// sample.h
+//
+// Approximate aggregates: <est>[,<low>,<high>]=approx_count(...), approx_sum(...) and approx_avg(...)
+// read the rows of a uniform random sample of the table (see TableSample in cs165_api.h) instead of
+// whole columns, and return the estimate with the bounds of its 95% confidence interval.
+// The sample is a reservoir of TABLE_SAMPLE_SIZE row positions. Rows loaded or inserted are streamed
+// into it with Algorithm L, which draws how many rows to skip before the next one replaced, so a load
+// costs O(TABLE_SAMPLE_SIZE * log(rows / TABLE_SAMPLE_SIZE)) draws and touches no data. Sorted inserts
+// shift the sampled positions after theirs. Deletes and updates move rows around: they invalidate the
+// sample, which is drawn again from the row count alone by the next approximate aggregate.
+// The sample is dumped and loaded with its table, and draws are deterministic, so estimates repeat.
+// Tables of at most TABLE_SAMPLE_SIZE rows are sampled whole and their estimates are exact.
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "cs165_api.h"
+
+#define TABLE_SAMPLE_SIZE 16384
+// two sided 95% confidence interval
+#define SAMPLE_Z 1.96
+
+/**
+ * empty sample of an empty table
+ **/
+void sample_init(TableSample* sample);
+
+void sample_free(TableSample* sample);
+
+/**
+ * streams in the row_num rows appended after the table_length rows of the table
+ **/
+void sample_append(TableSample* sample, size_t table_length, size_t row_num);
+
+/**
+ * streams in the row inserted at insert_pos into a table of table_length rows, rows from insert_pos on shift by one
+ **/
+void sample_insert(TableSample* sample, size_t table_length, int insert_pos);
+
+void sample_invalidate(TableSample* sample);
+
+/**
+ * draws the sample of a table of table_length rows again if it was invalidated
+ **/
+void sample_refresh(TableSample* sample, size_t table_length);
+
+void sample_dump(FILE* fd, TableSample* sample);
+
+void sample_load(FILE* fd, TableSample* sample);
+
+/**
+ * estimates t (COUNT, SUM or AVG) of val_col over the rows of table where pred_col satisfies comp,
+ * all rows if pred_col is NULL, and sets [*low, *high] to its 95% confidence interval.
+ * *sample_rows and *qualifying_rows are the rows read and how many satisfied comp.
+ * Returns 0 if there is nothing to estimate (an avg over no qualifying sampled row), 1 otherwise.
+ **/
+int sample_estimate(Table* table, Column* val_col, Column* pred_col, Comparator* comp, AggregateType t,
+                    double* estimate, double* low, double* high, size_t* sample_rows, size_t* qualifying_rows);
+
+#endif /* SAMPLE_H */
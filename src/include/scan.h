@@ -0,0 +1,59 @@
+// scan.h
+//
+// Range-select kernels used by execute_scan.
+// Every kernel evaluates
+//     (ct1 == NO_COMPARISON || lowerbound <= v) && (ct2 == NO_COMPARISON || upperbound > v)
+// over a vector and writes the qualifying positions into a caller owned buffer.
+// The kernel used is picked once at startup through CPUID (see scan_init)
+// and can be overridden for benchmarking with scan_set_kernel.
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "cs165_api.h"
+
+typedef enum ScanKernel {
+    SCAN_KERNEL_SCALAR,
+    SCAN_KERNEL_SSE4,
+    SCAN_KERNEL_AVX2,
+} ScanKernel;
+
+/**
+ * detects the instruction sets supported by this cpu, builds the shuffle
+ * lookup tables and selects the widest kernel available.
+ **/
+void scan_init();
+
+ScanKernel scan_best_kernel();
+
+ScanKernel scan_current_kernel();
+
+const char* scan_kernel_name(ScanKernel kernel);
+
+/**
+ * forces a kernel, returns 0 if the cpu does not support it (the current kernel is kept)
+ **/
+int scan_set_kernel(ScanKernel kernel);
+
+/**
+ * scans tuples_num values of val_vec and writes the qualifying positions to qualifying_index.
+ * If pos_vec is NULL, the position of a value is its offset in val_vec, otherwise it is pos_vec[i].
+ * qualifying_index must be able to hold tuples_num ints.
+ * Returns the number of qualifying positions.
+ **/
+size_t scan_select_int(int* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index);
+
+size_t scan_select_double(double* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index);
+
+size_t scan_select_long(long* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index);
+
+size_t scan_select(void* val_payload, int* pos_vec, DataType dt, size_t tuples_num, Comparator* comp, int* qualifying_index);
+
+/**
+ * scans tuples_num values of val_payload and sets bit i of bitmap when val_payload[i] qualifies.
+ * bitmap must be able to hold bitmap_words(tuples_num) words, it is cleared first.
+ * Returns the number of qualifying positions.
+ **/
+size_t scan_bitmap(void* val_payload, DataType dt, size_t tuples_num, Comparator* comp, uint64_t* bitmap);
+
+#endif /* SCAN_H */
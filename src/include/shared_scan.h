@@ -0,0 +1,81 @@
+// shared_scan.h
+//
+// Kernels of the shared scan run by batch_execute(): one pass over a vector
+// evaluates the range predicates of many batched selects.
+// Each predicate is (ct1 == NO_COMPARISON || lowerbound <= v) && (ct2 == NO_COMPARISON || upperbound > v).
+//
+// The loop kernel checks every tuple against every predicate, O(Q) per tuple.
+// The indexed kernel cuts the value domain at the predicate bounds into elementary
+// intervals that each qualify a fixed list of queries, so a tuple costs one binary
+// search over the bounds plus its matches, O(log Q + matches).
+// shared_scan_benchmark measures the crossover between the two.
+
+#ifndef SHARED_SCAN_H
+#define SHARED_SCAN_H
+
+#include "cs165_api.h"
+
+// groups with fewer selects than this use the loop kernel. Measured with shared_scan_benchmark (-O2, 200K ints):
+// 1% predicates break even at 4 selects and the index is 1.5x faster at 16, 39x at 1024;
+// 80-99% predicates are bound by writing the matches and stay within +-30% of the loop from 16 selects on
+#define SHARED_SCAN_INDEX_MIN_QUERIES 16
+// beyond this many (interval, query) pairs the index is not built and the loop kernel is used
+#define PREDICATE_INDEX_MAX_ENTRIES (1 << 24)
+
+/*
+ * PredicateIndex maps every elementary interval to the queries whose predicate covers it.
+ * bounds: the distinct predicate bounds in ascending order, interval k is [bounds[k-1], bounds[k])
+ *         with interval 0 open below and interval bound_num open above
+ * offsets: queries of interval k are query_lists[offsets[k]] to query_lists[offsets[k+1]-1]
+ */
+typedef struct PredicateIndex {
+    long* bounds;
+    size_t bound_num;
+    size_t* offsets;
+    int* query_lists;
+} PredicateIndex;
+
+/*
+ * SharedScanGroup holds the batched selects that read the same vector, scanned once for all of them.
+ * gch1, gch2: the operands shared by the selects of the group (gch2 is NULL unless select(<posn_vec>,<val_vec>,...))
+ * val_payload, dt, tuples_num: the vector to scan
+ * pos_vec: the position reported for every tuple, NULL when the tuple index is the position
+ * query_ids: index in the batch of every select of the group
+ * comparators: the predicate of every select of the group, in query_ids order
+ * predicate_index: index of comparators for the indexed kernel, NULL for the loop kernel
+ * morsel_results, morsel_results_count: qualifying positions per morsel, shape (morsel_num, query_num)
+ * results: the merged output of every select of the group
+ */
+typedef struct SharedScanGroup{
+    GCHandle* gch1;
+    GCHandle* gch2;
+    void* val_payload;
+    DataType dt;
+    size_t tuples_num;
+    int* pos_vec;
+    size_t* query_ids;
+    Comparator* comparators;
+    size_t query_num;
+    PredicateIndex* predicate_index;
+    int*** morsel_results;
+    size_t** morsel_results_count;
+    Result** results;
+} SharedScanGroup;
+
+/**
+ * builds the index over query_num predicates, returns NULL if it would exceed PREDICATE_INDEX_MAX_ENTRIES
+ **/
+PredicateIndex* predicate_index_build(Comparator* comps, size_t query_num);
+
+void predicate_index_free(PredicateIndex* pi);
+
+/**
+ * scans the tuples [start, end) of val_payload for query_num predicates at once. results[q] receives
+ * the qualifying positions of predicate q and results_count[q] their number, results[q] must have room
+ * for end-start positions. The position of tuple i is i, or pos_vec[i] if pos_vec is not NULL.
+ * pi is the index of comps, NULL to run the loop kernel.
+ **/
+void shared_scan(void* val_payload, int* pos_vec, DataType dt, size_t start, size_t end,
+                 Comparator* comps, size_t query_num, PredicateIndex* pi, int** results, size_t* results_count);
+
+#endif /* SHARED_SCAN_H */
@@ -0,0 +1,34 @@
+// sort.h
+//
+// Ordering of a vector: <vals>,<pos>=sort(...) and <vals>,<pos>=topk(...,<k>) return the values in order
+// and, aligned with them, where they come from, so that other columns can be fetched in the same order.
+// Full sorts are parallel LSD radix sorts: the values are turned into unsigned keys in the same order
+// (sign bit flipped, all bits of negative doubles flipped), every pass histograms the digit of every
+// morsel and scatters the morsels in parallel, each to its own slices. Passes over a digit that all keys
+// share are skipped, so narrow value ranges take fewer passes.
+// A small k keeps the k best tuples of every morsel in a bounded heap, merged once all morsels are done;
+// a large k sorts everything and keeps the prefix.
+// Equal values keep the order of their indices, in both directions, so results never depend on the workers.
+
+#ifndef SORT_H
+#define SORT_H
+
+#include "cs165_api.h"
+
+// topk uses heaps up to this k, and only while k is at most the number of tuples / TOPK_HEAP_FRACTION
+#define TOPK_HEAP_MAX 4096
+#define TOPK_HEAP_FRACTION 16
+
+/**
+ * sorts the tuples_num values of val_payload (of type dt) in ascending order into res_vals (same type),
+ * res_idx[i] is the index in val_payload of res_vals[i]. Equal values keep the order of their indices.
+ **/
+void sort_vector(void* val_payload, DataType dt, size_t tuples_num, void* res_vals, int* res_idx);
+
+/**
+ * the k largest values of val_payload in descending order, equal values by ascending index, into res_vals
+ * and their indices into res_idx. Returns how many were written, k or tuples_num if it is smaller.
+ **/
+size_t topk_vector(void* val_payload, DataType dt, size_t tuples_num, size_t k, void* res_vals, int* res_idx);
+
+#endif /* SORT_H */
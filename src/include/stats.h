@@ -0,0 +1,57 @@
+// stats.h
+//
+// Column statistics (see ColumnStats in cs165_api.h) for cardinality estimates:
+// an equi-depth histogram, a HyperLogLog distinct count sketch, min, max and the row count.
+// They are built in parallel when a column is loaded and adjusted on every insert and delete,
+// which keeps the row count and the histogram counts exact. Min, max and the sketch cannot
+// shrink on delete, and the bucket bounds drift from equi-depth as rows change, so the
+// statistics are rebuilt from the data once the rows changed since the last build reach
+// half of the rows built from. The rebuild waits until the statistics are read next
+// (stats_refresh), a run of inserts or deletes only counts its changes.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "cs165_api.h"
+
+// values sorted to place the bucket bounds of the histogram, taken at a fixed stride
+#define STATS_SAMPLE_SIZE 16384
+
+/**
+ * statistics of an empty column
+ **/
+void stats_init(ColumnStats* stats);
+
+/**
+ * recomputes the statistics of data[0, size), one morsel per task
+ **/
+void stats_build(ColumnStats* stats, int* data, size_t size);
+
+/**
+ * accounts for value inserted into the column
+ **/
+void stats_insert(ColumnStats* stats, int value);
+
+/**
+ * accounts for value deleted from the column
+ **/
+void stats_remove(ColumnStats* stats, int value);
+
+/**
+ * rebuilds the statistics of column from its data if too many rows changed since the last build,
+ * called before the statistics are read. An encoded column keeps them until it is decoded.
+ **/
+void stats_refresh(Column* column);
+
+/**
+ * estimated number of distinct values of the column
+ **/
+size_t stats_distinct(ColumnStats* stats);
+
+/**
+ * estimated number of rows of the column satisfying comp, assuming values are spread
+ * uniformly inside every histogram bucket
+ **/
+size_t stats_estimate_range(ColumnStats* stats, Comparator* comp);
+
+#endif /* STATS_H */
@@ -0,0 +1,55 @@
+// threadpool.h
+//
+// Process-wide pool of worker threads shared by every parallel operator.
+// The workers are started once (threadpool_init) instead of per query or per batch.
+// Every worker owns a deque of tasks: it pushes and pops at the bottom (newest first,
+// the data is still in its cache) while idle workers steal from the top of the others
+// (oldest first, usually the largest remaining piece of work).
+// A thread that waits for a group of tasks runs queued tasks in the meantime,
+// so tasks may themselves submit and wait for sub tasks.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+
+typedef void (*TaskFunc)(void* args);
+
+/*
+ * A set of submitted tasks that can be waited for as a whole.
+ */
+typedef struct TaskGroup {
+    size_t pending;
+} TaskGroup;
+
+/**
+ * starts the workers. thread_num counts the threads that execute tasks, the thread
+ * waiting on a group included, so thread_num-1 workers are created. 0 means one per online core.
+ **/
+void threadpool_init(size_t thread_num);
+
+/**
+ * stops and joins the workers. They run every task still queued before they exit.
+ **/
+void threadpool_shutdown(void);
+
+/**
+ * number of threads that execute tasks (workers + the waiting thread)
+ **/
+size_t threadpool_size(void);
+
+void task_group_init(TaskGroup* group);
+
+/**
+ * queues func(args) as part of group. Called from a worker, the task goes to the bottom
+ * of its own deque. Called from any other thread, tasks are dealt to the workers in turn.
+ * Without workers the task runs right away.
+ **/
+void threadpool_submit(TaskGroup* group, TaskFunc func, void* args);
+
+/**
+ * returns once every task of group is done, running queued tasks while waiting
+ **/
+void threadpool_wait(TaskGroup* group);
+
+#endif /* THREADPOOL_H */
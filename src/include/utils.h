@@ -76,9 +76,9 @@ BTreeNode* btree_insert_leaf_simple(BTreeNode* leaf, int key, int pos, int inser
 
 BTreeNode* btree_create_new_root_and_insert(BTreeNode* left_child, BTreeNode* right_child, int extra_key);
 
-BTreeNode* btree_insert_internal_simple(BTreeNode* internal, BTreeNode* right_child, int extra_key, BTreeNode* root);
+BTreeNode* btree_insert_internal_simple(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root);
 
-BTreeNode* btree_split_and_insert_internal(BTreeNode* internal, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size);
+BTreeNode* btree_split_and_insert_internal(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size);
 
 BTreeNode* btree_insert_internal(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size);
 
@@ -92,6 +92,12 @@ int btree_find_pos_clustered(BTreeNode* root, int key, int include_key);
 
 void btree_find_pos_unclustered(BTreeNode* root, Comparator* comp, int** qualifying_index_add, size_t* index_count_add);
 
+/**
+ * number of keys of an unclustered btree that satisfy comp, counted leaf by leaf.
+ * Stops as soon as the count exceeds limit, so the result is only exact up to limit.
+ **/
+size_t btree_count_unclustered(BTreeNode* root, Comparator* comp, size_t limit);
+
 void btree_remove(BTreeNode* root, int key, int pos);
 
 void sorted_insert_val_vec(int* vec, int vec_size, int idx, int val);
@@ -104,6 +110,8 @@ void sorted_delete_and_update(ColumnIndex* ci, int size, int pos);
 
 void update_column_index(Column* column, int key, size_t pos, int no_need_to_shift);
 
+int IndexPairCompare(const void *ip1p, const void *ip2p);
+
 ExtHashTable* hashtable_create();
 
 unsigned long hash_func(int key);
@@ -120,4 +128,35 @@ void hashtable_probe(ExtHashTable* ht, int key, int* res_pos_vec, size_t* res_tu
 
 void hashtable_free(ExtHashTable* ht);
 
+/**
+ * number of 64 bit words needed to hold a bitmap over n positions
+ **/
+size_t bitmap_words(size_t n);
+
+/**
+ * number of set bits in the first words words of bitmap
+ **/
+size_t bitmap_count(uint64_t* bitmap, size_t words);
+
+/**
+ * writes the positions of the set bits of bitmap, in ascending order, to pos_vec.
+ * Returns the number of positions written.
+ **/
+size_t bitmap_to_positions(uint64_t* bitmap, size_t bitmap_len, int* pos_vec);
+
+/**
+ * bitmap over [0, bitmap_len) with the tuples_num positions of pos_vec set, to be freed by the caller
+ **/
+uint64_t* positions_to_bitmap(int* pos_vec, size_t tuples_num, size_t bitmap_len);
+
+/**
+ * converts a BITMAP or RANGES result into a VECTOR of positions in place, does nothing for other results
+ **/
+void result_materialize_positions(Result* res);
+
+/**
+ * copies the values of a SLICE result into a VECTOR it owns, does nothing for other results
+ **/
+void result_materialize_slice(Result* res);
+
 #endif /* __UTILS_H__ */
@@ -0,0 +1,66 @@
+// zonemap.h
+//
+// Zone maps (per block min/max, see ZoneMap in cs165_api.h) of column data.
+// The zone map of a column covers column->data[0, column->size) and is kept in sync by
+// every operator that changes the data: load, insert, delete and update (delete + insert).
+// Unindexed full scans of a column read it to skip blocks that cannot qualify
+// and to emit blocks that qualify entirely without reading their values.
+
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include "cs165_api.h"
+
+// what the min and max of a block tell about a predicate
+typedef enum ZoneMatch {
+    ZONE_NONE,
+    ZONE_PARTIAL,
+    ZONE_ALL,
+} ZoneMatch;
+
+/**
+ * allocates room for the zones of a column of capacity values, the zone map is empty
+ **/
+void zone_map_init(ZoneMap* zm, size_t capacity);
+
+/**
+ * grows the zone map to cover a column of capacity values (see table_length_capacity)
+ **/
+void zone_map_reserve(ZoneMap* zm, size_t capacity);
+
+void zone_map_free(ZoneMap* zm);
+
+/**
+ * recomputes every zone of data[0, size), one morsel of zones per task
+ **/
+void zone_map_build(ZoneMap* zm, int* data, size_t size);
+
+/**
+ * recomputes the zones from the one holding pos to the end of data[0, size),
+ * after the values from pos on have moved (sorted insert, delete)
+ **/
+void zone_map_rebuild_from(ZoneMap* zm, int* data, size_t size, size_t pos);
+
+/**
+ * widens the zone of pos for value, after value is appended at position pos
+ **/
+void zone_map_append(ZoneMap* zm, size_t pos, int value);
+
+/**
+ * whether none, some or all of the values of a block with this min and max satisfy comp
+ **/
+ZoneMatch zone_map_match(Comparator* comp, int min, int max);
+
+/**
+ * number of values of data[0, size) that zone_map_scan_bitmap reads for comp,
+ * the values of the blocks the zone map cannot decide
+ **/
+size_t zone_map_values_to_read(ZoneMap* zm, size_t size, Comparator* comp);
+
+/**
+ * scan_bitmap (see scan.h) of data[0, size) for an INT column, reading only the blocks
+ * whose min/max neither exclude nor include every value.
+ **/
+size_t zone_map_scan_bitmap(ZoneMap* zm, int* data, size_t size, Comparator* comp, uint64_t* bitmap);
+
+#endif /* ZONEMAP_H */
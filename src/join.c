@@ -0,0 +1,746 @@
+#define _DEFAULT_SOURCE
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cs165_api.h"
+#include "join.h"
+#include "morsel.h"
+#include "threadpool.h"
+#include "utils.h"
+
+// first capacity of the match buffers of a task
+#define JOIN_MATCHES_INITIAL 1024
+
+/*
+ * a tuple being partitioned: its value and the position aligned with it
+ */
+typedef struct JoinTuple {
+    int key;
+    int pos;
+} JoinTuple;
+
+typedef struct JoinMorselArgs {
+    int* vals;
+    int* pos;
+    unsigned int bits;
+    //1 << bits counts per morsel
+    size_t* counts;
+    JoinTuple* to;
+} JoinMorselArgs;
+
+/*
+ * matches found by a task, in the order it found them
+ */
+typedef struct JoinMatches {
+    int* build_pos;
+    int* probe_pos;
+    size_t size;
+    size_t capacity;
+} JoinMatches;
+
+/*
+ * a partition of the first pass of both inputs, split by the second pass (if bits2 > 0) then joined
+ */
+typedef struct JoinPartitionTask {
+    JoinTuple* build;
+    size_t build_num;
+    JoinTuple* probe;
+    size_t probe_num;
+    unsigned int bits1;
+    unsigned int bits2;
+    JoinMatches matches;
+} JoinPartitionTask;
+
+static inline uint32_t join_hash(int key){
+    //multiplicative hashing, the high bits of the product are the best mixed
+    return (uint32_t) key * UINT32_C(2654435769);
+}
+
+//the bits bits of h below its shift highest ones
+static inline size_t join_digit(uint32_t h, unsigned int shift, unsigned int bits){
+    return bits == 0 ? 0 : (size_t) ((uint32_t) (h << shift) >> (32 - bits));
+}
+
+/*
+ * first pass
+ */
+static void histogram_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    JoinMorselArgs* args = (JoinMorselArgs*) a;
+    size_t* counts = args->counts + (morsel_id << args->bits);
+    int* vals = args->vals;
+    unsigned int bits = args->bits;
+    for(size_t i=start;i<end;i++){
+        counts[join_digit(join_hash(vals[i]), 0, bits)]++;
+    }
+}
+
+//counts hold the offset of the slice of every partition the morsel writes to
+static void scatter_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    JoinMorselArgs* args = (JoinMorselArgs*) a;
+    size_t* offsets = args->counts + (morsel_id << args->bits);
+    int* vals = args->vals;
+    int* pos = args->pos;
+    JoinTuple* to = args->to;
+    unsigned int bits = args->bits;
+    size_t o;
+    for(size_t i=start;i<end;i++){
+        o = offsets[join_digit(join_hash(vals[i]), 0, bits)]++;
+        to[o].key = vals[i];
+        to[o].pos = pos[i];
+    }
+}
+
+//splits the tuples_num values of vals, with their positions, on the bits highest bits of their hash into to.
+//Partition p is [bounds[p], bounds[p+1]).
+static void partition_input(int* vals, int* pos, size_t tuples_num, unsigned int bits, JoinTuple* to, size_t* bounds){
+    size_t fanout = (size_t) 1 << bits;
+    size_t morsel_num = morsel_count(tuples_num);
+    JoinMorselArgs args;
+    args.vals = vals;
+    args.pos = pos;
+    args.bits = bits;
+    args.counts = calloc(morsel_num * fanout, sizeof(size_t));
+    args.to = to;
+    morsel_run(tuples_num, histogram_morsel, &args);
+    //partition by partition, the slices of the morsels in morsel order
+    size_t offset = 0;
+    size_t count;
+    for(size_t p=0;p<fanout;p++){
+        bounds[p] = offset;
+        for(size_t m=0;m<morsel_num;m++){
+            count = args.counts[m * fanout + p];
+            args.counts[m * fanout + p] = offset;
+            offset += count;
+        }
+    }
+    bounds[fanout] = offset;
+    morsel_run(tuples_num, scatter_morsel, &args);
+    free(args.counts);
+}
+
+/*
+ * second pass and joins
+ */
+//splits the tuples_num tuples of from on the bits bits of their hash below the shift highest ones into to
+static void partition_tuples(JoinTuple* from, size_t tuples_num, unsigned int shift, unsigned int bits,
+                             JoinTuple* to, size_t* bounds){
+    size_t fanout = (size_t) 1 << bits;
+    size_t cursors[1 << JOIN_RADIX_PASS_BITS];
+    memset(cursors, 0, fanout * sizeof(size_t));
+    for(size_t i=0;i<tuples_num;i++){
+        cursors[join_digit(join_hash(from[i].key), shift, bits)]++;
+    }
+    size_t offset = 0;
+    size_t count;
+    for(size_t p=0;p<fanout;p++){
+        bounds[p] = offset;
+        count = cursors[p];
+        cursors[p] = offset;
+        offset += count;
+    }
+    bounds[fanout] = offset;
+    for(size_t i=0;i<tuples_num;i++){
+        to[cursors[join_digit(join_hash(from[i].key), shift, bits)]++] = from[i];
+    }
+}
+
+static void matches_append(JoinMatches* matches, int build_pos, int probe_pos){
+    if(matches->size == matches->capacity){
+        matches->capacity = matches->capacity == 0 ? JOIN_MATCHES_INITIAL : 2 * matches->capacity;
+        matches->build_pos = realloc(matches->build_pos, matches->capacity * sizeof(int));
+        matches->probe_pos = realloc(matches->probe_pos, matches->capacity * sizeof(int));
+    }
+    matches->build_pos[matches->size] = build_pos;
+    matches->probe_pos[matches->size] = probe_pos;
+    matches->size++;
+}
+
+//table bits for a partition of build_num tuples, the hash bits left below the shift partitioning ones at most
+static unsigned int table_bits(size_t build_num, unsigned int shift){
+    unsigned int bits = 1;
+    while(((size_t) 1 << bits) < build_num && bits < 32 - shift){
+        bits++;
+    }
+    return bits;
+}
+
+//joins a pair of partitions whose hashes share their shift highest bits. heads holds at least
+//1 << table_bits(build_num, shift) ints and next build_num.
+static void join_partition(JoinTuple* build, size_t build_num, JoinTuple* probe, size_t probe_num,
+                           unsigned int shift, int* heads, int* next, JoinMatches* matches){
+    if(build_num == 0 || probe_num == 0){
+        return;
+    }
+    unsigned int bits = table_bits(build_num, shift);
+    memset(heads, 0, ((size_t) 1 << bits) * sizeof(int));
+    //the tuples of a bucket are chained by index + 1, 0 ends a chain
+    size_t b;
+    for(size_t i=0;i<build_num;i++){
+        b = join_digit(join_hash(build[i].key), shift, bits);
+        next[i] = heads[b];
+        heads[b] = (int) i + 1;
+    }
+    int key;
+    for(size_t i=0;i<probe_num;i++){
+        key = probe[i].key;
+        for(int j=heads[join_digit(join_hash(key), shift, bits)];j!=0;j=next[j-1]){
+            if(build[j-1].key == key){
+                matches_append(matches, build[j-1].pos, probe[i].pos);
+            }
+        }
+    }
+}
+
+static void join_partition_task(void* a){
+    JoinPartitionTask* task = (JoinPartitionTask*) a;
+    if(task->build_num == 0 || task->probe_num == 0){
+        return;
+    }
+    unsigned int shift = task->bits1 + task->bits2;
+    if(task->bits2 == 0){
+        int* heads = malloc(((size_t) 1 << table_bits(task->build_num, shift)) * sizeof(int));
+        int* next = malloc(task->build_num * sizeof(int));
+        join_partition(task->build, task->build_num, task->probe, task->probe_num, shift, heads, next, &task->matches);
+        free(heads);
+        free(next);
+        return;
+    }
+    size_t fanout = (size_t) 1 << task->bits2;
+    size_t build_bounds[(1 << JOIN_RADIX_PASS_BITS) + 1];
+    size_t probe_bounds[(1 << JOIN_RADIX_PASS_BITS) + 1];
+    JoinTuple* build = malloc(task->build_num * sizeof(JoinTuple));
+    JoinTuple* probe = malloc(task->probe_num * sizeof(JoinTuple));
+    partition_tuples(task->build, task->build_num, task->bits1, task->bits2, build, build_bounds);
+    partition_tuples(task->probe, task->probe_num, task->bits1, task->bits2, probe, probe_bounds);
+    size_t max_build = 0;
+    for(size_t p=0;p<fanout;p++){
+        max_build = build_bounds[p+1] - build_bounds[p] > max_build ? build_bounds[p+1] - build_bounds[p] : max_build;
+    }
+    int* heads = malloc(((size_t) 1 << table_bits(max_build, shift)) * sizeof(int));
+    int* next = malloc(max_build * sizeof(int));
+    for(size_t p=0;p<fanout;p++){
+        join_partition(build + build_bounds[p], build_bounds[p+1] - build_bounds[p],
+                       probe + probe_bounds[p], probe_bounds[p+1] - probe_bounds[p],
+                       shift, heads, next, &task->matches);
+    }
+    free(heads);
+    free(next);
+    free(build);
+    free(probe);
+}
+
+void join_radix(int* build_vals, int* build_pos, size_t build_num,
+                int* probe_vals, int* probe_pos, size_t probe_num,
+                int** res_build_pos, int** res_probe_pos, size_t* res_num){
+    //partitioning bits, split evenly between the passes once one is not enough
+    unsigned int bits = 0;
+    while((build_num >> bits) > JOIN_PARTITION_TUPLES && bits < 2 * JOIN_RADIX_PASS_BITS){
+        bits++;
+    }
+    unsigned int bits1 = bits <= JOIN_RADIX_PASS_BITS ? bits : (bits + 1) / 2;
+    unsigned int bits2 = bits - bits1;
+    size_t fanout = (size_t) 1 << bits1;
+    JoinPartitionTask* tasks = calloc(fanout, sizeof(JoinPartitionTask));
+    JoinTuple* build = NULL;
+    JoinTuple* probe = NULL;
+    if(build_num > 0 && probe_num > 0){
+        size_t* build_bounds = malloc((fanout + 1) * sizeof(size_t));
+        size_t* probe_bounds = malloc((fanout + 1) * sizeof(size_t));
+        build = malloc(build_num * sizeof(JoinTuple));
+        probe = malloc(probe_num * sizeof(JoinTuple));
+        partition_input(build_vals, build_pos, build_num, bits1, build, build_bounds);
+        partition_input(probe_vals, probe_pos, probe_num, bits1, probe, probe_bounds);
+        TaskGroup task_group;
+        task_group_init(&task_group);
+        for(size_t p=0;p<fanout;p++){
+            tasks[p].build = build + build_bounds[p];
+            tasks[p].build_num = build_bounds[p+1] - build_bounds[p];
+            tasks[p].probe = probe + probe_bounds[p];
+            tasks[p].probe_num = probe_bounds[p+1] - probe_bounds[p];
+            tasks[p].bits1 = bits1;
+            tasks[p].bits2 = bits2;
+            threadpool_submit(&task_group, join_partition_task, &tasks[p]);
+        }
+        threadpool_wait(&task_group);
+        free(build_bounds);
+        free(probe_bounds);
+    }
+    //matches of the partitions in partition order
+    size_t total = 0;
+    for(size_t p=0;p<fanout;p++){
+        total += tasks[p].matches.size;
+    }
+    *res_build_pos = realloc(*res_build_pos, total * sizeof(int));
+    *res_probe_pos = realloc(*res_probe_pos, total * sizeof(int));
+    size_t offset = 0;
+    for(size_t p=0;p<fanout;p++){
+        if(tasks[p].matches.size > 0){
+            memcpy(*res_build_pos + offset, tasks[p].matches.build_pos, tasks[p].matches.size * sizeof(int));
+            memcpy(*res_probe_pos + offset, tasks[p].matches.probe_pos, tasks[p].matches.size * sizeof(int));
+            offset += tasks[p].matches.size;
+        }
+        free(tasks[p].matches.build_pos);
+        free(tasks[p].matches.probe_pos);
+    }
+    *res_num = total;
+    cs165_log(stdout, "radix join: %zu build x %zu probe tuples, %u + %u partitioning bits, %zu matches\n",
+              build_num, probe_num, bits1, bits2, total);
+    free(tasks);
+    free(build);
+    free(probe);
+}
+
+/*
+ * parallel-hash
+ */
+// the position of an empty slot is -1, which no tuple has
+#define JOIN_EMPTY_SLOT UINT64_MAX
+// tuples a morsel prefetches the slot of ahead, the table is usually far larger than the caches
+#define JOIN_PREFETCH_DISTANCE 16
+
+typedef struct JoinHashArgs {
+    int* vals;
+    int* pos;
+    uint64_t* slots;
+    unsigned int bits;
+    //matches of every probe morsel and where they go in the result
+    JoinMatches* matches;
+    size_t* offsets;
+    int* res_build_pos;
+    int* res_probe_pos;
+} JoinHashArgs;
+
+static inline uint64_t slot_pack(int key, int pos){
+    return (uint64_t) (uint32_t) pos << 32 | (uint32_t) key;
+}
+
+static void clear_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    JoinHashArgs* args = (JoinHashArgs*) a;
+    memset(args->slots + start, 0xFF, (end - start) * sizeof(uint64_t));
+}
+
+static void build_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    JoinHashArgs* args = (JoinHashArgs*) a;
+    uint64_t* slots = args->slots;
+    unsigned int bits = args->bits;
+    size_t mask = ((size_t) 1 << bits) - 1;
+    uint64_t entry, cur;
+    size_t s;
+    for(size_t i=start;i<end;i++){
+        if(i + JOIN_PREFETCH_DISTANCE < end){
+            __builtin_prefetch(&slots[join_digit(join_hash(args->vals[i + JOIN_PREFETCH_DISTANCE]), 0, bits)], 1);
+        }
+        entry = slot_pack(args->vals[i], args->pos[i]);
+        s = join_digit(join_hash(args->vals[i]), 0, bits);
+        //the first empty slot from s on, whoever fills a slot first keeps it
+        for(;;){
+            cur = __atomic_load_n(&slots[s], __ATOMIC_RELAXED);
+            if(cur == JOIN_EMPTY_SLOT
+               && __atomic_compare_exchange_n(&slots[s], &cur, entry, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                break;
+            }
+            s = (s + 1) & mask;
+        }
+    }
+}
+
+//the table is complete and only read from now on
+static void probe_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    JoinHashArgs* args = (JoinHashArgs*) a;
+    JoinMatches* matches = &args->matches[morsel_id];
+    uint64_t* slots = args->slots;
+    unsigned int bits = args->bits;
+    size_t mask = ((size_t) 1 << bits) - 1;
+    uint64_t cur;
+    size_t s;
+    int key;
+    for(size_t i=start;i<end;i++){
+        if(i + JOIN_PREFETCH_DISTANCE < end){
+            __builtin_prefetch(&slots[join_digit(join_hash(args->vals[i + JOIN_PREFETCH_DISTANCE]), 0, bits)]);
+        }
+        key = args->vals[i];
+        s = join_digit(join_hash(key), 0, bits);
+        while((cur = slots[s]) != JOIN_EMPTY_SLOT){
+            if((int) (uint32_t) cur == key){
+                matches_append(matches, (int) (uint32_t) (cur >> 32), args->pos[i]);
+            }
+            s = (s + 1) & mask;
+        }
+    }
+}
+
+static void copy_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) start;
+    (void) end;
+    JoinHashArgs* args = (JoinHashArgs*) a;
+    JoinMatches* matches = &args->matches[morsel_id];
+    if(matches->size > 0){
+        memcpy(args->res_build_pos + args->offsets[morsel_id], matches->build_pos, matches->size * sizeof(int));
+        memcpy(args->res_probe_pos + args->offsets[morsel_id], matches->probe_pos, matches->size * sizeof(int));
+    }
+    free(matches->build_pos);
+    free(matches->probe_pos);
+}
+
+void join_parallel_hash(int* build_vals, int* build_pos, size_t build_num,
+                        int* probe_vals, int* probe_pos, size_t probe_num,
+                        int** res_build_pos, int** res_probe_pos, size_t* res_num){
+    size_t morsel_num = morsel_count(probe_num);
+    JoinHashArgs args;
+    args.bits = 1;
+    args.matches = calloc(morsel_num, sizeof(JoinMatches));
+    if(build_num > 0 && probe_num > 0){
+        while(((size_t) 1 << args.bits) < JOIN_TABLE_SLOTS_PER_TUPLE * build_num){
+            args.bits++;
+        }
+        size_t capacity = (size_t) 1 << args.bits;
+        args.slots = malloc(capacity * sizeof(uint64_t));
+        morsel_run(capacity, clear_morsel, &args);
+        args.vals = build_vals;
+        args.pos = build_pos;
+        morsel_run(build_num, build_morsel, &args);
+        args.vals = probe_vals;
+        args.pos = probe_pos;
+        morsel_run(probe_num, probe_morsel, &args);
+        free(args.slots);
+    }
+    args.offsets = malloc(morsel_num * sizeof(size_t));
+    size_t total = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        args.offsets[m] = total;
+        total += args.matches[m].size;
+    }
+    *res_build_pos = realloc(*res_build_pos, total * sizeof(int));
+    *res_probe_pos = realloc(*res_probe_pos, total * sizeof(int));
+    args.res_build_pos = *res_build_pos;
+    args.res_probe_pos = *res_probe_pos;
+    morsel_run(probe_num, copy_morsel, &args);
+    *res_num = total;
+    cs165_log(stdout, "parallel hash join: %zu build x %zu probe tuples, %zu slots, %zu matches\n",
+              build_num, probe_num, build_num > 0 && probe_num > 0 ? (size_t) 1 << args.bits : 0, total);
+    free(args.offsets);
+    free(args.matches);
+}
+
+/*
+ * grace
+ */
+/*
+ * a partition of a spill file: the tuples it buffers, then the offsets of its blocks in the file,
+ * all full but the last
+ */
+typedef struct JoinSpillPartition {
+    JoinTuple* buffer;
+    size_t buffered;
+    long* blocks;
+    size_t block_num;
+    size_t block_capacity;
+    size_t tuples_num;
+} JoinSpillPartition;
+
+typedef struct JoinSpill {
+    FILE* file;
+    long end;
+    JoinSpillPartition* partitions;
+    size_t partition_num;
+} JoinSpill;
+
+static inline uint32_t grace_hash(int key){
+    //another odd multiplier, the radix join of a partition splits it on the bits of join_hash
+    return (uint32_t) key * UINT32_C(0x85EBCA77);
+}
+
+//spill directory, JOIN_SPILL_DIR unless the environment variable of that name is set
+static const char* join_spill_dir(void){
+    const char* dir = getenv("JOIN_SPILL_DIR");
+    return dir != NULL && dir[0] != '\0' ? dir : JOIN_SPILL_DIR;
+}
+
+//memory budget in bytes, JOIN_MEMORY_BUDGET unless the environment variable of that name holds a positive number
+static size_t join_memory_budget(void){
+    const char* value = getenv("JOIN_MEMORY_BUDGET");
+    if(value != NULL){
+        char* end;
+        unsigned long long budget = strtoull(value, &end, 10);
+        if(end != value && *end == '\0' && budget > 0){
+            return (size_t) budget;
+        }
+    }
+    return JOIN_MEMORY_BUDGET;
+}
+
+static int spill_open(JoinSpill* spill, size_t partition_num){
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/cs165_join_XXXXXX", join_spill_dir());
+    spill->partitions = calloc(partition_num, sizeof(JoinSpillPartition));
+    spill->partition_num = partition_num;
+    spill->end = 0;
+    int fd = mkstemp(path);
+    if(fd < 0){
+        cs165_log(stdout, "cannot create a spill file under %s\n", join_spill_dir());
+        return 0;
+    }
+    unlink(path);
+    spill->file = fdopen(fd, "w+b");
+    if(spill->file == NULL){
+        close(fd);
+        return 0;
+    }
+    return 1;
+}
+
+static void spill_close(JoinSpill* spill){
+    if(spill->file != NULL){
+        fclose(spill->file);
+    }
+    for(size_t p=0;p<spill->partition_num;p++){
+        free(spill->partitions[p].buffer);
+        free(spill->partitions[p].blocks);
+    }
+    free(spill->partitions);
+}
+
+static int spill_flush(JoinSpill* spill, JoinSpillPartition* partition){
+    if(fwrite(partition->buffer, sizeof(JoinTuple), partition->buffered, spill->file) != partition->buffered){
+        cs165_log(stdout, "cannot write to a spill file under %s\n", join_spill_dir());
+        return 0;
+    }
+    if(partition->block_num == partition->block_capacity){
+        partition->block_capacity = partition->block_capacity == 0 ? 16 : 2 * partition->block_capacity;
+        partition->blocks = realloc(partition->blocks, partition->block_capacity * sizeof(long));
+    }
+    partition->blocks[partition->block_num++] = spill->end;
+    spill->end += (long) (partition->buffered * sizeof(JoinTuple));
+    partition->buffered = 0;
+    return 1;
+}
+
+//writes the tuples_num values of vals, with their positions, to the partition of the bits highest bits of their grace hash
+static int spill_write(JoinSpill* spill, int* vals, int* pos, size_t tuples_num, unsigned int bits){
+    JoinSpillPartition* partition;
+    for(size_t p=0;p<spill->partition_num;p++){
+        spill->partitions[p].buffer = malloc(JOIN_SPILL_BLOCK_TUPLES * sizeof(JoinTuple));
+    }
+    for(size_t i=0;i<tuples_num;i++){
+        partition = &spill->partitions[join_digit(grace_hash(vals[i]), 0, bits)];
+        partition->buffer[partition->buffered].key = vals[i];
+        partition->buffer[partition->buffered].pos = pos[i];
+        partition->buffered++;
+        partition->tuples_num++;
+        if(partition->buffered == JOIN_SPILL_BLOCK_TUPLES && !spill_flush(spill, partition)){
+            return 0;
+        }
+    }
+    for(size_t p=0;p<spill->partition_num;p++){
+        partition = &spill->partitions[p];
+        if(partition->buffered > 0 && !spill_flush(spill, partition)){
+            return 0;
+        }
+        free(partition->buffer);
+        partition->buffer = NULL;
+    }
+    return fflush(spill->file) == 0;
+}
+
+//reads block_num blocks of partition from first_block on into vals and pos, returns the tuples read, 0 on error
+static size_t spill_read(JoinSpill* spill, JoinSpillPartition* partition, size_t first_block, size_t block_num,
+                         int* vals, int* pos){
+    JoinTuple* block = malloc(JOIN_SPILL_BLOCK_TUPLES * sizeof(JoinTuple));
+    size_t tuples_num = 0;
+    size_t count;
+    for(size_t b=first_block;b<first_block+block_num;b++){
+        count = b + 1 < partition->block_num ? JOIN_SPILL_BLOCK_TUPLES
+                                             : partition->tuples_num - b * JOIN_SPILL_BLOCK_TUPLES;
+        if(fseek(spill->file, partition->blocks[b], SEEK_SET) != 0
+           || fread(block, sizeof(JoinTuple), count, spill->file) != count){
+            cs165_log(stdout, "cannot read a spill file back\n");
+            free(block);
+            return 0;
+        }
+        for(size_t i=0;i<count;i++){
+            vals[tuples_num + i] = block[i].key;
+            pos[tuples_num + i] = block[i].pos;
+        }
+        tuples_num += count;
+    }
+    free(block);
+    return tuples_num;
+}
+
+int join_grace(int* build_vals, int* build_pos, size_t build_num,
+               int* probe_vals, int* probe_pos, size_t probe_num,
+               int** res_build_pos, int** res_probe_pos, size_t* res_num){
+    size_t budget = join_memory_budget();
+    if(build_num * JOIN_BUILD_TUPLE_BYTES <= budget || probe_num == 0){
+        cs165_log(stdout, "grace join: the build side fits in memory\n");
+        join_radix(build_vals, build_pos, build_num, probe_vals, probe_pos, probe_num, res_build_pos, res_probe_pos, res_num);
+        return 1;
+    }
+    //the build side of a partition takes half of the budget, probe chunks the other half
+    unsigned int bits = 1;
+    while(((size_t) 1 << bits) < JOIN_GRACE_MAX_PARTITIONS
+          && ((size_t) 1 << bits) * (budget / 2) < build_num * JOIN_BUILD_TUPLE_BYTES){
+        bits++;
+    }
+    size_t partition_num = (size_t) 1 << bits;
+    size_t chunk_blocks = budget / 2 / JOIN_PROBE_TUPLE_BYTES / JOIN_SPILL_BLOCK_TUPLES;
+    chunk_blocks = chunk_blocks == 0 ? 1 : chunk_blocks;
+    JoinSpill build_spill = {NULL, 0, NULL, 0};
+    JoinSpill probe_spill = {NULL, 0, NULL, 0};
+    int ok = spill_open(&build_spill, partition_num)
+             && spill_write(&build_spill, build_vals, build_pos, build_num, bits)
+             && spill_open(&probe_spill, partition_num)
+             && spill_write(&probe_spill, probe_vals, probe_pos, probe_num, bits);
+    //partition pairs one after the other, their matches appended in partition order
+    size_t total = 0;
+    size_t capacity = 0;
+    JoinSpillPartition* build_partition;
+    JoinSpillPartition* probe_partition;
+    int *vals, *pos, *chunk_vals, *chunk_pos;
+    int *matches_build, *matches_probe;
+    size_t chunk_num, matches_num, build_read;
+    for(size_t p=0;p<partition_num && ok;p++){
+        build_partition = &build_spill.partitions[p];
+        probe_partition = &probe_spill.partitions[p];
+        if(build_partition->tuples_num == 0 || probe_partition->tuples_num == 0){
+            continue;
+        }
+        vals = malloc(build_partition->tuples_num * sizeof(int));
+        pos = malloc(build_partition->tuples_num * sizeof(int));
+        chunk_vals = malloc(chunk_blocks * JOIN_SPILL_BLOCK_TUPLES * sizeof(int));
+        chunk_pos = malloc(chunk_blocks * JOIN_SPILL_BLOCK_TUPLES * sizeof(int));
+        build_read = spill_read(&build_spill, build_partition, 0, build_partition->block_num, vals, pos);
+        ok = build_read == build_partition->tuples_num;
+        for(size_t b=0;b<probe_partition->block_num && ok;b+=chunk_blocks){
+            chunk_num = spill_read(&probe_spill, probe_partition, b,
+                                   b + chunk_blocks < probe_partition->block_num ? chunk_blocks : probe_partition->block_num - b,
+                                   chunk_vals, chunk_pos);
+            if(chunk_num == 0){
+                ok = 0;
+                break;
+            }
+            matches_build = NULL;
+            matches_probe = NULL;
+            join_radix(vals, pos, build_read, chunk_vals, chunk_pos, chunk_num, &matches_build, &matches_probe, &matches_num);
+            if(total + matches_num > capacity){
+                capacity = 2 * (total + matches_num);
+                *res_build_pos = realloc(*res_build_pos, capacity * sizeof(int));
+                *res_probe_pos = realloc(*res_probe_pos, capacity * sizeof(int));
+            }
+            if(matches_num > 0){
+                memcpy(*res_build_pos + total, matches_build, matches_num * sizeof(int));
+                memcpy(*res_probe_pos + total, matches_probe, matches_num * sizeof(int));
+            }
+            total += matches_num;
+            free(matches_build);
+            free(matches_probe);
+        }
+        free(vals);
+        free(pos);
+        free(chunk_vals);
+        free(chunk_pos);
+    }
+    spill_close(&build_spill);
+    spill_close(&probe_spill);
+    if(!ok){
+        return 0;
+    }
+    *res_build_pos = realloc(*res_build_pos, total * sizeof(int));
+    *res_probe_pos = realloc(*res_probe_pos, total * sizeof(int));
+    *res_num = total;
+    cs165_log(stdout, "grace join: %zu build x %zu probe tuples spilled to %zu partitions under %s, %zu matches\n",
+              build_num, probe_num, partition_num, join_spill_dir(), total);
+    return 1;
+}
+
+void execute_nested_loop_join(void* outer_val_vec_p, int* outer_pos_vec, size_t outer_tuples_num,
+                              void* inner_val_vec_p, int* inner_pos_vec, size_t inner_tuples_num,
+                              int** res_outer_pos_vec_p, int** res_inner_pos_vec_p,  size_t* res_tuples_num_p,
+                              DataType dt){
+    int* res_outer_pos_vec = *res_outer_pos_vec_p;
+    int* res_inner_pos_vec = *res_inner_pos_vec_p;
+    size_t res_tuples_num = 0;
+    size_t res_capacity = PAGE_SIZE;
+    if(dt == INT){
+        int* outer_val_vec = (int*) outer_val_vec_p;
+        int* inner_val_vec = (int*) inner_val_vec_p;
+        size_t outer_p = PAGE_SIZE/sizeof(int);
+        size_t inner_p = PAGE_SIZE/sizeof(int);
+        for(size_t block_i=0;block_i<outer_tuples_num;block_i=block_i+outer_p){
+            for(size_t block_j=0;block_j<inner_tuples_num;block_j=block_j+inner_p){
+                for(size_t i=block_i;i<block_i+outer_p && i<outer_tuples_num;i++){
+                    for(size_t j=block_j;j<block_j+inner_p && j<inner_tuples_num;j++){
+                        if(outer_val_vec[i]==inner_val_vec[j]){
+                            if(res_tuples_num == res_capacity){
+                                res_capacity *= 2;
+                                res_outer_pos_vec = realloc(res_outer_pos_vec, res_capacity * sizeof(int));
+                                res_inner_pos_vec = realloc(res_inner_pos_vec, res_capacity * sizeof(int));
+                            }
+                            res_outer_pos_vec[res_tuples_num] = outer_pos_vec[i];
+                            res_inner_pos_vec[res_tuples_num] = inner_pos_vec[j];
+                            res_tuples_num++;
+                        }
+                    }
+                }
+            }
+        }
+        res_outer_pos_vec = realloc(res_outer_pos_vec, res_tuples_num * sizeof(int));
+        res_inner_pos_vec = realloc(res_inner_pos_vec, res_tuples_num * sizeof(int));
+        *res_inner_pos_vec_p = res_inner_pos_vec;
+        *res_outer_pos_vec_p = res_outer_pos_vec;
+        *res_tuples_num_p = res_tuples_num;
+    }else if(dt == FLOAT){
+        //TODO: support double
+    }else{
+        //TODO: support long
+    }
+    
+}
+
+void execute_hash_join(void* smaller_val_vec_p, int* smaller_pos_vec, size_t smaller_tuples_num,
+                       void* larger_val_vec_p, int* larger_pos_vec, size_t larger_tuples_num,
+                       int** res_smaller_pos_vec_p, int** res_larger_pos_vec_p,  size_t* res_tuples_num_p,
+                       DataType dt){
+    int* res_smaller_pos_vec = *res_smaller_pos_vec_p;
+    int* res_larger_pos_vec = *res_larger_pos_vec_p;
+    size_t res_tuples_num = 0;
+    size_t res_capacity = PAGE_SIZE;
+    if(dt == INT){
+        int* smaller_val_vec = (int*) smaller_val_vec_p;
+        int* larger_val_vec = (int*) larger_val_vec_p;
+        ExtHashTable* ht = hashtable_create();
+        for(size_t i=0;i<smaller_tuples_num;i++){
+            hashtable_insert(ht, smaller_val_vec[i], smaller_pos_vec[i]);
+        }
+        int* temp_prob_res = malloc(smaller_tuples_num * sizeof(int));
+        size_t temp_prob_res_num = 0;
+        for(size_t i=0;i<larger_tuples_num;i++){
+            hashtable_probe(ht, larger_val_vec[i], temp_prob_res, &temp_prob_res_num);
+            for(size_t j=0;j<temp_prob_res_num;j++){
+                if(res_tuples_num == res_capacity){
+                    res_capacity *= 2;
+                    res_smaller_pos_vec = realloc(res_smaller_pos_vec, res_capacity * sizeof(int));
+                    res_larger_pos_vec = realloc(res_larger_pos_vec, res_capacity * sizeof(int));
+                }
+                res_smaller_pos_vec[res_tuples_num] = temp_prob_res[j];
+                res_larger_pos_vec[res_tuples_num] = larger_pos_vec[i];
+                res_tuples_num++;
+            }
+        }
+        free(temp_prob_res);
+        hashtable_free(ht);
+        res_smaller_pos_vec = realloc(res_smaller_pos_vec, res_tuples_num * sizeof(int));
+        res_larger_pos_vec = realloc(res_larger_pos_vec, res_tuples_num * sizeof(int));
+        *res_smaller_pos_vec_p = res_smaller_pos_vec;
+        *res_larger_pos_vec_p = res_larger_pos_vec;
+        *res_tuples_num_p = res_tuples_num;
+    }else if(dt == FLOAT){
+        //TODO: support double
+    }else{
+        //TODO: support long
+    }
+}
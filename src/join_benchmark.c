@@ -0,0 +1,158 @@
+/**
+ * join_benchmark.c
+ *
+ * Microbenchmark for the joins in join.c.
+ * Generates the tables of the join tests (milestone4.py with the sizes of gen_all_for_staff_use.sh):
+ * a fact table of tuples_num rows and two dimension tables of 10000 rows, and reports the time of
+ * the radix join, the hash join and the nested loop join for
+ *   - fact.col4 = dim2.col1: uniform keys against a key column, one match per fact row
+ *   - fact.col1 = dim1.col1: zipfian keys on both sides, after a select of 10% of the fact rows
+ *
+ * Usage: make join_benchmark; ./join_benchmark [tuples_num]
+ **/
+#define _DEFAULT_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cs165_api.h"
+#include "join.h"
+#include "threadpool.h"
+
+#define DEFAULT_TUPLES_NUM 100000
+#define DIM1_TUPLES_NUM 10000
+#define DIM2_TUPLES_NUM 10000
+#define ZIPF_PARAM 1.0
+#define ZIPF_DISTINCT 1000
+#define FACT_SELECTIVITY 0.1
+#define REPEAT 3
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//draws from 1..distinct with probability proportional to 1/k^param, as ZipfianDistribution of milestone4.py
+static void fill_zipf(int* vec, size_t num, double param, int distinct){
+    double* cdf = malloc(distinct * sizeof(double));
+    double total = 0;
+    for(int k=1;k<=distinct;k++){
+        total += 1.0 / pow(k, param);
+        cdf[k-1] = total;
+    }
+    for(size_t i=0;i<num;i++){
+        double u = (double) rand() / ((double) RAND_MAX + 1) * total;
+        int lo = 0, hi = distinct - 1;
+        while(lo < hi){
+            int mid = (lo + hi) / 2;
+            if(cdf[mid] <= u){
+                lo = mid + 1;
+            }else{
+                hi = mid;
+            }
+        }
+        vec[i] = lo + 1;
+    }
+    free(cdf);
+}
+
+static void fill_positions(int* pos, size_t num){
+    for(size_t i=0;i<num;i++){
+        pos[i] = (int) i;
+    }
+}
+
+//best of REPEAT runs, in seconds. The build side is the smaller input, as execute_join_operator picks it.
+static double time_join(JoinType jt, int* build_vals, int* build_pos, size_t build_num,
+                        int* probe_vals, int* probe_pos, size_t probe_num, size_t* res_num){
+    double best = -1;
+    double begin, elapsed;
+    for(int r=0;r<REPEAT;r++){
+        int* res_build_pos = malloc(PAGE_SIZE * sizeof(int));
+        int* res_probe_pos = malloc(PAGE_SIZE * sizeof(int));
+        begin = now();
+        if(jt == NESTED_LOOP){
+            execute_nested_loop_join((void*) build_vals, build_pos, build_num, (void*) probe_vals, probe_pos, probe_num,
+                                     &res_build_pos, &res_probe_pos, res_num, INT);
+        }else if(jt == HASH){
+            execute_hash_join((void*) build_vals, build_pos, build_num, (void*) probe_vals, probe_pos, probe_num,
+                              &res_build_pos, &res_probe_pos, res_num, INT);
+        }else{
+            join_radix(build_vals, build_pos, build_num, probe_vals, probe_pos, probe_num,
+                       &res_build_pos, &res_probe_pos, res_num);
+        }
+        elapsed = now() - begin;
+        free(res_build_pos);
+        free(res_probe_pos);
+        if(best < 0 || elapsed < best){
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static void run_join(const char* name, int* build_vals, int* build_pos, size_t build_num,
+                     int* probe_vals, int* probe_pos, size_t probe_num){
+    JoinType jt_list[] = {RADIX_HASH, HASH, NESTED_LOOP};
+    const char* jt_name[] = {"radix", "hash", "nested-loop"};
+    size_t res_num;
+    size_t expected = 0;
+    double seconds;
+    for(size_t j=0;j<3;j++){
+        seconds = time_join(jt_list[j], build_vals, build_pos, build_num, probe_vals, probe_pos, probe_num, &res_num);
+        if(j == 0){
+            expected = res_num;
+        }
+        printf("%-8s %-12s %-10zu %-10zu %-12zu %-10.4f %-10.2f%s\n", name, jt_name[j], build_num, probe_num, res_num,
+               seconds, (double) (build_num + probe_num) / seconds / 1e6, res_num == expected ? "" : "  matches differ");
+    }
+}
+
+int main(int argc, char** argv){
+    size_t tuples_num = DEFAULT_TUPLES_NUM;
+    if(argc > 1){
+        tuples_num = strtoul(argv[1], NULL, 10);
+    }
+    threadpool_init(0);
+    srand(42);
+    int* fact_col1 = malloc(tuples_num * sizeof(int));
+    int* fact_col4 = malloc(tuples_num * sizeof(int));
+    int* fact_pos = malloc(tuples_num * sizeof(int));
+    int* dim1_col1 = malloc(DIM1_TUPLES_NUM * sizeof(int));
+    int* dim2_col1 = malloc(DIM2_TUPLES_NUM * sizeof(int));
+    int* dim_pos = malloc((DIM1_TUPLES_NUM > DIM2_TUPLES_NUM ? DIM1_TUPLES_NUM : DIM2_TUPLES_NUM) * sizeof(int));
+    fill_zipf(fact_col1, tuples_num, ZIPF_PARAM, ZIPF_DISTINCT);
+    fill_zipf(dim1_col1, DIM1_TUPLES_NUM, ZIPF_PARAM, ZIPF_DISTINCT);
+    for(size_t i=0;i<tuples_num;i++){
+        fact_col4[i] = 1 + rand() % (DIM2_TUPLES_NUM - 1);
+    }
+    for(size_t i=0;i<DIM2_TUPLES_NUM;i++){
+        dim2_col1[i] = (int) i + 1;
+    }
+    fill_positions(fact_pos, tuples_num);
+    fill_positions(dim_pos, DIM1_TUPLES_NUM > DIM2_TUPLES_NUM ? DIM1_TUPLES_NUM : DIM2_TUPLES_NUM);
+
+    printf("fact tuples: %zu, threads: %zu\n", tuples_num, threadpool_size());
+    printf("%-8s %-12s %-10s %-10s %-12s %-10s %-10s\n", "join", "algorithm", "build", "probe", "matches", "seconds", "Mtuples/s");
+    if(tuples_num < DIM2_TUPLES_NUM){
+        run_join("uniform", fact_col4, fact_pos, tuples_num, dim2_col1, dim_pos, DIM2_TUPLES_NUM);
+    }else{
+        run_join("uniform", dim2_col1, dim_pos, DIM2_TUPLES_NUM, fact_col4, fact_pos, tuples_num);
+    }
+    //the selected fact rows keep their positions, like a fetch after a select
+    size_t selected_num = (size_t) (tuples_num * FACT_SELECTIVITY);
+    if(selected_num < DIM1_TUPLES_NUM){
+        run_join("zipf", fact_col1, fact_pos, selected_num, dim1_col1, dim_pos, DIM1_TUPLES_NUM);
+    }else{
+        run_join("zipf", dim1_col1, dim_pos, DIM1_TUPLES_NUM, fact_col1, fact_pos, selected_num);
+    }
+    free(fact_col1);
+    free(fact_col4);
+    free(fact_pos);
+    free(dim1_col1);
+    free(dim2_col1);
+    free(dim_pos);
+    threadpool_shutdown();
+    return 0;
+}
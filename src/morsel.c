@@ -0,0 +1,814 @@
+#include <string.h>
+#include "cs165_api.h"
+#include "morsel.h"
+#include "aggregate.h"
+#include "scan.h"
+#include "threadpool.h"
+#include "utils.h"
+
+typedef struct MorselJob {
+    MorselFunc func;
+    void* args;
+    size_t tuples_num;
+} MorselJob;
+
+typedef struct MorselTask {
+    MorselJob* job;
+    size_t morsel_id;
+} MorselTask;
+
+size_t morsel_count(size_t tuples_num){
+    return (tuples_num + MORSEL_SIZE - 1) / MORSEL_SIZE;
+}
+
+static void morsel_task(void* task_args){
+    MorselTask* task = (MorselTask*) task_args;
+    MorselJob* job = task->job;
+    size_t start = task->morsel_id * MORSEL_SIZE;
+    size_t end = start + MORSEL_SIZE < job->tuples_num ? start + MORSEL_SIZE : job->tuples_num;
+    job->func(task->morsel_id, start, end, job->args);
+}
+
+void morsel_run(size_t tuples_num, MorselFunc func, void* args){
+    size_t morsel_num = morsel_count(tuples_num);
+    size_t start, end;
+    if(morsel_num < MORSEL_PARALLEL_MIN || threadpool_size() == 1){
+        for(size_t m=0;m<morsel_num;m++){
+            start = m * MORSEL_SIZE;
+            end = start + MORSEL_SIZE < tuples_num ? start + MORSEL_SIZE : tuples_num;
+            func(m, start, end, args);
+        }
+        return;
+    }
+    //one task per morsel, idle workers steal the morsels of busy ones
+    MorselJob job;
+    job.func = func;
+    job.args = args;
+    job.tuples_num = tuples_num;
+    MorselTask* tasks = malloc(morsel_num * sizeof(MorselTask));
+    TaskGroup group;
+    task_group_init(&group);
+    for(size_t m=0;m<morsel_num;m++){
+        tasks[m].job = &job;
+        tasks[m].morsel_id = m;
+        threadpool_submit(&group, morsel_task, &tasks[m]);
+    }
+    threadpool_wait(&group);
+    free(tasks);
+}
+
+static void* value_offset(void* payload, DataType dt, size_t offset){
+    if(dt == INT){
+        return (void*) ((int*) payload + offset);
+    }else if(dt == FLOAT){
+        return (void*) ((double*) payload + offset);
+    }
+    return (void*) ((long*) payload + offset);
+}
+
+/*
+ * select
+ */
+typedef struct ScanMorselArgs {
+    void* val_payload;
+    int* pos_vec;
+    DataType dt;
+    Comparator* comp;
+    int* qualifying_index;
+    uint64_t* bitmap;
+    size_t* counts;
+} ScanMorselArgs;
+
+//a morsel writes its positions at qualifying_index+start, it never writes more than end-start of them
+static void scan_select_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    ScanMorselArgs* args = (ScanMorselArgs*) a;
+    int* out = args->qualifying_index + start;
+    size_t count;
+    if(args->pos_vec != NULL){
+        count = scan_select(value_offset(args->val_payload, args->dt, start), args->pos_vec + start, args->dt, end - start, args->comp, out);
+    }else{
+        count = scan_select(value_offset(args->val_payload, args->dt, start), NULL, args->dt, end - start, args->comp, out);
+        for(size_t i=0;i<count;i++){
+            out[i] += start;
+        }
+    }
+    args->counts[morsel_id] = count;
+}
+
+size_t morsel_scan_select(void* val_payload, int* pos_vec, DataType dt, size_t tuples_num, Comparator* comp, int* qualifying_index){
+    size_t morsel_num = morsel_count(tuples_num);
+    ScanMorselArgs args;
+    args.val_payload = val_payload;
+    args.pos_vec = pos_vec;
+    args.dt = dt;
+    args.comp = comp;
+    args.qualifying_index = qualifying_index;
+    args.bitmap = NULL;
+    args.counts = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(size_t));
+    morsel_run(tuples_num, scan_select_morsel, &args);
+    //ordered merge: slide every morsel output down next to the previous one
+    size_t index_count = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        if(index_count != m * MORSEL_SIZE){
+            memmove(qualifying_index + index_count, qualifying_index + m * MORSEL_SIZE, args.counts[m] * sizeof(int));
+        }
+        index_count += args.counts[m];
+    }
+    free(args.counts);
+    return index_count;
+}
+
+//MORSEL_SIZE is a multiple of 64, so a morsel owns the bitmap words it writes
+static void scan_bitmap_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    ScanMorselArgs* args = (ScanMorselArgs*) a;
+    args->counts[morsel_id] = scan_bitmap(value_offset(args->val_payload, args->dt, start), args->dt, end - start, args->comp, args->bitmap + start / 64);
+}
+
+size_t morsel_scan_bitmap(void* val_payload, DataType dt, size_t tuples_num, Comparator* comp, uint64_t* bitmap){
+    size_t morsel_num = morsel_count(tuples_num);
+    ScanMorselArgs args;
+    args.val_payload = val_payload;
+    args.pos_vec = NULL;
+    args.dt = dt;
+    args.comp = comp;
+    args.qualifying_index = NULL;
+    args.bitmap = bitmap;
+    args.counts = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(size_t));
+    morsel_run(tuples_num, scan_bitmap_morsel, &args);
+    size_t index_count = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        index_count += args.counts[m];
+    }
+    free(args.counts);
+    return index_count;
+}
+
+/*
+ * fetch
+ */
+typedef struct FetchMorselArgs {
+    void* val_payload;
+    DataType dt;
+    int* pos_vec;
+    uint64_t* bitmap;
+    size_t* offsets;
+    void* res_payload;
+} FetchMorselArgs;
+
+//positions a random gather prefetches ahead, enough for the loads to overlap a memory latency
+#define FETCH_PREFETCH_DISTANCE 16
+
+//whether pos_vec[start, end) are the consecutive positions pos_vec[start], pos_vec[start]+1, ...
+//Only a morsel whose first and last positions are end-start-1 apart is checked in full.
+static int positions_contiguous(int* pos_vec, size_t start, size_t end){
+    if(pos_vec[end-1] < pos_vec[start] || (size_t) (pos_vec[end-1] - pos_vec[start]) != end - start - 1){
+        return 0;
+    }
+    for(size_t i=start+1;i<end;i++){
+        if(pos_vec[i] != pos_vec[i-1] + 1){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//a contiguous morsel is copied in one go, any other one prefetches the value FETCH_PREFETCH_DISTANCE
+//positions ahead, so that the cache misses of a random position list overlap
+static void fetch_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    FetchMorselArgs* args = (FetchMorselArgs*) a;
+    int* pos_vec = args->pos_vec;
+    if(positions_contiguous(pos_vec, start, end)){
+        size_t width = args->dt == INT ? sizeof(int) : args->dt == FLOAT ? sizeof(double) : sizeof(long);
+        memcpy(value_offset(args->res_payload, args->dt, start), value_offset(args->val_payload, args->dt, pos_vec[start]), (end - start) * width);
+        return;
+    }
+    size_t prefetch_end = end - start > FETCH_PREFETCH_DISTANCE ? end - FETCH_PREFETCH_DISTANCE : start;
+    size_t i = start;
+    if(args->dt == INT){
+        int* val_vec = (int*) args->val_payload;
+        int* res_payload = (int*) args->res_payload;
+        for(;i<prefetch_end;i++){
+            __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+        for(;i<end;i++){
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+    }else if(args->dt == FLOAT){
+        double* val_vec = (double*) args->val_payload;
+        double* res_payload = (double*) args->res_payload;
+        for(;i<prefetch_end;i++){
+            __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+        for(;i<end;i++){
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+    }else{
+        long* val_vec = (long*) args->val_payload;
+        long* res_payload = (long*) args->res_payload;
+        for(;i<prefetch_end;i++){
+            __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+        for(;i<end;i++){
+            res_payload[i] = val_vec[pos_vec[i]];
+        }
+    }
+}
+
+void morsel_fetch(void* val_payload, DataType dt, int* pos_vec, size_t tuples_num, void* res_payload){
+    FetchMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.pos_vec = pos_vec;
+    args.bitmap = NULL;
+    args.offsets = NULL;
+    args.res_payload = res_payload;
+    morsel_run(tuples_num, fetch_morsel, &args);
+}
+
+//a bitmap morsel covers the positions [start, end), its output starts at offsets[morsel_id].
+//Full words are runs of 64 positions and are copied at once.
+static void bitmap_fetch_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    FetchMorselArgs* args = (FetchMorselArgs*) a;
+    size_t k = args->offsets[morsel_id];
+    size_t first_word = start / 64;
+    size_t last_word = bitmap_words(end);
+    uint64_t word;
+    if(args->dt == INT){
+        int* val_vec = (int*) args->val_payload;
+        int* res_payload = (int*) args->res_payload;
+        for(size_t i=first_word;i<last_word;i++){
+            if(args->bitmap[i] == ~UINT64_C(0)){
+                memcpy(res_payload + k, val_vec + i * 64, 64 * sizeof(int));
+                k += 64;
+                continue;
+            }
+            for(word=args->bitmap[i];word;word&=word-1){
+                res_payload[k++] = val_vec[i * 64 + __builtin_ctzll(word)];
+            }
+        }
+    }else if(args->dt == FLOAT){
+        double* val_vec = (double*) args->val_payload;
+        double* res_payload = (double*) args->res_payload;
+        for(size_t i=first_word;i<last_word;i++){
+            if(args->bitmap[i] == ~UINT64_C(0)){
+                memcpy(res_payload + k, val_vec + i * 64, 64 * sizeof(double));
+                k += 64;
+                continue;
+            }
+            for(word=args->bitmap[i];word;word&=word-1){
+                res_payload[k++] = val_vec[i * 64 + __builtin_ctzll(word)];
+            }
+        }
+    }else{
+        long* val_vec = (long*) args->val_payload;
+        long* res_payload = (long*) args->res_payload;
+        for(size_t i=first_word;i<last_word;i++){
+            if(args->bitmap[i] == ~UINT64_C(0)){
+                memcpy(res_payload + k, val_vec + i * 64, 64 * sizeof(long));
+                k += 64;
+                continue;
+            }
+            for(word=args->bitmap[i];word;word&=word-1){
+                res_payload[k++] = val_vec[i * 64 + __builtin_ctzll(word)];
+            }
+        }
+    }
+}
+
+void morsel_bitmap_fetch(void* val_payload, DataType dt, uint64_t* bitmap, size_t bitmap_len, void* res_payload){
+    size_t morsel_num = morsel_count(bitmap_len);
+    size_t* offsets = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(size_t));
+    //prefix sum of the morsel popcounts gives every morsel its output offset
+    size_t total = 0;
+    size_t words;
+    for(size_t m=0;m<morsel_num;m++){
+        offsets[m] = total;
+        words = m + 1 < morsel_num ? MORSEL_SIZE / 64 : bitmap_words(bitmap_len) - m * (MORSEL_SIZE / 64);
+        total += bitmap_count(bitmap + m * (MORSEL_SIZE / 64), words);
+    }
+    FetchMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.pos_vec = NULL;
+    args.bitmap = bitmap;
+    args.offsets = offsets;
+    args.res_payload = res_payload;
+    morsel_run(bitmap_len, bitmap_fetch_morsel, &args);
+    free(offsets);
+}
+
+/*
+ * sum, min and max: one partial per morsel from the kernels of aggregate.h, merged in morsel order by the caller
+ */
+typedef struct AggMorselArgs {
+    void* val_payload;
+    AggregateType t;
+    void* partials;
+} AggMorselArgs;
+
+static void sum_int_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    int* val_vec = (int*) args->val_payload;
+    ((long*) args->partials)[morsel_id] = agg_sum_int(val_vec + start, end - start);
+}
+
+static void sum_long_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    long* val_vec = (long*) args->val_payload;
+    ((long*) args->partials)[morsel_id] = agg_sum_long(val_vec + start, end - start);
+}
+
+static void sum_double_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    double* val_vec = (double*) args->val_payload;
+    double s = 0;
+    for(size_t i=start;i<end;i++){
+        s += val_vec[i];
+    }
+    ((double*) args->partials)[morsel_id] = s;
+}
+
+long morsel_sum_int(int* val_vec, size_t tuples_num){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.partials = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(long));
+    morsel_run(tuples_num, sum_int_morsel, &args);
+    long s = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        s += ((long*) args.partials)[m];
+    }
+    free(args.partials);
+    return s;
+}
+
+long morsel_sum_long(long* val_vec, size_t tuples_num){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.partials = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(long));
+    morsel_run(tuples_num, sum_long_morsel, &args);
+    long s = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        s += ((long*) args.partials)[m];
+    }
+    free(args.partials);
+    return s;
+}
+
+double morsel_sum_double(double* val_vec, size_t tuples_num){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.partials = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(double));
+    morsel_run(tuples_num, sum_double_morsel, &args);
+    double s = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        s += ((double*) args.partials)[m];
+    }
+    free(args.partials);
+    return s;
+}
+
+static void min_max_int_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    int* val_vec = (int*) args->val_payload;
+    ((int*) args->partials)[morsel_id] = agg_min_max_int(val_vec + start, end - start, args->t);
+}
+
+static void min_max_long_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    long* val_vec = (long*) args->val_payload;
+    ((long*) args->partials)[morsel_id] = agg_min_max_long(val_vec + start, end - start, args->t);
+}
+
+static void min_max_double_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    AggMorselArgs* args = (AggMorselArgs*) a;
+    double* val_vec = (double*) args->val_payload;
+    ((double*) args->partials)[morsel_id] = agg_min_max_double(val_vec + start, end - start, args->t);
+}
+
+int morsel_min_max_int(int* val_vec, size_t tuples_num, AggregateType t){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.t = t;
+    args.partials = malloc(morsel_num * sizeof(int));
+    morsel_run(tuples_num, min_max_int_morsel, &args);
+    int* partials = (int*) args.partials;
+    int v = agg_min_max_int(partials, morsel_num, t);
+    free(partials);
+    return v;
+}
+
+long morsel_min_max_long(long* val_vec, size_t tuples_num, AggregateType t){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.t = t;
+    args.partials = malloc(morsel_num * sizeof(long));
+    morsel_run(tuples_num, min_max_long_morsel, &args);
+    long* partials = (long*) args.partials;
+    long v = agg_min_max_long(partials, morsel_num, t);
+    free(partials);
+    return v;
+}
+
+double morsel_min_max_double(double* val_vec, size_t tuples_num, AggregateType t){
+    size_t morsel_num = morsel_count(tuples_num);
+    AggMorselArgs args;
+    args.val_payload = (void*) val_vec;
+    args.t = t;
+    args.partials = malloc(morsel_num * sizeof(double));
+    morsel_run(tuples_num, min_max_double_morsel, &args);
+    double* partials = (double*) args.partials;
+    double v = agg_min_max_double(partials, morsel_num, t);
+    free(partials);
+    return v;
+}
+
+/*
+ * stats for aggregates(): one AggStats per morsel, merged in morsel order
+ */
+typedef struct StatsMorselArgs {
+    void* val_payload;
+    DataType dt;
+    int with_m2;
+    AggStats* partials;
+} StatsMorselArgs;
+
+static void stats_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    StatsMorselArgs* args = (StatsMorselArgs*) a;
+    if(args->dt == INT){
+        agg_stats_int((int*) args->val_payload + start, end - start, args->with_m2, &args->partials[morsel_id]);
+    }else if(args->dt == FLOAT){
+        agg_stats_double((double*) args->val_payload + start, end - start, args->with_m2, &args->partials[morsel_id]);
+    }else{
+        agg_stats_long((long*) args->val_payload + start, end - start, args->with_m2, &args->partials[morsel_id]);
+    }
+}
+
+void morsel_stats(void* val_payload, DataType dt, size_t tuples_num, int with_m2, AggStats* stats){
+    stats->count = 0;
+    size_t morsel_num = morsel_count(tuples_num);
+    if(morsel_num == 0){
+        return;
+    }
+    StatsMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.with_m2 = with_m2;
+    args.partials = malloc(morsel_num * sizeof(AggStats));
+    morsel_run(tuples_num, stats_morsel, &args);
+    for(size_t m=0;m<morsel_num;m++){
+        agg_stats_merge(stats, &args.partials[m], dt);
+    }
+    free(args.partials);
+}
+
+/*
+ * positional min and max: every morsel keeps the first best (position, value) of its positions (or values
+ * when aligned), the partials are merged in morsel order with a strict comparison so that ties keep the first position
+ */
+typedef struct ArgMinMaxPartial {
+    int found;
+    int pos;
+    long long_val;
+    double double_val;
+} ArgMinMaxPartial;
+
+typedef struct ArgMinMaxMorselArgs {
+    void* val_payload;
+    DataType dt;
+    int* pos_vec;
+    uint64_t* bitmap;
+    AggregateType t;
+    ArgMinMaxPartial* partials;
+} ArgMinMaxMorselArgs;
+
+static void arg_min_max_int(int* val_vec, int* pos_vec, size_t n, AggregateType t, ArgMinMaxPartial* p){
+    if(n == 0){
+        return;
+    }
+    size_t i = 0;
+    if(!p->found){
+        p->found = 1;
+        p->pos = pos_vec[0];
+        p->long_val = val_vec[pos_vec[0]];
+        i = 1;
+    }
+    int best = (int) p->long_val;
+    int best_pos = p->pos;
+    int v, better;
+    if(t == MIN){
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v < best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }else{
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v > best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }
+    p->long_val = best;
+    p->pos = best_pos;
+}
+
+static void arg_min_max_long(long* val_vec, int* pos_vec, size_t n, AggregateType t, ArgMinMaxPartial* p){
+    if(n == 0){
+        return;
+    }
+    size_t i = 0;
+    if(!p->found){
+        p->found = 1;
+        p->pos = pos_vec[0];
+        p->long_val = val_vec[pos_vec[0]];
+        i = 1;
+    }
+    long best = p->long_val;
+    int best_pos = p->pos;
+    long v;
+    int better;
+    if(t == MIN){
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v < best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }else{
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v > best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }
+    p->long_val = best;
+    p->pos = best_pos;
+}
+
+static void arg_min_max_double(double* val_vec, int* pos_vec, size_t n, AggregateType t, ArgMinMaxPartial* p){
+    if(n == 0){
+        return;
+    }
+    size_t i = 0;
+    if(!p->found){
+        p->found = 1;
+        p->pos = pos_vec[0];
+        p->double_val = val_vec[pos_vec[0]];
+        i = 1;
+    }
+    double best = p->double_val;
+    int best_pos = p->pos;
+    double v;
+    int better;
+    if(t == MIN){
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v < best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }else{
+        for(;i<n;i++){
+            if(i + FETCH_PREFETCH_DISTANCE < n){
+                __builtin_prefetch(&val_vec[pos_vec[i + FETCH_PREFETCH_DISTANCE]]);
+            }
+            v = val_vec[pos_vec[i]];
+            better = v > best;
+            best = better ? v : best;
+            best_pos = better ? pos_vec[i] : best_pos;
+        }
+    }
+    p->double_val = best;
+    p->pos = best_pos;
+}
+
+static void arg_min_max_positions(ArgMinMaxMorselArgs* args, int* pos_vec, size_t n, ArgMinMaxPartial* p){
+    if(args->dt == INT){
+        arg_min_max_int((int*) args->val_payload, pos_vec, n, args->t, p);
+    }else if(args->dt == FLOAT){
+        arg_min_max_double((double*) args->val_payload, pos_vec, n, args->t, p);
+    }else{
+        arg_min_max_long((long*) args->val_payload, pos_vec, n, args->t, p);
+    }
+}
+
+static void arg_min_max_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    ArgMinMaxMorselArgs* args = (ArgMinMaxMorselArgs*) a;
+    ArgMinMaxPartial* p = &args->partials[morsel_id];
+    p->found = 0;
+    arg_min_max_positions(args, args->pos_vec + start, end - start, p);
+}
+
+static void bitmap_arg_min_max_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    ArgMinMaxMorselArgs* args = (ArgMinMaxMorselArgs*) a;
+    ArgMinMaxPartial* p = &args->partials[morsel_id];
+    p->found = 0;
+    //the set bits of a word are decoded into positions and reduced by the same kernels
+    int positions[64];
+    size_t n;
+    uint64_t word;
+    for(size_t i=start/64;i<bitmap_words(end);i++){
+        n = 0;
+        for(word=args->bitmap[i];word;word&=word-1){
+            positions[n++] = i * 64 + __builtin_ctzll(word);
+        }
+        arg_min_max_positions(args, positions, n, p);
+    }
+}
+
+static ArgMinMaxPartial arg_min_max_merge(ArgMinMaxPartial* partials, size_t morsel_num, DataType dt, AggregateType t){
+    ArgMinMaxPartial best;
+    best.found = 0;
+    ArgMinMaxPartial* p;
+    int better;
+    for(size_t m=0;m<morsel_num;m++){
+        p = &partials[m];
+        if(!p->found){
+            continue;
+        }
+        if(!best.found){
+            best = *p;
+            continue;
+        }
+        if(dt == FLOAT){
+            better = t == MIN ? p->double_val < best.double_val : p->double_val > best.double_val;
+        }else{
+            better = t == MIN ? p->long_val < best.long_val : p->long_val > best.long_val;
+        }
+        if(better){
+            best = *p;
+        }
+    }
+    return best;
+}
+
+static void arg_min_max_store(ArgMinMaxPartial* best, DataType dt, int* res_pos, void* res_val){
+    *res_pos = best->pos;
+    if(dt == INT){
+        *((int*) res_val) = (int) best->long_val;
+    }else if(dt == FLOAT){
+        *((double*) res_val) = best->double_val;
+    }else{
+        *((long*) res_val) = best->long_val;
+    }
+}
+
+int morsel_arg_min_max(void* val_payload, DataType dt, int* pos_vec, uint64_t* bitmap, size_t tuples_num, AggregateType t, int* res_pos, void* res_val){
+    size_t morsel_num = morsel_count(tuples_num);
+    if(morsel_num == 0){
+        return 0;
+    }
+    ArgMinMaxMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.pos_vec = pos_vec;
+    args.bitmap = bitmap;
+    args.t = t;
+    args.partials = malloc(morsel_num * sizeof(ArgMinMaxPartial));
+    morsel_run(tuples_num, pos_vec != NULL ? arg_min_max_morsel : bitmap_arg_min_max_morsel, &args);
+    ArgMinMaxPartial best = arg_min_max_merge(args.partials, morsel_num, dt, t);
+    free(args.partials);
+    if(!best.found){
+        return 0;
+    }
+    arg_min_max_store(&best, dt, res_pos, res_val);
+    return 1;
+}
+
+static void arg_min_max_aligned_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    ArgMinMaxMorselArgs* args = (ArgMinMaxMorselArgs*) a;
+    ArgMinMaxPartial* p = &args->partials[morsel_id];
+    size_t i;
+    //pos holds the index of the value here, mapped to its position once merged
+    if(args->dt == INT){
+        int* val_vec = (int*) args->val_payload;
+        i = start + agg_arg_min_max_int(val_vec + start, end - start, args->t);
+        p->long_val = val_vec[i];
+    }else if(args->dt == FLOAT){
+        double* val_vec = (double*) args->val_payload;
+        i = start + agg_arg_min_max_double(val_vec + start, end - start, args->t);
+        p->double_val = val_vec[i];
+    }else{
+        long* val_vec = (long*) args->val_payload;
+        i = start + agg_arg_min_max_long(val_vec + start, end - start, args->t);
+        p->long_val = val_vec[i];
+    }
+    p->pos = i;
+    p->found = 1;
+}
+
+int morsel_arg_min_max_aligned(void* val_payload, DataType dt, int* pos_vec, size_t tuples_num, AggregateType t, int* res_pos, void* res_val){
+    size_t morsel_num = morsel_count(tuples_num);
+    if(morsel_num == 0){
+        return 0;
+    }
+    ArgMinMaxMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.pos_vec = pos_vec;
+    args.bitmap = NULL;
+    args.t = t;
+    args.partials = malloc(morsel_num * sizeof(ArgMinMaxPartial));
+    morsel_run(tuples_num, arg_min_max_aligned_morsel, &args);
+    ArgMinMaxPartial best = arg_min_max_merge(args.partials, morsel_num, dt, t);
+    free(args.partials);
+    best.pos = pos_vec[best.pos];
+    arg_min_max_store(&best, dt, res_pos, res_val);
+    return 1;
+}
+
+/*
+ * add and sub: every morsel writes its own slice of the output
+ */
+typedef struct AddSubMorselArgs {
+    void* val_vec1;
+    DataType dt1;
+    void* val_vec2;
+    DataType dt2;
+    AggregateType t;
+    void* res_payload;
+} AddSubMorselArgs;
+
+//both operands are converted to the result type, as the usual arithmetic conversions would do
+#define ADD_SUB_LOOP(T1, T2, TR) { \
+        T1* v1 = (T1*) args->val_vec1; \
+        T2* v2 = (T2*) args->val_vec2; \
+        TR* out = (TR*) args->res_payload; \
+        if(args->t == ADD){ \
+            for(size_t i=start;i<end;i++){ \
+                out[i] = (TR) v1[i] + (TR) v2[i]; \
+            } \
+        }else{ \
+            for(size_t i=start;i<end;i++){ \
+                out[i] = (TR) v1[i] - (TR) v2[i]; \
+            } \
+        } \
+    }
+
+static void add_sub_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    AddSubMorselArgs* args = (AddSubMorselArgs*) a;
+    if(args->dt1 == INT){
+        if(args->dt2 == INT){
+            ADD_SUB_LOOP(int, int, int)
+        }else if(args->dt2 == FLOAT){
+            ADD_SUB_LOOP(int, double, double)
+        }else{
+            ADD_SUB_LOOP(int, long, long)
+        }
+    }else if(args->dt1 == FLOAT){
+        if(args->dt2 == INT){
+            ADD_SUB_LOOP(double, int, double)
+        }else if(args->dt2 == FLOAT){
+            ADD_SUB_LOOP(double, double, double)
+        }else{
+            ADD_SUB_LOOP(double, long, double)
+        }
+    }else{
+        if(args->dt2 == INT){
+            ADD_SUB_LOOP(long, int, long)
+        }else if(args->dt2 == FLOAT){
+            ADD_SUB_LOOP(long, double, double)
+        }else{
+            ADD_SUB_LOOP(long, long, long)
+        }
+    }
+}
+
+void morsel_add_sub(void* val_vec1, DataType dt1, void* val_vec2, DataType dt2, size_t tuples_num, AggregateType t, void* res_payload){
+    AddSubMorselArgs args;
+    args.val_vec1 = val_vec1;
+    args.dt1 = dt1;
+    args.val_vec2 = val_vec2;
+    args.dt2 = dt2;
+    args.t = t;
+    args.res_payload = res_payload;
+    morsel_run(tuples_num, add_sub_morsel, &args);
+}
@@ -17,6 +17,7 @@
 #include "utils.h"
 #include "client_context.h"
 #include "message.h"
+#include "expr.h"
 
 /**
  * Takes a pointer to a string.
@@ -183,7 +184,7 @@ DbOperator* parse_create_db(char* create_arguments, message* msg) {
     }
 }
 
-//Usage: create(idx,<col_name>,[btree, sorted], [clustered, unclustered])
+//Usage: create(idx,<col_name>,[btree, sorted, cracked, imprints], [clustered, unclustered]), cracked and imprints are unclustered only
 DbOperator* parse_create_idx(char* create_arguments, message* msg){
     char** create_arguments_index = &create_arguments;
     char* col_name = next_token(create_arguments_index, msg);
@@ -194,7 +195,13 @@ DbOperator* parse_create_idx(char* create_arguments, message* msg){
     if (msg->status == INCORRECT_FORMAT) {
         return NULL;
     }
-    
+    int last_char = strlen(cluster_type) - 1;
+    if (last_char < 0 || cluster_type[last_char] != ')') {
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    cluster_type[last_char] = '\0';
+
     char *col_name_copy, *to_free;
     col_name_copy = to_free = malloc((strlen(col_name)+1) * sizeof(char));
     strcpy(col_name_copy, col_name);
@@ -234,6 +241,15 @@ DbOperator* parse_create_idx(char* create_arguments, message* msg){
         }else if(strcmp(cluster_type, "unclustered") == 0){
             it = SORTED_UNCLUSTERED;
         }
+    }else if(strcmp(idx_type, "cracked") == 0){
+        //the cracker copy never orders the table
+        if(strcmp(cluster_type, "unclustered") == 0){
+            it = CRACKED;
+        }
+    }else if(strcmp(idx_type, "imprints") == 0){
+        if(strcmp(cluster_type, "unclustered") == 0){
+            it = IMPRINTS;
+        }
     }
     if(it == NONE){
         msg->status = QUERY_UNSUPPORTED;
@@ -343,8 +359,21 @@ DbOperator* parse_insert(char* query_command, message* send_message) {
     }
 }
 
+//table db.tbl of column db.tbl.col, NULL if there is none
+Table* find_column_table(char* col_name){
+    char table_name[MAX_SIZE_NAME];
+    char* last_dot = strrchr(col_name, '.');
+    if(last_dot == NULL || (size_t) (last_dot - col_name) >= MAX_SIZE_NAME){
+        return NULL;
+    }
+    memcpy(table_name, col_name, last_dot - col_name);
+    table_name[last_dot - col_name] = '\0';
+    return (Table*) find_context(db_catalog, table_name, TABLE);
+}
+
 //Usage1: <vec_pos>=select(<col_name>,<low>,<high>)
 //Usage2: <vec_pos>=select(<posn_vec>,<val_vec>,<low>,<high>)
+//Usage3: <vec_pos>=select(<col_name>,<low>,<high>,<col_name>,<low>,<high>[,...]), the conjunction of the predicates over columns of one table
 DbOperator* parse_select(char* query_command, ContextTable* client_context_table, message* msg){
     char *tokenizer_copy, *to_free;
     tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
@@ -371,6 +400,9 @@ DbOperator* parse_select(char* query_command, ContextTable* client_context_table
     ComparatorType ct2;
     long int lowerbound = 0;
     long int upperbound = 0;
+    size_t predicate_num = 1;
+    Column** columns = NULL;
+    Comparator* comparators = NULL;
     if (arg_count < 3) {
         cs165_log(stdout, "missing arguments \n");
         msg->status = INCORRECT_FORMAT;
@@ -453,6 +485,54 @@ DbOperator* parse_select(char* query_command, ContextTable* client_context_table
         }else{
             ct2 = NO_COMPARISON;
         }
+    }else if (arg_count % 3 == 0){
+        predicate_num = arg_count / 3;
+        columns = malloc(predicate_num * sizeof(Column*));
+        comparators = malloc(predicate_num * sizeof(Comparator));
+        Table* table = NULL;
+        for(size_t i=0;i<predicate_num;i++){
+            char* col_name = next_token(&tokenizer_copy, msg);
+            char* low = next_token(&tokenizer_copy, msg);
+            char* high = next_token(&tokenizer_copy, msg);
+            if(msg->status == INCORRECT_FORMAT){
+                cs165_log(stdout, "missing next_token arguments \n");
+                free(columns);
+                free(comparators);
+                free(to_free);
+                return NULL;
+            }
+            //every predicate is over a column of the db
+            GCHandle* gch = (GCHandle*) find_context(db_catalog, col_name, GCOLUMN);
+            Table* col_table = find_column_table(col_name);
+            if(gch == NULL || gch->type != COLUMN || col_table == NULL){
+                cs165_log(stdout, "cannot find necessary select context\n");
+                msg->status = OBJECT_NOT_FOUND;
+                free(columns);
+                free(comparators);
+                free(to_free);
+                return NULL;
+            }
+            if(i == 0){
+                gch1 = gch;
+                table = col_table;
+            }else if(col_table != table){
+                cs165_log(stdout, "columns of a conjunctive select belong to different tables\n");
+                msg->status = QUERY_UNSUPPORTED;
+                free(columns);
+                free(comparators);
+                free(to_free);
+                return NULL;
+            }
+            columns[i] = gch->p.column;
+            comparators[i].ct1 = strcmp(low, "null") != 0 ? GREATER_THAN_OR_EQUAL : NO_COMPARISON;
+            comparators[i].lowerbound = strcmp(low, "null") != 0 ? atoi(low) : 0;
+            comparators[i].ct2 = strcmp(high, "null") != 0 ? LESS_THAN : NO_COMPARISON;
+            comparators[i].upperbound = strcmp(high, "null") != 0 ? atoi(high) : 0;
+        }
+        ct1 = comparators[0].ct1;
+        ct2 = comparators[0].ct2;
+        lowerbound = comparators[0].lowerbound;
+        upperbound = comparators[0].upperbound;
     }else{
         msg->status = INCORRECT_FORMAT;
         cs165_log(stdout, "Command format incorrect \n");
@@ -467,6 +547,9 @@ DbOperator* parse_select(char* query_command, ContextTable* client_context_table
     dbo->operator_fields.select_operator.comparator.upperbound = upperbound;
     dbo->operator_fields.select_operator.comparator.ct1 = ct1;
     dbo->operator_fields.select_operator.comparator.ct2 = ct2;
+    dbo->operator_fields.select_operator.predicate_num = predicate_num;
+    dbo->operator_fields.select_operator.columns = columns;
+    dbo->operator_fields.select_operator.comparators = comparators;
     free(to_free);
     return dbo;
 }
@@ -629,6 +712,393 @@ DbOperator* parse_aggregate(char* query_command, AggregateType type, ContextTabl
     return dbo;
 }
 
+//count, sum, min, max, avg or var, returns 0 for any other name
+int parse_aggregate_name(char* name, AggregateType* t){
+    if(strcmp(name, "count") == 0){
+        *t = COUNT;
+    }else if(strcmp(name, "sum") == 0){
+        *t = SUM;
+    }else if(strcmp(name, "min") == 0){
+        *t = MIN;
+    }else if(strcmp(name, "max") == 0){
+        *t = MAX;
+    }else if(strcmp(name, "avg") == 0){
+        *t = AVG;
+    }else if(strcmp(name, "var") == 0){
+        *t = VAR;
+    }else{
+        return 0;
+    }
+    return 1;
+}
+
+//Usage: <agg_val1>,...=aggregates(<vec_val>,<agg1>,...) with agg among count, sum, min, max, avg and var,
+//one client variable per agg, all computed in one pass over vec_val
+DbOperator* parse_multi_aggregate(char* query_command, ContextTable* client_context_table, message* msg){
+    query_command = trim_parenthesis(query_command);
+    char *tokenizer_copy, *to_free;
+    tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
+    strcpy(tokenizer_copy, query_command);
+    char* val_vec = next_token(&tokenizer_copy, msg);
+    if(msg->status == INCORRECT_FORMAT){
+        cs165_log(stdout, "cannot get first argument right\n");
+        free(to_free);
+        return NULL;
+    }
+    //check if val_vec is a true column in db first
+    GCHandle* gch = (GCHandle*) find_context(db_catalog, val_vec, GCOLUMN);
+    if(gch == NULL){
+        gch = (GCHandle*) find_context(client_context_table, val_vec, GCOLUMN);
+        if(gch == NULL){
+            cs165_log(stdout, "cannot get context for first argument string: %s \n", val_vec);
+            msg->status = OBJECT_NOT_FOUND;
+            free(to_free);
+            return NULL;
+        }
+    }
+    AggregateType types[MAX_CLIENT_VARIABLES];
+    size_t type_num = 0;
+    char* agg;
+    while((agg = strsep(&tokenizer_copy, ",")) != NULL){
+        agg = trim_whitespace(agg);
+        if(type_num == MAX_CLIENT_VARIABLES){
+            cs165_log(stdout, "too many aggregates\n");
+            msg->status = INCORRECT_FORMAT;
+            free(to_free);
+            return NULL;
+        }
+        if(!parse_aggregate_name(agg, &types[type_num])){
+            cs165_log(stdout, "unknown aggregate: %s\n", agg);
+            msg->status = INCORRECT_FORMAT;
+            free(to_free);
+            return NULL;
+        }
+        type_num++;
+    }
+    if(type_num == 0){
+        msg->status = INCORRECT_FORMAT;
+        free(to_free);
+        return NULL;
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = MULTI_AGGREGATE;
+    dbo->operator_fields.multi_aggregate_operator.gch = gch;
+    memcpy(dbo->operator_fields.multi_aggregate_operator.types, types, type_num * sizeof(AggregateType));
+    dbo->operator_fields.multi_aggregate_operator.type_num = type_num;
+    free(to_free);
+    return dbo;
+}
+
+//Usage: <keys>,<aggs>=group_agg(<key_vec>,<val_vec>,<agg>) with agg among count, sum, min, max and avg
+DbOperator* parse_group_aggregate(char* query_command, ContextTable* client_context_table, message* msg){
+    query_command = trim_parenthesis(query_command);
+    char *tokenizer_copy, *to_free;
+    tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
+    strcpy(tokenizer_copy, query_command);
+    char* key_vec = next_token(&tokenizer_copy, msg);
+    char* val_vec = next_token(&tokenizer_copy, msg);
+    char* agg = next_token(&tokenizer_copy, msg);
+    if(msg->status == INCORRECT_FORMAT || tokenizer_copy != NULL){
+        cs165_log(stdout, "group_agg takes a key vector, a value vector and an aggregate\n");
+        msg->status = INCORRECT_FORMAT;
+        free(to_free);
+        return NULL;
+    }
+    AggregateType t;
+    agg = trim_whitespace(agg);
+    if(!parse_aggregate_name(agg, &t) || t == VAR){
+        cs165_log(stdout, "unknown aggregate: %s\n", agg);
+        msg->status = INCORRECT_FORMAT;
+        free(to_free);
+        return NULL;
+    }
+    //check if key_vec is a true column in db first
+    GCHandle* gch1 = (GCHandle*) find_context(db_catalog, key_vec, GCOLUMN);
+    if(gch1 == NULL){
+        gch1 = (GCHandle*) find_context(client_context_table, key_vec, GCOLUMN);
+        if(gch1 == NULL){
+            cs165_log(stdout, "cannot get context for first argument string: %s \n", key_vec);
+            msg->status = OBJECT_NOT_FOUND;
+            free(to_free);
+            return NULL;
+        }
+    }
+    GCHandle* gch2 = (GCHandle*) find_context(db_catalog, val_vec, GCOLUMN);
+    if(gch2 == NULL){
+        gch2 = (GCHandle*) find_context(client_context_table, val_vec, GCOLUMN);
+        if(gch2 == NULL){
+            cs165_log(stdout, "cannot get context for second argument string: %s \n", val_vec);
+            msg->status = OBJECT_NOT_FOUND;
+            free(to_free);
+            return NULL;
+        }
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = GROUP_AGGREGATE;
+    dbo->operator_fields.group_aggregate_operator.gch1 = gch1;
+    dbo->operator_fields.group_aggregate_operator.gch2 = gch2;
+    dbo->operator_fields.group_aggregate_operator.type = t;
+    free(to_free);
+    return dbo;
+}
+
+//Usage: <vals>[,<pos>]=sort([<vec_pos>,]<vec_val>) and <vals>[,<pos>]=topk([<vec_pos>,]<vec_val>,<k>)
+DbOperator* parse_sort(char* query_command, int topk, ContextTable* client_context_table, message* msg){
+    query_command = trim_parenthesis(query_command);
+    char *tokenizer_copy, *to_free;
+    tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
+    strcpy(tokenizer_copy, query_command);
+    char* args[3];
+    size_t arg_num = 0;
+    char* arg;
+    while((arg = strsep(&tokenizer_copy, ",")) != NULL){
+        if(arg_num == 3){
+            arg_num++;
+            break;
+        }
+        args[arg_num++] = trim_whitespace(arg);
+    }
+    size_t vec_num = topk ? arg_num - 1 : arg_num;
+    if(arg_num == 0 || vec_num < 1 || vec_num > 2){
+        cs165_log(stdout, "%s takes an optional position vector, a value vector%s\n", topk ? "topk" : "sort", topk ? " and k" : "");
+        msg->status = INCORRECT_FORMAT;
+        free(to_free);
+        return NULL;
+    }
+    long k = 0;
+    if(topk){
+        char* end;
+        k = strtol(args[arg_num-1], &end, 10);
+        if(end == args[arg_num-1] || *end != '\0' || k < 0){
+            cs165_log(stdout, "k is not a number: %s\n", args[arg_num-1]);
+            msg->status = INCORRECT_FORMAT;
+            free(to_free);
+            return NULL;
+        }
+    }
+    GCHandle* gchs[2] = {NULL, NULL};
+    for(size_t i=0;i<vec_num;i++){
+        //check if the vector is a true column in db first
+        gchs[i] = (GCHandle*) find_context(db_catalog, args[i], GCOLUMN);
+        if(gchs[i] == NULL){
+            gchs[i] = (GCHandle*) find_context(client_context_table, args[i], GCOLUMN);
+            if(gchs[i] == NULL){
+                cs165_log(stdout, "cannot get context for argument string: %s \n", args[i]);
+                msg->status = OBJECT_NOT_FOUND;
+                free(to_free);
+                return NULL;
+            }
+        }
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = SORT;
+    dbo->operator_fields.sort_operator.gch1 = vec_num == 2 ? gchs[0] : NULL;
+    dbo->operator_fields.sort_operator.gch2 = vec_num == 2 ? gchs[1] : gchs[0];
+    dbo->operator_fields.sort_operator.topk = topk;
+    dbo->operator_fields.sort_operator.k = (size_t) k;
+    free(to_free);
+    return dbo;
+}
+
+ExprNode* parse_expression_sum(char** cursor, ContextTable* client_context_table, message* msg);
+
+//a number, a vector or a parenthesized sum
+ExprNode* parse_expression_primary(char** cursor, ContextTable* client_context_table, message* msg){
+    char* start = *cursor;
+    if(*start == '('){
+        (*cursor)++;
+        ExprNode* node = parse_expression_sum(cursor, client_context_table, msg);
+        if(node == NULL){
+            return NULL;
+        }
+        if(**cursor != ')'){
+            cs165_log(stdout, "missing ) in expression\n");
+            msg->status = INCORRECT_FORMAT;
+            expr_node_free(node);
+            return NULL;
+        }
+        (*cursor)++;
+        return node;
+    }
+    if(isdigit(*start) || *start == '.'){
+        int is_float = 0;
+        while(isdigit(**cursor) || **cursor == '.'){
+            is_float |= **cursor == '.';
+            (*cursor)++;
+        }
+        return is_float ? expr_constant(0, strtod(start, NULL), 1) : expr_constant(strtol(start, NULL, 10), 0, 0);
+    }
+    if(*start == '\0'){
+        cs165_log(stdout, "expression ends too early\n");
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    if(!isalpha(*start) && *start != '_'){
+        cs165_log(stdout, "unexpected character in expression: %c\n", *start);
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    while(isalnum(**cursor) || **cursor == '_' || **cursor == '.'){
+        (*cursor)++;
+    }
+    char name[HANDLE_MAX_SIZE];
+    if((size_t) (*cursor - start) >= HANDLE_MAX_SIZE){
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    memcpy(name, start, *cursor - start);
+    name[*cursor - start] = '\0';
+    //check if the name is a true column in db first
+    GCHandle* gch = (GCHandle*) find_context(db_catalog, name, GCOLUMN);
+    if(gch == NULL){
+        gch = (GCHandle*) find_context(client_context_table, name, GCOLUMN);
+        if(gch == NULL){
+            cs165_log(stdout, "cannot get context for vector in expression: %s \n", name);
+            msg->status = OBJECT_NOT_FOUND;
+            return NULL;
+        }
+    }
+    return expr_vector(gch);
+}
+
+ExprNode* parse_expression_unary(char** cursor, ContextTable* client_context_table, message* msg){
+    if(**cursor == '-'){
+        (*cursor)++;
+        ExprNode* node = parse_expression_unary(cursor, client_context_table, msg);
+        return node == NULL ? NULL : expr_binary('-', expr_constant(0, 0, 0), node);
+    }
+    return parse_expression_primary(cursor, client_context_table, msg);
+}
+
+ExprNode* parse_expression_product(char** cursor, ContextTable* client_context_table, message* msg){
+    ExprNode* node = parse_expression_unary(cursor, client_context_table, msg);
+    ExprNode* right;
+    char op;
+    while(node != NULL && (**cursor == '*' || **cursor == '/')){
+        op = *(*cursor)++;
+        right = parse_expression_unary(cursor, client_context_table, msg);
+        if(right == NULL){
+            expr_node_free(node);
+            return NULL;
+        }
+        node = expr_binary(op, node, right);
+    }
+    return node;
+}
+
+ExprNode* parse_expression_sum(char** cursor, ContextTable* client_context_table, message* msg){
+    ExprNode* node = parse_expression_product(cursor, client_context_table, msg);
+    ExprNode* right;
+    char op;
+    while(node != NULL && (**cursor == '+' || **cursor == '-')){
+        op = *(*cursor)++;
+        right = parse_expression_product(cursor, client_context_table, msg);
+        if(right == NULL){
+            expr_node_free(node);
+            return NULL;
+        }
+        node = expr_binary(op, node, right);
+    }
+    return node;
+}
+
+//Usage: <vec>=expr(<expression>) with + - * /, unary minus and parentheses over vectors and constants
+DbOperator* parse_expression(char* query_command, ContextTable* client_context_table, message* msg){
+    //whitespace is already gone, only the outer parentheses are removed: the expression keeps its own
+    size_t length = strlen(query_command);
+    if(length < 2 || query_command[0] != '(' || query_command[length-1] != ')'){
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    query_command[length-1] = '\0';
+    char* cursor = query_command + 1;
+    ExprNode* root = parse_expression_sum(&cursor, client_context_table, msg);
+    if(root == NULL){
+        return NULL;
+    }
+    if(*cursor != '\0'){
+        cs165_log(stdout, "unexpected character in expression: %c\n", *cursor);
+        msg->status = INCORRECT_FORMAT;
+        expr_node_free(root);
+        return NULL;
+    }
+    ExprProgram* program = expr_compile(root);
+    expr_node_free(root);
+    if(program == NULL){
+        cs165_log(stdout, "expression needs from 1 to %d distinct vectors\n", EXPR_MAX_VECTORS);
+        msg->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = EXPRESSION;
+    dbo->operator_fields.expr_operator.program = program;
+    return dbo;
+}
+
+//Usage: <est>[,<low>,<high>]=approx_count(<col>[,<low>,<high>]), same for approx_sum and approx_avg,
+//or approx_sum(<val_col>,<pred_col>,<low>,<high>) to aggregate one column over a range of another of the table
+DbOperator* parse_approx(char* query_command, AggregateType t, message* msg){
+    query_command = trim_parenthesis(query_command);
+    char *tokenizer_copy, *to_free;
+    tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
+    strcpy(tokenizer_copy, query_command);
+    char* args[4];
+    size_t arg_num = 0;
+    char* arg;
+    while((arg = strsep(&tokenizer_copy, ",")) != NULL){
+        if(arg_num == 4){
+            arg_num++;
+            break;
+        }
+        args[arg_num++] = trim_whitespace(arg);
+    }
+    if(arg_num != 1 && arg_num != 3 && arg_num != 4){
+        cs165_log(stdout, "approximate aggregates take a column and optionally a column and a range\n");
+        msg->status = INCORRECT_FORMAT;
+        free(to_free);
+        return NULL;
+    }
+    //only columns of the db, they are sampled through their table
+    char* val_name = args[0];
+    char* pred_name = arg_num == 4 ? args[1] : arg_num == 3 ? args[0] : NULL;
+    GCHandle* gch_val = (GCHandle*) find_context(db_catalog, val_name, GCOLUMN);
+    GCHandle* gch_pred = pred_name != NULL ? (GCHandle*) find_context(db_catalog, pred_name, GCOLUMN) : NULL;
+    Table* table = find_column_table(val_name);
+    if(gch_val == NULL || gch_val->type != COLUMN || table == NULL
+       || (pred_name != NULL && (gch_pred == NULL || gch_pred->type != COLUMN || find_column_table(pred_name) != table))){
+        cs165_log(stdout, "approximate aggregates need columns of one table\n");
+        msg->status = OBJECT_NOT_FOUND;
+        free(to_free);
+        return NULL;
+    }
+    Comparator comparator;
+    comparator.ct1 = NO_COMPARISON;
+    comparator.ct2 = NO_COMPARISON;
+    comparator.lowerbound = 0;
+    comparator.upperbound = 0;
+    if(pred_name != NULL){
+        char* low = args[arg_num-2];
+        char* high = args[arg_num-1];
+        if(strcmp(low, "null") != 0){
+            comparator.ct1 = GREATER_THAN_OR_EQUAL;
+            comparator.lowerbound = atoi(low);
+        }
+        if(strcmp(high, "null") != 0){
+            comparator.ct2 = LESS_THAN;
+            comparator.upperbound = atoi(high);
+        }
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = APPROX_AGGREGATE;
+    dbo->operator_fields.approx_operator.table = table;
+    dbo->operator_fields.approx_operator.val_col = gch_val->p.column;
+    dbo->operator_fields.approx_operator.pred_col = gch_pred != NULL ? gch_pred->p.column : NULL;
+    dbo->operator_fields.approx_operator.comparator = comparator;
+    dbo->operator_fields.approx_operator.type = t;
+    free(to_free);
+    return dbo;
+}
+
 //Usage: print(<vec_val1>,...)
 DbOperator* parse_print(char* query_command, ContextTable* client_context_table, message* msg){
     query_command = trim_parenthesis(query_command);
@@ -716,6 +1186,22 @@ DbOperator* parse_shutdown(char* query_command, message* msg){
     return dbo;
 }
 
+//Usage: stats(<col_name>)
+DbOperator* parse_stats(char* query_command, message* msg){
+    query_command = trim_parenthesis(query_command);
+    query_command = trim_whitespace(query_command);
+    GCHandle* gch = (GCHandle*) find_context(db_catalog, query_command, GCOLUMN);
+    if(gch == NULL || gch->type != COLUMN){
+        msg->status = OBJECT_NOT_FOUND;
+        cs165_log(stdout, "target column does not exist\n");
+        return NULL;
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = STATS;
+    dbo->operator_fields.stats_operator.column = gch->p.column;
+    return dbo;
+}
+
 DbOperator* parse_batch_queries(char* query_command, message* msg){
     (void) query_command;
     (void) msg;
@@ -731,7 +1217,7 @@ DbOperator* parse_batch_execute(char* query_command, message* msg){
     dbo->type = BATCH_MODE_EXECUTE;
     return dbo;
 }
-//Usage: join(<vec_val1>,<vec_pos1>,<vec_val2>,<vec_pos2>, [hash,nested-loop,...])
+//Usage: join(<vec_val1>,<vec_pos1>,<vec_val2>,<vec_pos2>, [hash,nested-loop,radix,parallel-hash,grace])
 DbOperator* parse_join(char* query_command, ContextTable* client_context_table, message* msg){
     char *tokenizer_copy, *to_free;
     tokenizer_copy = to_free = malloc((strlen(query_command)+1) * sizeof(char));
@@ -785,7 +1271,9 @@ DbOperator* parse_join(char* query_command, ContextTable* client_context_table,
             msg->status = OBJECT_NOT_FOUND;
             return NULL;
         }
-        if(gch_val_vec1->p.result->num_tuples != gch_pos_vec1->p.result->num_tuples){
+        //deferred results are only sized when the join runs, see execute_join_operator
+        if(gch_val_vec1->p.result->format != DEFERRED && gch_pos_vec1->p.result->format != DEFERRED
+           && gch_val_vec1->p.result->num_tuples != gch_pos_vec1->p.result->num_tuples){
             cs165_log(stdout, "val vec 1 size != pos vec 1 size\n");
             msg->status = INCORRECT_FORMAT;
             return NULL;
@@ -814,7 +1302,9 @@ DbOperator* parse_join(char* query_command, ContextTable* client_context_table,
             msg->status = OBJECT_NOT_FOUND;
             return NULL;
         }
-        if(gch_val_vec2->p.result->num_tuples != gch_pos_vec2->p.result->num_tuples){
+        //deferred results are only sized when the join runs, see execute_join_operator
+        if(gch_val_vec2->p.result->format != DEFERRED && gch_pos_vec2->p.result->format != DEFERRED
+           && gch_val_vec2->p.result->num_tuples != gch_pos_vec2->p.result->num_tuples){
             cs165_log(stdout, "val vec 2 size != pos vec 2 size\n");
             msg->status = INCORRECT_FORMAT;
             return NULL;
@@ -834,6 +1324,12 @@ DbOperator* parse_join(char* query_command, ContextTable* client_context_table,
             jt = NESTED_LOOP;
         }else if(strcmp(join_arg, "hash") == 0){
             jt = HASH;
+        }else if(strcmp(join_arg, "radix") == 0){
+            jt = RADIX_HASH;
+        }else if(strcmp(join_arg, "parallel-hash") == 0){
+            jt = PARALLEL_HASH;
+        }else if(strcmp(join_arg, "grace") == 0){
+            jt = GRACE_HASH;
         }else{
             cs165_log(stdout, "join type not supported\n");
             msg->status = INCORRECT_FORMAT;
@@ -1029,7 +1525,7 @@ DbOperator* parse_command(char* query_command, message* send_message, int client
     }
     char *equals_pointer = strchr(query_command, '=');\
     size_t client_variable_count = 0;
-    char client_variables[2][HANDLE_MAX_SIZE];
+    char client_variables[MAX_CLIENT_VARIABLES][HANDLE_MAX_SIZE];
     if (equals_pointer != NULL) {
         // handle exists, store here.
         client_variable_count=1;
@@ -1042,15 +1538,16 @@ DbOperator* parse_command(char* query_command, message* send_message, int client
                 client_variable_count++;
             }
         }
-        if(client_variable_count==1){
-            strcpy(client_variables[0], client_variable_p);
-            cs165_log(stdout, "client variable 1: %s\n", client_variables[0]);
-        }else{
-            //we have two handles
-            strcpy(client_variables[0], next_token(&client_variable_p, send_message));
-            strcpy(client_variables[1], next_token(&client_variable_p, send_message));
-            cs165_log(stdout, "client variable 1: %s\n", client_variables[0]);
-            cs165_log(stdout, "client variable 2: %s\n", client_variables[1]);
+        if(client_variable_count > MAX_CLIENT_VARIABLES){
+            cs165_log(stdout, "too many client variables: %zu\n", client_variable_count);
+            send_message->status = INCORRECT_FORMAT;
+            free(to_free);
+            return NULL;
+        }
+        //one handle per output, separated by commas
+        for(size_t i=0;i<client_variable_count;i++){
+            strcpy(client_variables[i], next_token(&client_variable_p, send_message));
+            cs165_log(stdout, "client variable %zu: %s\n", i+1, client_variables[i]);
         }
         query_command = ++equals_pointer;
         free(to_free);
@@ -1088,12 +1585,36 @@ DbOperator* parse_command(char* query_command, message* send_message, int client
     } else if (strncmp(query_command, "sum", 3) == 0){
         query_command += 3;
         dbo = parse_aggregate(query_command, SUM, client_context_table, send_message);
+    } else if (strncmp(query_command, "aggregates", 10) == 0){
+        query_command += 10;
+        dbo = parse_multi_aggregate(query_command, client_context_table, send_message);
     } else if (strncmp(query_command, "add", 3) == 0){
         query_command += 3;
         dbo = parse_aggregate(query_command, ADD, client_context_table, send_message);
     } else if (strncmp(query_command, "sub", 3) == 0){
         query_command += 3;
         dbo = parse_aggregate(query_command, SUB, client_context_table, send_message);
+    } else if (strncmp(query_command, "group_agg", 9) == 0){
+        query_command += 9;
+        dbo = parse_group_aggregate(query_command, client_context_table, send_message);
+    } else if (strncmp(query_command, "sort", 4) == 0){
+        query_command += 4;
+        dbo = parse_sort(query_command, 0, client_context_table, send_message);
+    } else if (strncmp(query_command, "topk", 4) == 0){
+        query_command += 4;
+        dbo = parse_sort(query_command, 1, client_context_table, send_message);
+    } else if (strncmp(query_command, "approx_count", 12) == 0){
+        query_command += 12;
+        dbo = parse_approx(query_command, COUNT, send_message);
+    } else if (strncmp(query_command, "approx_sum", 10) == 0){
+        query_command += 10;
+        dbo = parse_approx(query_command, SUM, send_message);
+    } else if (strncmp(query_command, "approx_avg", 10) == 0){
+        query_command += 10;
+        dbo = parse_approx(query_command, AVG, send_message);
+    } else if (strncmp(query_command, "expr", 4) == 0){
+        query_command += 4;
+        dbo = parse_expression(query_command, client_context_table, send_message);
     } else if (strncmp(query_command, "print", 5) == 0){
         query_command += 5;
         dbo = parse_print(query_command, client_context_table, send_message);
@@ -1103,6 +1624,9 @@ DbOperator* parse_command(char* query_command, message* send_message, int client
     } else if (strncmp(query_command, "shutdown", 8) == 0){
         query_command += 8;
         dbo = parse_shutdown(query_command, send_message);
+    } else if (strncmp(query_command, "stats", 5) == 0){
+        query_command += 5;
+        dbo = parse_stats(query_command, send_message);
     } else if (strncmp(query_command, "batch_queries()", 15) == 0){
         query_command += 15;
         dbo = parse_batch_queries(query_command, send_message);
@@ -0,0 +1,140 @@
+#include <limits.h>
+#include "cs165_api.h"
+#include "morsel.h"
+#include "pipeline.h"
+#include "utils.h"
+#include "zonemap.h"
+
+typedef struct PipelineArgs {
+    ZoneMap* zm;
+    int* select_data;
+    int* fetch_data;
+    AggregateType t;
+    //the predicate as the half open range [low, high)
+    long low;
+    long high;
+    //per morsel: qualifying positions and their sum, min or max
+    size_t* counts;
+    long* values;
+} PipelineArgs;
+
+//aggregates fetch_data over [start, end), every position qualifies
+static void aggregate_block(PipelineArgs* args, size_t start, size_t end, long* value){
+    int* fetch_data = args->fetch_data;
+    if(args->t == SUM || args->t == AVG){
+        long s = 0;
+        for(size_t i=start;i<end;i++){
+            s += fetch_data[i];
+        }
+        *value += s;
+    }else if(args->t == MIN){
+        int m = INT_MAX;
+        for(size_t i=start;i<end;i++){
+            m = fetch_data[i] < m ? fetch_data[i] : m;
+        }
+        *value = m < *value ? m : *value;
+    }else{
+        int m = INT_MIN;
+        for(size_t i=start;i<end;i++){
+            m = fetch_data[i] > m ? fetch_data[i] : m;
+        }
+        *value = m > *value ? m : *value;
+    }
+}
+
+//aggregates fetch_data over the positions of [start, end) satisfying the predicate, returns their number.
+//The loops have no branch on the predicate, a position that does not qualify adds 0 or the identity.
+static size_t aggregate_block_where(PipelineArgs* args, size_t start, size_t end, long* value){
+    int* select_data = args->select_data;
+    int* fetch_data = args->fetch_data;
+    long low = args->low;
+    long high = args->high;
+    size_t count = 0;
+    int q;
+    if(args->t == SUM || args->t == AVG){
+        long s = 0;
+        for(size_t i=start;i<end;i++){
+            q = (select_data[i] >= low) & (select_data[i] < high);
+            s += q * (long) fetch_data[i];
+            count += q;
+        }
+        *value += s;
+    }else if(args->t == MIN){
+        int m = INT_MAX;
+        for(size_t i=start;i<end;i++){
+            q = (select_data[i] >= low) & (select_data[i] < high);
+            m = q && fetch_data[i] < m ? fetch_data[i] : m;
+            count += q;
+        }
+        *value = m < *value ? m : *value;
+    }else{
+        int m = INT_MIN;
+        for(size_t i=start;i<end;i++){
+            q = (select_data[i] >= low) & (select_data[i] < high);
+            m = q && fetch_data[i] > m ? fetch_data[i] : m;
+            count += q;
+        }
+        *value = m > *value ? m : *value;
+    }
+    return count;
+}
+
+static void pipeline_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    PipelineArgs* args = (PipelineArgs*) a;
+    Comparator comp;
+    comp.ct1 = GREATER_THAN_OR_EQUAL;
+    comp.ct2 = LESS_THAN;
+    comp.lowerbound = args->low;
+    comp.upperbound = args->high;
+    long value = args->t == MIN ? INT_MAX : (args->t == MAX ? INT_MIN : 0);
+    size_t count = 0;
+    size_t zone_start, zone_end;
+    //a morsel is made of whole zones, each is skipped, taken whole or filtered
+    for(zone_start=start;zone_start<end;zone_start+=ZONE_SIZE){
+        zone_end = zone_start + ZONE_SIZE < end ? zone_start + ZONE_SIZE : end;
+        ZoneMatch match = zone_map_match(&comp, args->zm->min_vec[zone_start / ZONE_SIZE], args->zm->max_vec[zone_start / ZONE_SIZE]);
+        if(match == ZONE_ALL){
+            aggregate_block(args, zone_start, zone_end, &value);
+            count += zone_end - zone_start;
+        }else if(match == ZONE_PARTIAL){
+            count += aggregate_block_where(args, zone_start, zone_end, &value);
+        }
+    }
+    args->counts[morsel_id] = count;
+    args->values[morsel_id] = value;
+}
+
+size_t pipeline_select_aggregate(Column* select_column, Comparator* comp, Column* fetch_column, AggregateType t, long* value){
+    size_t tuples_num = select_column->size;
+    size_t morsel_num = morsel_count(tuples_num);
+    PipelineArgs args;
+    args.zm = &select_column->zone_map;
+    args.select_data = select_column->data;
+    args.fetch_data = fetch_column->data;
+    args.t = t;
+    args.low = comp->ct1 != NO_COMPARISON ? comp->lowerbound : LONG_MIN;
+    args.high = comp->ct2 != NO_COMPARISON ? comp->upperbound : LONG_MAX;
+    args.counts = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(size_t));
+    args.values = malloc((morsel_num > 0 ? morsel_num : 1) * sizeof(long));
+    morsel_run(tuples_num, pipeline_morsel, &args);
+    size_t count = 0;
+    long s = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        if(args.counts[m] == 0){
+            continue;
+        }
+        if(t == SUM || t == AVG){
+            s += args.values[m];
+        }else if(count == 0 || (t == MIN ? args.values[m] < s : args.values[m] > s)){
+            s = args.values[m];
+        }
+        count += args.counts[m];
+    }
+    free(args.counts);
+    free(args.values);
+    if(count > 0 || t == SUM || t == AVG){
+        *value = s;
+    }
+    cs165_log(stdout, "pipeline: %zd of %zd tuples qualify\n", count, tuples_num);
+    return count;
+}
@@ -0,0 +1,215 @@
+#include <math.h>
+#include "cs165_api.h"
+#include "sample.h"
+#include "compress.h"
+#include "morsel.h"
+#include "scan.h"
+#include "utils.h"
+
+#define SAMPLE_SEED UINT64_C(0x9E3779B97F4A7C15)
+
+//xorshift64*
+static uint64_t sample_random(TableSample* sample){
+    uint64_t x = sample->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    sample->rng = x;
+    return x * UINT64_C(0x2545F4914F6CDD1D);
+}
+
+//uniform in (0, 1)
+static double sample_uniform(TableSample* sample){
+    return ((sample_random(sample) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+//Algorithm L: rows skipped before the next one that replaces a sampled one
+static void sample_skip(TableSample* sample, size_t row){
+    double skip = floor(log(sample_uniform(sample)) / log(1 - sample->w));
+    sample->next = skip < (double) (SIZE_MAX / 2) ? row + (size_t) skip + 1 : SIZE_MAX;
+}
+
+void sample_init(TableSample* sample){
+    sample->positions = NULL;
+    sample->size = 0;
+    sample->rng = SAMPLE_SEED;
+    sample->w = 0;
+    sample->next = 0;
+    sample->valid = 1;
+}
+
+void sample_free(TableSample* sample){
+    free(sample->positions);
+    sample->positions = NULL;
+}
+
+//offers the row streamed in at index row, returns the slot it took or -1
+static long sample_offer(TableSample* sample, size_t row){
+    size_t slot;
+    if(sample->size < TABLE_SAMPLE_SIZE){
+        if(sample->positions == NULL){
+            sample->positions = malloc(TABLE_SAMPLE_SIZE * sizeof(int));
+        }
+        slot = sample->size++;
+        sample->positions[slot] = (int) row;
+        if(sample->size == TABLE_SAMPLE_SIZE){
+            sample->w = exp(log(sample_uniform(sample)) / TABLE_SAMPLE_SIZE);
+            sample_skip(sample, row);
+        }
+        return (long) slot;
+    }
+    if(row < sample->next){
+        return -1;
+    }
+    slot = sample_random(sample) % TABLE_SAMPLE_SIZE;
+    sample->positions[slot] = (int) row;
+    sample->w *= exp(log(sample_uniform(sample)) / TABLE_SAMPLE_SIZE);
+    sample_skip(sample, row);
+    return (long) slot;
+}
+
+void sample_append(TableSample* sample, size_t table_length, size_t row_num){
+    if(!sample->valid){
+        return;
+    }
+    size_t end = table_length + row_num;
+    size_t row = table_length;
+    while(row < end){
+        if(sample->size == TABLE_SAMPLE_SIZE){
+            //straight to the next row replacing a sampled one
+            if(sample->next >= end){
+                break;
+            }
+            row = sample->next;
+        }
+        sample_offer(sample, row);
+        row++;
+    }
+}
+
+void sample_insert(TableSample* sample, size_t table_length, int insert_pos){
+    if(!sample->valid){
+        return;
+    }
+    if((size_t) insert_pos < table_length){
+        for(size_t i=0;i<sample->size;i++){
+            sample->positions[i] += sample->positions[i] >= insert_pos;
+        }
+    }
+    long slot = sample_offer(sample, table_length);
+    if(slot >= 0){
+        sample->positions[slot] = insert_pos;
+    }
+}
+
+void sample_invalidate(TableSample* sample){
+    sample->valid = 0;
+}
+
+void sample_refresh(TableSample* sample, size_t table_length){
+    if(sample->valid){
+        return;
+    }
+    sample->size = 0;
+    sample->valid = 1;
+    sample_append(sample, 0, table_length);
+    cs165_log(stdout, "sample: %zu of %zu rows drawn again\n", sample->size, table_length);
+}
+
+//the fields of the sample are part of the table metadata, only the positions are left
+void sample_dump(FILE* fd, TableSample* sample){
+    fwrite(sample->positions, sizeof(int), sample->size, fd);
+    sample_free(sample);
+}
+
+void sample_load(FILE* fd, TableSample* sample){
+    sample->positions = NULL;
+    if(sample->size > 0){
+        sample->positions = malloc(TABLE_SAMPLE_SIZE * sizeof(int));
+        fread(sample->positions, sizeof(int), sample->size, fd);
+    }
+}
+
+static void sample_gather(Column* column, int* positions, size_t sample_num, int* res_vec){
+    if(column->encoding != PLAIN){
+        encoded_fetch(column, positions, sample_num, res_vec);
+    }else{
+        morsel_fetch((void*) column->data, INT, positions, sample_num, (void*) res_vec);
+    }
+}
+
+int sample_estimate(Table* table, Column* val_col, Column* pred_col, Comparator* comp, AggregateType t,
+                    double* estimate, double* low, double* high, size_t* sample_rows, size_t* qualifying_rows){
+    TableSample* sample = &table->sample;
+    sample_refresh(sample, table->table_length);
+    size_t n = sample->size;
+    double rows = (double) table->table_length;
+    *sample_rows = n;
+    *qualifying_rows = 0;
+    *estimate = *low = *high = 0;
+    if(n == 0){
+        return t != AVG;
+    }
+    //sampled rows satisfying comp, by their index in the sample
+    int* qualifying = malloc(n * sizeof(int));
+    size_t h;
+    if(pred_col != NULL){
+        int* pred_vals = malloc(n * sizeof(int));
+        sample_gather(pred_col, sample->positions, n, pred_vals);
+        h = scan_select_int(pred_vals, NULL, n, comp, qualifying);
+        free(pred_vals);
+    }else{
+        for(size_t i=0;i<n;i++){
+            qualifying[i] = (int) i;
+        }
+        h = n;
+    }
+    *qualifying_rows = h;
+    //without replacement: the variance shrinks to 0 as the sample covers the whole table
+    double fpc = rows > 1 ? (rows - n) / (rows - 1) : 0;
+    double se;
+    if(t == COUNT){
+        double p = (double) h / n;
+        *estimate = rows * p;
+        se = n > 1 ? rows * sqrt(p * (1 - p) * n / (n - 1) / n * fpc) : 0;
+    }else{
+        int* vals = malloc(n * sizeof(int));
+        sample_gather(val_col, sample->positions, n, vals);
+        long sum = 0;
+        for(size_t k=0;k<h;k++){
+            sum += vals[qualifying[k]];
+        }
+        double m2 = 0;
+        double d;
+        if(t == AVG){
+            if(h == 0){
+                free(vals);
+                free(qualifying);
+                return 0;
+            }
+            //mean of the qualifying rows
+            double mean = (double) sum / h;
+            for(size_t k=0;k<h;k++){
+                d = vals[qualifying[k]] - mean;
+                m2 += d * d;
+            }
+            *estimate = mean;
+            se = h > 1 ? sqrt(m2 / (h - 1) / h * fpc) : 0;
+        }else{
+            //mean over all sampled rows of the value, 0 for the rows not qualifying
+            double mean = (double) sum / n;
+            for(size_t k=0;k<h;k++){
+                d = vals[qualifying[k]] - mean;
+                m2 += d * d;
+            }
+            m2 += (n - h) * mean * mean;
+            *estimate = rows * mean;
+            se = n > 1 ? rows * sqrt(m2 / (n - 1) / n * fpc) : 0;
+        }
+        free(vals);
+    }
+    free(qualifying);
+    *low = *estimate - SAMPLE_Z * se;
+    *high = *estimate + SAMPLE_Z * se;
+    return 1;
+}
@@ -0,0 +1,594 @@
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "scan.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_HAS_X86 1
+#else
+#define SCAN_HAS_X86 0
+#endif
+
+//lookup tables turning a comparison bit mask into a shuffle that packs the qualifying lanes to the front
+//avx2: 8 int lanes -> permutevar8x32 lane indexes
+//sse4: 4 int lanes -> pshufb byte indexes
+static int avx2_compress_lut[256][8];
+static unsigned char sse4_compress_lut[16][16];
+
+static ScanKernel best_kernel = SCAN_KERNEL_SCALAR;
+static ScanKernel current_kernel = SCAN_KERNEL_SCALAR;
+
+/**
+ * the predicate is rewritten as lo <= v <= hi (both inclusive) so that the kernels
+ * need neither ct1/ct2 checks nor overflow care inside the hot loop.
+ * returns 0 if no value can qualify.
+ **/
+static int int_bounds(Comparator* comp, int* lo, int* hi){
+    long l = LONG_MIN;
+    long h = LONG_MAX;
+    if(comp->ct1 != NO_COMPARISON){
+        l = comp->lowerbound;
+    }
+    if(comp->ct2 != NO_COMPARISON){
+        if(comp->upperbound == LONG_MIN){
+            return 0;
+        }
+        h = comp->upperbound - 1;
+    }
+    if(l > h || l > INT_MAX || h < INT_MIN){
+        return 0;
+    }
+    *lo = l < INT_MIN ? INT_MIN : (int) l;
+    *hi = h > INT_MAX ? INT_MAX : (int) h;
+    return 1;
+}
+
+static int long_bounds(Comparator* comp, long* lo, long* hi){
+    *lo = LONG_MIN;
+    *hi = LONG_MAX;
+    if(comp->ct1 != NO_COMPARISON){
+        *lo = comp->lowerbound;
+    }
+    if(comp->ct2 != NO_COMPARISON){
+        if(comp->upperbound == LONG_MIN){
+            return 0;
+        }
+        *hi = comp->upperbound - 1;
+    }
+    return *lo <= *hi;
+}
+
+//doubles keep the original lo <= v < hi form, an open side becomes an infinity
+static void double_bounds(Comparator* comp, double* lo, double* hi){
+    *lo = comp->ct1 != NO_COMPARISON ? (double) comp->lowerbound : -INFINITY;
+    *hi = comp->ct2 != NO_COMPARISON ? (double) comp->upperbound : INFINITY;
+}
+
+/*
+ * Portable kernels. Branch free: the position is always written and the
+ * output cursor only advances when the predicate holds.
+ * base is the position of val_vec[0] when there is no pos_vec, so that the
+ * SIMD kernels can hand their tail over.
+ */
+static size_t scan_int_scalar(int* val_vec, int* pos_vec, size_t base, size_t tuples_num, int lo, int hi, int* qualifying_index){
+    size_t index_count = 0;
+    int v;
+    if(pos_vec == NULL){
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = base + i;
+            index_count += (lo <= v) & (v <= hi);
+        }
+    }else{
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = pos_vec[i];
+            index_count += (lo <= v) & (v <= hi);
+        }
+    }
+    return index_count;
+}
+
+static size_t scan_long_scalar(long* val_vec, int* pos_vec, size_t base, size_t tuples_num, long lo, long hi, int* qualifying_index){
+    size_t index_count = 0;
+    long v;
+    if(pos_vec == NULL){
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = base + i;
+            index_count += (lo <= v) & (v <= hi);
+        }
+    }else{
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = pos_vec[i];
+            index_count += (lo <= v) & (v <= hi);
+        }
+    }
+    return index_count;
+}
+
+static size_t scan_double_scalar(double* val_vec, int* pos_vec, size_t base, size_t tuples_num, double lo, double hi, int* qualifying_index){
+    size_t index_count = 0;
+    double v;
+    if(pos_vec == NULL){
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = base + i;
+            index_count += (lo <= v) & (hi > v);
+        }
+    }else{
+        for(size_t i=0;i<tuples_num;i++){
+            v = val_vec[i];
+            qualifying_index[index_count] = pos_vec[i];
+            index_count += (lo <= v) & (hi > v);
+        }
+    }
+    return index_count;
+}
+
+/*
+ * Scalar bitmap kernels: fill the bits [first_bit, first_bit+tuples_num) of bitmap.
+ * The bitmap must be zeroed beforehand.
+ */
+static void bitmap_int_scalar(int* val_vec, size_t first_bit, size_t tuples_num, int lo, int hi, uint64_t* bitmap){
+    size_t bit;
+    int v;
+    for(size_t i=0;i<tuples_num;i++){
+        v = val_vec[i];
+        bit = first_bit + i;
+        bitmap[bit >> 6] |= (uint64_t) ((lo <= v) & (v <= hi)) << (bit & 63);
+    }
+}
+
+static void bitmap_long_scalar(long* val_vec, size_t first_bit, size_t tuples_num, long lo, long hi, uint64_t* bitmap){
+    size_t bit;
+    long v;
+    for(size_t i=0;i<tuples_num;i++){
+        v = val_vec[i];
+        bit = first_bit + i;
+        bitmap[bit >> 6] |= (uint64_t) ((lo <= v) & (v <= hi)) << (bit & 63);
+    }
+}
+
+static void bitmap_double_scalar(double* val_vec, size_t first_bit, size_t tuples_num, double lo, double hi, uint64_t* bitmap){
+    size_t bit;
+    double v;
+    for(size_t i=0;i<tuples_num;i++){
+        v = val_vec[i];
+        bit = first_bit + i;
+        bitmap[bit >> 6] |= (uint64_t) ((lo <= v) & (hi > v)) << (bit & 63);
+    }
+}
+
+#if SCAN_HAS_X86
+/*
+ * AVX2 kernels: 8 values per step (two registers for 64 bit types).
+ * The qualifying positions are packed with permutevar8x32 and stored unaligned.
+ * The store may write up to 7 garbage lanes past the cursor, which is safe
+ * because the cursor never runs ahead of i.
+ */
+__attribute__((target("avx2,popcnt")))
+static inline int avx2_mask_int(int* val_vec, __m256i vlo, __m256i vhi){
+    __m256i v = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(vlo, v), _mm256_cmpgt_epi32(v, vhi));
+    return ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xFF;
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline int avx2_mask_long(long* val_vec, __m256i vlo, __m256i vhi){
+    __m256i v0 = _mm256_loadu_si256((__m256i*) val_vec);
+    __m256i v1 = _mm256_loadu_si256((__m256i*) (val_vec+4));
+    __m256i out0 = _mm256_or_si256(_mm256_cmpgt_epi64(vlo, v0), _mm256_cmpgt_epi64(v0, vhi));
+    __m256i out1 = _mm256_or_si256(_mm256_cmpgt_epi64(vlo, v1), _mm256_cmpgt_epi64(v1, vhi));
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(out0)) | (_mm256_movemask_pd(_mm256_castsi256_pd(out1)) << 4);
+    return ~mask & 0xFF;
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline int avx2_mask_double(double* val_vec, __m256d vlo, __m256d vhi){
+    __m256d v0 = _mm256_loadu_pd(val_vec);
+    __m256d v1 = _mm256_loadu_pd(val_vec+4);
+    __m256d in0 = _mm256_and_pd(_mm256_cmp_pd(vlo, v0, _CMP_LE_OQ), _mm256_cmp_pd(vhi, v0, _CMP_GT_OQ));
+    __m256d in1 = _mm256_and_pd(_mm256_cmp_pd(vlo, v1, _CMP_LE_OQ), _mm256_cmp_pd(vhi, v1, _CMP_GT_OQ));
+    return _mm256_movemask_pd(in0) | (_mm256_movemask_pd(in1) << 4);
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline size_t avx2_emit(int mask, int* pos_vec, size_t i, __m256i vpos, int* out){
+    __m256i src = pos_vec == NULL ? vpos : _mm256_loadu_si256((__m256i*) (pos_vec+i));
+    src = _mm256_permutevar8x32_epi32(src, _mm256_loadu_si256((__m256i*) avx2_compress_lut[mask]));
+    _mm256_storeu_si256((__m256i*) out, src);
+    return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_int_avx2(int* val_vec, int* pos_vec, size_t tuples_num, int lo, int hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m256i vlo = _mm256_set1_epi32(lo);
+    __m256i vhi = _mm256_set1_epi32(hi);
+    __m256i vpos = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vstep = _mm256_set1_epi32(8);
+    for(;i+8<=tuples_num;i+=8){
+        index_count += avx2_emit(avx2_mask_int(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm256_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_int_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_long_avx2(long* val_vec, int* pos_vec, size_t tuples_num, long lo, long hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m256i vlo = _mm256_set1_epi64x(lo);
+    __m256i vhi = _mm256_set1_epi64x(hi);
+    __m256i vpos = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vstep = _mm256_set1_epi32(8);
+    for(;i+8<=tuples_num;i+=8){
+        index_count += avx2_emit(avx2_mask_long(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm256_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_long_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_double_avx2(double* val_vec, int* pos_vec, size_t tuples_num, double lo, double hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    __m256i vpos = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vstep = _mm256_set1_epi32(8);
+    for(;i+8<=tuples_num;i+=8){
+        index_count += avx2_emit(avx2_mask_double(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm256_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_double_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+//bitmap kernels: one 64 bit word per 8 masks
+__attribute__((target("avx2,popcnt")))
+static void bitmap_int_avx2(int* val_vec, size_t tuples_num, int lo, int hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m256i vlo = _mm256_set1_epi32(lo);
+    __m256i vhi = _mm256_set1_epi32(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<8;k++){
+            word |= (uint64_t) avx2_mask_int(val_vec+i+8*k, vlo, vhi) << (8*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_int_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+
+__attribute__((target("avx2,popcnt")))
+static void bitmap_long_avx2(long* val_vec, size_t tuples_num, long lo, long hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m256i vlo = _mm256_set1_epi64x(lo);
+    __m256i vhi = _mm256_set1_epi64x(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<8;k++){
+            word |= (uint64_t) avx2_mask_long(val_vec+i+8*k, vlo, vhi) << (8*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_long_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+
+__attribute__((target("avx2,popcnt")))
+static void bitmap_double_avx2(double* val_vec, size_t tuples_num, double lo, double hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<8;k++){
+            word |= (uint64_t) avx2_mask_double(val_vec+i+8*k, vlo, vhi) << (8*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_double_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+
+/*
+ * SSE4.2 kernels: 4 values per step (two registers for 64 bit types).
+ * The qualifying positions are packed with pshufb.
+ */
+__attribute__((target("sse4.2,popcnt")))
+static inline int sse4_mask_int(int* val_vec, __m128i vlo, __m128i vhi){
+    __m128i v = _mm_loadu_si128((__m128i*) val_vec);
+    __m128i out = _mm_or_si128(_mm_cmpgt_epi32(vlo, v), _mm_cmpgt_epi32(v, vhi));
+    return ~_mm_movemask_ps(_mm_castsi128_ps(out)) & 0xF;
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static inline int sse4_mask_long(long* val_vec, __m128i vlo, __m128i vhi){
+    __m128i v0 = _mm_loadu_si128((__m128i*) val_vec);
+    __m128i v1 = _mm_loadu_si128((__m128i*) (val_vec+2));
+    __m128i out0 = _mm_or_si128(_mm_cmpgt_epi64(vlo, v0), _mm_cmpgt_epi64(v0, vhi));
+    __m128i out1 = _mm_or_si128(_mm_cmpgt_epi64(vlo, v1), _mm_cmpgt_epi64(v1, vhi));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(out0)) | (_mm_movemask_pd(_mm_castsi128_pd(out1)) << 2);
+    return ~mask & 0xF;
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static inline int sse4_mask_double(double* val_vec, __m128d vlo, __m128d vhi){
+    __m128d v0 = _mm_loadu_pd(val_vec);
+    __m128d v1 = _mm_loadu_pd(val_vec+2);
+    __m128d in0 = _mm_and_pd(_mm_cmple_pd(vlo, v0), _mm_cmpgt_pd(vhi, v0));
+    __m128d in1 = _mm_and_pd(_mm_cmple_pd(vlo, v1), _mm_cmpgt_pd(vhi, v1));
+    return _mm_movemask_pd(in0) | (_mm_movemask_pd(in1) << 2);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static inline size_t sse4_emit(int mask, int* pos_vec, size_t i, __m128i vpos, int* out){
+    __m128i src = pos_vec == NULL ? vpos : _mm_loadu_si128((__m128i*) (pos_vec+i));
+    src = _mm_shuffle_epi8(src, _mm_loadu_si128((__m128i*) sse4_compress_lut[mask]));
+    _mm_storeu_si128((__m128i*) out, src);
+    return __builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static size_t scan_int_sse4(int* val_vec, int* pos_vec, size_t tuples_num, int lo, int hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m128i vlo = _mm_set1_epi32(lo);
+    __m128i vhi = _mm_set1_epi32(hi);
+    __m128i vpos = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i vstep = _mm_set1_epi32(4);
+    for(;i+4<=tuples_num;i+=4){
+        index_count += sse4_emit(sse4_mask_int(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_int_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static size_t scan_long_sse4(long* val_vec, int* pos_vec, size_t tuples_num, long lo, long hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m128i vlo = _mm_set1_epi64x(lo);
+    __m128i vhi = _mm_set1_epi64x(hi);
+    __m128i vpos = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i vstep = _mm_set1_epi32(4);
+    for(;i+4<=tuples_num;i+=4){
+        index_count += sse4_emit(sse4_mask_long(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_long_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static size_t scan_double_sse4(double* val_vec, int* pos_vec, size_t tuples_num, double lo, double hi, int* qualifying_index){
+    size_t index_count = 0;
+    size_t i = 0;
+    __m128d vlo = _mm_set1_pd(lo);
+    __m128d vhi = _mm_set1_pd(hi);
+    __m128i vpos = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i vstep = _mm_set1_epi32(4);
+    for(;i+4<=tuples_num;i+=4){
+        index_count += sse4_emit(sse4_mask_double(val_vec+i, vlo, vhi), pos_vec, i, vpos, qualifying_index+index_count);
+        vpos = _mm_add_epi32(vpos, vstep);
+    }
+    return index_count + scan_double_scalar(val_vec+i, pos_vec == NULL ? NULL : pos_vec+i, i, tuples_num-i, lo, hi, qualifying_index+index_count);
+}
+
+//bitmap kernels: one 64 bit word per 16 masks
+__attribute__((target("sse4.2,popcnt")))
+static void bitmap_int_sse4(int* val_vec, size_t tuples_num, int lo, int hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m128i vlo = _mm_set1_epi32(lo);
+    __m128i vhi = _mm_set1_epi32(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<16;k++){
+            word |= (uint64_t) sse4_mask_int(val_vec+i+4*k, vlo, vhi) << (4*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_int_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static void bitmap_long_sse4(long* val_vec, size_t tuples_num, long lo, long hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m128i vlo = _mm_set1_epi64x(lo);
+    __m128i vhi = _mm_set1_epi64x(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<16;k++){
+            word |= (uint64_t) sse4_mask_long(val_vec+i+4*k, vlo, vhi) << (4*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_long_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static void bitmap_double_sse4(double* val_vec, size_t tuples_num, double lo, double hi, uint64_t* bitmap){
+    size_t i = 0;
+    uint64_t word;
+    __m128d vlo = _mm_set1_pd(lo);
+    __m128d vhi = _mm_set1_pd(hi);
+    for(;i+64<=tuples_num;i+=64){
+        word = 0;
+        for(size_t k=0;k<16;k++){
+            word |= (uint64_t) sse4_mask_double(val_vec+i+4*k, vlo, vhi) << (4*k);
+        }
+        bitmap[i >> 6] = word;
+    }
+    bitmap_double_scalar(val_vec+i, i, tuples_num-i, lo, hi, bitmap);
+}
+#endif
+
+static ScanKernel detect_kernel(){
+#if SCAN_HAS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")){
+        return SCAN_KERNEL_AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")){
+        return SCAN_KERNEL_SSE4;
+    }
+#endif
+    return SCAN_KERNEL_SCALAR;
+}
+
+void scan_init(){
+    int lane;
+    for(int mask=0;mask<256;mask++){
+        lane = 0;
+        memset(avx2_compress_lut[mask], 0, sizeof(avx2_compress_lut[mask]));
+        for(int j=0;j<8;j++){
+            if(mask & (1<<j)){
+                avx2_compress_lut[mask][lane++] = j;
+            }
+        }
+    }
+    for(int mask=0;mask<16;mask++){
+        lane = 0;
+        memset(sse4_compress_lut[mask], 0x80, sizeof(sse4_compress_lut[mask]));
+        for(int j=0;j<4;j++){
+            if(mask & (1<<j)){
+                for(int b=0;b<4;b++){
+                    sse4_compress_lut[mask][4*lane+b] = (unsigned char) (4*j+b);
+                }
+                lane++;
+            }
+        }
+    }
+    best_kernel = detect_kernel();
+    current_kernel = best_kernel;
+}
+
+ScanKernel scan_best_kernel(){
+    return best_kernel;
+}
+
+ScanKernel scan_current_kernel(){
+    return current_kernel;
+}
+
+const char* scan_kernel_name(ScanKernel kernel){
+    if(kernel == SCAN_KERNEL_AVX2){
+        return "avx2";
+    }else if(kernel == SCAN_KERNEL_SSE4){
+        return "sse4";
+    }
+    return "scalar";
+}
+
+int scan_set_kernel(ScanKernel kernel){
+    if(kernel > best_kernel){
+        return 0;
+    }
+    current_kernel = kernel;
+    return 1;
+}
+
+size_t scan_select_int(int* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index){
+    int lo, hi;
+    if(!int_bounds(comp, &lo, &hi)){
+        return 0;
+    }
+#if SCAN_HAS_X86
+    if(current_kernel == SCAN_KERNEL_AVX2){
+        return scan_int_avx2(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }else if(current_kernel == SCAN_KERNEL_SSE4){
+        return scan_int_sse4(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }
+#endif
+    return scan_int_scalar(val_vec, pos_vec, 0, tuples_num, lo, hi, qualifying_index);
+}
+
+size_t scan_select_long(long* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index){
+    long lo, hi;
+    if(!long_bounds(comp, &lo, &hi)){
+        return 0;
+    }
+#if SCAN_HAS_X86
+    if(current_kernel == SCAN_KERNEL_AVX2){
+        return scan_long_avx2(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }else if(current_kernel == SCAN_KERNEL_SSE4){
+        return scan_long_sse4(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }
+#endif
+    return scan_long_scalar(val_vec, pos_vec, 0, tuples_num, lo, hi, qualifying_index);
+}
+
+size_t scan_select_double(double* val_vec, int* pos_vec, size_t tuples_num, Comparator* comp, int* qualifying_index){
+    double lo, hi;
+    double_bounds(comp, &lo, &hi);
+#if SCAN_HAS_X86
+    if(current_kernel == SCAN_KERNEL_AVX2){
+        return scan_double_avx2(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }else if(current_kernel == SCAN_KERNEL_SSE4){
+        return scan_double_sse4(val_vec, pos_vec, tuples_num, lo, hi, qualifying_index);
+    }
+#endif
+    return scan_double_scalar(val_vec, pos_vec, 0, tuples_num, lo, hi, qualifying_index);
+}
+
+size_t scan_select(void* val_payload, int* pos_vec, DataType dt, size_t tuples_num, Comparator* comp, int* qualifying_index){
+    if(dt == INT){
+        return scan_select_int((int*) val_payload, pos_vec, tuples_num, comp, qualifying_index);
+    }else if(dt == FLOAT){
+        return scan_select_double((double*) val_payload, pos_vec, tuples_num, comp, qualifying_index);
+    }
+    return scan_select_long((long*) val_payload, pos_vec, tuples_num, comp, qualifying_index);
+}
+
+size_t scan_bitmap(void* val_payload, DataType dt, size_t tuples_num, Comparator* comp, uint64_t* bitmap){
+    size_t words = bitmap_words(tuples_num);
+    memset(bitmap, 0, words * sizeof(uint64_t));
+    if(dt == INT){
+        int lo, hi;
+        if(!int_bounds(comp, &lo, &hi)){
+            return 0;
+        }
+#if SCAN_HAS_X86
+        if(current_kernel == SCAN_KERNEL_AVX2){
+            bitmap_int_avx2((int*) val_payload, tuples_num, lo, hi, bitmap);
+        }else if(current_kernel == SCAN_KERNEL_SSE4){
+            bitmap_int_sse4((int*) val_payload, tuples_num, lo, hi, bitmap);
+        }else
+#endif
+        bitmap_int_scalar((int*) val_payload, 0, tuples_num, lo, hi, bitmap);
+    }else if(dt == FLOAT){
+        double lo, hi;
+        double_bounds(comp, &lo, &hi);
+#if SCAN_HAS_X86
+        if(current_kernel == SCAN_KERNEL_AVX2){
+            bitmap_double_avx2((double*) val_payload, tuples_num, lo, hi, bitmap);
+        }else if(current_kernel == SCAN_KERNEL_SSE4){
+            bitmap_double_sse4((double*) val_payload, tuples_num, lo, hi, bitmap);
+        }else
+#endif
+        bitmap_double_scalar((double*) val_payload, 0, tuples_num, lo, hi, bitmap);
+    }else{
+        long lo, hi;
+        if(!long_bounds(comp, &lo, &hi)){
+            return 0;
+        }
+#if SCAN_HAS_X86
+        if(current_kernel == SCAN_KERNEL_AVX2){
+            bitmap_long_avx2((long*) val_payload, tuples_num, lo, hi, bitmap);
+        }else if(current_kernel == SCAN_KERNEL_SSE4){
+            bitmap_long_sse4((long*) val_payload, tuples_num, lo, hi, bitmap);
+        }else
+#endif
+        bitmap_long_scalar((long*) val_payload, 0, tuples_num, lo, hi, bitmap);
+    }
+    return bitmap_count(bitmap, words);
+}
@@ -0,0 +1,99 @@
+/**
+ * scan_benchmark.c
+ *
+ * Microbenchmark for the range-select kernels in scan.c.
+ * Reports the scan bandwidth (GB/s of input values read) for every data type,
+ * every kernel supported by this cpu, both output formats (position list and bitmap)
+ * and a sweep of selectivities.
+ *
+ * Usage: make scan_benchmark; ./scan_benchmark [tuples_num]
+ **/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cs165_api.h"
+#include "scan.h"
+#include "utils.h"
+
+#define DEFAULT_TUPLES_NUM 16000000
+#define VALUE_RANGE 1000000
+#define REPEAT 5
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//best of REPEAT runs, in seconds
+static double time_scan(void* val_vec, DataType dt, size_t tuples_num, Comparator* comp, int* qualifying_index, uint64_t* bitmap, size_t* index_count){
+    double best = -1;
+    double begin, elapsed;
+    for(int r=0;r<REPEAT;r++){
+        begin = now();
+        if(bitmap != NULL){
+            *index_count = scan_bitmap(val_vec, dt, tuples_num, comp, bitmap);
+        }else{
+            *index_count = scan_select(val_vec, NULL, dt, tuples_num, comp, qualifying_index);
+        }
+        elapsed = now() - begin;
+        if(best < 0 || elapsed < best){
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv){
+    size_t tuples_num = DEFAULT_TUPLES_NUM;
+    if(argc > 1){
+        tuples_num = strtoul(argv[1], NULL, 10);
+    }
+    scan_init();
+    srand(42);
+    int* int_vec = malloc(tuples_num * sizeof(int));
+    long* long_vec = malloc(tuples_num * sizeof(long));
+    double* double_vec = malloc(tuples_num * sizeof(double));
+    int* qualifying_index = malloc(tuples_num * sizeof(int));
+    uint64_t* bitmap = malloc((bitmap_words(tuples_num) + 1) * sizeof(uint64_t));
+    for(size_t i=0;i<tuples_num;i++){
+        int_vec[i] = rand() % VALUE_RANGE;
+        long_vec[i] = int_vec[i];
+        double_vec[i] = int_vec[i];
+    }
+    double selectivity_list[] = {0.001, 0.01, 0.1, 0.5, 0.9, 1.0};
+    size_t selectivity_num = sizeof(selectivity_list) / sizeof(double);
+    DataType dt_list[] = {INT, LONG, FLOAT};
+    const char* dt_name[] = {"INT", "LONG", "FLOAT"};
+    void* vec_list[] = {int_vec, long_vec, double_vec};
+    size_t width_list[] = {sizeof(int), sizeof(long), sizeof(double)};
+
+    printf("tuples: %zu, best kernel: %s\n", tuples_num, scan_kernel_name(scan_best_kernel()));
+    printf("%-6s %-8s %-8s %-12s %-12s %-10s\n", "type", "kernel", "output", "selectivity", "qualifying", "GB/s");
+    Comparator comp;
+    comp.ct1 = GREATER_THAN_OR_EQUAL;
+    comp.ct2 = LESS_THAN;
+    comp.lowerbound = 0;
+    size_t index_count;
+    double seconds;
+    for(size_t t=0;t<3;t++){
+        for(int k=SCAN_KERNEL_SCALAR;k<=(int) scan_best_kernel();k++){
+            scan_set_kernel((ScanKernel) k);
+            for(int b=0;b<2;b++){
+                for(size_t s=0;s<selectivity_num;s++){
+                    comp.upperbound = (long) (selectivity_list[s] * VALUE_RANGE);
+                    seconds = time_scan(vec_list[t], dt_list[t], tuples_num, &comp, qualifying_index, b ? bitmap : NULL, &index_count);
+                    printf("%-6s %-8s %-8s %-12.3f %-12zu %-10.2f\n", dt_name[t], scan_kernel_name((ScanKernel) k), b ? "bitmap" : "vector",
+                           selectivity_list[s], index_count, (double) (tuples_num * width_list[t]) / seconds / 1e9);
+                }
+            }
+        }
+    }
+    free(int_vec);
+    free(long_vec);
+    free(double_vec);
+    free(qualifying_index);
+    free(bitmap);
+    return 0;
+}
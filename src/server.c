@@ -20,7 +20,6 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <string.h>
-#include <pthread.h>
 #include <time.h>
 
 #include "common.h"
@@ -29,10 +28,32 @@
 #include "message.h"
 #include "utils.h"
 #include "client_context.h"
+#include "scan.h"
+#include "morsel.h"
+#include "threadpool.h"
+#include "shared_scan.h"
+#include "zonemap.h"
+#include "stats.h"
+#include "pipeline.h"
+#include "cracking.h"
+#include "compress.h"
+#include "group.h"
+#include "sort.h"
+#include "expr.h"
+#include "sample.h"
+#include "join.h"
+#include "imprints.h"
+#include "conjunction.h"
 
 #define DEFAULT_QUERY_BUFFER_SIZE 1024
 #define MULTI_THREADING 1
-#define THREAD_NUM 4
+
+//access path costs of a select, in values read by the scan kernel (see choose_index_access_path).
+//A match of an unclustered index (leaf walk, sort back to position order, random fetch later) measured
+//~50 scanned values on 1M ints, the index wins below ~1% selectivity
+#define SCAN_COST_PER_VALUE 1
+#define INDEX_COST_PER_MATCH 48
+#define INDEX_COST_PER_PROBE 64
 
 /** execute_DbOperator takes as input the DbOperator and executes the query.
  * This should be replaced in your implementation (and its implementation possibly moved to a different file).
@@ -47,20 +68,17 @@
 int batch_mode=0;
 size_t batch_size=0;
 DbOperator** batched_queries=NULL;
-Result** batched_results=NULL;
-
-//to store results for multithreaded shared scan
-//takes the shape (THREAD_NUM, batch_size, tuples_num)
-//only support column literals at the moment
-//TODO: support other data types
-int*** threaded_batched_results=NULL;
-int** threaded_batched_results_count=NULL;
 
 void free_query(DbOperator* query){
     if(query->type == INSERT){
         free(query->operator_fields.insert_operator.values);
     }else if(query->type == PRINT){
         free(query->operator_fields.print_operator.gch_list);
+    }else if(query->type == EXPRESSION){
+        expr_free(query->operator_fields.expr_operator.program);
+    }else if(query->type == SELECT){
+        free(query->operator_fields.select_operator.columns);
+        free(query->operator_fields.select_operator.comparators);
     }
     free(query);
 }
@@ -99,6 +117,7 @@ void execute_insert(Table* table, int* values, message* msg){
         table->table_length_capacity *= 2;
         for(size_t i=0;i<table->col_capacity;i++){
             columns[i].data = realloc(columns[i].data, sizeof(int) * table->table_length_capacity);
+            zone_map_reserve(&columns[i].zone_map, table->table_length_capacity);
             if(columns[i].it == SORTED_UNCLUSTERED){
                 //other index type does not need to allocate additional memory
                 ColumnIndex* ci = (ColumnIndex*) columns[i].index_file;
@@ -113,6 +132,10 @@ void execute_insert(Table* table, int* values, message* msg){
         if(columns[i].it == BTREE_CLUSTERED || columns[i].it == SORTED_CLUSTERED){
             principal_column = i;
             insert_pos = search_key(values[i], columns[i].data, columns[i].size);
+            //after the rows with the same key, where a clustered btree puts the new key too (see btree_search)
+            while(insert_pos < (int) columns[i].size && columns[i].data[insert_pos] == values[i]){
+                insert_pos++;
+            }
             break;
         }
     }
@@ -126,11 +149,29 @@ void execute_insert(Table* table, int* values, message* msg){
             sorted_insert_val_vec(columns[i].data, columns[i].size, insert_pos, values[i]);
         }
         //next update index file
-        if(columns[i].it != NONE){
+        if(columns[i].it == CRACKED){
+            cracker_insert((CrackerIndex*) columns[i].index_file, values[i], insert_pos);
+        }else if(columns[i].it != NONE && columns[i].it != IMPRINTS){
             update_column_index(&columns[i], values[i], insert_pos, 0);
         }
         columns[i].size++;
+        if(columns[i].it == IMPRINTS){
+            //an append only touches the imprint of the last cache line, a sorted insert moves every later value
+            if(principal_column == -1){
+                imprints_append((ImprintIndex*) columns[i].index_file, columns[i].data, columns[i].size);
+            }else{
+                imprints_build((ImprintIndex*) columns[i].index_file, columns[i].data, columns[i].size);
+            }
+        }
+        //and the zone map, values after insert_pos have moved if the table is sorted
+        if(principal_column == -1){
+            zone_map_append(&columns[i].zone_map, insert_pos, values[i]);
+        }else{
+            zone_map_rebuild_from(&columns[i].zone_map, columns[i].data, columns[i].size, insert_pos);
+        }
+        stats_insert(&columns[i].stats, values[i]);
     }
+    sample_insert(&table->sample, table->table_length, insert_pos);
     table->table_length++;
     msg->status = OK_DONE;
 }
@@ -141,50 +182,160 @@ void execute_insert_operator(DbOperator* query, message* msg){
     execute_insert(table, values, msg);
 }
 
-int* execute_scan(void* val_payload, void* pos_payload, Comparator* comp, DataType dt, Result* res, size_t tuples_num, IndexType it, void* index_file){
+/**
+ * full scan of a column or result without a pos_vec.
+ * The qualifying positions are first written as a bitmap (1 bit per tuple instead of 32),
+ * which is kept as the result when it is smaller than the equivalent position list.
+ * Sparse results are converted to a position list so that the consumers stay cheap.
+ * encoded_column is set for an encoded column, which is scanned without decoding it (val_payload is NULL).
+ **/
+void* execute_bitmap_scan(void* val_payload, Comparator* comp, DataType dt, Result* res, size_t tuples_num, ZoneMap* zm, Column* encoded_column){
+    size_t words = bitmap_words(tuples_num);
+    uint64_t* bitmap = malloc((words > 0 ? words : 1) * sizeof(uint64_t));
+    size_t index_count;
+    if(encoded_column != NULL){
+        index_count = encoded_scan_bitmap(encoded_column, comp, bitmap);
+    }else if(zm != NULL && dt == INT){
+        //columns: only the blocks the zone map cannot decide are read
+        index_count = zone_map_scan_bitmap(zm, (int*) val_payload, tuples_num, comp, bitmap);
+    }else{
+        index_count = morsel_scan_bitmap(val_payload, dt, tuples_num, comp, bitmap);
+    }
+    res->format = BITMAP;
+    res->bitmap_len = tuples_num;
+    res->num_tuples = index_count;
+    res->payload = (void*) bitmap;
+    if(index_count * sizeof(int) < words * sizeof(uint64_t)){
+        result_materialize_positions(res);
+    }
+    return res->payload;
+}
+
+/**
+ * cost based choice between probing the index of a column and scanning it for comp, returns 1 for the index.
+ * Clustered indexes return a contiguous range of positions and always win. An unclustered index
+ * costs a random, key ordered position per match, so the matches are counted first from the index
+ * itself (two binary searches for a sorted index, a walk over the leaf key counts for a btree,
+ * stopped once the index has lost) and weighed against the values the scan reads.
+ **/
+int choose_index_access_path(Comparator* comp, size_t tuples_num, IndexType it, void* index_file, ZoneMap* zm){
+    if(it == BTREE_CLUSTERED || it == SORTED_CLUSTERED){
+        cs165_log(stdout, "access path: clustered index\n");
+        return 1;
+    }
+    if(it == CRACKED){
+        //cracking is how the index is built, every select goes through it
+        cs165_log(stdout, "access path: cracker index\n");
+        return 1;
+    }
+    if(it == IMPRINTS){
+        //the imprints only add the cache lines they cannot decide to a scan, so they always win
+        cs165_log(stdout, "access path: column imprints\n");
+        return 1;
+    }
+    //the scan reads the blocks its zone map cannot decide and writes one bit per tuple
+    size_t scan_values = zm != NULL ? zone_map_values_to_read(zm, tuples_num, comp) : tuples_num;
+    double scan_cost = scan_values * SCAN_COST_PER_VALUE + tuples_num / 64.0;
+    size_t limit = (size_t) (scan_cost / INDEX_COST_PER_MATCH);
+    size_t matches = 0;
+    double probe_cost = 0;
+    if(it == SORTED_UNCLUSTERED){
+        ColumnIndex* ci = (ColumnIndex*) index_file;
+        size_t start = 0;
+        size_t end = tuples_num;
+        if(tuples_num > 0 && comp->ct1 != NO_COMPARISON){
+            start = search_key(comp->lowerbound, ci->key_vec, tuples_num);
+        }
+        if(tuples_num > 0 && comp->ct2 != NO_COMPARISON){
+            end = search_key(comp->upperbound, ci->key_vec, tuples_num);
+        }
+        matches = end > start ? end - start : 0;
+        probe_cost = 2 * INDEX_COST_PER_PROBE;
+    }else if(it == BTREE_UNCLUSTERED){
+        matches = btree_count_unclustered((BTreeNode*) index_file, comp, limit);
+        probe_cost = 2 * INDEX_COST_PER_PROBE + (matches / LEAF_SIZE) * INDEX_COST_PER_PROBE;
+    }
+    double index_cost = matches * INDEX_COST_PER_MATCH + probe_cost;
+    int use_index = index_cost < scan_cost;
+    cs165_log(stdout, "access path: %s, %s%zd of %zd tuples qualify, index cost %.0f, scan cost %.0f\n",
+              use_index ? "unclustered index" : "scan", matches > limit ? "more than " : "", matches > limit ? limit : matches,
+              tuples_num, index_cost, scan_cost);
+    return use_index;
+}
+
+/**
+ * whether a select of comp over a whole column of tuples_num values goes through its index
+ **/
+int select_uses_index(Comparator* comp, size_t tuples_num, IndexType it, void* index_file, ZoneMap* zm){
+    if(it == NONE || (index_file == NULL && it != SORTED_CLUSTERED) || (comp->ct1 == NO_COMPARISON && comp->ct2 == NO_COMPARISON)){
+        return 0;
+    }
+    return choose_index_access_path(comp, tuples_num, it, index_file, zm);
+}
+
+int PosCompare(const void *p1p, const void *p2p){
+    int p1 = *(const int*) p1p;
+    int p2 = *(const int*) p2p;
+    return (p1 > p2) - (p1 < p2);
+}
+
+void* execute_scan(void* val_payload, void* pos_payload, Comparator* comp, DataType dt, Result* res, size_t tuples_num, IndexType it, void* index_file, ZoneMap* zm){
     //cs165_log(stdout, "Entering scan\n");
-    int* qualifying_index = (int*) malloc(tuples_num * sizeof(int));
+    int* qualifying_index = NULL;
     size_t index_count = 0;
     int* pos_vec = (int*) pos_payload;
-    //TODO: add a query optimizer
-    if(it != NONE && index_file != NULL && pos_vec == NULL && (comp->ct1 != NO_COMPARISON || comp->ct2 != NO_COMPARISON)){
-        //we can use the index
+    int use_index = 0;
+    if(pos_vec == NULL){
+        use_index = select_uses_index(comp, tuples_num, it, index_file, zm);
+    }
+    if(pos_vec == NULL && !use_index){
+        void* payload = execute_bitmap_scan(val_payload, comp, dt, res, tuples_num, zm, NULL);
+        cs165_log(stdout, "qualifying index count value %zd, %s result \n", res->num_tuples, res->format == BITMAP ? "bitmap" : "vector");
+        return payload;
+    }
+    if(use_index && (it == BTREE_CLUSTERED || it == SORTED_CLUSTERED)){
+        //a clustered index answers with one range of positions, which is kept as such instead of listed
+        int start = 0;
+        int end = tuples_num;
         if(it == BTREE_CLUSTERED){
-            int start = 0;
-            int end = tuples_num;
             if(comp->ct1 != NO_COMPARISON){
                 start = btree_find_pos_clustered((BTreeNode*) index_file, comp->lowerbound, 1);
             }
             if(comp->ct2 != NO_COMPARISON){
                 end = btree_find_pos_clustered((BTreeNode*) index_file, comp->upperbound, 0);
             }
-            if(start != -1 && end != -1){
-                for(int i=start;i<end;i++){
-                    qualifying_index[index_count] = i;
-                    index_count++;
-                }
-            }else{
+            if(start == -1 || end == -1){
                 cs165_log(stdout, "WARNING: btree clustered index start = -1 or end = -1 in execute_scan. \n");
                 cs165_log(stdout, "WARNING: If there are actually no qualifying indexes, then this is the expected behavior. \n");
                 cs165_log(stdout, "WARNING: Otherwise, expect error! \n");
+                start = end = 0;
             }
-        }else if(it == BTREE_UNCLUSTERED){
-            //we will realloc memory for qualifying index which might cause pointer change. Hence, we have to pass address of it.
-            btree_find_pos_unclustered((BTreeNode*) index_file, comp, &qualifying_index, &index_count);
-        }else if(it == SORTED_CLUSTERED){
+        }else{
             int* val_vec = (int*) val_payload;
-            int start = 0;
-            int end = tuples_num;
             if(comp->ct1 != NO_COMPARISON){
                 start = search_key(comp->lowerbound, val_vec, tuples_num);
             }
             if(comp->ct2 != NO_COMPARISON){
                 end = search_key(comp->upperbound, val_vec, tuples_num);
             }
-            for(int i=start;i<end;i++){
-                qualifying_index[index_count] = i;
-                index_count++;
-            }
+        }
+        int* ranges = malloc(2 * sizeof(int));
+        ranges[0] = start;
+        ranges[1] = end > start ? end : start;
+        res->format = RANGES;
+        res->range_num = end > start ? 1 : 0;
+        res->num_tuples = ranges[1] - ranges[0];
+        cs165_log(stdout, "qualifying index count value %zd, range result [%d, %d) \n", res->num_tuples, ranges[0], ranges[1]);
+        return (void*) ranges;
+    }
+    qualifying_index = (int*) malloc(tuples_num * sizeof(int));
+    if(use_index){
+        //the index is cheaper than a scan
+        if(it == BTREE_UNCLUSTERED){
+            //we will realloc memory for qualifying index which might cause pointer change. Hence, we have to pass address of it.
+            btree_find_pos_unclustered((BTreeNode*) index_file, comp, &qualifying_index, &index_count);
+            //back to position order, as a scan would return them
+            qsort(qualifying_index, index_count, sizeof(int), PosCompare);
         }else if(it == SORTED_UNCLUSTERED){
             ColumnIndex* ci = (ColumnIndex*) index_file;
             int* index_key_vec = ci->key_vec;
@@ -201,70 +352,80 @@ int* execute_scan(void* val_payload, void* pos_payload, Comparator* comp, DataTy
                 qualifying_index[index_count] = index_pos_vec[i];
                 index_count++;
             }
-        }
-    }else{
-        //do the scan
-        if(dt == INT){
-            int* val_vec = (int*) val_payload;
-            if(pos_vec == NULL){
-            //we are selecting directly from a column/result, no pos_vec
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = i;
-                        index_count++;
-                    }
-                }
-            }else{
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = pos_vec[i];
-                        index_count++;
-                    }
-                }
+            qsort(qualifying_index, index_count, sizeof(int), PosCompare);
+        }else if(it == CRACKED){
+            //the select cracks the copy, its qualifying values end up in [start, end)
+            CrackerIndex* ci = (CrackerIndex*) index_file;
+            size_t start, end;
+            cracker_select(ci, comp, &start, &end);
+            size_t words = bitmap_words(tuples_num);
+            if((end - start) * sizeof(int) >= words * sizeof(uint64_t)){
+                //dense result: a bitmap avoids sorting the positions back
+                uint64_t* bitmap = positions_to_bitmap(ci->pos_vec + start, end - start, tuples_num);
+                free(qualifying_index);
+                res->format = BITMAP;
+                res->bitmap_len = tuples_num;
+                res->num_tuples = end - start;
+                cs165_log(stdout, "qualifying index count value %zd, bitmap result \n", res->num_tuples);
+                return (void*) bitmap;
             }
-        }else if(dt == FLOAT){
-            double* val_vec = (double*) val_payload;
-            if(pos_vec == NULL){
-            //we are selecting directly from a column/result, no pos_vec
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = i;
-                        index_count++;
-                    }
-                }
-            }else{
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = pos_vec[i];
-                        index_count++;
-                    }
-                }
+            for(size_t i=start;i<end;i++){
+                qualifying_index[index_count] = ci->pos_vec[i];
+                index_count++;
             }
-        }else{
-            long* val_vec = (long*) val_payload;
-            if(pos_vec == NULL){
-            //we are selecting directly from a column/result, no pos_vec
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = i;
-                        index_count++;
-                    }
-                }
-            }else{
-                for(size_t i=0;i<tuples_num;i++){
-                    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= val_vec[i]) && (comp->ct2 == NO_COMPARISON || comp->upperbound > val_vec[i])){
-                        qualifying_index[index_count] = pos_vec[i];
-                        index_count++;
-                    }
-                }
+            qsort(qualifying_index, index_count, sizeof(int), PosCompare);
+        }else if(it == IMPRINTS){
+            //the qualifying positions are written as a bitmap, like a scan's
+            free(qualifying_index);
+            size_t words = bitmap_words(tuples_num);
+            uint64_t* bitmap = malloc((words > 0 ? words : 1) * sizeof(uint64_t));
+            res->format = BITMAP;
+            res->bitmap_len = tuples_num;
+            res->num_tuples = imprints_scan_bitmap((ImprintIndex*) index_file, (int*) val_payload, comp, bitmap);
+            res->payload = (void*) bitmap;
+            if(res->num_tuples * sizeof(int) < words * sizeof(uint64_t)){
+                result_materialize_positions(res);
             }
+            cs165_log(stdout, "qualifying index count value %zd, %s result \n", res->num_tuples, res->format == BITMAP ? "bitmap" : "vector");
+            return res->payload;
         }
+    }else{
+        //do the scan with the widest kernel the cpu supports, one morsel per worker at a time, see scan.c and morsel.c
+        index_count = morsel_scan_select(val_payload, pos_vec, dt, tuples_num, comp, qualifying_index);
     }
     qualifying_index = realloc(qualifying_index, sizeof(int)*index_count);
     res->num_tuples=index_count;
     cs165_log(stdout, "qualifying index count value %zd \n", index_count);
     //cs165_log(stdout, "Exiting scan\n");
-    return qualifying_index;
+    return (void*) qualifying_index;
+}
+
+//Usage3: <vec_pos>=select(<col_name>,<low>,<high>,<col_name>,<low>,<high>[,...])
+//the most selective predicate is evaluated like Usage1 but never deferred, the others refine its result, see conjunction.h
+void execute_conjunctive_select(DbOperator* query, message* msg){
+    SelectOperator* operator = &query->operator_fields.select_operator;
+    size_t* order = conjunction_order(operator->columns, operator->comparators, operator->predicate_num);
+    Column* column = operator->columns[order[0]];
+    Comparator comp = operator->comparators[order[0]];
+    Result* res = calloc(1, sizeof(Result));
+    res->data_type = INT;
+    if(column->encoding != PLAIN){
+        res->payload = execute_bitmap_scan(NULL, &comp, INT, res, column->size, &column->zone_map, column);
+    }else{
+        res->payload = execute_scan((void*) column->data, NULL, &comp, INT, res, column->size, column->it, column->index_file, &column->zone_map);
+    }
+    for(size_t i=1;i<operator->predicate_num;i++){
+        conjunction_refine(operator->columns[order[i]], &operator->comparators[order[i]], res);
+    }
+    free(order);
+
+    GCHandle* gch_res = malloc(sizeof(GCHandle));
+    strcpy(gch_res->name, query->client_variables[0]);
+    gch_res->type = RESULT;
+    gch_res->p.result = res;
+    insert_context(query->context_table, gch_res->name, (void*) gch_res, GCOLUMN);
+    cs165_log(stdout, "adding new context with variable name: %s\n", gch_res->name);
+    msg->status = OK_DONE;
 }
 
 //Usage1: <vec_pos>=select(<col_name>,<low>,<high>)
@@ -276,11 +437,15 @@ void execute_select_operator(DbOperator* query, message* msg){
         cs165_log(stdout, "no client variable to store the result\n");
         return;
     }
+    if(query->operator_fields.select_operator.predicate_num > 1){
+        execute_conjunctive_select(query, msg);
+        return;
+    }
     GCHandle* gch1 = query->operator_fields.select_operator.gch1;
     GCHandle* gch2 = query->operator_fields.select_operator.gch2;
     Comparator comp = query->operator_fields.select_operator.comparator;
     size_t tuples_num = 0;
-    Result* res = malloc(sizeof(Result));
+    Result* res = calloc(1, sizeof(Result));
     int* qualifying_index = NULL;
     IndexType it = NONE;
     void* index_file = NULL;
@@ -297,22 +462,22 @@ void execute_select_operator(DbOperator* query, message* msg){
         qualifying_index = (int*) pos_vec->payload;
         if(gch2->type == RESULT){
             Result* val_vec = gch2->p.result;
-            res->data_type = val_vec->data_type;
-            res->payload = (void*) execute_scan((void *) val_vec->payload, (void*) qualifying_index, &comp, val_vec->data_type, res, tuples_num, it, index_file);
+            res->data_type = INT;
+            res->payload = (void*) execute_scan((void *) val_vec->payload, (void*) qualifying_index, &comp, val_vec->data_type, res, tuples_num, it, index_file, NULL);
         }else{
             Column* val_vec = gch2->p.column;
             it = val_vec->it;
             index_file = val_vec->index_file;
             res->data_type = INT;
-            res->payload = (void*) execute_scan((void *) val_vec->data, (void*) qualifying_index, &comp, INT, res, tuples_num, it, index_file);
+            res->payload = (void*) execute_scan((void *) val_vec->data, (void*) qualifying_index, &comp, INT, res, tuples_num, it, index_file, NULL);
         }
     }else{
         //we have only val_vec from gch1
         if(gch1->type == RESULT){
             Result* val_vec = gch1->p.result;
-            res->data_type = val_vec->data_type;
+            res->data_type = INT;
             tuples_num = val_vec->num_tuples;
-            res->payload = (void*) execute_scan((void *) val_vec->payload, (void*) qualifying_index, &comp, val_vec->data_type, res, tuples_num, it, index_file);
+            res->payload = (void*) execute_scan((void *) val_vec->payload, (void*) qualifying_index, &comp, val_vec->data_type, res, tuples_num, it, index_file, NULL);
         }else{
             //cs165_log(stdout, "preprocess & type casting for scan\n");
             Column* val_vec = gch1->p.column;
@@ -321,7 +486,20 @@ void execute_select_operator(DbOperator* query, message* msg){
             res->data_type = INT;
             tuples_num = val_vec->size;
             //cs165_log(stdout, "preprocess & type casting for scan completed\n");
-            res->payload = (void*) execute_scan((void *) val_vec->data, (void*) qualifying_index, &comp, INT, res, tuples_num, it, index_file);
+            if(val_vec->encoding != PLAIN){
+                //encoded columns have no index and are scanned in their encoded form
+                res->payload = execute_bitmap_scan(NULL, &comp, INT, res, tuples_num, &val_vec->zone_map, val_vec);
+            }else if(select_uses_index(&comp, tuples_num, it, index_file, &val_vec->zone_map)){
+                res->payload = (void*) execute_scan((void *) val_vec->data, (void*) qualifying_index, &comp, INT, res, tuples_num, it, index_file, &val_vec->zone_map);
+            }else{
+                //the scan waits for the consumer, which may fuse it with a fetch and an aggregate, see pipeline.h
+                res->format = DEFERRED;
+                res->deferred = malloc(sizeof(DeferredResult));
+                res->deferred->select_column = val_vec;
+                res->deferred->comparator = comp;
+                res->deferred->fetch_column = NULL;
+                cs165_log(stdout, "select deferred\n");
+            }
         }
     }
     
@@ -348,55 +526,62 @@ void execute_fetch_operator(DbOperator* query, message* msg){
         return;
     }
     Result* pos_vec = gch2->p.result;
-    Result* res = malloc(sizeof(Result));
+    Result* res = calloc(1, sizeof(Result));
+    void* val_payload;
+    size_t width;
     if(gch1->type == RESULT){
-        Result* val_vec = gch1->p.result;
-        res->data_type = val_vec->data_type;
-        if(pos_vec->num_tuples == 0){
-            res->num_tuples = 0;
-            res->payload = NULL;
-        }else{
-            int* qualifying_index = (int*) pos_vec->payload;
-            if(val_vec->data_type == INT){
-                int* val_payload = (int*) val_vec->payload;
-                int* res_payload = malloc(pos_vec->num_tuples * sizeof(int));
-                for(size_t i=0;i<pos_vec->num_tuples;i++){
-                    res_payload[i] = val_payload[qualifying_index[i]];
-                }
-                res->payload = (void*) res_payload;
-            }else if(val_vec->data_type == FLOAT){
-                double* val_payload = (double*) val_vec->payload;
-                double* res_payload = malloc(pos_vec->num_tuples * sizeof(double));
-                for(size_t i=0;i<pos_vec->num_tuples;i++){
-                    res_payload[i] = val_payload[qualifying_index[i]];
-                }
-                res->payload = (void*) res_payload;
-            }else{
-                long* val_payload = (long*) val_vec->payload;
-                long* res_payload = malloc(pos_vec->num_tuples * sizeof(long));
-                for(size_t i=0;i<pos_vec->num_tuples;i++){
-                    res_payload[i] = val_payload[qualifying_index[i]];
-                }
-                res->payload = (void*) res_payload;
-            }
-            res->num_tuples = pos_vec->num_tuples;
-        }
+        val_payload = gch1->p.result->payload;
+        res->data_type = gch1->p.result->data_type;
     }else{
-        Column* val_vec = gch1->p.column;
+        val_payload = (void*) gch1->p.column->data;
         res->data_type = INT;
-        if(pos_vec->num_tuples == 0){
-            res->num_tuples = 0;
-            res->payload = NULL;
-        }else{
-            int* qualifying_index = (int*) pos_vec->payload;
-            int* val_payload = val_vec->data;
-            int* res_payload = malloc(pos_vec->num_tuples * sizeof(int));
-            for(size_t i=0;i<pos_vec->num_tuples;i++){
-                res_payload[i] = val_payload[qualifying_index[i]];
+    }
+    if(res->data_type == INT){
+        width = sizeof(int);
+    }else if(res->data_type == FLOAT){
+        width = sizeof(double);
+    }else{
+        width = sizeof(long);
+    }
+    if(pos_vec->format == DEFERRED){
+        //a column fetched at the positions of a deferred select, only reachable if the fetch can be fused (see materialize_deferred_operands)
+        res->format = DEFERRED;
+        res->deferred = malloc(sizeof(DeferredResult));
+        *res->deferred = *pos_vec->deferred;
+        res->deferred->fetch_column = gch1->p.column;
+        cs165_log(stdout, "fetch deferred\n");
+    }else if(pos_vec->num_tuples == 0){
+        res->num_tuples = 0;
+        res->payload = NULL;
+    }else if(pos_vec->format == RANGES && pos_vec->range_num == 1 && gch1->type == COLUMN && gch1->p.column->encoding == PLAIN){
+        //the values at a single range of positions are a piece of the column, nothing is copied
+        res->format = SLICE;
+        res->payload = (void*) (gch1->p.column->data + ((int*) pos_vec->payload)[0]);
+        res->num_tuples = pos_vec->num_tuples;
+        cs165_log(stdout, "fetch: slice of %zd values\n", res->num_tuples);
+    }else{
+        //gather in parallel, every morsel of the pos_vec fills its own slice of the output
+        res->payload = malloc(pos_vec->num_tuples * width);
+        if(gch1->type == COLUMN && gch1->p.column->encoding != PLAIN){
+            //values are decoded at the fetched positions only
+            result_materialize_positions(pos_vec);
+            encoded_fetch(gch1->p.column, (int*) pos_vec->payload, pos_vec->num_tuples, (int*) res->payload);
+        }else if(pos_vec->format == RANGES){
+            //one copy per range of positions
+            int* ranges = (int*) pos_vec->payload;
+            size_t k = 0;
+            size_t range_len;
+            for(size_t r=0;r<pos_vec->range_num;r++){
+                range_len = ranges[2*r+1] - ranges[2*r];
+                memcpy((char*) res->payload + k * width, (char*) val_payload + ranges[2*r] * width, range_len * width);
+                k += range_len;
             }
-            res->num_tuples = pos_vec->num_tuples;
-            res->payload = (void*) res_payload;
+        }else if(pos_vec->format == BITMAP){
+            morsel_bitmap_fetch(val_payload, res->data_type, (uint64_t*) pos_vec->payload, pos_vec->bitmap_len, res->payload);
+        }else{
+            morsel_fetch(val_payload, res->data_type, (int*) pos_vec->payload, pos_vec->num_tuples, res->payload);
         }
+        res->num_tuples = pos_vec->num_tuples;
     }
     
     GCHandle* gch_res = malloc(sizeof(GCHandle));
@@ -424,8 +609,23 @@ void execute_min_max_operator(DbOperator* query, message* msg){
             return;
         }
         size_t val_tuples_num;
-        Result* res = malloc(sizeof(Result));
-        if(gch1->type == COLUMN){
+        Result* res = calloc(1, sizeof(Result));
+        if(gch1->type == RESULT && gch1->p.result->format == DEFERRED){
+            //min/max of a deferred fetch: select, fetch and aggregate in one pass, see pipeline.h
+            DeferredResult* deferred = gch1->p.result->deferred;
+            long value = 0;
+            val_tuples_num = pipeline_select_aggregate(deferred->select_column, &deferred->comparator, deferred->fetch_column, t, &value);
+            res->data_type = INT;
+            if(val_tuples_num == 0){
+                res->num_tuples = 0;
+                res->payload = NULL;
+            }else{
+                res->num_tuples = 1;
+                int* payload = malloc(sizeof(int));
+                *payload = (int) value;
+                res->payload = (void*) payload;
+            }
+        }else if(gch1->type == COLUMN){
             int* val_vec = gch1->p.column->data;
             val_tuples_num = gch1->p.column->size;
             if(val_tuples_num == 0){//no tuples to aggregate over
@@ -436,16 +636,7 @@ void execute_min_max_operator(DbOperator* query, message* msg){
                 res->num_tuples = 1;
                 res->data_type = INT;
                 int* payload = malloc(sizeof(int));
-                *payload = val_vec[0];
-                for(size_t i=1;i<val_tuples_num;i++){
-                    //TODO: check if we have a better way to do this, too many ifs
-                    //we might want to break this function into two after all.
-                    if(t == MIN){
-                        *payload = val_vec[i] < *payload ? val_vec[i] : *payload;
-                    }else{
-                        *payload = val_vec[i] > *payload ? val_vec[i] : *payload;
-                    }
-                }
+                *payload = gch1->p.column->encoding != PLAIN ? encoded_min_max(gch1->p.column, t) : morsel_min_max_int(val_vec, val_tuples_num, t);
                 res->payload = (void*) payload;
             }
         }else{
@@ -461,14 +652,7 @@ void execute_min_max_operator(DbOperator* query, message* msg){
                     res->num_tuples = 1;
                     res->data_type = gch1->p.result->data_type;
                     int* payload = malloc(sizeof(int));
-                    *payload = val_vec[0];
-                    for(size_t i=1;i<val_tuples_num;i++){
-                        if(t == MIN){
-                            *payload = val_vec[i] < *payload ? val_vec[i] : *payload;
-                        }else{
-                            *payload = val_vec[i] > *payload ? val_vec[i] : *payload;
-                        }
-                    }
+                    *payload = morsel_min_max_int(val_vec, val_tuples_num, t);
                     res->payload = (void*) payload;
                 }
             }else if(gch1->p.result->data_type == FLOAT){
@@ -481,14 +665,7 @@ void execute_min_max_operator(DbOperator* query, message* msg){
                     res->num_tuples = 1;
                     res->data_type = gch1->p.result->data_type;
                     double* payload = malloc(sizeof(double));
-                    *payload = val_vec[0];
-                    for(size_t i=1;i<val_tuples_num;i++){
-                        if(t == MIN){
-                            *payload = val_vec[i] < *payload ? val_vec[i] : *payload;
-                        }else{
-                            *payload = val_vec[i] > *payload ? val_vec[i] : *payload;
-                        }
-                    }
+                    *payload = morsel_min_max_double(val_vec, val_tuples_num, t);
                     res->payload = (void*) payload;
                 }
             }else{
@@ -502,14 +679,7 @@ void execute_min_max_operator(DbOperator* query, message* msg){
                     res->num_tuples = 1;
                     res->data_type = gch1->p.result->data_type;
                     long* payload = malloc(sizeof(long));
-                    *payload = val_vec[0];
-                    for(size_t i=1;i<val_tuples_num;i++){
-                        if(t == MIN){
-                            *payload = val_vec[i] < *payload ? val_vec[i] : *payload;
-                        }else{
-                            *payload = val_vec[i] > *payload ? val_vec[i] : *payload;
-                        }
-                    }
+                    *payload = morsel_min_max_long(val_vec, val_tuples_num, t);
                     res->payload = (void*) payload;
                 }
             }
@@ -527,158 +697,49 @@ void execute_min_max_operator(DbOperator* query, message* msg){
             msg->status = QUERY_UNSUPPORTED;
             return;
         }
-        int* pos_vec = (int*) gch1->p.result->payload;
-        size_t pos_tuples_num = gch1->p.result->num_tuples;
-        Result* res_pos = malloc(sizeof(Result));
-        Result* res_val = malloc(sizeof(Result));
+        if(gch1->p.result->format == RANGES){
+            result_materialize_positions(gch1->p.result);
+        }
+        void* val_payload;
+        DataType dt;
         if(gch2->type == COLUMN){
-            int* val_vec = gch2->p.column->data;
-            if(pos_tuples_num == 0){//no tuples to aggregate over
-                res_pos->num_tuples = 0;
-                res_pos->data_type = INT; //can be any type actually?
-                res_pos->payload = NULL;
-                res_val->num_tuples = 0;
-                res_val->data_type = INT;
-                res_val->payload = NULL;
-            }else{
-                res_pos->num_tuples = 1;
-                res_pos->data_type = INT;
-                int* payload_pos = malloc(sizeof(int));
-                *payload_pos = pos_vec[0];
-                res_val->num_tuples = 1;
-                res_val->data_type = INT;
-                int* payload_val = malloc(sizeof(int));
-                *payload_val = val_vec[pos_vec[0]];
-                for(size_t i=1;i<pos_tuples_num;i++){
-                    //TODO: check if we have a better way to do this, too many ifs
-                    //we might want to break this function into two after all.
-                    if(t == MIN){
-                        if(val_vec[pos_vec[i]] < *payload_val){
-                            *payload_val = val_vec[pos_vec[i]];
-                            *payload_pos = pos_vec[i];
-                        }
-                    }else{
-                        if(val_vec[i] > *payload_val){
-                            *payload_val = val_vec[pos_vec[i]];
-                            *payload_pos = pos_vec[i];
-                        }
-                    }
-                }
-                res_pos->payload = (void*) payload_pos;
-                res_val->payload = (void*) payload_val;
-            }
+            val_payload = (void*) gch2->p.column->data;
+            dt = INT;
         }else{
-            //we are dealing with result with data_type
-            if(gch2->p.result->data_type == INT){
-                int* val_vec = (int*) gch2->p.result->payload;
-                if(pos_tuples_num == 0){//no tuples to aggregate over
-                    res_pos->num_tuples = 0;
-                    res_pos->data_type = INT; //can be any type actually?
-                    res_pos->payload = NULL;
-                    res_val->num_tuples = 0;
-                    res_val->data_type = INT;
-                    res_val->payload = NULL;
-                }else{
-                    res_pos->num_tuples = 1;
-                    res_pos->data_type = INT;
-                    int* payload_pos = malloc(sizeof(int));
-                    *payload_pos = pos_vec[0];
-                    res_val->num_tuples = 1;
-                    res_val->data_type = INT;
-                    int* payload_val = malloc(sizeof(int));
-                    *payload_val = val_vec[pos_vec[0]];
-                    for(size_t i=1;i<pos_tuples_num;i++){
-                        //TODO: check if we have a better way to do this, too many ifs
-                        //we might want to break this function into two after all.
-                        if(t == MIN){
-                            if(val_vec[pos_vec[i]] < *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }else{
-                            if(val_vec[i] > *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }
-                    }
-                    res_pos->payload = (void*) payload_pos;
-                    res_val->payload = (void*) payload_val;
-                }
-            }else if(gch2->p.result->data_type == FLOAT){
-                double* val_vec = (double*) gch2->p.result->payload;
-                if(pos_tuples_num == 0){//no tuples to aggregate over
-                    res_pos->num_tuples = 0;
-                    res_pos->data_type = INT; //can be any type actually?
-                    res_pos->payload = NULL;
-                    res_val->num_tuples = 0;
-                    res_val->data_type = FLOAT;
-                    res_val->payload = NULL;
-                }else{
-                    res_pos->num_tuples = 1;
-                    res_pos->data_type = INT;
-                    int* payload_pos = malloc(sizeof(int));
-                    *payload_pos = pos_vec[0];
-                    res_val->num_tuples = 1;
-                    res_val->data_type = FLOAT;
-                    double* payload_val = malloc(sizeof(double));
-                    *payload_val = val_vec[pos_vec[0]];
-                    for(size_t i=1;i<pos_tuples_num;i++){
-                        //TODO: check if we have a better way to do this, too many ifs
-                        //we might want to break this function into two after all.
-                        if(t == MIN){
-                            if(val_vec[pos_vec[i]] < *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }else{
-                            if(val_vec[i] > *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }
-                    }
-                    res_pos->payload = (void*) payload_pos;
-                    res_val->payload = (void*) payload_val;
-                }
-            }else{
-                //dealing with LONG type
-                long* val_vec = (long*) gch2->p.result->payload;
-                if(pos_tuples_num == 0){//no tuples to aggregate over
-                    res_pos->num_tuples = 0;
-                    res_pos->data_type = INT; //can be any type actually?
-                    res_pos->payload = NULL;
-                    res_val->num_tuples = 0;
-                    res_val->data_type = LONG;
-                    res_val->payload = NULL;
-                }else{
-                    res_pos->num_tuples = 1;
-                    res_pos->data_type = INT;
-                    int* payload_pos = malloc(sizeof(int));
-                    *payload_pos = pos_vec[0];
-                    res_val->num_tuples = 1;
-                    res_val->data_type = FLOAT;
-                    long* payload_val = malloc(sizeof(long));
-                    *payload_val = val_vec[pos_vec[0]];
-                    for(size_t i=1;i<pos_tuples_num;i++){
-                        //TODO: check if we have a better way to do this, too many ifs
-                        //we might want to break this function into two after all.
-                        if(t == MIN){
-                            if(val_vec[pos_vec[i]] < *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }else{
-                            if(val_vec[i] > *payload_val){
-                                *payload_val = val_vec[pos_vec[i]];
-                                *payload_pos = pos_vec[i];
-                            }
-                        }
-                    }
-                    res_pos->payload = (void*) payload_pos;
-                    res_val->payload = (void*) payload_val;
-                }
+            val_payload = gch2->p.result->payload;
+            dt = gch2->p.result->data_type;
+        }
+        Result* res_pos = calloc(1, sizeof(Result));
+        Result* res_val = calloc(1, sizeof(Result));
+        res_pos->data_type = INT;
+        res_val->data_type = dt;
+        int* payload_pos = malloc(sizeof(int));
+        void* payload_val = malloc(dt == INT ? sizeof(int) : dt == FLOAT ? sizeof(double) : sizeof(long));
+        //parallel over the positions, see morsel.h. A value vector holding one value per position (a fetch
+        //over vec_pos) is read in the order of the positions, a column or any other vector is indexed by them.
+        int found;
+        if(gch2->type == RESULT && gch2->p.result->num_tuples == gch1->p.result->num_tuples){
+            if(gch1->p.result->format == BITMAP){
+                result_materialize_positions(gch1->p.result);
             }
+            found = morsel_arg_min_max_aligned(val_payload, dt, (int*) gch1->p.result->payload, gch1->p.result->num_tuples, t, payload_pos, payload_val);
+        }else if(gch1->p.result->format == BITMAP){
+            found = morsel_arg_min_max(val_payload, dt, NULL, (uint64_t*) gch1->p.result->payload, gch1->p.result->bitmap_len, t, payload_pos, payload_val);
+        }else{
+            found = morsel_arg_min_max(val_payload, dt, (int*) gch1->p.result->payload, NULL, gch1->p.result->num_tuples, t, payload_pos, payload_val);
+        }
+        if(found){
+            res_pos->num_tuples = 1;
+            res_pos->payload = (void*) payload_pos;
+            res_val->num_tuples = 1;
+            res_val->payload = payload_val;
+        }else{//no tuples to aggregate over
+            free(payload_pos);
+            free(payload_val);
+            res_pos->num_tuples = 0;
+            res_pos->payload = NULL;
+            res_val->num_tuples = 0;
+            res_val->payload = NULL;
         }
         GCHandle* gch_res_pos = malloc(sizeof(GCHandle));
         strcpy(gch_res_pos->name, query->client_variables[0]);
@@ -686,7 +747,7 @@ void execute_min_max_operator(DbOperator* query, message* msg){
         gch_res_pos->p.result = res_pos;
         insert_context(query->context_table, gch_res_pos->name, (void*) gch_res_pos, GCOLUMN);
         GCHandle* gch_res_val = malloc(sizeof(GCHandle));
-        strcpy(gch_res_val->name, query->client_variables[0]);
+        strcpy(gch_res_val->name, query->client_variables[1]);
         gch_res_val->type = RESULT;
         gch_res_val->p.result = res_val;
         insert_context(query->context_table, gch_res_val->name, (void*) gch_res_val, GCOLUMN);
@@ -703,15 +764,32 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
         return;
     }
     size_t tuples_num;
-    Result* res = malloc(sizeof(Result));
-    if(gch1->type == COLUMN){
+    Result* res = calloc(1, sizeof(Result));
+    if(gch1->type == RESULT && gch1->p.result->format == DEFERRED){
+        //sum of a deferred fetch: select, fetch and sum in one pass, see pipeline.h
+        DeferredResult* deferred = gch1->p.result->deferred;
+        long s = 0;
+        tuples_num = pipeline_select_aggregate(deferred->select_column, &deferred->comparator, deferred->fetch_column, t, &s);
+        res->num_tuples = 1;
+        if(t == AVG){
+            res->data_type = FLOAT;
+            double* res_payload = malloc(sizeof(double));
+            *res_payload = tuples_num > 0 ? (double) s / (double) tuples_num : 0;
+            res->payload = (void*) res_payload;
+        }else{
+            res->data_type = LONG;
+            long* res_payload = malloc(sizeof(long));
+            *res_payload = s;
+            res->payload = (void*) res_payload;
+        }
+    }else if(gch1->type == COLUMN){
         tuples_num = gch1->p.column->size;
         int* val_vec = gch1->p.column->data;
         if(tuples_num == 0){
             res->num_tuples = 1;
             if(t == AVG){
                 res->data_type = FLOAT;
-                double* res_payload = malloc(sizeof(int));
+                double* res_payload = malloc(sizeof(double));
                 *res_payload = 0;
                 res->payload = res_payload;
             }else{
@@ -722,10 +800,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
             }
         }else{
             res->num_tuples = 1;
-            long s = 0;
-            for(size_t i=0;i<tuples_num;i++){
-                s += val_vec[i];
-            }
+            long s = gch1->p.column->encoding != PLAIN ? encoded_sum(gch1->p.column) : morsel_sum_int(val_vec, tuples_num);
             if(t == AVG){
                 res->data_type = FLOAT;
                 double* res_payload = malloc(sizeof(double));
@@ -747,7 +822,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 res->num_tuples = 1;
                 if(t == AVG){
                     res->data_type = FLOAT;
-                    double* res_payload = malloc(sizeof(int));
+                    double* res_payload = malloc(sizeof(double));
                     *res_payload = 0;
                     res->payload = res_payload;
                 }else{
@@ -758,10 +833,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 }
             }else{
                 res->num_tuples = 1;
-                long s = 0;
-                for(size_t i=0;i<tuples_num;i++){
-                    s += val_vec[i];
-                }
+                long s = morsel_sum_int(val_vec, tuples_num);
                 cs165_log(stdout, "finish aggregate sum loop\n");
                 if(t == AVG){
                     res->data_type = FLOAT;
@@ -781,7 +853,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 res->num_tuples = 1;
                 if(t == AVG){
                     res->data_type = FLOAT;
-                    double* res_payload = malloc(sizeof(int));
+                    double* res_payload = malloc(sizeof(double));
                     *res_payload = 0;
                     res->payload = res_payload;
                 }else{
@@ -792,10 +864,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 }
             }else{
                 res->num_tuples = 1;
-                double s = 0;
-                for(size_t i=0;i<tuples_num;i++){
-                    s += val_vec[i];
-                }
+                double s = morsel_sum_double(val_vec, tuples_num);
                 if(t == AVG){
                     res->data_type = FLOAT;
                     double* res_payload = malloc(sizeof(double));
@@ -815,7 +884,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 res->num_tuples = 1;
                 if(t == AVG){
                     res->data_type = FLOAT;
-                    double* res_payload = malloc(sizeof(int));
+                    double* res_payload = malloc(sizeof(double));
                     *res_payload = 0;
                     res->payload = res_payload;
                 }else{
@@ -826,10 +895,7 @@ void execute_sum_avg_operator(DbOperator* query, message* msg){
                 }
             }else{
                 res->num_tuples = 1;
-                long s = 0;
-                for(size_t i=0;i<tuples_num;i++){
-                    s += val_vec[i];
-                }
+                long s = morsel_sum_long(val_vec, tuples_num);
                 if(t == AVG){
                     res->data_type = FLOAT;
                     double* res_payload = malloc(sizeof(double));
@@ -896,189 +962,313 @@ void execute_add_sub_operator(DbOperator* query, message* msg){
     if(dt1 == FLOAT || dt2 == FLOAT){
         res_dt = FLOAT;
     }
-    Result* res = malloc(sizeof(Result));
+    Result* res = calloc(1, sizeof(Result));
     res->data_type = res_dt;
     res->num_tuples = res_tuples_num;
-    if(gch1->type == COLUMN){
-        int* val_vec1 = gch1->p.column->data;
-        if(gch2->type == COLUMN){
-            int* val_vec2 = gch2->p.column->data;
-            int* payload = malloc(res_tuples_num * sizeof(int));
-            for(size_t i=0;i<res_tuples_num;i++){
-                if(t == ADD){
-                    payload[i] = val_vec1[i] + val_vec2[i];
-                }else{
-                    payload[i] = val_vec1[i] - val_vec2[i];
-                }
-            }
-            res->payload = (void*) payload;
-            res->data_type = INT;
+    void* val_vec1 = gch1->type == COLUMN ? (void*) gch1->p.column->data : gch1->p.result->payload;
+    void* val_vec2 = gch2->type == COLUMN ? (void*) gch2->p.column->data : gch2->p.result->payload;
+    if(res_dt == INT){
+        res->payload = malloc(res_tuples_num * sizeof(int));
+    }else if(res_dt == FLOAT){
+        res->payload = malloc(res_tuples_num * sizeof(double));
+    }else{
+        res->payload = malloc(res_tuples_num * sizeof(long));
+    }
+    morsel_add_sub(val_vec1, dt1, val_vec2, dt2, res_tuples_num, t, res->payload);
+    GCHandle* gch_res = malloc(sizeof(GCHandle));
+    strcpy(gch_res->name, query->client_variables[0]);
+    gch_res->type = RESULT;
+    gch_res->p.result = res;
+    insert_context(query->context_table, gch_res->name, (void*) gch_res, GCOLUMN);
+    cs165_log(stdout, "adding new context with variable name: %s\n", gch_res->name);
+    msg->status = OK_DONE;
+}
+
+void execute_aggregate_operator(DbOperator* query, message* msg){
+    AggregateType t = query->operator_fields.aggregate_operator.type;
+    if(t==MIN || t==MAX){
+        execute_min_max_operator(query, msg);
+    }else if(t==SUM || t==AVG){
+        execute_sum_avg_operator(query, msg);
+    }else if(t==ADD || t==SUB){
+        execute_add_sub_operator(query, msg);
+    }else{
+        msg->status = QUERY_UNSUPPORTED;
+    }
+}
+
+// Usage: <agg_val1>,...=aggregates(<vec_val>,<agg1>,...)
+// count is LONG, sum LONG (FLOAT over a FLOAT vector), min and max of the type of the vector,
+// avg and var (population variance) FLOAT. Over no tuples count, sum and avg are 0, min, max and var empty.
+void execute_multi_aggregate_operator(DbOperator* query, message* msg){
+    GCHandle* gch = query->operator_fields.multi_aggregate_operator.gch;
+    AggregateType* types = query->operator_fields.multi_aggregate_operator.types;
+    size_t type_num = query->operator_fields.multi_aggregate_operator.type_num;
+    if(query->client_variables_num != type_num){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    int with_m2 = 0;
+    for(size_t k=0;k<type_num;k++){
+        with_m2 |= types[k] == VAR;
+    }
+    //one pass over the vector for all the aggregates, see morsel_stats
+    AggStats stats;
+    DataType dt;
+    if(gch->type == COLUMN){
+        dt = INT;
+        if(gch->p.column->encoding != PLAIN){
+            encoded_stats(gch->p.column, with_m2, &stats);
         }else{
-            //we are dealing with results with different data types for gch2
-            if(gch2->p.result->data_type == INT){
-                int* val_vec2 = (int*) gch2->p.result->payload;
-                int* payload = malloc(res_tuples_num * sizeof(int));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = INT;
-            }else if(gch2->p.result->data_type == FLOAT){
-                double* val_vec2 = (double*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = (double) val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = (double) val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = FLOAT;
-            }else{
-                //dealing with long
-                long* val_vec2 = (long*) gch2->p.result->payload;
-                long* payload = malloc(res_tuples_num * sizeof(long));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = (long) val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = (long) val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = LONG;
-            }
+            morsel_stats((void*) gch->p.column->data, INT, gch->p.column->size, with_m2, &stats);
         }
     }else{
-        //we are dealing with results with different data types for gch1
-        if(gch1->p.result->data_type == INT){
-            int* val_vec1 = (int*) gch1->p.result->payload;
-            if(gch2->p.result->data_type == INT){
-                int* val_vec2 = (int*) gch2->p.result->payload;
-                int* payload = malloc(res_tuples_num * sizeof(int));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = INT;
-            }else if(gch2->p.result->data_type == FLOAT){
-                double* val_vec2 = (double*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = (double) val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = (double) val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = FLOAT;
-            }else{
-                //dealing with long
-                long* val_vec2 = (long*) gch2->p.result->payload;
-                long* payload = malloc(res_tuples_num * sizeof(long));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = (long) val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = (long) val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = LONG;
-            }
-        }else if(gch1->p.result->data_type == FLOAT){
-            double* val_vec1 = (double *) gch1->p.result->payload;
-            if(gch2->p.result->data_type == INT){
-                int* val_vec2 = (int*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + (double) val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - (double) val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = FLOAT;
-            }else if(gch2->p.result->data_type == FLOAT){
-                double* val_vec2 = (double*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - val_vec2[i];
-                    }
-                }
-                res->payload = (void*) payload;
-                res->data_type = FLOAT;
+        dt = gch->p.result->data_type;
+        morsel_stats(gch->p.result->payload, dt, gch->p.result->num_tuples, with_m2, &stats);
+    }
+    cs165_log(stdout, "aggregates: %zu aggregates over %zu tuples in one pass\n", type_num, stats.count);
+    Result* res;
+    GCHandle* gch_res;
+    for(size_t k=0;k<type_num;k++){
+        res = calloc(1, sizeof(Result));
+        if(types[k] == COUNT || (types[k] == SUM && dt != FLOAT)){
+            res->data_type = LONG;
+            res->num_tuples = 1;
+            long* payload = malloc(sizeof(long));
+            *payload = types[k] == COUNT ? (long) stats.count : (stats.count > 0 ? stats.sum : 0);
+            res->payload = (void*) payload;
+        }else if(types[k] == SUM || types[k] == AVG || types[k] == VAR){
+            res->data_type = FLOAT;
+            if(types[k] == VAR && stats.count == 0){
+                res->num_tuples = 0;
+                res->payload = NULL;
             }else{
-                //dealing with long
-                long* val_vec2 = (long*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + (double) val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - (double) val_vec2[i];
-                    }
+                res->num_tuples = 1;
+                double* payload = malloc(sizeof(double));
+                if(stats.count == 0){
+                    *payload = 0;
+                }else if(types[k] == SUM){
+                    *payload = stats.double_sum;
+                }else if(types[k] == AVG){
+                    *payload = (dt == FLOAT ? stats.double_sum : (double) stats.sum) / (double) stats.count;
+                }else{
+                    *payload = stats.m2 / (double) stats.count;
                 }
                 res->payload = (void*) payload;
-                res->data_type = FLOAT;
             }
         }else{
-            //we are dealting with long payload from gch1
-            long* val_vec1 = (long *) gch1->p.result->payload;
-            if(gch2->p.result->data_type == INT){
-                int* val_vec2 = (int*) gch2->p.result->payload;
-                long* payload = malloc(res_tuples_num * sizeof(long));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + (long) val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - (long) val_vec2[i];
-                    }
-                }
+            //MIN or MAX
+            res->data_type = dt;
+            if(stats.count == 0){
+                res->num_tuples = 0;
+                res->payload = NULL;
+            }else if(dt == INT){
+                res->num_tuples = 1;
+                int* payload = malloc(sizeof(int));
+                *payload = (int) (types[k] == MIN ? stats.min : stats.max);
                 res->payload = (void*) payload;
-                res->data_type = LONG;
-            }else if(gch2->p.result->data_type == FLOAT){
-                double* val_vec2 = (double*) gch2->p.result->payload;
-                double* payload = malloc(res_tuples_num * sizeof(double));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = (double) val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = (double) val_vec1[i] - val_vec2[i];
-                    }
-                }
+            }else if(dt == FLOAT){
+                res->num_tuples = 1;
+                double* payload = malloc(sizeof(double));
+                *payload = types[k] == MIN ? stats.double_min : stats.double_max;
                 res->payload = (void*) payload;
-                res->data_type = FLOAT;
             }else{
-                //dealing with long
-                long* val_vec2 = (long*) gch2->p.result->payload;
-                long* payload = malloc(res_tuples_num * sizeof(long));
-                for(size_t i=0;i<res_tuples_num;i++){
-                    if(t == ADD){
-                        payload[i] = val_vec1[i] + val_vec2[i];
-                    }else{
-                        payload[i] = val_vec1[i] - val_vec2[i];
-                    }
-                }
+                res->num_tuples = 1;
+                long* payload = malloc(sizeof(long));
+                *payload = types[k] == MIN ? stats.min : stats.max;
                 res->payload = (void*) payload;
-                res->data_type = LONG;
             }
         }
+        gch_res = malloc(sizeof(GCHandle));
+        strcpy(gch_res->name, query->client_variables[k]);
+        gch_res->type = RESULT;
+        gch_res->p.result = res;
+        insert_context(query->context_table, gch_res->name, (void*) gch_res, GCOLUMN);
+        cs165_log(stdout, "adding new context with variable name: %s\n", gch_res->name);
+    }
+    msg->status = OK_DONE;
+}
+
+// Usage: <keys>,<aggs>=group_agg(<key_vec>,<val_vec>,<agg>)
+// keys are the distinct keys, ascending, aggs the aggregate of the aligned values of every key (see group.h)
+void execute_group_aggregate_operator(DbOperator* query, message* msg){
+    GCHandle* gch1 = query->operator_fields.group_aggregate_operator.gch1;
+    GCHandle* gch2 = query->operator_fields.group_aggregate_operator.gch2;
+    AggregateType t = query->operator_fields.group_aggregate_operator.type;
+    if(query->client_variables_num != 2){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    int* key_vec;
+    size_t key_tuples_num;
+    size_t distinct_estimate = 0;
+    if(gch1->type == COLUMN){
+        key_vec = gch1->p.column->data;
+        key_tuples_num = gch1->p.column->size;
+        stats_refresh(gch1->p.column);
+        distinct_estimate = stats_distinct(&gch1->p.column->stats);
+    }else if(gch1->p.result->data_type == INT){
+        key_vec = (int*) gch1->p.result->payload;
+        key_tuples_num = gch1->p.result->num_tuples;
+    }else{
+        //keys are ints
+        msg->status = QUERY_UNSUPPORTED;
+        return;
+    }
+    void* val_payload;
+    DataType dt;
+    size_t val_tuples_num;
+    if(gch2->type == COLUMN){
+        val_payload = (void*) gch2->p.column->data;
+        dt = INT;
+        val_tuples_num = gch2->p.column->size;
+    }else{
+        val_payload = gch2->p.result->payload;
+        dt = gch2->p.result->data_type;
+        val_tuples_num = gch2->p.result->num_tuples;
+    }
+    if(key_tuples_num != val_tuples_num){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    int* keys;
+    void* vals;
+    size_t group_num = group_aggregate(key_vec, val_payload, dt, key_tuples_num, t, distinct_estimate, &keys, &vals);
+    Result* res_keys = calloc(1, sizeof(Result));
+    res_keys->data_type = INT;
+    res_keys->num_tuples = group_num;
+    res_keys->payload = (void*) keys;
+    Result* res_vals = calloc(1, sizeof(Result));
+    res_vals->data_type = group_result_type(dt, t);
+    res_vals->num_tuples = group_num;
+    res_vals->payload = vals;
+    GCHandle* gch_keys = malloc(sizeof(GCHandle));
+    strcpy(gch_keys->name, query->client_variables[0]);
+    gch_keys->type = RESULT;
+    gch_keys->p.result = res_keys;
+    insert_context(query->context_table, gch_keys->name, (void*) gch_keys, GCOLUMN);
+    GCHandle* gch_vals = malloc(sizeof(GCHandle));
+    strcpy(gch_vals->name, query->client_variables[1]);
+    gch_vals->type = RESULT;
+    gch_vals->p.result = res_vals;
+    insert_context(query->context_table, gch_vals->name, (void*) gch_vals, GCOLUMN);
+    cs165_log(stdout, "adding new contexts with variable names: %s, %s\n", gch_keys->name, gch_vals->name);
+    msg->status = OK_DONE;
+}
+
+// Usage: <vals>[,<pos>]=sort([<vec_pos>,]<vec_val>) and <vals>[,<pos>]=topk([<vec_pos>,]<vec_val>,<k>)
+// sort orders ascending, topk keeps the k largest in descending order. pos holds the positions of vals,
+// taken from vec_pos when given, else the indices in vec_val (the row ids of a column), see sort.h
+void execute_sort_operator(DbOperator* query, message* msg){
+    GCHandle* gch1 = query->operator_fields.sort_operator.gch1;
+    GCHandle* gch2 = query->operator_fields.sort_operator.gch2;
+    if(query->client_variables_num != 1 && query->client_variables_num != 2){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    void* val_payload;
+    DataType dt;
+    size_t tuples_num;
+    if(gch2->type == COLUMN){
+        val_payload = (void*) gch2->p.column->data;
+        dt = INT;
+        tuples_num = gch2->p.column->size;
+    }else{
+        val_payload = gch2->p.result->payload;
+        dt = gch2->p.result->data_type;
+        tuples_num = gch2->p.result->num_tuples;
+    }
+    int* pos_vec = NULL;
+    if(gch1 != NULL){
+        size_t pos_tuples_num;
+        if(gch1->type == COLUMN){
+            pos_vec = gch1->p.column->data;
+            pos_tuples_num = gch1->p.column->size;
+        }else if(gch1->p.result->data_type == INT){
+            pos_vec = (int*) gch1->p.result->payload;
+            pos_tuples_num = gch1->p.result->num_tuples;
+        }else{
+            msg->status = INCORRECT_FORMAT;
+            return;
+        }
+        if(pos_tuples_num != tuples_num){
+            msg->status = INCORRECT_FORMAT;
+            return;
+        }
     }
+    size_t res_num = tuples_num;
+    if(query->operator_fields.sort_operator.topk){
+        res_num = query->operator_fields.sort_operator.k < tuples_num ? query->operator_fields.sort_operator.k : tuples_num;
+    }
+    size_t value_size = dt == INT ? sizeof(int) : dt == FLOAT ? sizeof(double) : sizeof(long);
+    void* vals = malloc(res_num * value_size);
+    int* positions = malloc(res_num * sizeof(int));
+    if(query->operator_fields.sort_operator.topk){
+        topk_vector(val_payload, dt, tuples_num, res_num, vals, positions);
+    }else{
+        sort_vector(val_payload, dt, tuples_num, vals, positions);
+    }
+    if(pos_vec != NULL){
+        for(size_t i=0;i<res_num;i++){
+            positions[i] = pos_vec[positions[i]];
+        }
+    }
+    Result* res_vals = calloc(1, sizeof(Result));
+    res_vals->data_type = dt;
+    res_vals->num_tuples = res_num;
+    res_vals->payload = vals;
+    GCHandle* gch_vals = malloc(sizeof(GCHandle));
+    strcpy(gch_vals->name, query->client_variables[0]);
+    gch_vals->type = RESULT;
+    gch_vals->p.result = res_vals;
+    insert_context(query->context_table, gch_vals->name, (void*) gch_vals, GCOLUMN);
+    cs165_log(stdout, "adding new context with variable name: %s\n", gch_vals->name);
+    if(query->client_variables_num == 2){
+        Result* res_pos = calloc(1, sizeof(Result));
+        res_pos->data_type = INT;
+        res_pos->num_tuples = res_num;
+        res_pos->payload = (void*) positions;
+        GCHandle* gch_pos = malloc(sizeof(GCHandle));
+        strcpy(gch_pos->name, query->client_variables[1]);
+        gch_pos->type = RESULT;
+        gch_pos->p.result = res_pos;
+        insert_context(query->context_table, gch_pos->name, (void*) gch_pos, GCOLUMN);
+        cs165_log(stdout, "adding new context with variable name: %s\n", gch_pos->name);
+    }else{
+        free(positions);
+    }
+    msg->status = OK_DONE;
+}
+
+// Usage: <vec>=expr(<expression>)
+// the expression is evaluated in one pass over its vectors, see expr.h
+void execute_expression_operator(DbOperator* query, message* msg){
+    ExprProgram* program = query->operator_fields.expr_operator.program;
+    if(query->client_variables_num != 1){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    size_t tuples_num = 0;
+    size_t vector_tuples_num;
+    for(size_t i=0;i<program->gch_num;i++){
+        if(program->gchs[i]->type == COLUMN){
+            vector_tuples_num = program->gchs[i]->p.column->size;
+        }else{
+            vector_tuples_num = program->gchs[i]->p.result->num_tuples;
+        }
+        if(i > 0 && vector_tuples_num != tuples_num){
+            cs165_log(stdout, "tuples num not matched! \n");
+            msg->status = INCORRECT_FORMAT;
+            return;
+        }
+        tuples_num = vector_tuples_num;
+    }
+    Result* res = calloc(1, sizeof(Result));
+    res->data_type = expr_result_type(program);
+    res->num_tuples = tuples_num;
+    res->payload = malloc(tuples_num * (res->data_type == FLOAT ? sizeof(double) : sizeof(long)));
+    cs165_log(stdout, "expr: %zu instructions over %zu vectors of %zu tuples\n", program->instruction_num, program->gch_num, tuples_num);
+    expr_evaluate(program, tuples_num, res->payload);
     GCHandle* gch_res = malloc(sizeof(GCHandle));
     strcpy(gch_res->name, query->client_variables[0]);
     gch_res->type = RESULT;
@@ -1088,17 +1278,39 @@ void execute_add_sub_operator(DbOperator* query, message* msg){
     msg->status = OK_DONE;
 }
 
-void execute_aggregate_operator(DbOperator* query, message* msg){
-    AggregateType t = query->operator_fields.aggregate_operator.type;
-    if(t==MIN || t==MAX){
-        execute_min_max_operator(query, msg);
-    }else if(t==SUM || t==AVG){
-        execute_sum_avg_operator(query, msg);
-    }else if(t==ADD || t==SUB){
-        execute_add_sub_operator(query, msg);
-    }else{
-        msg->status = QUERY_UNSUPPORTED;
+// Usage: <est>[,<low>,<high>]=approx_count/approx_sum/approx_avg(...)
+// FLOAT estimate and bounds of its 95% confidence interval, from the sample of the table (see sample.h).
+// An avg over no qualifying sampled row gives empty results.
+void execute_approx_operator(DbOperator* query, message* msg){
+    ApproxOperator* op = &query->operator_fields.approx_operator;
+    if(query->client_variables_num < 1 || query->client_variables_num > 3){
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
+    double values[3];
+    size_t sample_rows, qualifying_rows;
+    int defined = sample_estimate(op->table, op->val_col, op->pred_col, &op->comparator, op->type,
+                                  &values[0], &values[1], &values[2], &sample_rows, &qualifying_rows);
+    cs165_log(stdout, "approx: %zu sampled rows of %zu, %zu qualify\n", sample_rows, op->table->table_length, qualifying_rows);
+    Result* res;
+    GCHandle* gch_res;
+    for(size_t k=0;k<query->client_variables_num;k++){
+        res = calloc(1, sizeof(Result));
+        res->data_type = FLOAT;
+        if(defined){
+            res->num_tuples = 1;
+            double* payload = malloc(sizeof(double));
+            *payload = values[k];
+            res->payload = (void*) payload;
+        }
+        gch_res = malloc(sizeof(GCHandle));
+        strcpy(gch_res->name, query->client_variables[k]);
+        gch_res->type = RESULT;
+        gch_res->p.result = res;
+        insert_context(query->context_table, gch_res->name, (void*) gch_res, GCOLUMN);
+        cs165_log(stdout, "adding new context with variable name: %s\n", gch_res->name);
     }
+    msg->status = OK_DONE;
 }
 
 void execute_print_operator(DbOperator* query, message* msg){
@@ -1156,10 +1368,31 @@ void execute_print_operator(DbOperator* query, message* msg){
     msg->status = OK_DONE;
 }
 
-int IndexPairCompare(const void *ip1p, const void *ip2p){
-    IndexPair* ip1 = (IndexPair*) ip1p;
-    IndexPair* ip2 = (IndexPair*) ip2p;
-    return (ip1->key - ip2->key);
+//Usage: stats(<col_name>)
+//answers with the statistics of the column (see stats.h) as text, one histogram bucket per line
+void execute_stats_operator(DbOperator* query, message* msg){
+    stats_refresh(query->operator_fields.stats_operator.column);
+    ColumnStats* stats = &query->operator_fields.stats_operator.column->stats;
+    size_t capacity = 256 + stats->bucket_num * 64;
+    char* text = malloc(capacity);
+    int len = 0;
+    if(stats->row_count == 0){
+        len = snprintf(text, capacity, "rows: 0\ndistinct: 0\nhistogram: 0 buckets");
+    }else{
+        len = snprintf(text, capacity, "rows: %zu\nmin: %d\nmax: %d\ndistinct: ~%zu\nhistogram: %zu buckets",
+                       stats->row_count, stats->min, stats->max, stats_distinct(stats), stats->bucket_num);
+        for(size_t b=0;b<stats->bucket_num;b++){
+            if(b + 1 < stats->bucket_num){
+                len += snprintf(text + len, capacity - len, "\n[%d, %d): %zu", stats->bounds[b], stats->bounds[b+1], stats->counts[b]);
+            }else{
+                len += snprintf(text + len, capacity - len, "\n[%d, %d]: %zu", stats->bounds[b], stats->max, stats->counts[b]);
+            }
+        }
+    }
+    //handle_client sends the payload back as the response
+    msg->payload = text;
+    msg->length = len;
+    msg->status = OK_DONE;
 }
 
 /*TODO: if we have indexes, the following load might break
@@ -1189,6 +1422,7 @@ void execute_load_operator(DbOperator* query, message* msg){
         //realloc memory for this table
         for(size_t i=0;i<col_count;i++){
             columns[i].data = realloc(columns[i].data, table_length_capacity * sizeof(int));
+            zone_map_reserve(&columns[i].zone_map, table_length_capacity);
             if(columns[i].it == SORTED_UNCLUSTERED){
                 ColumnIndex* index_file = (ColumnIndex*) columns[i].index_file;
                 index_file->key_vec = realloc(index_file->key_vec, table_length_capacity * sizeof(int));
@@ -1218,10 +1452,7 @@ void execute_load_operator(DbOperator* query, message* msg){
         }
         qsort(ip_vector, tuples_num, sizeof(IndexPair), IndexPairCompare);
         for(size_t i=0;i<tuples_num;i++){ //rearange the data
-            tuples[principal_column][ip_vector[i].pos] = ip_vector[i].key;
-        }
-        for(size_t i=0;i<tuples_num;i++){
-            columns[principal_column].data[i] = tuples[principal_column][i];
+            columns[principal_column].data[i] = ip_vector[i].key;
         }
         //propogate the order of principal copy
         for(int j=0;j< (int)col_count;j++){
@@ -1244,7 +1475,7 @@ void execute_load_operator(DbOperator* query, message* msg){
         if(columns[j].it == SORTED_UNCLUSTERED){
             //generate additional copy of data for sorted unclustered index
             for(size_t i=0;i<tuples_num;i++){
-                ip_vector[i].key = columns[i].data[i];
+                ip_vector[i].key = columns[j].data[i];
                 ip_vector[i].pos = i;
             }
             qsort(ip_vector, tuples_num, sizeof(IndexPair), IndexPairCompare);
@@ -1256,302 +1487,265 @@ void execute_load_operator(DbOperator* query, message* msg){
             }
         }else if(columns[j].it == BTREE_CLUSTERED || columns[j].it == BTREE_UNCLUSTERED){
             for(size_t i=0;i<tuples_num;i++){
-                update_column_index(&(columns[j]), tuples[j][i], i, 1); //no need to shift pos_vec since data have been sorted already
+                update_column_index(&(columns[j]), columns[j].data[i], i, 1); //no need to shift pos_vec since data have been sorted already
             }
+        }else if(columns[j].it == CRACKED){
+            //an uncracked copy, the selects crack it
+            cracker_build((CrackerIndex*) columns[j].index_file, columns[j].data, columns[j].size);
+        }else if(columns[j].it == IMPRINTS){
+            imprints_build((ImprintIndex*) columns[j].index_file, columns[j].data, columns[j].size);
+        }
+        zone_map_build(&columns[j].zone_map, columns[j].data, columns[j].size);
+        stats_build(&columns[j].stats, columns[j].data, columns[j].size);
+        if(columns[j].it == NONE){
+            //indexed columns keep their data plain for the index maintenance
+            column_encode(&columns[j], table_length_capacity);
         }
         free(tuples[j]);
     }
     free(tuples);
     free(tuple);
     free(ip_vector);
+    sample_append(&table->sample, table->table_length, tuples_num);
     table->table_length += tuples_num;
     
     msg->status = OK_DONE;
 }
 
-//work with int type only for now
-//work with column literal only for now
-void execute_shared_scan(void* val_payload, DataType dt, size_t tuples_num){
-    (void) dt;
-    //TODO:Support Other data type
-    int* data = (int*) val_payload;
-    int** payloads = malloc(batch_size * sizeof(int*));
-    size_t* results_tuples_num = malloc(batch_size * sizeof(size_t));
+//shared scan of the tuples [start, end) of the group's vector, see shared_scan.h
+void execute_shared_scan(SharedScanGroup* group, size_t start, size_t end, int** results, size_t* results_count){
+    shared_scan(group->val_payload, group->pos_vec, group->dt, start, end,
+                group->comparators, group->query_num, group->predicate_index, results, results_count);
+}
+
+//shared scan of the morsel [start, end) for every select of the group, run as a thread pool task by morsel_run
+void threaded_execute_shared_scan(size_t morsel_id, size_t start, size_t end, void* thread_args){
+    SharedScanGroup* group = (SharedScanGroup*) thread_args;
+    int** unit_batched_results = malloc(group->query_num * sizeof(int*));
+    size_t* unit_batched_results_count = malloc(group->query_num * sizeof(size_t));
     //assume worst case scenario for payloads memory usage
-    for(size_t j=0;j<batch_size;j++){
-        payloads[j] = malloc(tuples_num * sizeof(int));
-        results_tuples_num[j] = 0;
-    }
-    int target;
-    for(size_t i=0;i<tuples_num;i++){
-        target = data[i];
-        for(size_t j=0;j<batch_size;j++){
-            payloads[j][results_tuples_num[j]] = i;
-            results_tuples_num[j] += (batched_queries[j]->operator_fields.select_operator.comparator.ct1 == NO_COMPARISON || batched_queries[j]->operator_fields.select_operator.comparator.lowerbound <= target) && (batched_queries[j]->operator_fields.select_operator.comparator.ct2 == NO_COMPARISON || batched_queries[j]->operator_fields.select_operator.comparator.upperbound > target);
-        }
+    for(size_t q=0;q<group->query_num;q++){
+        unit_batched_results[q] = malloc((end-start) * sizeof(int));
     }
+    execute_shared_scan(group, start, end, unit_batched_results, unit_batched_results_count);
     //realloc space for payloads
-    for(size_t j=0;j<batch_size;j++){
-        payloads[j]=realloc(payloads[j], results_tuples_num[j] * sizeof(int));
-        batched_results[j]->num_tuples = results_tuples_num[j];
-        batched_results[j]->payload = payloads[j];
+    for(size_t q=0;q<group->query_num;q++){
+        unit_batched_results[q] = realloc(unit_batched_results[q], unit_batched_results_count[q] * sizeof(int));
     }
-    
-    free(results_tuples_num);
-    free(payloads);
-    return;
+    group->morsel_results[morsel_id] = unit_batched_results;
+    group->morsel_results_count[morsel_id] = unit_batched_results_count;
 }
 
-void * threaded_execute_shared_scan(void * thread_args){
-    //TODO:Support Other data type using args->dt
-    ThreadedScanArgs* args = (ThreadedScanArgs*) thread_args;
-    size_t thread_id = args->thread_id;
-    int* data = (int*) args->data;
-    size_t start = args->start;
-    size_t end = args->end;
-    DataType dt = args->dt;
-    (void) dt;
-    int** unit_batched_results = malloc(batch_size * sizeof(int*));
-    int* unit_batched_results_count = malloc(batch_size * sizeof(int));
-    size_t tuples_num = end+1-start;
-    //assume worst case scenario for payloads memory usage
-    for(size_t j=0;j<batch_size;j++){
-        unit_batched_results[j] = malloc(tuples_num * sizeof(int));
-        unit_batched_results_count[j] = 0;
-    }
-    int target;
-    for(size_t i=start;i<=end;i++){
-        target = data[i];
-        for(size_t j=0;j<batch_size;j++){
-            unit_batched_results[i][unit_batched_results_count[j]] = i;
-            unit_batched_results_count[j] += (batched_queries[j]->operator_fields.select_operator.comparator.ct1 == NO_COMPARISON || batched_queries[j]->operator_fields.select_operator.comparator.lowerbound <= target) && (batched_queries[j]->operator_fields.select_operator.comparator.ct2 == NO_COMPARISON || batched_queries[j]->operator_fields.select_operator.comparator.upperbound > target);
+/**
+ * runs the shared scan of one group and stores the output of every select in group->results.
+ * With MULTI_THREADING the vector is split into morsels (see morsel.h) whose outputs are merged in morsel order.
+ **/
+void execute_shared_scan_group(void* args){
+    SharedScanGroup* group = (SharedScanGroup*) args;
+    int* payload;
+    size_t start;
+    for(size_t q=0;q<group->query_num;q++){
+        group->results[q] = calloc(1, sizeof(Result));
+        group->results[q]->data_type = INT;
+    }
+    group->predicate_index = NULL;
+    if(group->query_num >= SHARED_SCAN_INDEX_MIN_QUERIES){
+        group->predicate_index = predicate_index_build(group->comparators, group->query_num);
+    }
+    cs165_log(stdout, "shared scan of %zd tuples for %zd selects, %s kernel\n", group->tuples_num, group->query_num,
+              group->predicate_index != NULL ? "indexed" : "loop");
+    if(MULTI_THREADING){
+        size_t morsel_num = morsel_count(group->tuples_num);
+        group->morsel_results = malloc(morsel_num * sizeof(int**));
+        group->morsel_results_count = malloc(morsel_num * sizeof(size_t*));
+        //the morsels are tasks of the thread pool, idle workers steal from busy ones
+        morsel_run(group->tuples_num, threaded_execute_shared_scan, group);
+        //reduce, in morsel order
+        for(size_t q=0;q<group->query_num;q++){
+            for(size_t morsel_id=0;morsel_id<morsel_num;morsel_id++){
+                group->results[q]->num_tuples += group->morsel_results_count[morsel_id][q];
+            }
+            payload = malloc(group->results[q]->num_tuples * sizeof(int));
+            start = 0;
+            for(size_t morsel_id=0;morsel_id<morsel_num;morsel_id++){
+                memcpy(payload+start, group->morsel_results[morsel_id][q], group->morsel_results_count[morsel_id][q] * sizeof(int));
+                start += group->morsel_results_count[morsel_id][q];
+                free(group->morsel_results[morsel_id][q]);
+            }
+            group->results[q]->payload = (void*) payload;
         }
+        for(size_t morsel_id=0;morsel_id<morsel_num;morsel_id++){
+            free(group->morsel_results[morsel_id]);
+            free(group->morsel_results_count[morsel_id]);
+        }
+        free(group->morsel_results);
+        free(group->morsel_results_count);
+    }else{
+        int** payloads = malloc(group->query_num * sizeof(int*));
+        size_t* results_tuples_num = malloc(group->query_num * sizeof(size_t));
+        //assume worst case scenario for payloads memory usage
+        for(size_t q=0;q<group->query_num;q++){
+            payloads[q] = malloc(group->tuples_num * sizeof(int));
+        }
+        execute_shared_scan(group, 0, group->tuples_num, payloads, results_tuples_num);
+        //realloc space for payloads
+        for(size_t q=0;q<group->query_num;q++){
+            group->results[q]->num_tuples = results_tuples_num[q];
+            group->results[q]->payload = realloc(payloads[q], results_tuples_num[q] * sizeof(int));
+        }
+        free(results_tuples_num);
+        free(payloads);
     }
-    
-    //realloc space for payloads
-    for(size_t j=0;j<batch_size;j++){
-        unit_batched_results[j]=realloc(unit_batched_results[j], unit_batched_results_count[j] * sizeof(int));
-    }
-    threaded_batched_results[thread_id]=unit_batched_results;
-    threaded_batched_results_count[thread_id]=unit_batched_results_count;
-    return NULL;
+    predicate_index_free(group->predicate_index);
 }
 
-//Assume that all batched queries access the same GCHandle at the moment
-void execute_batched_select_operators(message* msg){
-    GCHandle* gch;
-    batched_results = malloc(batch_size * sizeof(Result*));
-    gch=batched_queries[0]->operator_fields.select_operator.gch1;
-    DataType dt;
-    size_t tuples_num;
-    //TODO:support results handle
-    if(gch->type==COLUMN){
-        dt=INT;
-        int* data = gch->p.column->data;
-        tuples_num = gch->p.column->size;
-        execute_shared_scan((void*) data, dt, tuples_num);
-        for(size_t i=0;i<batch_size;i++){
-            gch = malloc(1*sizeof(GCHandle));
-            strcpy(gch->name, batched_queries[i]->client_variables[0]);
-            gch->type = RESULT;
-            gch->p.result = batched_results[i];
-            insert_context(batched_queries[i]->context_table, gch->name, (void*) gch, GCOLUMN);
-        }
-        msg->status = OK_DONE;
+/**
+ * sets the vector of a new group from the operands of its first select,
+ * see execute_select_operator for the two usages
+ **/
+void init_shared_scan_group(SharedScanGroup* group, GCHandle* gch1, GCHandle* gch2){
+    group->gch1 = gch1;
+    group->gch2 = gch2;
+    group->pos_vec = NULL;
+    GCHandle* val_gch = gch1;
+    if(gch2 != NULL){
+        group->pos_vec = (int*) gch1->p.result->payload;
+        val_gch = gch2;
     }
-    batch_mode=0;
-    batch_size=0;
-    free_batched_queries();
-    free(batched_results);
-    return;
+    if(val_gch->type == RESULT){
+        group->val_payload = val_gch->p.result->payload;
+        group->dt = val_gch->p.result->data_type;
+    }else{
+        group->val_payload = (void*) val_gch->p.column->data;
+        group->dt = INT;
+    }
+    if(gch2 != NULL){
+        group->tuples_num = gch1->p.result->num_tuples;
+    }else if(gch1->type == RESULT){
+        group->tuples_num = gch1->p.result->num_tuples;
+    }else{
+        group->tuples_num = gch1->p.column->size;
+    }
+    group->query_ids = malloc(batch_size * sizeof(size_t));
+    group->comparators = malloc(batch_size * sizeof(Comparator));
+    group->query_num = 0;
 }
 
-void execute_batched_select_operators_threaded(message* msg){
-    GCHandle* gch;
-    
-    threaded_batched_results = malloc(THREAD_NUM * sizeof(int**));
-    threaded_batched_results_count = malloc(THREAD_NUM * sizeof(int*));
-    
-    gch=batched_queries[0]->operator_fields.select_operator.gch1;
-    DataType dt;
-    size_t tuples_num, threaded_tuples_num, start, end;
-    int* payload_temp;
-    //TODO:support results handle
-    if(gch->type==COLUMN){
-        dt=INT;
-        int* data = gch->p.column->data;
-        tuples_num = gch->p.column->size;
-        threaded_tuples_num = tuples_num/THREAD_NUM;
-        pthread_t* threads = malloc(THREAD_NUM * sizeof(pthread_t));
-        ThreadedScanArgs** threads_args = malloc(THREAD_NUM * sizeof(ThreadedScanArgs *));
-        start=0;
-        for(size_t thread_id=0;thread_id<THREAD_NUM;thread_id++){
-            end = start + threaded_tuples_num - 1 + ((tuples_num % THREAD_NUM) - thread_id > 0);
-            threads_args[thread_id] = malloc(1 * sizeof(ThreadedScanArgs));
-            threads_args[thread_id]->thread_id = thread_id;
-            threads_args[thread_id]->data = (void *) data;
-            threads_args[thread_id]->start = start;
-            threads_args[thread_id]->end = end;
-            threads_args[thread_id]->dt = dt;
-            pthread_create(&threads[thread_id], NULL, threaded_execute_shared_scan, threads_args[thread_id]);
-            start = end + 1;
-        }
-        for(size_t thread_id=0;thread_id<THREAD_NUM;thread_id++){
-            pthread_join(threads[thread_id], NULL);
-            free(threads_args[thread_id]);
-        }
-        free(threads);
-        free(threads_args);
-        
-        //reduce
-        batched_results = malloc(batch_size * sizeof(Result*));
-        for(size_t j=0;j<batch_size;j++){
-            batched_results[j] = malloc(1 * sizeof(Result));
-            batched_results[j]->num_tuples = 0;
-            for(size_t thread_id=0;thread_id<THREAD_NUM;thread_id++){
-                batched_results[j]->num_tuples += threaded_batched_results_count[thread_id][j];
-            }
-            batched_results[j]->payload = malloc(batched_results[j]->num_tuples * sizeof(int));
-            start = 0;
-            for(size_t thread_id=0;thread_id<THREAD_NUM;thread_id++){
-                for(int i=0;i<threaded_batched_results_count[thread_id][j];i++){
-                    payload_temp = (int*) batched_results[j]->payload;
-                    payload_temp[start+i] = threaded_batched_results[thread_id][j][i];
-                }
-                start+=threaded_batched_results_count[thread_id][j];
-                free(threaded_batched_results[thread_id][j]);
+/**
+ * The batched selects are grouped by the vector they read: the same column or result, or for
+ * select(<posn_vec>,<val_vec>,...) the same pair of handles. Each group is scanned once for all of its
+ * selects and the groups are scanned concurrently, one thread pool task per group.
+ **/
+void execute_batched_select_operators(message* msg){
+    SharedScanGroup* groups = malloc(batch_size * sizeof(SharedScanGroup));
+    size_t group_num = 0;
+    size_t g;
+    DbOperator* query;
+    GCHandle* gch1;
+    GCHandle* gch2;
+    msg->status = OK_DONE;
+    for(size_t j=0;j<batch_size;j++){
+        query = batched_queries[j];
+        gch1 = query->operator_fields.select_operator.gch1;
+        gch2 = query->operator_fields.select_operator.gch2;
+        if(query->client_variables_num != 1){
+            msg->status = INCORRECT_FORMAT;
+            cs165_log(stdout, "no client variable to store the result of batched select %zd\n", j);
+            continue;
+        }
+        if(gch2 != NULL && (gch1->type != RESULT || gch1->p.result->data_type != INT)){
+            msg->status = QUERY_UNSUPPORTED;
+            cs165_log(stdout, "query unsupported: batched select %zd uses column data or a non int result as pos_vec\n", j);
+            continue;
+        }
+        for(g=0;g<group_num;g++){
+            if(groups[g].gch1 == gch1 && groups[g].gch2 == gch2){
+                break;
             }
-            batched_results[j]->data_type = INT;
         }
-        for(size_t thread_id=0;thread_id<THREAD_NUM;thread_id++){
-            free(threaded_batched_results[thread_id]);
-            free(threaded_batched_results_count[thread_id]);
+        if(g == group_num){
+            init_shared_scan_group(&groups[g], gch1, gch2);
+            group_num++;
         }
-        free(threaded_batched_results);
-        free(threaded_batched_results_count);
-        
-        for(size_t j=0;j<batch_size;j++){
+        groups[g].query_ids[groups[g].query_num] = j;
+        groups[g].comparators[groups[g].query_num] = query->operator_fields.select_operator.comparator;
+        groups[g].query_num++;
+    }
+    cs165_log(stdout, "%zd batched selects share %zd scans\n", batch_size, group_num);
+
+    TaskGroup task_group;
+    task_group_init(&task_group);
+    for(g=0;g<group_num;g++){
+        groups[g].results = malloc(groups[g].query_num * sizeof(Result*));
+        if(MULTI_THREADING){
+            threadpool_submit(&task_group, execute_shared_scan_group, &groups[g]);
+        }else{
+            execute_shared_scan_group(&groups[g]);
+        }
+    }
+    threadpool_wait(&task_group);
+
+    //every scan is done before a result replaces a handle that another group might read
+    GCHandle* gch;
+    for(g=0;g<group_num;g++){
+        for(size_t q=0;q<groups[g].query_num;q++){
+            query = batched_queries[groups[g].query_ids[q]];
             gch = malloc(1*sizeof(GCHandle));
-            strcpy(gch->name, batched_queries[j]->client_variables[0]);
+            strcpy(gch->name, query->client_variables[0]);
             gch->type = RESULT;
-            gch->p.result = batched_results[j];
-            insert_context(batched_queries[j]->context_table, gch->name, (void*) gch, GCOLUMN);
+            gch->p.result = groups[g].results[q];
+            insert_context(query->context_table, gch->name, (void*) gch, GCOLUMN);
         }
-        msg->status = OK_DONE;
+        free(groups[g].results);
+        free(groups[g].query_ids);
+        free(groups[g].comparators);
     }
-    batch_mode=0;
-    batch_size=0;
-    free_batched_queries();
-    free(batched_results);
-    return;
+    free(groups);
 }
 
 void execute_batched_queries(message* msg){
-    if(batch_size==0){
-        return;
-    }
-    clock_t begin, end;
-    double time_elapsed = 0;
-    if(MULTI_THREADING){
-        begin = clock();
-        execute_batched_select_operators_threaded(msg);
-        end = clock();
-        cs165_log(stdout, "Multithreaded shared scan takes time: %f \n", time_elapsed);
-    }else{
+    msg->status = OK_DONE;
+    if(batch_size > 0){
+        clock_t begin, end;
+        double time_elapsed = 0;
         begin = clock();
         execute_batched_select_operators(msg);
         end = clock();
-        cs165_log(stdout, "Single thread shared scan takes time: %f \n", time_elapsed);
+        time_elapsed = (double) (end - begin) / CLOCKS_PER_SEC;
+        cs165_log(stdout, "%s shared scan takes time: %f \n", MULTI_THREADING ? "Multithreaded" : "Single thread", time_elapsed);
         //TODO: for comparison purpose, add a mode to execute batched select queries one by one
     }
+    free_batched_queries();
+    batch_mode=0;
+    batch_size=0;
 }
 
-void execute_nested_loop_join(void* outer_val_vec_p, int* outer_pos_vec, size_t outer_tuples_num,
-                              void* inner_val_vec_p, int* inner_pos_vec, size_t inner_tuples_num,
-                              int** res_outer_pos_vec_p, int** res_inner_pos_vec_p,  size_t* res_tuples_num_p,
-                              DataType dt){
-    int* res_outer_pos_vec = *res_outer_pos_vec_p;
-    int* res_inner_pos_vec = *res_inner_pos_vec_p;
-    size_t res_tuples_num = 0;
-    size_t res_capacity = PAGE_SIZE;
-    if(dt == INT){
-        int* outer_val_vec = (int*) outer_val_vec_p;
-        int* inner_val_vec = (int*) inner_val_vec_p;
-        size_t outer_p = PAGE_SIZE/sizeof(int);
-        size_t inner_p = PAGE_SIZE/sizeof(int);
-        for(size_t block_i=0;block_i<outer_tuples_num;block_i=block_i+outer_p){
-            for(size_t block_j=0;block_j<inner_tuples_num;block_j=block_j+inner_p){
-                for(size_t i=block_i;i<block_i+outer_p && i<outer_tuples_num;i++){
-                    for(size_t j=block_j;j<block_j+inner_p && j<inner_tuples_num;j++){
-                        if(outer_val_vec[i]==inner_val_vec[j]){
-                            if(res_tuples_num == res_capacity){
-                                res_capacity *= 2;
-                                res_outer_pos_vec = realloc(res_outer_pos_vec, res_capacity * sizeof(int));
-                                res_inner_pos_vec = realloc(res_inner_pos_vec, res_capacity * sizeof(int));
-                            }
-                            res_outer_pos_vec[res_tuples_num] = outer_pos_vec[i];
-                            res_inner_pos_vec[res_tuples_num] = inner_pos_vec[j];
-                            res_tuples_num++;
-                        }
-                    }
-                }
-            }
-        }
-        res_outer_pos_vec = realloc(res_outer_pos_vec, res_tuples_num * sizeof(int));
-        res_inner_pos_vec = realloc(res_inner_pos_vec, res_tuples_num * sizeof(int));
-        *res_inner_pos_vec_p = res_inner_pos_vec;
-        *res_outer_pos_vec_p = res_outer_pos_vec;
-        *res_tuples_num_p = res_tuples_num;
-    }else if(dt == FLOAT){
-        //TODO: support double
-    }else{
-        //TODO: support long
-    }
-    
-}
-
-void execute_hash_join(void* smaller_val_vec_p, int* smaller_pos_vec, size_t smaller_tuples_num,
-                       void* larger_val_vec_p, int* larger_pos_vec, size_t larger_tuples_num,
-                       int** res_smaller_pos_vec_p, int** res_larger_pos_vec_p,  size_t* res_tuples_num_p,
-                       DataType dt){
-    int* res_smaller_pos_vec = *res_smaller_pos_vec_p;
-    int* res_larger_pos_vec = *res_larger_pos_vec_p;
-    size_t res_tuples_num = 0;
-    size_t res_capacity = PAGE_SIZE;
-    if(dt == INT){
-        int* smaller_val_vec = (int*) smaller_val_vec_p;
-        int* larger_val_vec = (int*) larger_val_vec_p;
-        ExtHashTable* ht = hashtable_create();
-        for(size_t i=0;i<smaller_tuples_num;i++){
-            hashtable_insert(ht, smaller_val_vec[i], smaller_pos_vec[i]);
-        }
-        int* temp_prob_res = malloc(smaller_tuples_num * sizeof(int));
-        size_t temp_prob_res_num = 0;
-        for(size_t i=0;i<larger_tuples_num;i++){
-            hashtable_probe(ht, larger_val_vec[i], temp_prob_res, &temp_prob_res_num);
-            for(size_t j=0;j<temp_prob_res_num;j++){
-                if(res_tuples_num == res_capacity){
-                    res_capacity *= 2;
-                    res_smaller_pos_vec = realloc(res_smaller_pos_vec, res_capacity * sizeof(int));
-                    res_larger_pos_vec = realloc(res_larger_pos_vec, res_capacity * sizeof(int));
-                }
-                res_smaller_pos_vec[res_tuples_num] = temp_prob_res[j];
-                res_larger_pos_vec[res_tuples_num] = larger_pos_vec[i];
-                res_tuples_num++;
-            }
-        }
-        free(temp_prob_res);
-        hashtable_free(ht);
-        res_smaller_pos_vec = realloc(res_smaller_pos_vec, res_tuples_num * sizeof(int));
-        res_larger_pos_vec = realloc(res_larger_pos_vec, res_tuples_num * sizeof(int));
-        *res_smaller_pos_vec_p = res_smaller_pos_vec;
-        *res_larger_pos_vec_p = res_larger_pos_vec;
-        *res_tuples_num_p = res_tuples_num;
-    }else if(dt == FLOAT){
-        //TODO: support double
+//the outer input is the smaller one, the build side of the hash joins. Returns 0 if the join failed.
+int execute_join_algorithm(JoinType jt, int* outer_val_vec, int* outer_pos_vec, size_t outer_tuples_num,
+                            int* inner_val_vec, int* inner_pos_vec, size_t inner_tuples_num,
+                            int** res_outer_pos_vec_p, int** res_inner_pos_vec_p, size_t* res_tuples_num_p){
+    if(jt == NESTED_LOOP){
+        execute_nested_loop_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
+                                 (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
+                                 res_outer_pos_vec_p, res_inner_pos_vec_p, res_tuples_num_p, INT);
+    }else if(jt == HASH){
+        execute_hash_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
+                          (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
+                          res_outer_pos_vec_p, res_inner_pos_vec_p, res_tuples_num_p, INT);
+    }else if(jt == RADIX_HASH){
+        join_radix(outer_val_vec, outer_pos_vec, outer_tuples_num,
+                   inner_val_vec, inner_pos_vec, inner_tuples_num,
+                   res_outer_pos_vec_p, res_inner_pos_vec_p, res_tuples_num_p);
+    }else if(jt == PARALLEL_HASH){
+        join_parallel_hash(outer_val_vec, outer_pos_vec, outer_tuples_num,
+                           inner_val_vec, inner_pos_vec, inner_tuples_num,
+                           res_outer_pos_vec_p, res_inner_pos_vec_p, res_tuples_num_p);
     }else{
-        //TODO: support long
+        return join_grace(outer_val_vec, outer_pos_vec, outer_tuples_num,
+                          inner_val_vec, inner_pos_vec, inner_tuples_num,
+                          res_outer_pos_vec_p, res_inner_pos_vec_p, res_tuples_num_p);
     }
+    return 1;
 }
 
 void execute_join_operator(DbOperator* query, message* msg){
@@ -1563,6 +1757,12 @@ void execute_join_operator(DbOperator* query, message* msg){
     Result* gch_pos_vec1 = query->operator_fields.join_operator.pos_vec1;
     Result* gch_val_vec2 = query->operator_fields.join_operator.val_vec2;
     Result* gch_pos_vec2 = query->operator_fields.join_operator.pos_vec2;
+    if(gch_val_vec1->num_tuples != gch_pos_vec1->num_tuples || gch_val_vec2->num_tuples != gch_pos_vec2->num_tuples){
+        //only possible for results that were deferred when the join was parsed
+        cs165_log(stdout, "val vec size != pos vec size\n");
+        msg->status = INCORRECT_FORMAT;
+        return;
+    }
     int* pos_vec1 = (int*) gch_pos_vec1->payload;
     size_t tuples_num1 = gch_pos_vec1->num_tuples;
     int* pos_vec2 = (int*) gch_pos_vec2->payload;
@@ -1573,8 +1773,8 @@ void execute_join_operator(DbOperator* query, message* msg){
     size_t outer_tuples_num = 0;
     size_t inner_tuples_num = 0;
     
-    Result* res_outer = malloc(1 * sizeof(Result));
-    Result* res_inner = malloc(1 * sizeof(Result));
+    Result* res_outer = calloc(1, sizeof(Result));
+    Result* res_inner = calloc(1, sizeof(Result));
     res_outer->data_type = INT;
     res_inner->data_type = INT;
     int* res_outer_pos_vec = NULL;
@@ -1597,14 +1797,15 @@ void execute_join_operator(DbOperator* query, message* msg){
             inner_val_vec = val_vec1;
             inner_pos_vec = pos_vec1;
             inner_tuples_num = tuples_num1;
-            if(jt == NESTED_LOOP){
-                execute_nested_loop_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
-                                         (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
-                                         &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num, INT);
-            }else{
-                execute_hash_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
-                                  (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
-                                  &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num, INT);
+            if(!execute_join_algorithm(jt, outer_val_vec, outer_pos_vec, outer_tuples_num,
+                                       inner_val_vec, inner_pos_vec, inner_tuples_num,
+                                       &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num)){
+                free(res_outer_pos_vec);
+                free(res_inner_pos_vec);
+                free(res_outer);
+                free(res_inner);
+                msg->status = EXECUTION_ERROR;
+                return;
             }
             res_outer->payload = (void*) res_outer_pos_vec;
             res_outer->num_tuples = res_tuples_num;
@@ -1638,14 +1839,15 @@ void execute_join_operator(DbOperator* query, message* msg){
             inner_val_vec = val_vec2;
             inner_pos_vec = pos_vec2;
             inner_tuples_num = tuples_num2;
-            if(jt == NESTED_LOOP){
-                execute_nested_loop_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
-                                         (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
-                                         &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num, INT);
-            }else{
-                execute_hash_join((void*)outer_val_vec, outer_pos_vec, outer_tuples_num,
-                                  (void*)inner_val_vec, inner_pos_vec, inner_tuples_num,
-                                  &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num, INT);
+            if(!execute_join_algorithm(jt, outer_val_vec, outer_pos_vec, outer_tuples_num,
+                                       inner_val_vec, inner_pos_vec, inner_tuples_num,
+                                       &res_outer_pos_vec, &res_inner_pos_vec, &res_tuples_num)){
+                free(res_outer_pos_vec);
+                free(res_inner_pos_vec);
+                free(res_outer);
+                free(res_inner);
+                msg->status = EXECUTION_ERROR;
+                return;
             }
             res_outer->payload = (void*) res_outer_pos_vec;
             res_outer->num_tuples = res_tuples_num;
@@ -1681,14 +1883,26 @@ void execute_delete_simple(Table* table, int* pos_vec, size_t tuples_num){
     BTreeNode* root = NULL;
     int pos;
     int key;
+    //zones from the first deleted position on have to be recomputed
+    int first_pos = tuples_num > 0 ? pos_vec[0] : 0;
+    for(size_t i=1;i<tuples_num;i++){
+        first_pos = pos_vec[i] < first_pos ? pos_vec[i] : first_pos;
+    }
+    size_t original_column_size=0;
+    uint64_t* deleted = NULL;
     for(size_t j=0;j<table->col_count;j++){
         ci = NULL;
         root = NULL;
         col = &(table->columns[j]);
+        original_column_size=col->size;
         if(col->it == BTREE_CLUSTERED || col->it == BTREE_UNCLUSTERED){
             root = (BTreeNode*) col->index_file;
         }else if(col->it == SORTED_UNCLUSTERED){
             ci = (ColumnIndex*) col->index_file;
+        }else if(col->it == CRACKED){
+            //the cracker copy drops every deleted position in one pass
+            deleted = deleted != NULL ? deleted : positions_to_bitmap(pos_vec, tuples_num, original_column_size);
+            cracker_delete((CrackerIndex*) col->index_file, deleted, original_column_size);
         }
         //TODO:can we do better? can we move data and update index in one pass?
         //entirely possible for all cases, but have to assume pos_vec is sorted, a trade-off
@@ -1697,6 +1911,7 @@ void execute_delete_simple(Table* table, int* pos_vec, size_t tuples_num){
         for(int i=tuples_num-1;i>=0;i--){
             pos=pos_vec[i];
             key=col->data[pos];
+            stats_remove(&col->stats, key);
             for(size_t k=pos;k+1<col->size;k++){
                 col->data[k] = col->data[k+1];
             }
@@ -1707,8 +1922,15 @@ void execute_delete_simple(Table* table, int* pos_vec, size_t tuples_num){
             }
             col->size--;
         }
-        
+        if(tuples_num > 0){
+            zone_map_rebuild_from(&col->zone_map, col->data, col->size, first_pos);
+        }
+        if(col->it == IMPRINTS){
+            //the values after a deleted one move to other cache lines
+            imprints_build((ImprintIndex*) col->index_file, col->data, col->size);
+        }
     }
+    free(deleted);
     table->table_length -= tuples_num;
 }
 
@@ -1725,6 +1947,7 @@ void execute_delete_one_pass(Table* table, int* pos_vec, size_t tuples_num){
     int delete_pos=0;
     int shift=0;
     size_t original_column_size=0;
+    uint64_t* deleted = NULL;
     for(size_t j=0;j<table->col_count;j++){
         ci = NULL;
         root = NULL;
@@ -1734,11 +1957,16 @@ void execute_delete_one_pass(Table* table, int* pos_vec, size_t tuples_num){
             root = (BTreeNode*) col->index_file;
         }else if(col->it == SORTED_UNCLUSTERED){
             ci = (ColumnIndex*) col->index_file;
+        }else if(col->it == CRACKED){
+            //the cracker copy drops every deleted position in one pass
+            deleted = deleted != NULL ? deleted : positions_to_bitmap(pos_vec, tuples_num, original_column_size);
+            cracker_delete((CrackerIndex*) col->index_file, deleted, original_column_size);
         }
         //update index one by one
         for(int i=tuples_num-1;i>=0;i--){
             pos=pos_vec[i];
             key=col->data[pos];
+            stats_remove(&col->stats, key);
             if(root != NULL){
                 btree_remove(root, key, pos);
             }else if(ci != NULL){
@@ -1761,14 +1989,96 @@ void execute_delete_one_pass(Table* table, int* pos_vec, size_t tuples_num){
             col->data[real_pos]=col->data[real_pos+shift];
             real_pos++;
         }
-        
+        //zones from the first deleted position on have shifted
+        zone_map_rebuild_from(&col->zone_map, col->data, col->size, pos_vec[0]);
+        if(col->it == IMPRINTS){
+            imprints_build((ImprintIndex*) col->index_file, col->data, col->size);
+        }
+    }
+    free(deleted);
+    table->table_length -= tuples_num;
+}
+
+/**
+ * same as execute_delete_one_pass but driven by a BITMAP result.
+ * A bitmap is sorted by construction, so the data is always compacted in one pass.
+ **/
+void execute_delete_bitmap(Table* table, Result* res_pos_vec){
+    size_t tuples_num = res_pos_vec->num_tuples;
+    if(tuples_num <= 0){
+        return;
+    }
+    uint64_t* bitmap = (uint64_t*) res_pos_vec->payload;
+    size_t bitmap_len = res_pos_vec->bitmap_len;
+    //zones from the first deleted position on have to be recomputed
+    size_t first_word = 0;
+    while(bitmap[first_word] == 0){
+        first_word++;
+    }
+    size_t first_pos = first_word * 64 + __builtin_ctzll(bitmap[first_word]);
+    Column* col = NULL;
+    ColumnIndex* ci = NULL;
+    BTreeNode* root = NULL;
+    int key;
+    size_t real_pos=0;
+    size_t original_column_size=0;
+    for(size_t j=0;j<table->col_count;j++){
+        ci = NULL;
+        root = NULL;
+        col = &(table->columns[j]);
+        original_column_size=col->size;
+        if(col->it == BTREE_CLUSTERED || col->it == BTREE_UNCLUSTERED){
+            root = (BTreeNode*) col->index_file;
+        }else if(col->it == SORTED_UNCLUSTERED){
+            ci = (ColumnIndex*) col->index_file;
+        }else if(col->it == CRACKED){
+            cracker_delete((CrackerIndex*) col->index_file, bitmap, bitmap_len);
+        }
+        //update index and statistics one by one, from the last position to the first
+        for(size_t pos=bitmap_len;pos-->0;){
+            if(!((bitmap[pos >> 6] >> (pos & 63)) & 1)){
+                continue;
+            }
+            key=col->data[pos];
+            stats_remove(&col->stats, key);
+            if(root != NULL){
+                btree_remove(root, key, pos);
+            }else if(ci != NULL){
+                sorted_delete_and_update(ci, col->size, pos);
+            }
+            col->size--;
+        }
+
+        //remove data in one pass
+        real_pos=0;
+        for(size_t pos=0;pos<original_column_size;pos++){
+            if(pos < bitmap_len && ((bitmap[pos >> 6] >> (pos & 63)) & 1)){
+                continue;
+            }
+            col->data[real_pos]=col->data[pos];
+            real_pos++;
+        }
+        zone_map_rebuild_from(&col->zone_map, col->data, col->size, first_pos);
+        if(col->it == IMPRINTS){
+            imprints_build((ImprintIndex*) col->index_file, col->data, col->size);
+        }
     }
     table->table_length -= tuples_num;
 }
 
 void execute_delete_operator(DbOperator* query, message* msg){
     Table* table = query->operator_fields.delete_operator.table;
+    //rows after the deleted ones move up
+    sample_invalidate(&table->sample);
     Result* res_pos_vec = query->operator_fields.delete_operator.pos_vec;
+    if(res_pos_vec->format == RANGES){
+        result_materialize_positions(res_pos_vec);
+    }
+    if(res_pos_vec->format == BITMAP){
+        execute_delete_bitmap(table, res_pos_vec);
+        msg->status = OK_DONE;
+        return;
+    }
     size_t tuples_num = res_pos_vec->num_tuples;
     int* pos_vec = (int*) res_pos_vec->payload;
     execute_delete_one_pass(table, pos_vec, tuples_num);
@@ -1777,7 +2087,12 @@ void execute_delete_operator(DbOperator* query, message* msg){
 
 void execute_update_operator(DbOperator* query, message* msg){
     Table* table = query->operator_fields.update_operator.table;
+    //updated rows are deleted and inserted again
+    sample_invalidate(&table->sample);
     Result* res_pos_vec = query->operator_fields.update_operator.pos_vec;
+    if(res_pos_vec->format == RANGES){
+        result_materialize_positions(res_pos_vec);
+    }
     size_t tuples_num = res_pos_vec->num_tuples;
     int* pos_vec = (int*) res_pos_vec->payload;
     Column* col = query->operator_fields.update_operator.col;
@@ -1787,9 +2102,25 @@ void execute_update_operator(DbOperator* query, message* msg){
     int** rows = malloc(tuples_num * sizeof(int*));
     int target_pos;
     Column* cur_col;
+    uint64_t* bitmap = NULL;
+    size_t word_idx = 0;
+    uint64_t word = 0;
+    if(res_pos_vec->format == BITMAP){
+        bitmap = (uint64_t*) res_pos_vec->payload;
+        word = tuples_num > 0 ? bitmap[0] : 0;
+    }
     for(size_t i=0;i<tuples_num;i++){
         rows[i] = malloc(table->col_count * sizeof(int));
-        target_pos = pos_vec[i];
+        if(bitmap != NULL){
+            //walk to the next set bit
+            while(word == 0){
+                word = bitmap[++word_idx];
+            }
+            target_pos = word_idx * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+        }else{
+            target_pos = pos_vec[i];
+        }
         for(size_t j=0;j<table->col_count;j++){
             cur_col = &(table->columns[j]);
             if(cur_col == col){
@@ -1800,7 +2131,11 @@ void execute_update_operator(DbOperator* query, message* msg){
         }
     }
     //delete rows
-    execute_delete_one_pass(table, pos_vec, tuples_num);
+    if(bitmap != NULL){
+        execute_delete_bitmap(table, res_pos_vec);
+    }else{
+        execute_delete_one_pass(table, pos_vec, tuples_num);
+    }
     //insert rows
     for(size_t i=0;i<tuples_num;i++){
         execute_insert(table, rows[i], msg);
@@ -1808,17 +2143,240 @@ void execute_update_operator(DbOperator* query, message* msg){
     msg->status = OK_DONE;
 }
 
+/**
+ * computes a DEFERRED result in place: the select runs as the scan it was deferred for
+ * and a fetch gathers the values at the qualifying positions.
+ **/
+void materialize_deferred_result(Result* res){
+    if(res->format != DEFERRED){
+        return;
+    }
+    DeferredResult* deferred = res->deferred;
+    Column* col = deferred->select_column;
+    res->deferred = NULL;
+    res->data_type = INT;
+    execute_bitmap_scan((void*) col->data, &deferred->comparator, INT, res, col->size, &col->zone_map, NULL);
+    if(deferred->fetch_column != NULL){
+        int* val_vec = NULL;
+        if(res->num_tuples > 0){
+            val_vec = malloc(res->num_tuples * sizeof(int));
+            if(res->format == BITMAP){
+                morsel_bitmap_fetch((void*) deferred->fetch_column->data, INT, (uint64_t*) res->payload, res->bitmap_len, (void*) val_vec);
+            }else{
+                morsel_fetch((void*) deferred->fetch_column->data, INT, (int*) res->payload, res->num_tuples, (void*) val_vec);
+            }
+        }
+        free(res->payload);
+        res->payload = (void*) val_vec;
+        res->format = VECTOR;
+        res->bitmap_len = 0;
+    }
+    free(deferred);
+    cs165_log(stdout, "deferred result materialized, %zd tuples\n", res->num_tuples);
+}
+
+void materialize_deferred_handle(GCHandle* gch){
+    if(gch != NULL && gch->type == RESULT){
+        materialize_deferred_result(gch->p.result);
+    }
+}
+
+//every deferred and slice result of the client, before the data they were deferred over or point to changes
+void materialize_context_results(ContextTable* ct){
+    ContextNode* cur;
+    GCHandle* gch;
+    for(size_t i=0;i<ct->size;i++){
+        for(cur=ct->buckets[i];cur!=NULL;cur=cur->next){
+            if(cur->type == GCOLUMN){
+                gch = (GCHandle*) cur->p;
+                materialize_deferred_handle(gch);
+                if(gch->type == RESULT){
+                    result_materialize_slice(gch->p.result);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * DEFERRED results are consumed natively by a fetch of a column of the same table (select only)
+ * and by sum, avg, min and max (fetch only). Every other use computes them first, and so does
+ * every change to the data, for all the deferred results of the client. SLICE results are copied then too.
+ **/
+void materialize_deferred_operands(DbOperator* query){
+    if(query->type == INSERT || query->type == DELETE || query->type == UPDATE || query->type == LOAD){
+        materialize_context_results(query->context_table);
+    }else if(query->type == SELECT){
+        materialize_deferred_handle(query->operator_fields.select_operator.gch1);
+        materialize_deferred_handle(query->operator_fields.select_operator.gch2);
+    }else if(query->type == FETCH){
+        GCHandle* gch1 = query->operator_fields.fetch_operator.gch1;
+        GCHandle* gch2 = query->operator_fields.fetch_operator.gch2;
+        materialize_deferred_handle(gch1);
+        if(gch2->type == RESULT && gch2->p.result->format == DEFERRED
+           && !(gch1->type == COLUMN && gch1->p.column->encoding == PLAIN && gch2->p.result->deferred->fetch_column == NULL
+                && column_table(gch1->p.column) != NULL
+                && column_table(gch1->p.column) == column_table(gch2->p.result->deferred->select_column))){
+            materialize_deferred_result(gch2->p.result);
+        }
+    }else if(query->type == AGGREGATE){
+        GCHandle* gch1 = query->operator_fields.aggregate_operator.gch1;
+        AggregateType t = query->operator_fields.aggregate_operator.type;
+        if(gch1->type == RESULT && gch1->p.result->format == DEFERRED
+           && !(query->client_variables_num == 1 && query->operator_fields.aggregate_operator.gch2 == NULL
+                && (t == SUM || t == AVG || t == MIN || t == MAX) && gch1->p.result->deferred->fetch_column != NULL)){
+            materialize_deferred_result(gch1->p.result);
+        }
+        materialize_deferred_handle(query->operator_fields.aggregate_operator.gch2);
+    }else if(query->type == MULTI_AGGREGATE){
+        materialize_deferred_handle(query->operator_fields.multi_aggregate_operator.gch);
+    }else if(query->type == GROUP_AGGREGATE){
+        materialize_deferred_handle(query->operator_fields.group_aggregate_operator.gch1);
+        materialize_deferred_handle(query->operator_fields.group_aggregate_operator.gch2);
+    }else if(query->type == SORT){
+        materialize_deferred_handle(query->operator_fields.sort_operator.gch1);
+        materialize_deferred_handle(query->operator_fields.sort_operator.gch2);
+    }else if(query->type == EXPRESSION){
+        for(size_t i=0;i<query->operator_fields.expr_operator.program->gch_num;i++){
+            materialize_deferred_handle(query->operator_fields.expr_operator.program->gchs[i]);
+        }
+    }else if(query->type == PRINT){
+        for(size_t i=0;i<query->operator_fields.print_operator.gch_count;i++){
+            materialize_deferred_handle(query->operator_fields.print_operator.gch_list[i]);
+        }
+    }else if(query->type == JOIN){
+        materialize_deferred_result(query->operator_fields.join_operator.val_vec1);
+        materialize_deferred_result(query->operator_fields.join_operator.pos_vec1);
+        materialize_deferred_result(query->operator_fields.join_operator.val_vec2);
+        materialize_deferred_result(query->operator_fields.join_operator.pos_vec2);
+    }
+}
+
+void materialize_bitmap_handle(GCHandle* gch){
+    if(gch != NULL && gch->type == RESULT){
+        result_materialize_positions(gch->p.result);
+    }
+}
+
+/**
+ * BITMAP results are consumed natively as a pos_vec by fetch, positional min/max, delete and update,
+ * RANGES results by fetch. Every other use of a result reads it as a plain vector, so it is converted in place here.
+ **/
+void materialize_bitmap_operands(DbOperator* query){
+    if(query->type == SELECT){
+        materialize_bitmap_handle(query->operator_fields.select_operator.gch1);
+        materialize_bitmap_handle(query->operator_fields.select_operator.gch2);
+    }else if(query->type == FETCH){
+        materialize_bitmap_handle(query->operator_fields.fetch_operator.gch1);
+    }else if(query->type == AGGREGATE){
+        //<agg_pos>,<agg_val>=min/max(<vec_pos>,<vec_val>) reads the bitmap directly
+        if(!(query->client_variables_num == 2 && (query->operator_fields.aggregate_operator.type == MIN || query->operator_fields.aggregate_operator.type == MAX))){
+            materialize_bitmap_handle(query->operator_fields.aggregate_operator.gch1);
+        }
+        materialize_bitmap_handle(query->operator_fields.aggregate_operator.gch2);
+    }else if(query->type == MULTI_AGGREGATE){
+        materialize_bitmap_handle(query->operator_fields.multi_aggregate_operator.gch);
+    }else if(query->type == GROUP_AGGREGATE){
+        materialize_bitmap_handle(query->operator_fields.group_aggregate_operator.gch1);
+        materialize_bitmap_handle(query->operator_fields.group_aggregate_operator.gch2);
+    }else if(query->type == SORT){
+        materialize_bitmap_handle(query->operator_fields.sort_operator.gch1);
+        materialize_bitmap_handle(query->operator_fields.sort_operator.gch2);
+    }else if(query->type == EXPRESSION){
+        for(size_t i=0;i<query->operator_fields.expr_operator.program->gch_num;i++){
+            materialize_bitmap_handle(query->operator_fields.expr_operator.program->gchs[i]);
+        }
+    }else if(query->type == PRINT){
+        for(size_t i=0;i<query->operator_fields.print_operator.gch_count;i++){
+            materialize_bitmap_handle(query->operator_fields.print_operator.gch_list[i]);
+        }
+    }else if(query->type == JOIN){
+        result_materialize_positions(query->operator_fields.join_operator.val_vec1);
+        result_materialize_positions(query->operator_fields.join_operator.pos_vec1);
+        result_materialize_positions(query->operator_fields.join_operator.val_vec2);
+        result_materialize_positions(query->operator_fields.join_operator.pos_vec2);
+    }
+}
+
+void decode_column_handle(GCHandle* gch){
+    if(gch != NULL && gch->type == COLUMN){
+        column_decode(gch->p.column);
+    }
+}
+
+void decode_table_columns(Table* table){
+    for(size_t i=0;i<table->col_count;i++){
+        column_decode(&table->columns[i]);
+    }
+}
+
+/**
+ * encoded columns are read in their encoded form by full scans, fetches, single value
+ * sum, avg, min and max and aggregates() (see compress.h). Every other operator reads column->data, and every
+ * change to a table rewrites it, so their columns are decoded here once and for all.
+ **/
+void decode_column_operands(DbOperator* query){
+    if(query->type == INSERT){
+        decode_table_columns(query->operator_fields.insert_operator.table);
+    }else if(query->type == DELETE){
+        decode_table_columns(query->operator_fields.delete_operator.table);
+    }else if(query->type == UPDATE){
+        decode_table_columns(query->operator_fields.update_operator.table);
+    }else if(query->type == LOAD){
+        decode_table_columns(query->operator_fields.load_operator.table);
+    }else if(query->type == CREATE && query->operator_fields.create_operator.create_type == _IDX){
+        column_decode(query->operator_fields.create_operator.column);
+    }else if(query->type == SELECT){
+        //shared scans read the data of the column
+        if(batch_mode && query->operator_fields.select_operator.predicate_num == 1){
+            decode_column_handle(query->operator_fields.select_operator.gch1);
+        }
+        decode_column_handle(query->operator_fields.select_operator.gch2);
+    }else if(query->type == AGGREGATE){
+        AggregateType t = query->operator_fields.aggregate_operator.type;
+        if(!(query->client_variables_num == 1 && query->operator_fields.aggregate_operator.gch2 == NULL
+             && (t == SUM || t == AVG || t == MIN || t == MAX))){
+            decode_column_handle(query->operator_fields.aggregate_operator.gch1);
+            decode_column_handle(query->operator_fields.aggregate_operator.gch2);
+        }
+    }else if(query->type == GROUP_AGGREGATE){
+        decode_column_handle(query->operator_fields.group_aggregate_operator.gch1);
+        decode_column_handle(query->operator_fields.group_aggregate_operator.gch2);
+    }else if(query->type == SORT){
+        decode_column_handle(query->operator_fields.sort_operator.gch1);
+        decode_column_handle(query->operator_fields.sort_operator.gch2);
+    }else if(query->type == EXPRESSION){
+        for(size_t i=0;i<query->operator_fields.expr_operator.program->gch_num;i++){
+            decode_column_handle(query->operator_fields.expr_operator.program->gchs[i]);
+        }
+    }else if(query->type == PRINT){
+        for(size_t i=0;i<query->operator_fields.print_operator.gch_count;i++){
+            decode_column_handle(query->operator_fields.print_operator.gch_list[i]);
+        }
+    }
+}
+
 void execute_DbOperator(DbOperator* query, message* send_message) {
     cs165_log(stdout, "Query parsed. Executing the query...\n");
-    if(batch_mode){
-        if(query->type == BATCH_MODE_BEGIN){
-            batch_size++;
-            batched_queries=realloc(batched_queries, batch_size*sizeof(DbOperator*));
-            batched_queries[batch_size-1]=query;
-        }else if(query->type == BATCH_MODE_EXECUTE){
-            execute_batched_queries(send_message);
-            free_query(query);
-        }
+    if(query->type == BATCH_MODE_BEGIN){
+        batch_mode=1;
+        send_message->status = OK_DONE;
+        free_query(query);
+        return;
+    }else if(query->type == BATCH_MODE_EXECUTE){
+        execute_batched_queries(send_message);
+        free_query(query);
+        return;
+    }
+    materialize_deferred_operands(query);
+    materialize_bitmap_operands(query);
+    decode_column_operands(query);
+    if(batch_mode && query->type == SELECT && query->operator_fields.select_operator.predicate_num == 1){
+        //single column selects wait for batch_execute() to share scans, every other query runs right away
+        batch_size++;
+        batched_queries=realloc(batched_queries, batch_size*sizeof(DbOperator*));
+        batched_queries[batch_size-1]=query;
+        send_message->status = OK_DONE;
     }else{
         if(query->type == CREATE){
             execute_create_operator(query, send_message);
@@ -1830,6 +2388,16 @@ void execute_DbOperator(DbOperator* query, message* send_message) {
             execute_fetch_operator(query, send_message);
         }else if(query->type == AGGREGATE){
             execute_aggregate_operator(query, send_message);
+        }else if(query->type == MULTI_AGGREGATE){
+            execute_multi_aggregate_operator(query, send_message);
+        }else if(query->type == GROUP_AGGREGATE){
+            execute_group_aggregate_operator(query, send_message);
+        }else if(query->type == SORT){
+            execute_sort_operator(query, send_message);
+        }else if(query->type == EXPRESSION){
+            execute_expression_operator(query, send_message);
+        }else if(query->type == APPROX_AGGREGATE){
+            execute_approx_operator(query, send_message);
         }else if(query->type == JOIN){
             execute_join_operator(query, send_message);
         }else if (query->type == DELETE){
@@ -1842,6 +2410,8 @@ void execute_DbOperator(DbOperator* query, message* send_message) {
             execute_load_operator(query, send_message);
         }else if(query->type == SHUTDOWN){
             shutdown_server(send_message);
+        }else if(query->type == STATS){
+            execute_stats_operator(query, send_message);
         }
         free_query(query);
         return;
@@ -1910,9 +2480,15 @@ int handle_client(int client_socket) {
             // 2. Handle request
             //    Corresponding database operator is executed over the query
             char* result = "";
+            //operators answering with text (stats) leave it in the payload
+            send_message.payload = NULL;
             if(query != NULL){
                 execute_DbOperator(query, &send_message);
             }
+            char* response = send_message.payload;
+            if(response != NULL){
+                result = response;
+            }
 
             send_message.length = strlen(result);
             char send_buffer[send_message.length + 1];
@@ -1926,10 +2502,12 @@ int handle_client(int client_socket) {
             }
 
             // 4. Send response to the request
-            if (send(client_socket, result, send_message.length, 0) == -1) {
+            //    the client does not read an empty payload and may already be gone
+            if (send_message.length > 0 && send(client_socket, result, send_message.length, 0) == -1) {
                 log_err("Failed to send message.");
                 exit(1);
             }
+            free(response);
         }
     } while (!done);
     
@@ -1993,15 +2571,10 @@ BTreeNode* load_btree_recursive(FILE* fd, BTreeNode*** leaf_vec, size_t* leaf_ve
         fread(root->core_node.lnode.pos_vec, sizeof(int), root->key_count, fd);
         root->core_node.lnode.pre = NULL;
         root->core_node.lnode.next = NULL;
-        if(leaf_vec == NULL){
-            *leaf_vec = malloc(1 * sizeof(BTreeNode*));
-            *leaf_vec[0] = root;
-            *leaf_vec_size = 1;
-        }else{
-            *leaf_vec = realloc(*leaf_vec, (*leaf_vec_size+1) * sizeof(BTreeNode*));
-            *leaf_vec[*leaf_vec_size] = root;
-            *leaf_vec_size += 1;
-        }
+        //realloc of NULL is a malloc, for the first leaf
+        *leaf_vec = realloc(*leaf_vec, (*leaf_vec_size+1) * sizeof(BTreeNode*));
+        (*leaf_vec)[*leaf_vec_size] = root;
+        *leaf_vec_size += 1;
         return root;
     }else{
         fread(root->core_node.inode.keys, sizeof(int), root->key_count, fd);
@@ -2051,6 +2624,7 @@ void load_db(){
         table = &(current_db->tables[i]);
         //load table meta data
         fread(table, sizeof(Table), 1, fd);
+        sample_load(fd, &table->sample);
         insert_context(db_catalog, table->name, (void*) table, TABLE);
         table->columns = malloc(table->col_capacity * sizeof(Column));
         columns_count = table->col_count;
@@ -2058,9 +2632,7 @@ void load_db(){
             column = &(table->columns[j]);
             //load column meta data
             fread(column, sizeof(Column), 1, fd);
-            column->data = malloc(table->table_length_capacity * sizeof(int));
-            fread(column->data, sizeof(int), column->size, fd);
-            //load column index
+            //load column index, dumped before the data
             if(column->it == BTREE_CLUSTERED || column->it == BTREE_UNCLUSTERED){
                 column->index_file = load_btree(fd);
             }else if(column->it == SORTED_UNCLUSTERED){
@@ -2070,7 +2642,42 @@ void load_db(){
                 fread(ci->key_vec, sizeof(int), column->size, fd);
                 fread(ci->pos_vec, sizeof(int), column->size, fd);
                 column->index_file = (void*) ci;
+            }else if(column->it == CRACKED){
+                CrackerIndex* cracker = cracker_create(table->table_length_capacity);
+                cracker->size = column->size;
+                fread(cracker->key_vec, sizeof(int), column->size, fd);
+                fread(cracker->pos_vec, sizeof(int), column->size, fd);
+                fread(&cracker->crack_num, sizeof(size_t), 1, fd);
+                cracker->crack_capacity = cracker->crack_num;
+                cracker->crack_keys = malloc((cracker->crack_num > 0 ? cracker->crack_num : 1) * sizeof(int));
+                cracker->crack_pos = malloc((cracker->crack_num > 0 ? cracker->crack_num : 1) * sizeof(size_t));
+                fread(cracker->crack_keys, sizeof(int), cracker->crack_num, fd);
+                fread(cracker->crack_pos, sizeof(size_t), cracker->crack_num, fd);
+                column->index_file = (void*) cracker;
+            }else if(column->it == IMPRINTS){
+                ImprintIndex* ii = malloc(sizeof(ImprintIndex));
+                fread(ii, sizeof(ImprintIndex), 1, fd);
+                ii->imprint_capacity = ii->imprint_num > 0 ? ii->imprint_num : 1;
+                ii->dict_capacity = ii->dict_num > 0 ? ii->dict_num : 1;
+                ii->imprints = malloc(ii->imprint_capacity * sizeof(uint64_t));
+                ii->dict = malloc(ii->dict_capacity * sizeof(uint32_t));
+                fread(ii->imprints, sizeof(uint64_t), ii->imprint_num, fd);
+                fread(ii->dict, sizeof(uint32_t), ii->dict_num, fd);
+                column->index_file = (void*) ii;
             }
+            if(column->encoding != PLAIN){
+                encoded_load(fd, column);
+                column->data = NULL;
+            }else{
+                column->encoded = NULL;
+                column->data = malloc(table->table_length_capacity * sizeof(int));
+                fread(column->data, sizeof(int), column->size, fd);
+            }
+            //load zone map
+            zone_map_init(&column->zone_map, table->table_length_capacity);
+            fread(&column->zone_map.zone_num, sizeof(size_t), 1, fd);
+            fread(column->zone_map.min_vec, sizeof(int), column->zone_map.zone_num, fd);
+            fread(column->zone_map.max_vec, sizeof(int), column->zone_map.zone_num, fd);
             GCHandle* gch = malloc(sizeof(GCHandle));
             gch->p.column = column;
             strcpy(gch->name, column->name);
@@ -2110,14 +2717,17 @@ void dump_db(Db* db, message* msg){
     Column* column;
     BTreeNode* root;
     ColumnIndex* ci;
+    CrackerIndex* cracker;
+    ImprintIndex* ii;
     for(size_t i=0;i<tables_size;i++){
         table = &(db->tables[i]);
         //metadata for this table
         fwrite(table, sizeof(Table), 1, fd);
+        sample_dump(fd, &table->sample);
         columns_num = table->col_count;
         for(size_t j=0;j<columns_num;j++){
             column = &(table->columns[j]);
-            //metadata for this column
+            //metadata for this column, statistics included
             fwrite(column, sizeof(Column), 1, fd);
             if(column->it == BTREE_CLUSTERED || column->it == BTREE_UNCLUSTERED){
                 root = (BTreeNode*) column->index_file;
@@ -2129,10 +2739,35 @@ void dump_db(Db* db, message* msg){
                 free(ci->key_vec);
                 free(ci->pos_vec);
                 free(ci);
+            }else if(column->it == CRACKED){
+                //the reorganized copy and its cracks, so that a restart does not lose what the selects did
+                cracker = (CrackerIndex*) column->index_file;
+                fwrite(cracker->key_vec, sizeof(int), cracker->size, fd);
+                fwrite(cracker->pos_vec, sizeof(int), cracker->size, fd);
+                fwrite(&cracker->crack_num, sizeof(size_t), 1, fd);
+                fwrite(cracker->crack_keys, sizeof(int), cracker->crack_num, fd);
+                fwrite(cracker->crack_pos, sizeof(size_t), cracker->crack_num, fd);
+                cracker_free(cracker);
+            }else if(column->it == IMPRINTS){
+                ii = (ImprintIndex*) column->index_file;
+                fwrite(ii, sizeof(ImprintIndex), 1, fd);
+                fwrite(ii->imprints, sizeof(uint64_t), ii->imprint_num, fd);
+                fwrite(ii->dict, sizeof(uint32_t), ii->dict_num, fd);
+                imprints_free(ii);
+            }
+            //stored data in this column, encoded columns stay encoded on disk
+            if(column->encoding != PLAIN){
+                encoded_dump(fd, column);
+                encoded_free(column->encoded);
+            }else{
+                fwrite(column->data, sizeof(int), column->size, fd);
+                free(column->data);
             }
-            //stored data in this column
-            fwrite(column->data, sizeof(int), column->size, fd);
-            free(column->data);
+            //zone map of the data
+            fwrite(&column->zone_map.zone_num, sizeof(size_t), 1, fd);
+            fwrite(column->zone_map.min_vec, sizeof(int), column->zone_map.zone_num, fd);
+            fwrite(column->zone_map.max_vec, sizeof(int), column->zone_map.zone_num, fd);
+            zone_map_free(&column->zone_map);
         }
         free(table->columns);
     }
@@ -2164,14 +2799,19 @@ void shutdown_server(message* msg){
 //      What aspects of siloes or isolation are maintained in your design? (Think `what` is shared between `whom`?)
 int main(void)
 {
+    scan_init();
+    log_info("Using %s scan kernel\n", scan_kernel_name(scan_current_kernel()));
+    threadpool_init(0);
+    log_info("Using a pool of %zd threads\n", threadpool_size());
     load_db();
+    //one listening socket for all clients, a client connecting while the previous one
+    //is served waits in its backlog
+    int server_socket = setup_server();
+    if (server_socket < 0) {
+        exit(1);
+    }
     int done = 0;
     while(!done){
-        int server_socket = setup_server();
-        if (server_socket < 0) {
-            exit(1);
-        }
-
         log_info("Waiting for a connection %d ...\n", server_socket);
 
         struct sockaddr_un remote;
@@ -2183,8 +2823,10 @@ int main(void)
             exit(1);
         }
 
-        handle_client(client_socket);
+        done = handle_client(client_socket);
     }
+    close(server_socket);
+    threadpool_shutdown();
     return 0;
 }
 
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include "cs165_api.h"
+#include "shared_scan.h"
+
+static int compare_long(const void* a, const void* b){
+    long l = *(const long*) a;
+    long r = *(const long*) b;
+    return (l > r) - (l < r);
+}
+
+//index of bound in bounds, which must contain it
+static size_t bound_index(long* bounds, size_t bound_num, long bound){
+    size_t lo = 0;
+    size_t hi = bound_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(bounds[mid] < bound){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//elementary intervals [first, last) covered by the predicate comp
+static void covered_intervals(PredicateIndex* pi, Comparator* comp, size_t* first, size_t* last){
+    *first = comp->ct1 == NO_COMPARISON ? 0 : bound_index(pi->bounds, pi->bound_num, comp->lowerbound) + 1;
+    *last = comp->ct2 == NO_COMPARISON ? pi->bound_num + 1 : bound_index(pi->bounds, pi->bound_num, comp->upperbound) + 1;
+    if(*last < *first){
+        *last = *first;
+    }
+}
+
+PredicateIndex* predicate_index_build(Comparator* comps, size_t query_num){
+    PredicateIndex* pi = malloc(sizeof(PredicateIndex));
+    pi->bounds = malloc((2 * query_num + 1) * sizeof(long));
+    pi->bound_num = 0;
+    for(size_t q=0;q<query_num;q++){
+        if(comps[q].ct1 != NO_COMPARISON){
+            pi->bounds[pi->bound_num++] = comps[q].lowerbound;
+        }
+        if(comps[q].ct2 != NO_COMPARISON){
+            pi->bounds[pi->bound_num++] = comps[q].upperbound;
+        }
+    }
+    qsort(pi->bounds, pi->bound_num, sizeof(long), compare_long);
+    size_t distinct = 0;
+    for(size_t i=0;i<pi->bound_num;i++){
+        if(distinct == 0 || pi->bounds[distinct-1] != pi->bounds[i]){
+            pi->bounds[distinct++] = pi->bounds[i];
+        }
+    }
+    pi->bound_num = distinct;
+
+    //count the queries of every interval, then lay the lists out one after the other
+    size_t interval_num = pi->bound_num + 1;
+    size_t first, last, entries = 0;
+    pi->offsets = calloc(interval_num + 1, sizeof(size_t));
+    for(size_t q=0;q<query_num;q++){
+        covered_intervals(pi, &comps[q], &first, &last);
+        for(size_t k=first;k<last;k++){
+            pi->offsets[k+1]++;
+        }
+        entries += last - first;
+        if(entries > PREDICATE_INDEX_MAX_ENTRIES){
+            free(pi->offsets);
+            free(pi->bounds);
+            free(pi);
+            return NULL;
+        }
+    }
+    for(size_t k=0;k<interval_num;k++){
+        pi->offsets[k+1] += pi->offsets[k];
+    }
+    pi->query_lists = malloc((entries > 0 ? entries : 1) * sizeof(int));
+    size_t* fill = malloc(interval_num * sizeof(size_t));
+    for(size_t k=0;k<interval_num;k++){
+        fill[k] = pi->offsets[k];
+    }
+    for(size_t q=0;q<query_num;q++){
+        covered_intervals(pi, &comps[q], &first, &last);
+        for(size_t k=first;k<last;k++){
+            pi->query_lists[fill[k]++] = (int) q;
+        }
+    }
+    free(fill);
+    return pi;
+}
+
+void predicate_index_free(PredicateIndex* pi){
+    if(pi == NULL){
+        return;
+    }
+    free(pi->bounds);
+    free(pi->offsets);
+    free(pi->query_lists);
+    free(pi);
+}
+
+/**
+ * interval of target: the number of bounds <= target.
+ * the comparisons are those of the predicates, so a FLOAT target sees the bounds as doubles.
+ **/
+static size_t interval_of_int(long* bounds, size_t bound_num, int target){
+    size_t lo = 0;
+    size_t hi = bound_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(bounds[mid] <= target){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static size_t interval_of_long(long* bounds, size_t bound_num, long target){
+    size_t lo = 0;
+    size_t hi = bound_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(bounds[mid] <= target){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static size_t interval_of_double(long* bounds, size_t bound_num, double target){
+    size_t lo = 0;
+    size_t hi = bound_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(bounds[mid] <= target){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void shared_scan_indexed(void* val_payload, int* pos_vec, DataType dt, size_t start, size_t end,
+                                PredicateIndex* pi, int** results, size_t* results_count){
+    size_t k;
+    int pos, q;
+    if(dt == INT){
+        int* val_vec = (int*) val_payload;
+        for(size_t i=start;i<end;i++){
+            k = interval_of_int(pi->bounds, pi->bound_num, val_vec[i]);
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t j=pi->offsets[k];j<pi->offsets[k+1];j++){
+                q = pi->query_lists[j];
+                results[q][results_count[q]++] = pos;
+            }
+        }
+    }else if(dt == LONG){
+        long* val_vec = (long*) val_payload;
+        for(size_t i=start;i<end;i++){
+            k = interval_of_long(pi->bounds, pi->bound_num, val_vec[i]);
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t j=pi->offsets[k];j<pi->offsets[k+1];j++){
+                q = pi->query_lists[j];
+                results[q][results_count[q]++] = pos;
+            }
+        }
+    }else if(dt == FLOAT){
+        double* val_vec = (double*) val_payload;
+        for(size_t i=start;i<end;i++){
+            k = interval_of_double(pi->bounds, pi->bound_num, val_vec[i]);
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t j=pi->offsets[k];j<pi->offsets[k+1];j++){
+                q = pi->query_lists[j];
+                results[q][results_count[q]++] = pos;
+            }
+        }
+    }
+}
+
+static void shared_scan_loop(void* val_payload, int* pos_vec, DataType dt, size_t start, size_t end,
+                             Comparator* comps, size_t query_num, int** results, size_t* results_count){
+    int pos;
+    if(dt == INT){
+        int* val_vec = (int*) val_payload;
+        int target;
+        for(size_t i=start;i<end;i++){
+            target = val_vec[i];
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t q=0;q<query_num;q++){
+                results[q][results_count[q]] = pos;
+                results_count[q] += (comps[q].ct1 == NO_COMPARISON || comps[q].lowerbound <= target) && (comps[q].ct2 == NO_COMPARISON || comps[q].upperbound > target);
+            }
+        }
+    }else if(dt == LONG){
+        long* val_vec = (long*) val_payload;
+        long target;
+        for(size_t i=start;i<end;i++){
+            target = val_vec[i];
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t q=0;q<query_num;q++){
+                results[q][results_count[q]] = pos;
+                results_count[q] += (comps[q].ct1 == NO_COMPARISON || comps[q].lowerbound <= target) && (comps[q].ct2 == NO_COMPARISON || comps[q].upperbound > target);
+            }
+        }
+    }else if(dt == FLOAT){
+        double* val_vec = (double*) val_payload;
+        double target;
+        for(size_t i=start;i<end;i++){
+            target = val_vec[i];
+            pos = pos_vec == NULL ? (int) i : pos_vec[i];
+            for(size_t q=0;q<query_num;q++){
+                results[q][results_count[q]] = pos;
+                results_count[q] += (comps[q].ct1 == NO_COMPARISON || comps[q].lowerbound <= target) && (comps[q].ct2 == NO_COMPARISON || comps[q].upperbound > target);
+            }
+        }
+    }
+}
+
+void shared_scan(void* val_payload, int* pos_vec, DataType dt, size_t start, size_t end,
+                 Comparator* comps, size_t query_num, PredicateIndex* pi, int** results, size_t* results_count){
+    for(size_t q=0;q<query_num;q++){
+        results_count[q] = 0;
+    }
+    if(pi != NULL){
+        shared_scan_indexed(val_payload, pos_vec, dt, start, end, pi, results, results_count);
+    }else{
+        shared_scan_loop(val_payload, pos_vec, dt, start, end, comps, query_num, results, results_count);
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * shared_scan_benchmark.c
+ *
+ * Microbenchmark for the shared scan kernels in shared_scan.c.
+ * Reports the time per tuple of the loop kernel and of the indexed kernel for a sweep
+ * of batch sizes, for selective predicates and for the wide predicates generated by
+ * experiments.py (generate_scan_script), and the batch size from which the indexed
+ * kernel is faster. The vector is scanned one morsel at a time as batch_execute() does.
+ *
+ * Usage: make shared_scan_benchmark; ./shared_scan_benchmark [tuples_num]
+ **/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cs165_api.h"
+#include "morsel.h"
+#include "shared_scan.h"
+
+#define DEFAULT_TUPLES_NUM 1000000
+#define VALUE_RANGE 50000
+#define MAX_QUERY_NUM 1024
+#define REPEAT 3
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//best of REPEAT runs, in seconds
+static double time_shared_scan(int* val_vec, size_t tuples_num, Comparator* comps, size_t query_num, PredicateIndex* pi,
+                               int** results, size_t* results_count){
+    double best = -1;
+    double begin, elapsed;
+    for(int r=0;r<REPEAT;r++){
+        begin = now();
+        for(size_t start=0;start<tuples_num;start+=MORSEL_SIZE){
+            size_t end = start + MORSEL_SIZE < tuples_num ? start + MORSEL_SIZE : tuples_num;
+            shared_scan(val_vec, NULL, INT, start, end, comps, query_num, pi, results, results_count);
+        }
+        elapsed = now() - begin;
+        if(best < 0 || elapsed < best){
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+//selective: every query keeps about 1% of the values
+static void generate_selective(Comparator* comps, size_t query_num){
+    for(size_t q=0;q<query_num;q++){
+        comps[q].ct1 = GREATER_THAN_OR_EQUAL;
+        comps[q].ct2 = LESS_THAN;
+        comps[q].lowerbound = rand() % VALUE_RANGE;
+        comps[q].upperbound = comps[q].lowerbound + VALUE_RANGE / 100;
+    }
+}
+
+//wide: the ranges of generate_scan_script in experiments.py, 80% to 99% of the values
+static void generate_wide(Comparator* comps, size_t query_num){
+    for(size_t q=0;q<query_num;q++){
+        comps[q].ct1 = GREATER_THAN_OR_EQUAL;
+        comps[q].ct2 = LESS_THAN;
+        comps[q].lowerbound = rand() % 201;
+        comps[q].upperbound = VALUE_RANGE - 10000 + rand() % 10001;
+    }
+}
+
+int main(int argc, char** argv){
+    size_t tuples_num = DEFAULT_TUPLES_NUM;
+    if(argc > 1){
+        tuples_num = strtoul(argv[1], NULL, 10);
+    }
+    srand(42);
+    int* val_vec = malloc(tuples_num * sizeof(int));
+    for(size_t i=0;i<tuples_num;i++){
+        val_vec[i] = rand() % VALUE_RANGE;
+    }
+    Comparator* comps = malloc(MAX_QUERY_NUM * sizeof(Comparator));
+    int** results = malloc(MAX_QUERY_NUM * sizeof(int*));
+    size_t* results_count = malloc(MAX_QUERY_NUM * sizeof(size_t));
+    for(size_t q=0;q<MAX_QUERY_NUM;q++){
+        results[q] = malloc(MORSEL_SIZE * sizeof(int));
+    }
+    const char* workload_name[] = {"selective", "wide"};
+    printf("tuples: %zu, index used from %d queries\n", tuples_num, SHARED_SCAN_INDEX_MIN_QUERIES);
+    printf("%-10s %-8s %-14s %-14s %-8s\n", "workload", "queries", "loop ns/tuple", "index ns/tuple", "speedup");
+    for(int w=0;w<2;w++){
+        size_t crossover = 0;
+        for(size_t query_num=1;query_num<=MAX_QUERY_NUM;query_num*=2){
+            if(w == 0){
+                generate_selective(comps, query_num);
+            }else{
+                generate_wide(comps, query_num);
+            }
+            PredicateIndex* pi = predicate_index_build(comps, query_num);
+            double loop_seconds = time_shared_scan(val_vec, tuples_num, comps, query_num, NULL, results, results_count);
+            double index_seconds = time_shared_scan(val_vec, tuples_num, comps, query_num, pi, results, results_count);
+            predicate_index_free(pi);
+            if(crossover == 0 && index_seconds < loop_seconds){
+                crossover = query_num;
+            }
+            printf("%-10s %-8zu %-14.2f %-14.2f %-8.2f\n", workload_name[w], query_num,
+                   loop_seconds / tuples_num * 1e9, index_seconds / tuples_num * 1e9, loop_seconds / index_seconds);
+        }
+        if(crossover > 0){
+            printf("%s: indexed kernel faster from %zu queries\n", workload_name[w], crossover);
+        }else{
+            printf("%s: indexed kernel never faster\n", workload_name[w]);
+        }
+    }
+    for(size_t q=0;q<MAX_QUERY_NUM;q++){
+        free(results[q]);
+    }
+    free(results);
+    free(results_count);
+    free(comps);
+    free(val_vec);
+    return 0;
+}
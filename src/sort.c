@@ -0,0 +1,279 @@
+#include <string.h>
+#include "cs165_api.h"
+#include "sort.h"
+#include "morsel.h"
+#include "utils.h"
+
+#define SIGN_BIT (UINT64_C(1) << 63)
+
+/*
+ * a tuple being sorted: the key of its value and its index in the input
+ */
+typedef struct SortItem {
+    uint64_t key;
+    int idx;
+} SortItem;
+
+typedef struct SortMorselArgs {
+    void* val_payload;
+    DataType dt;
+    //xored into the keys, all their bits to sort in descending order
+    uint64_t flip;
+    unsigned int shift;
+    size_t* counts;
+    SortItem* from;
+    SortItem* to;
+    void* res_vals;
+    int* res_idx;
+    //topk heaps, k items per morsel
+    size_t k;
+    SortItem* heaps;
+    size_t* heap_sizes;
+} SortMorselArgs;
+
+//unsigned key in the order of the value
+static inline uint64_t sort_key(void* val_payload, DataType dt, size_t i){
+    if(dt == INT){
+        return (uint64_t) ((uint32_t) ((int*) val_payload)[i] ^ UINT32_C(0x80000000));
+    }else if(dt == FLOAT){
+        uint64_t bits;
+        memcpy(&bits, &((double*) val_payload)[i], sizeof(bits));
+        //negative doubles grow as their bits shrink
+        return bits & SIGN_BIT ? ~bits : bits | SIGN_BIT;
+    }
+    return (uint64_t) ((long*) val_payload)[i] ^ SIGN_BIT;
+}
+
+static inline void store_value(void* res_vals, DataType dt, size_t i, uint64_t key){
+    if(dt == INT){
+        ((int*) res_vals)[i] = (int) (uint32_t) (key ^ UINT32_C(0x80000000));
+    }else if(dt == FLOAT){
+        uint64_t bits = key & SIGN_BIT ? key ^ SIGN_BIT : ~key;
+        memcpy(&((double*) res_vals)[i], &bits, sizeof(bits));
+    }else{
+        ((long*) res_vals)[i] = (long) (key ^ SIGN_BIT);
+    }
+}
+
+static inline unsigned int key_bits(DataType dt){
+    return dt == INT ? 32 : 64;
+}
+
+static inline uint64_t descending_flip(DataType dt){
+    return dt == INT ? UINT64_C(0xFFFFFFFF) : ~UINT64_C(0);
+}
+
+static inline int item_less(const SortItem* a, const SortItem* b){
+    return a->key < b->key || (a->key == b->key && a->idx < b->idx);
+}
+
+static void fill_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    SortMorselArgs* args = (SortMorselArgs*) a;
+    for(size_t i=start;i<end;i++){
+        args->from[i].key = sort_key(args->val_payload, args->dt, i) ^ args->flip;
+        args->from[i].idx = (int) i;
+    }
+}
+
+static void histogram_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    SortMorselArgs* args = (SortMorselArgs*) a;
+    size_t* counts = args->counts + morsel_id * 256;
+    SortItem* from = args->from;
+    unsigned int shift = args->shift;
+    for(size_t i=start;i<end;i++){
+        counts[(from[i].key >> shift) & 255]++;
+    }
+}
+
+//counts hold the offset of the slice of every digit the morsel writes to
+static void scatter_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    SortMorselArgs* args = (SortMorselArgs*) a;
+    size_t* offsets = args->counts + morsel_id * 256;
+    SortItem* from = args->from;
+    SortItem* to = args->to;
+    unsigned int shift = args->shift;
+    for(size_t i=start;i<end;i++){
+        to[offsets[(from[i].key >> shift) & 255]++] = from[i];
+    }
+}
+
+static void output_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    (void) morsel_id;
+    SortMorselArgs* args = (SortMorselArgs*) a;
+    for(size_t i=start;i<end;i++){
+        store_value(args->res_vals, args->dt, i, args->from[i].key ^ args->flip);
+        args->res_idx[i] = args->from[i].idx;
+    }
+}
+
+//sorts the first res_num items by (key ^ flip, index) into res_vals and res_idx
+static void radix_sort(SortMorselArgs* args, size_t tuples_num, size_t res_num){
+    size_t morsel_num = morsel_count(tuples_num);
+    SortItem* items = malloc(tuples_num * sizeof(SortItem));
+    SortItem* tmp = malloc(tuples_num * sizeof(SortItem));
+    args->from = items;
+    args->to = tmp;
+    morsel_run(tuples_num, fill_morsel, args);
+    args->counts = malloc(morsel_num * 256 * sizeof(size_t));
+    SortItem* swap;
+    size_t offset, count, total;
+    int skip;
+    for(unsigned int shift=0;shift<key_bits(args->dt);shift+=8){
+        args->shift = shift;
+        memset(args->counts, 0, morsel_num * 256 * sizeof(size_t));
+        morsel_run(tuples_num, histogram_morsel, args);
+        //digit by digit, the slices of the morsels in morsel order
+        offset = 0;
+        skip = 0;
+        for(size_t d=0;d<256;d++){
+            total = 0;
+            for(size_t m=0;m<morsel_num;m++){
+                count = args->counts[m * 256 + d];
+                args->counts[m * 256 + d] = offset;
+                offset += count;
+                total += count;
+            }
+            //all the keys share this digit, the pass would not move them
+            skip |= total == tuples_num;
+        }
+        if(skip){
+            continue;
+        }
+        morsel_run(tuples_num, scatter_morsel, args);
+        swap = args->from;
+        args->from = args->to;
+        args->to = swap;
+    }
+    free(args->counts);
+    morsel_run(res_num, output_morsel, args);
+    free(items);
+    free(tmp);
+}
+
+void sort_vector(void* val_payload, DataType dt, size_t tuples_num, void* res_vals, int* res_idx){
+    if(tuples_num == 0){
+        return;
+    }
+    SortMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.flip = 0;
+    args.res_vals = res_vals;
+    args.res_idx = res_idx;
+    radix_sort(&args, tuples_num, tuples_num);
+}
+
+/*
+ * topk heaps keep the k items first in (key, index) order, the last of them at the root
+ */
+static void heap_sift_up(SortItem* heap, size_t i){
+    SortItem item = heap[i];
+    size_t parent;
+    while(i > 0){
+        parent = (i - 1) / 2;
+        if(!item_less(&heap[parent], &item)){
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = item;
+}
+
+static void heap_replace_root(SortItem* heap, size_t size, SortItem item){
+    size_t i = 0;
+    size_t child;
+    while((child = 2 * i + 1) < size){
+        if(child + 1 < size && item_less(&heap[child], &heap[child+1])){
+            child++;
+        }
+        if(!item_less(&item, &heap[child])){
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+}
+
+//adds item to the heap of size items out of k, returns the new size
+static inline size_t heap_offer(SortItem* heap, size_t size, size_t k, SortItem item){
+    if(size < k){
+        heap[size] = item;
+        heap_sift_up(heap, size);
+        return size + 1;
+    }
+    if(item_less(&item, &heap[0])){
+        heap_replace_root(heap, size, item);
+    }
+    return size;
+}
+
+static void topk_morsel(size_t morsel_id, size_t start, size_t end, void* a){
+    SortMorselArgs* args = (SortMorselArgs*) a;
+    SortItem* heap = args->heaps + morsel_id * args->k;
+    size_t size = 0;
+    SortItem item;
+    size_t i = start;
+    for(;i<end && size<args->k;i++){
+        item.key = sort_key(args->val_payload, args->dt, i) ^ args->flip;
+        item.idx = (int) i;
+        size = heap_offer(heap, size, args->k, item);
+    }
+    //the indices grow, so a key equal to the root's comes after it: only smaller keys get in
+    for(;i<end;i++){
+        item.key = sort_key(args->val_payload, args->dt, i) ^ args->flip;
+        if(item.key < heap[0].key){
+            item.idx = (int) i;
+            heap_replace_root(heap, size, item);
+        }
+    }
+    args->heap_sizes[morsel_id] = size;
+}
+
+static int compare_item(const void* a, const void* b){
+    const SortItem* x = (const SortItem*) a;
+    const SortItem* y = (const SortItem*) b;
+    return item_less(x, y) ? -1 : item_less(y, x);
+}
+
+size_t topk_vector(void* val_payload, DataType dt, size_t tuples_num, size_t k, void* res_vals, int* res_idx){
+    k = k < tuples_num ? k : tuples_num;
+    if(k == 0){
+        return 0;
+    }
+    SortMorselArgs args;
+    args.val_payload = val_payload;
+    args.dt = dt;
+    args.flip = descending_flip(dt);
+    args.res_vals = res_vals;
+    args.res_idx = res_idx;
+    args.k = k;
+    if(k > TOPK_HEAP_MAX || k > tuples_num / TOPK_HEAP_FRACTION){
+        cs165_log(stdout, "topk: %zu of %zu tuples, radix sort\n", k, tuples_num);
+        radix_sort(&args, tuples_num, k);
+        return k;
+    }
+    cs165_log(stdout, "topk: %zu of %zu tuples, heaps\n", k, tuples_num);
+    size_t morsel_num = morsel_count(tuples_num);
+    args.heaps = malloc(morsel_num * k * sizeof(SortItem));
+    args.heap_sizes = malloc(morsel_num * sizeof(size_t));
+    morsel_run(tuples_num, topk_morsel, &args);
+    //the heaps of the morsels are merged into the first one
+    SortItem* heap = args.heaps;
+    size_t size = args.heap_sizes[0];
+    for(size_t m=1;m<morsel_num;m++){
+        for(size_t i=0;i<args.heap_sizes[m];i++){
+            size = heap_offer(heap, size, k, args.heaps[m * k + i]);
+        }
+    }
+    qsort(heap, size, sizeof(SortItem), compare_item);
+    for(size_t i=0;i<size;i++){
+        store_value(res_vals, dt, i, heap[i].key ^ args.flip);
+        res_idx[i] = heap[i].idx;
+    }
+    free(args.heaps);
+    free(args.heap_sizes);
+    return size;
+}
@@ -0,0 +1,214 @@
+#include <math.h>
+#include <string.h>
+#include "cs165_api.h"
+#include "morsel.h"
+#include "stats.h"
+
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+
+static int compare_int(const void* a, const void* b){
+    int l = *(const int*) a;
+    int r = *(const int*) b;
+    return (l > r) - (l < r);
+}
+
+//splitmix64 finalizer, spreads consecutive keys over all registers
+static uint64_t hll_hash(int value){
+    uint64_t h = (uint64_t) (uint32_t) value + UINT64_C(0x9e3779b97f4a7c15);
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return h ^ (h >> 31);
+}
+
+//the first bits of the hash pick a register, which keeps the longest run of leading zeros of the others
+static void hll_add(uint8_t* hll, int value){
+    uint64_t h = hll_hash(value);
+    size_t reg = h >> (64 - HLL_PRECISION);
+    uint64_t rest = h << HLL_PRECISION;
+    uint8_t rank = rest == 0 ? 64 - HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+    if(rank > hll[reg]){
+        hll[reg] = rank;
+    }
+}
+
+//bucket of value: the last bucket whose lower bound is <= value, values below every bound go to bucket 0
+static size_t bucket_of(ColumnStats* stats, int value){
+    size_t lo = 0;
+    size_t hi = stats->bucket_num;
+    size_t mid;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(stats->bounds[mid] <= value){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+void stats_init(ColumnStats* stats){
+    memset(stats, 0, sizeof(ColumnStats));
+}
+
+typedef struct StatsBuildArgs {
+    ColumnStats* stats;
+    int* data;
+    //per morsel: HISTOGRAM_BUCKETS counts, HLL_REGISTERS registers, min and max
+    size_t* counts;
+    uint8_t* hll;
+    int* mins;
+    int* maxs;
+} StatsBuildArgs;
+
+static void stats_build_morsel(size_t morsel_id, size_t start, size_t end, void* args){
+    StatsBuildArgs* build = (StatsBuildArgs*) args;
+    size_t* counts = build->counts + morsel_id * HISTOGRAM_BUCKETS;
+    uint8_t* hll = build->hll + morsel_id * HLL_REGISTERS;
+    int* data = build->data;
+    int min = data[start];
+    int max = data[start];
+    for(size_t i=start;i<end;i++){
+        min = data[i] < min ? data[i] : min;
+        max = data[i] > max ? data[i] : max;
+        counts[bucket_of(build->stats, data[i])]++;
+        hll_add(hll, data[i]);
+    }
+    build->mins[morsel_id] = min;
+    build->maxs[morsel_id] = max;
+}
+
+void stats_build(ColumnStats* stats, int* data, size_t size){
+    stats_init(stats);
+    if(size == 0){
+        return;
+    }
+    //bucket bounds at the quantiles of a sample, equal ones merged so that a frequent value fills whole buckets
+    size_t sample_num = size < STATS_SAMPLE_SIZE ? size : STATS_SAMPLE_SIZE;
+    int* sample = malloc(sample_num * sizeof(int));
+    for(size_t i=0;i<sample_num;i++){
+        sample[i] = data[i * size / sample_num];
+    }
+    qsort(sample, sample_num, sizeof(int), compare_int);
+    int bound;
+    for(size_t b=0;b<HISTOGRAM_BUCKETS;b++){
+        bound = sample[b * sample_num / HISTOGRAM_BUCKETS];
+        if(stats->bucket_num == 0 || bound > stats->bounds[stats->bucket_num-1]){
+            stats->bounds[stats->bucket_num++] = bound;
+        }
+    }
+    free(sample);
+
+    //exact bucket counts, sketch, min and max in one parallel pass
+    size_t morsel_num = morsel_count(size);
+    StatsBuildArgs args;
+    args.stats = stats;
+    args.data = data;
+    args.counts = calloc(morsel_num * HISTOGRAM_BUCKETS, sizeof(size_t));
+    args.hll = calloc(morsel_num * HLL_REGISTERS, sizeof(uint8_t));
+    args.mins = malloc(morsel_num * sizeof(int));
+    args.maxs = malloc(morsel_num * sizeof(int));
+    morsel_run(size, stats_build_morsel, &args);
+    stats->min = args.mins[0];
+    stats->max = args.maxs[0];
+    for(size_t m=0;m<morsel_num;m++){
+        stats->min = args.mins[m] < stats->min ? args.mins[m] : stats->min;
+        stats->max = args.maxs[m] > stats->max ? args.maxs[m] : stats->max;
+        for(size_t b=0;b<stats->bucket_num;b++){
+            stats->counts[b] += args.counts[m * HISTOGRAM_BUCKETS + b];
+        }
+        for(size_t r=0;r<HLL_REGISTERS;r++){
+            if(args.hll[m * HLL_REGISTERS + r] > stats->hll[r]){
+                stats->hll[r] = args.hll[m * HLL_REGISTERS + r];
+            }
+        }
+    }
+    free(args.counts);
+    free(args.hll);
+    free(args.mins);
+    free(args.maxs);
+    //the first bucket starts at the minimum, which the sample may have missed
+    stats->bounds[0] = stats->min;
+    stats->row_count = size;
+    stats->built_rows = size;
+    stats->modified = 0;
+}
+
+void stats_insert(ColumnStats* stats, int value){
+    if(stats->row_count == 0){
+        stats->min = value;
+        stats->max = value;
+    }else{
+        stats->min = value < stats->min ? value : stats->min;
+        stats->max = value > stats->max ? value : stats->max;
+    }
+    if(stats->bucket_num == 0){
+        stats->bucket_num = 1;
+        stats->bounds[0] = value;
+        stats->counts[0] = 0;
+    }else if(value < stats->bounds[0]){
+        stats->bounds[0] = value;
+    }
+    stats->counts[bucket_of(stats, value)]++;
+    hll_add(stats->hll, value);
+    stats->row_count++;
+    stats->modified++;
+}
+
+void stats_remove(ColumnStats* stats, int value){
+    if(stats->row_count == 0){
+        return;
+    }
+    size_t b = bucket_of(stats, value);
+    if(stats->counts[b] > 0){
+        stats->counts[b]--;
+    }
+    stats->row_count--;
+    stats->modified++;
+}
+
+void stats_refresh(Column* column){
+    ColumnStats* stats = &column->stats;
+    if(column->data != NULL && stats->modified > stats->built_rows / 2){
+        stats_build(stats, column->data, column->size);
+    }
+}
+
+size_t stats_distinct(ColumnStats* stats){
+    if(stats->row_count == 0){
+        return 0;
+    }
+    double m = HLL_REGISTERS;
+    double sum = 0;
+    size_t zeros = 0;
+    for(size_t r=0;r<HLL_REGISTERS;r++){
+        sum += 1.0 / (double) (UINT64_C(1) << stats->hll[r]);
+        zeros += stats->hll[r] == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if(estimate <= 2.5 * m && zeros > 0){
+        //few distinct values: linear counting on the empty registers is more accurate
+        estimate = m * log(m / zeros);
+    }
+    size_t distinct = (size_t) (estimate + 0.5);
+    return distinct < stats->row_count ? distinct : stats->row_count;
+}
+
+size_t stats_estimate_range(ColumnStats* stats, Comparator* comp){
+    //same predicate as the scan kernels, as the half open range [low, high)
+    double low = comp->ct1 != NO_COMPARISON ? (double) comp->lowerbound : (double) stats->min;
+    double high = comp->ct2 != NO_COMPARISON ? (double) comp->upperbound : (double) stats->max + 1;
+    double estimate = 0;
+    double bucket_low, bucket_high, overlap_low, overlap_high;
+    for(size_t b=0;b<stats->bucket_num;b++){
+        bucket_low = stats->bounds[b];
+        bucket_high = b + 1 < stats->bucket_num ? (double) stats->bounds[b+1] : (double) stats->max + 1;
+        overlap_low = low > bucket_low ? low : bucket_low;
+        overlap_high = high < bucket_high ? high : bucket_high;
+        if(overlap_high > overlap_low && bucket_high > bucket_low){
+            estimate += stats->counts[b] * (overlap_high - overlap_low) / (bucket_high - bucket_low);
+        }
+    }
+    size_t rows = (size_t) (estimate + 0.5);
+    return rows < stats->row_count ? rows : stats->row_count;
+}
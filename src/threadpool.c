@@ -0,0 +1,231 @@
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "threadpool.h"
+
+#define TASK_DEQUE_INITIAL_CAPACITY 256
+
+typedef struct Task {
+    TaskFunc func;
+    void* args;
+    TaskGroup* group;
+} Task;
+
+/*
+ * circular buffer of tasks, head is the top (oldest task), head+size-1 the bottom (newest task)
+ */
+typedef struct TaskDeque {
+    pthread_mutex_t lock;
+    Task* tasks;
+    size_t capacity;
+    size_t head;
+    size_t size;
+} TaskDeque;
+
+static TaskDeque* deques = NULL;
+static size_t deque_num = 0;
+static pthread_t* workers = NULL;
+static size_t worker_num = 0;
+static int shutting_down = 0;
+
+//number of tasks sitting in any deque, idle workers sleep while it is 0
+static size_t queued = 0;
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+
+//deque of the calling thread, -1 for threads outside the pool
+static __thread int current_worker = -1;
+//next deque an outside thread deals a task to
+static size_t next_deque = 0;
+
+static void deque_init(TaskDeque* deque){
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->tasks = malloc(TASK_DEQUE_INITIAL_CAPACITY * sizeof(Task));
+    deque->capacity = TASK_DEQUE_INITIAL_CAPACITY;
+    deque->head = 0;
+    deque->size = 0;
+}
+
+static void deque_push_bottom(TaskDeque* deque, Task task){
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size == deque->capacity){
+        //unroll the circular buffer into one twice as large
+        Task* tasks = malloc(2 * deque->capacity * sizeof(Task));
+        for(size_t i=0;i<deque->size;i++){
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity *= 2;
+        deque->head = 0;
+    }
+    deque->tasks[(deque->head + deque->size) % deque->capacity] = task;
+    deque->size++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int deque_pop_bottom(TaskDeque* deque, Task* task){
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size > 0){
+        deque->size--;
+        *task = deque->tasks[(deque->head + deque->size) % deque->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal_top(TaskDeque* deque, Task* task){
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size > 0){
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->size--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void run_task(Task* task){
+    task->func(task->args);
+    __atomic_fetch_sub(&task->group->pending, 1, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * takes a task from the own deque first, then steals from the others starting with the next one.
+ * returns 0 if every deque is empty.
+ **/
+static int find_task(Task* task){
+    int self = current_worker;
+    if(self >= 0 && deque_pop_bottom(&deques[self], task)){
+        __atomic_fetch_sub(&queued, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    size_t first = self >= 0 ? (size_t) self + 1 : 0;
+    for(size_t i=0;i<worker_num;i++){
+        size_t victim = (first + i) % worker_num;
+        if((int) victim == self){
+            continue;
+        }
+        if(deque_steal_top(&deques[victim], task)){
+            __atomic_fetch_sub(&queued, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* worker_loop(void* arg){
+    current_worker = (int) (size_t) arg;
+    Task task;
+    while(1){
+        if(find_task(&task)){
+            run_task(&task);
+            continue;
+        }
+        pthread_mutex_lock(&idle_lock);
+        while(__atomic_load_n(&queued, __ATOMIC_ACQUIRE) == 0 && !shutting_down){
+            pthread_cond_wait(&idle_cond, &idle_lock);
+        }
+        if(shutting_down && __atomic_load_n(&queued, __ATOMIC_ACQUIRE) == 0){
+            pthread_mutex_unlock(&idle_lock);
+            break;
+        }
+        pthread_mutex_unlock(&idle_lock);
+    }
+    return NULL;
+}
+
+void threadpool_init(size_t thread_num){
+    if(thread_num == 0){
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_num = cores > 0 ? (size_t) cores : 1;
+    }
+    worker_num = thread_num - 1;
+    if(worker_num == 0){
+        return;
+    }
+    deque_num = worker_num;
+    deques = malloc(deque_num * sizeof(TaskDeque));
+    workers = malloc(worker_num * sizeof(pthread_t));
+    for(size_t i=0;i<deque_num;i++){
+        deque_init(&deques[i]);
+    }
+    for(size_t i=0;i<worker_num;i++){
+        if(pthread_create(&workers[i], NULL, worker_loop, (void*) i) != 0){
+            //run with the workers we got, tasks are only dealt to their deques
+            worker_num = i;
+            break;
+        }
+    }
+}
+
+void threadpool_shutdown(void){
+    pthread_mutex_lock(&idle_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+    for(size_t i=0;i<worker_num;i++){
+        pthread_join(workers[i], NULL);
+    }
+    for(size_t i=0;i<deque_num;i++){
+        pthread_mutex_destroy(&deques[i].lock);
+        free(deques[i].tasks);
+    }
+    free(deques);
+    free(workers);
+    deques = NULL;
+    deque_num = 0;
+    workers = NULL;
+    worker_num = 0;
+    shutting_down = 0;
+}
+
+size_t threadpool_size(void){
+    return worker_num + 1;
+}
+
+void task_group_init(TaskGroup* group){
+    group->pending = 0;
+}
+
+void threadpool_submit(TaskGroup* group, TaskFunc func, void* args){
+    if(worker_num == 0){
+        func(args);
+        return;
+    }
+    Task task;
+    task.func = func;
+    task.args = args;
+    task.group = group;
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_ACQ_REL);
+    size_t target;
+    if(current_worker >= 0){
+        target = (size_t) current_worker;
+    }else{
+        target = __atomic_fetch_add(&next_deque, 1, __ATOMIC_RELAXED) % worker_num;
+    }
+    //counted before it is visible so that a thief never takes queued below 0
+    __atomic_fetch_add(&queued, 1, __ATOMIC_RELEASE);
+    deque_push_bottom(&deques[target], task);
+    pthread_mutex_lock(&idle_lock);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+void threadpool_wait(TaskGroup* group){
+    Task task;
+    while(__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0){
+        if(find_task(&task)){
+            run_task(&task);
+        }else{
+            //the remaining tasks of the group are running on other threads
+            sched_yield();
+        }
+    }
+}
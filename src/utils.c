@@ -129,6 +129,9 @@ void log_info(const char *format, ...) {
 
 //binary search key
 int search_key(int key, int* key_vec, int n){
+    if(n <= 0){
+        return 0;
+    }
     int low = 0;
     int high = n-1;
     int mid;
@@ -185,9 +188,16 @@ BTreeNode* btree_search(BTreeNode* root, int key, BTreeNode*** access_vec, size_
     BTreeNode* cur = root;
     size_t next_pos;
     while(!cur->is_leaf){
-        next_pos = search_key(key, cur->core_node.inode.keys, cur->key_count);
         if(need_access_vec){
-            *access_vec[*access_vec_size] = cur->core_node.inode.childs[next_pos];
+            //an insert goes after the keys equal to key, so that duplicates stay in insertion (position) order
+            next_pos = find_insert_pos(cur, key);
+        }else{
+            //a lookup goes to the first leaf that may hold key
+            next_pos = search_key(key, cur->core_node.inode.keys, cur->key_count);
+        }
+        if(need_access_vec){
+            //the internal nodes from the root down, the parents a leaf split propagates to
+            (*access_vec)[*access_vec_size] = cur;
             *access_vec_size +=1;
         }
         cur = cur->core_node.inode.childs[next_pos];
@@ -212,65 +222,19 @@ size_t find_insert_pos(BTreeNode* node, int key){
 }
 
 void update_index_pos_vec(BTreeNode* leaf, int pos, int is_insert){
-    BTreeNode* cur;
-    if(is_insert){
-        //adding a new key pos pair
-        //update current leaf first
-        for(int i=0;i<leaf->key_count;i++){
-            if(leaf->core_node.lnode.pos_vec[i] >= pos){
-                leaf->core_node.lnode.pos_vec[i]++;
+    //positions are spread over all leaves: walk back to the first leaf, then shift every leaf once
+    BTreeNode* cur = leaf;
+    while(cur->core_node.lnode.pre){
+        cur = cur->core_node.lnode.pre;
+    }
+    int shift = is_insert ? 1 : -1;
+    while(cur){
+        for(int i=0;i<cur->key_count;i++){
+            if(cur->core_node.lnode.pos_vec[i] >= pos){
+                cur->core_node.lnode.pos_vec[i] += shift;
             }
         }
-        //update all leaf nodes following current leaf node
-        cur = leaf->core_node.lnode.next;
-        while(cur){
-            for(int i=0;i<cur->key_count;i++){
-                if(cur->core_node.lnode.pos_vec[i] >= pos){
-                    leaf->core_node.lnode.pos_vec[i]++;
-                }
-            }
-            cur=cur->core_node.lnode.next;
-        }
-        //NECESSARY: update all leaf nodes preceding the current leaf node
-        //TODO: is the following code needed for clustered btree?
-        cur = leaf->core_node.lnode.pre;
-        while(cur){
-            for(int i=0;i<cur->key_count;i++){
-                if(cur->core_node.lnode.pos_vec[i] >= pos){
-                    leaf->core_node.lnode.pos_vec[i]++;
-                }
-            }
-            cur=cur->core_node.lnode.pre;
-        }
-    }else{
-        //removing an existing key pos pair
-        //update current leaf first
-        for(int i=0;i<leaf->key_count;i++){
-            if(leaf->core_node.lnode.pos_vec[i] >= pos){
-                leaf->core_node.lnode.pos_vec[i]--;
-            }
-        }
-        //update all leaf nodes following current leaf node
-        cur = leaf->core_node.lnode.next;
-        while(cur){
-            for(int i=0;i<cur->key_count;i++){
-                if(cur->core_node.lnode.pos_vec[i] >= pos){
-                    leaf->core_node.lnode.pos_vec[i]--;
-                }
-            }
-            cur=cur->core_node.lnode.next;
-        }
-        //NECESSARY: update all leaf nodes preceding the current leaf node
-        //TODO: is the following code needed for clustered btree?
-        cur = leaf->core_node.lnode.pre;
-        while(cur){
-            for(int i=0;i<cur->key_count;i++){
-                if(cur->core_node.lnode.pos_vec[i] >= pos){
-                    leaf->core_node.lnode.pos_vec[i]--;
-                }
-            }
-            cur=cur->core_node.lnode.pre;
-        }
+        cur = cur->core_node.lnode.next;
     }
 }
 
@@ -294,13 +258,22 @@ BTreeNode* btree_create_new_root_and_insert(BTreeNode* left_child, BTreeNode* ri
     new_root->core_node.inode.childs[0] = left_child;
     new_root->core_node.inode.childs[1] = right_child;
     new_root->core_node.inode.keys[0] = extra_key;
+    new_root->key_count = 1;
     return new_root;
 }
 
-BTreeNode* btree_insert_internal_simple(BTreeNode* internal, BTreeNode* right_child, int extra_key, BTreeNode* root){
-    
-    size_t insert_pos = find_insert_pos(internal, extra_key);
-    for(size_t i=internal->key_count;i>insert_pos;i++){
+//slot of child in internal, the new right sibling of a split child goes right after it
+static size_t btree_child_index(BTreeNode* internal, BTreeNode* child){
+    size_t i = 0;
+    while((int) i < internal->key_count && internal->core_node.inode.childs[i] != child){
+        i++;
+    }
+    return i;
+}
+
+BTreeNode* btree_insert_internal_simple(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root){
+    size_t insert_pos = btree_child_index(internal, left_child);
+    for(size_t i=internal->key_count;i>insert_pos;i--){
         internal->core_node.inode.keys[i] = internal->core_node.inode.keys[i-1];
         internal->core_node.inode.childs[i+1] = internal->core_node.inode.childs[i];
     }
@@ -310,58 +283,48 @@ BTreeNode* btree_insert_internal_simple(BTreeNode* internal, BTreeNode* right_ch
     return root;
 }
 
-BTreeNode* btree_split_and_insert_internal(BTreeNode* internal, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size){
+BTreeNode* btree_split_and_insert_internal(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size){
+    //put all keys and childs in one large container first before splitting
     int temp_keys[FANOUT];
-    void* temp_childs[FANOUT+1];
-    size_t insert_pos = find_insert_pos(internal, extra_key);
+    BTreeNode* temp_childs[FANOUT+1];
+    size_t insert_pos = btree_child_index(internal, left_child);
+    for(size_t i=0;i<insert_pos;i++){
+        temp_keys[i] = internal->core_node.inode.keys[i];
+    }
     temp_keys[insert_pos] = extra_key;
-    temp_childs[insert_pos+1] = right_child;
-    size_t new_index=0;
-    size_t old_index=0;
-    while(old_index < FANOUT-1){
-        if(new_index == insert_pos){
-            new_index++;
-        }
-        temp_keys[new_index] = internal->core_node.inode.keys[old_index];
-        new_index++;
-        old_index++;
+    for(size_t i=insert_pos;i<FANOUT-1;i++){
+        temp_keys[i+1] = internal->core_node.inode.keys[i];
     }
-    new_index=0;
-    old_index=0;
-    while(old_index < FANOUT){
-        if(new_index == insert_pos+1){
-            new_index++;
-        }
-        temp_childs[old_index] = internal->core_node.inode.childs[old_index];
-        new_index++;
-        old_index++;
+    for(size_t i=0;i<=insert_pos;i++){
+        temp_childs[i] = internal->core_node.inode.childs[i];
     }
-    BTreeNode* right_internal = btree_new_internal();
+    temp_childs[insert_pos+1] = right_child;
+    for(size_t i=insert_pos+1;i<FANOUT;i++){
+        temp_childs[i+1] = internal->core_node.inode.childs[i];
+    }
+    //redistribute, the middle key moves up to the parent
     BTreeNode* left_internal = internal;
+    BTreeNode* right_internal = btree_new_internal();
     size_t middle_point = FANOUT/2;
     int new_extra_key = temp_keys[middle_point];
     for(size_t i=0;i<middle_point;i++){
         left_internal->core_node.inode.keys[i] = temp_keys[i];
         left_internal->core_node.inode.childs[i] = temp_childs[i];
     }
-    left_internal->key_count = middle_point;
     left_internal->core_node.inode.childs[middle_point] = temp_childs[middle_point];
-    new_index=middle_point+1;
-    old_index=0;
-    while(new_index < FANOUT){
-        right_internal->core_node.inode.keys[old_index] = temp_keys[new_index];
-        right_internal->core_node.inode.childs[old_index] = temp_childs[new_index];
-        new_index++;
-        old_index++;
+    left_internal->key_count = middle_point;
+    for(size_t i=middle_point+1;i<FANOUT;i++){
+        right_internal->core_node.inode.keys[i-middle_point-1] = temp_keys[i];
+        right_internal->core_node.inode.childs[i-middle_point-1] = temp_childs[i];
     }
+    right_internal->core_node.inode.childs[FANOUT-middle_point-1] = temp_childs[FANOUT];
     right_internal->key_count = FANOUT-1-middle_point;
-    right_internal->core_node.inode.childs[old_index] = temp_childs[new_index];
-    BTreeNode* new_internal = NULL;
+    BTreeNode* parent = NULL;
     if(*access_vec_size>=1){
-        new_internal = *access_vec[*access_vec_size-1];
+        parent = (*access_vec)[*access_vec_size-1];
         *access_vec_size -= 1;
     }
-    return btree_insert_internal(new_internal, left_internal, right_internal, new_extra_key, root, access_vec, access_vec_size);
+    return btree_insert_internal(parent, left_internal, right_internal, new_extra_key, root, access_vec, access_vec_size);
 }
 
 BTreeNode* btree_insert_internal(BTreeNode* internal, BTreeNode* left_child, BTreeNode* right_child, int extra_key, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size){
@@ -369,15 +332,14 @@ BTreeNode* btree_insert_internal(BTreeNode* internal, BTreeNode* left_child, BTr
         return btree_create_new_root_and_insert(left_child, right_child, extra_key);
     }
     if(internal->key_count+1 < FANOUT){
-        return btree_insert_internal_simple(internal, right_child, extra_key, root);
+        return btree_insert_internal_simple(internal, left_child, right_child, extra_key, root);
     }else{
-        return btree_split_and_insert_internal(internal, right_child, extra_key, root, access_vec, access_vec_size);
+        return btree_split_and_insert_internal(internal, left_child, right_child, extra_key, root, access_vec, access_vec_size);
     }
 }
 
 BTreeNode* btree_split_and_insert_leaf(BTreeNode* leaf, int key, int pos, int insert_at_ordered_column_middle_pos, BTreeNode* root, BTreeNode*** access_vec, size_t* access_vec_size){
     size_t insert_pos = find_insert_pos(leaf, key);
-    //TODO: might be buggy here. Is situation exactly the same here?
     if(insert_at_ordered_column_middle_pos){
         update_index_pos_vec(leaf, pos, 1);
     }
@@ -410,18 +372,21 @@ BTreeNode* btree_split_and_insert_leaf(BTreeNode* leaf, int key, int pos, int in
     old_index=0;
     while(new_index<(LEAF_SIZE+1)){
         right_leaf->core_node.lnode.key_vec[old_index] = temp_key_vec[new_index];
-        right_leaf->core_node.lnode.pos_vec[old_index] = temp_key_vec[new_index];
+        right_leaf->core_node.lnode.pos_vec[old_index] = temp_pos_vec[new_index];
         new_index++;
         old_index++;
     }
     right_leaf->core_node.lnode.pre = left_leaf;
     right_leaf->core_node.lnode.next = left_leaf->core_node.lnode.next;
+    if(right_leaf->core_node.lnode.next){
+        right_leaf->core_node.lnode.next->core_node.lnode.pre = right_leaf;
+    }
     right_leaf->key_count = LEAF_SIZE+1-middle_point;
     left_leaf->core_node.lnode.next = right_leaf;
     
     BTreeNode* internal = NULL;
     if(*access_vec_size>=1){
-        internal = *access_vec[*access_vec_size-1];
+        internal = (*access_vec)[*access_vec_size-1];
         *access_vec_size -= 1;
     }
     return btree_insert_internal(internal, left_leaf, right_leaf, right_leaf->core_node.lnode.key_vec[0], root, access_vec, access_vec_size);
@@ -432,11 +397,8 @@ BTreeNode* btree_insert(BTreeNode* root, int key, int pos, int insert_at_ordered
         return btree_create(key, pos);
     }
     
-    //TODO: use access queue here?
     BTreeNode** access_vec = malloc(MAX_TREE_HEIGHT * sizeof(BTreeNode*));
     size_t access_vec_size=0;
-    access_vec[0]=root;
-    access_vec_size++;
     
     BTreeNode* leaf = btree_search(root, key, &access_vec, &access_vec_size, 1);
     BTreeNode* new_root = NULL;
@@ -525,6 +487,11 @@ int btree_find_pos_clustered(BTreeNode* root, int key, int include_key){
 }
 
 void btree_find_pos_unclustered(BTreeNode* root, Comparator* comp, int** qualifying_index_add, size_t* index_count_add){
+    if(comp->ct1 != NO_COMPARISON && comp->ct2 != NO_COMPARISON && comp->lowerbound >= comp->upperbound){
+        //an empty range, the walk from the lowerbound leaf would never meet the upperbound leaf
+        *index_count_add = 0;
+        return;
+    }
     int* qualifying_index = *qualifying_index_add;
     size_t index_count=0;
     int lowerbound;
@@ -549,6 +516,7 @@ void btree_find_pos_unclustered(BTreeNode* root, Comparator* comp, int** qualify
             end = upperbound_start_index;
             for(int i=start;i<end;i++){
                 qualifying_index[index_count] = lowerbound_start_leaf->core_node.lnode.pos_vec[i];
+                index_count++;
             }
         }else{
             end = lowerbound_start_leaf->key_count;
@@ -625,6 +593,47 @@ void btree_find_pos_unclustered(BTreeNode* root, Comparator* comp, int** qualify
     *index_count_add = index_count;
 }
 
+size_t btree_count_unclustered(BTreeNode* root, Comparator* comp, size_t limit){
+    if(comp->ct1 != NO_COMPARISON && comp->ct2 != NO_COMPARISON && comp->lowerbound >= comp->upperbound){
+        return 0;
+    }
+    BTreeNode* start_leaf = NULL;
+    int start_index = 0;
+    if(comp->ct1 != NO_COMPARISON){
+        BTreeNode* lowerbound_leaf = btree_search(root, comp->lowerbound, NULL, NULL, 0);
+        btree_find_real_start_leaf_and_index(lowerbound_leaf, comp->lowerbound, &start_leaf, &start_index);
+    }else{
+        //leftmost leaf
+        start_leaf = root;
+        while(!start_leaf->is_leaf){
+            start_leaf = start_leaf->core_node.inode.childs[0];
+        }
+    }
+    BTreeNode* end_leaf = NULL;
+    int end_index = 0;
+    if(comp->ct2 != NO_COMPARISON){
+        BTreeNode* upperbound_leaf = btree_search(root, comp->upperbound, NULL, NULL, 0);
+        btree_find_real_start_leaf_and_index(upperbound_leaf, comp->upperbound, &end_leaf, &end_index);
+    }
+    //only the key counts of the leaves are read, no position is touched
+    size_t count = 0;
+    BTreeNode* cur = start_leaf;
+    int i = start_index;
+    while(cur){
+        if(cur == end_leaf){
+            count += end_index > i ? end_index - i : 0;
+            break;
+        }
+        count += cur->key_count - i;
+        if(count > limit){
+            break;
+        }
+        i = 0;
+        cur = cur->core_node.lnode.next;
+    }
+    return count;
+}
+
 void btree_remove(BTreeNode* root, int key, int pos){
     BTreeNode* leaf = btree_search(root, key, NULL, NULL, 0);
     BTreeNode* real_start_leaf = NULL;
@@ -633,7 +642,11 @@ void btree_remove(BTreeNode* root, int key, int pos){
     BTreeNode* cur = real_start_leaf;
     int cur_index = real_start_index;
     while(cur != NULL){
-        if(cur->core_node.lnode.pos_vec[cur_index] == pos){
+        if(cur_index >= cur->key_count){
+            //go to the next leaf
+            cur = cur->core_node.lnode.next;
+            cur_index = 0;
+        }else if(cur->core_node.lnode.pos_vec[cur_index] == pos){
             for(int i=cur_index;i+1<cur->key_count;i++){
                 cur->core_node.lnode.key_vec[i]=cur->core_node.lnode.key_vec[i+1];
                 cur->core_node.lnode.pos_vec[i]=cur->core_node.lnode.pos_vec[i+1];
@@ -642,11 +655,6 @@ void btree_remove(BTreeNode* root, int key, int pos){
             break;
         }else{
             cur_index++;
-            if(cur_index >= cur->key_count){
-                //go to the next leaf
-                cur = cur->core_node.lnode.next;
-                cur_index = 0;
-            }
         }
     }
     //do not merge btree leaf
@@ -679,28 +687,36 @@ void sorted_insert_pos_vec(int* vec, int vec_size, int idx, int pos_val, int ins
 
 ColumnIndex* sorted_insert(ColumnIndex* ci, int size, int key, int pos, int insert_at_ordered_column_middle_pos){
     size_t insert_pos = search_key(key, ci->key_vec, size);
-    sorted_insert_val_vec(ci->key_vec, size, key, insert_pos);
-    sorted_insert_pos_vec(ci->key_vec, size, pos, insert_pos, insert_at_ordered_column_middle_pos);
+    sorted_insert_val_vec(ci->key_vec, size, insert_pos, key);
+    sorted_insert_pos_vec(ci->pos_vec, size, insert_pos, pos, insert_at_ordered_column_middle_pos);
     return ci;
 }
 
 void sorted_delete_and_update(ColumnIndex* ci, int size, int pos){
     int* key_vec = ci->key_vec;
     int* pos_vec = ci->pos_vec;
-    for(int i=pos;i+1<size;i++){
+    //the entry of pos is anywhere in key order
+    int idx = 0;
+    while(idx<size && pos_vec[idx]!=pos){
+        idx++;
+    }
+    for(int i=idx;i+1<size;i++){
         key_vec[i] = key_vec[i+1];
         pos_vec[i] = pos_vec[i+1];
-        if(pos_vec[i]>pos){
-            pos_vec[i]--;
-        }
     }
-    for(int i=0;i<pos;i++){
+    for(int i=0;i+1<size;i++){
         if(pos_vec[i]>pos){
             pos_vec[i]--;
         }
     }
 }
 
+int IndexPairCompare(const void *ip1p, const void *ip2p){
+    IndexPair* ip1 = (IndexPair*) ip1p;
+    IndexPair* ip2 = (IndexPair*) ip2p;
+    return (ip1->key > ip2->key) - (ip1->key < ip2->key);
+}
+
 void update_column_index(Column* column, int key, size_t pos, int no_need_to_shift){
     //TODO:double check if we get the flag conditions right
     int insert_at_ordered_column_middle_pos_flag = !no_need_to_shift && pos != column->size && column->clustered;
@@ -738,9 +754,9 @@ ExtHashTable* hashtable_create(){
 unsigned long hash_func(int key){
     unsigned char* str = (unsigned char*) &key;
     unsigned long res = 0;
-    int cur;
-    while((cur=*str++)){
-        res = cur + (res<<6) + (res<<16) - res;
+    //every byte of the key, a zero byte does not end it
+    for(size_t i=0;i<sizeof(int);i++){
+        res = str[i] + (res<<6) + (res<<16) - res;
     }
     return res;
 }
@@ -901,3 +917,77 @@ void hashtable_free(ExtHashTable* ht){
     free(ht->buckets);
     free(ht);
 }
+
+size_t bitmap_words(size_t n){
+    return (n + 63) / 64;
+}
+
+size_t bitmap_count(uint64_t* bitmap, size_t words){
+    size_t count = 0;
+    for(size_t i=0;i<words;i++){
+        count += __builtin_popcountll(bitmap[i]);
+    }
+    return count;
+}
+
+size_t bitmap_to_positions(uint64_t* bitmap, size_t bitmap_len, int* pos_vec){
+    size_t count = 0;
+    size_t words = bitmap_words(bitmap_len);
+    uint64_t word;
+    for(size_t i=0;i<words;i++){
+        word = bitmap[i];
+        while(word){
+            pos_vec[count++] = (int) (i * 64 + __builtin_ctzll(word));
+            //clear the lowest set bit
+            word &= word - 1;
+        }
+    }
+    return count;
+}
+
+uint64_t* positions_to_bitmap(int* pos_vec, size_t tuples_num, size_t bitmap_len){
+    size_t words = bitmap_words(bitmap_len);
+    uint64_t* bitmap = calloc(words > 0 ? words : 1, sizeof(uint64_t));
+    for(size_t i=0;i<tuples_num;i++){
+        bitmap[pos_vec[i] >> 6] |= UINT64_C(1) << (pos_vec[i] & 63);
+    }
+    return bitmap;
+}
+
+void result_materialize_positions(Result* res){
+    if(res->format == RANGES){
+        int* ranges = (int*) res->payload;
+        int* pos_vec = malloc((res->num_tuples > 0 ? res->num_tuples : 1) * sizeof(int));
+        size_t k = 0;
+        for(size_t r=0;r<res->range_num;r++){
+            for(int pos=ranges[2*r];pos<ranges[2*r+1];pos++){
+                pos_vec[k++] = pos;
+            }
+        }
+        res->payload = pos_vec;
+        res->format = VECTOR;
+        res->range_num = 0;
+        free(ranges);
+        return;
+    }
+    if(res->format != BITMAP){
+        return;
+    }
+    uint64_t* bitmap = (uint64_t*) res->payload;
+    int* pos_vec = malloc((res->num_tuples > 0 ? res->num_tuples : 1) * sizeof(int));
+    res->num_tuples = bitmap_to_positions(bitmap, res->bitmap_len, pos_vec);
+    res->payload = pos_vec;
+    res->format = VECTOR;
+    res->bitmap_len = 0;
+    free(bitmap);
+}
+
+void result_materialize_slice(Result* res){
+    if(res->format != SLICE){
+        return;
+    }
+    int* val_vec = malloc((res->num_tuples > 0 ? res->num_tuples : 1) * sizeof(int));
+    memcpy(val_vec, res->payload, res->num_tuples * sizeof(int));
+    res->payload = val_vec;
+    res->format = VECTOR;
+}
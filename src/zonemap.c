@@ -0,0 +1,184 @@
+#include <string.h>
+#include "cs165_api.h"
+#include "morsel.h"
+#include "scan.h"
+#include "utils.h"
+#include "zonemap.h"
+
+static size_t zone_count(size_t size){
+    return (size + ZONE_SIZE - 1) / ZONE_SIZE;
+}
+
+void zone_map_init(ZoneMap* zm, size_t capacity){
+    zm->zone_capacity = zone_count(capacity);
+    zm->min_vec = malloc((zm->zone_capacity > 0 ? zm->zone_capacity : 1) * sizeof(int));
+    zm->max_vec = malloc((zm->zone_capacity > 0 ? zm->zone_capacity : 1) * sizeof(int));
+    zm->zone_num = 0;
+}
+
+void zone_map_reserve(ZoneMap* zm, size_t capacity){
+    size_t zone_capacity = zone_count(capacity);
+    if(zone_capacity <= zm->zone_capacity){
+        return;
+    }
+    zm->min_vec = realloc(zm->min_vec, zone_capacity * sizeof(int));
+    zm->max_vec = realloc(zm->max_vec, zone_capacity * sizeof(int));
+    zm->zone_capacity = zone_capacity;
+}
+
+void zone_map_free(ZoneMap* zm){
+    free(zm->min_vec);
+    free(zm->max_vec);
+    zm->min_vec = NULL;
+    zm->max_vec = NULL;
+    zm->zone_num = 0;
+    zm->zone_capacity = 0;
+}
+
+//min and max of the zones [first_zone, last_zone) of data[0, size)
+static void compute_zones(ZoneMap* zm, int* data, size_t size, size_t first_zone, size_t last_zone){
+    size_t start, end;
+    int min, max;
+    for(size_t z=first_zone;z<last_zone;z++){
+        start = z * ZONE_SIZE;
+        end = start + ZONE_SIZE < size ? start + ZONE_SIZE : size;
+        min = data[start];
+        max = data[start];
+        for(size_t i=start+1;i<end;i++){
+            min = data[i] < min ? data[i] : min;
+            max = data[i] > max ? data[i] : max;
+        }
+        zm->min_vec[z] = min;
+        zm->max_vec[z] = max;
+    }
+}
+
+typedef struct ZoneBuildArgs {
+    ZoneMap* zm;
+    int* data;
+    size_t size;
+} ZoneBuildArgs;
+
+static void zone_build_morsel(size_t morsel_id, size_t start, size_t end, void* args){
+    (void) morsel_id;
+    ZoneBuildArgs* build = (ZoneBuildArgs*) args;
+    compute_zones(build->zm, build->data, build->size, start / ZONE_SIZE, zone_count(end));
+}
+
+void zone_map_build(ZoneMap* zm, int* data, size_t size){
+    zone_map_reserve(zm, size);
+    ZoneBuildArgs args;
+    args.zm = zm;
+    args.data = data;
+    args.size = size;
+    morsel_run(size, zone_build_morsel, &args);
+    zm->zone_num = zone_count(size);
+}
+
+void zone_map_rebuild_from(ZoneMap* zm, int* data, size_t size, size_t pos){
+    zone_map_reserve(zm, size);
+    zm->zone_num = zone_count(size);
+    compute_zones(zm, data, size, pos / ZONE_SIZE, zm->zone_num);
+}
+
+void zone_map_append(ZoneMap* zm, size_t pos, int value){
+    size_t z = pos / ZONE_SIZE;
+    zone_map_reserve(zm, pos + 1);
+    if(z >= zm->zone_num){
+        zm->min_vec[z] = value;
+        zm->max_vec[z] = value;
+        zm->zone_num = z + 1;
+        return;
+    }
+    zm->min_vec[z] = value < zm->min_vec[z] ? value : zm->min_vec[z];
+    zm->max_vec[z] = value > zm->max_vec[z] ? value : zm->max_vec[z];
+}
+
+//same predicate as the scan kernels: (ct1 == NO_COMPARISON || lowerbound <= v) && (ct2 == NO_COMPARISON || upperbound > v)
+ZoneMatch zone_map_match(Comparator* comp, int min, int max){
+    if((comp->ct1 != NO_COMPARISON && comp->lowerbound > max) || (comp->ct2 != NO_COMPARISON && comp->upperbound <= min)){
+        return ZONE_NONE;
+    }
+    if((comp->ct1 == NO_COMPARISON || comp->lowerbound <= min) && (comp->ct2 == NO_COMPARISON || comp->upperbound > max)){
+        return ZONE_ALL;
+    }
+    return ZONE_PARTIAL;
+}
+
+size_t zone_map_values_to_read(ZoneMap* zm, size_t size, Comparator* comp){
+    size_t values = 0;
+    size_t zone_num = zone_count(size);
+    for(size_t z=0;z<zone_num;z++){
+        if(zone_map_match(comp, zm->min_vec[z], zm->max_vec[z]) == ZONE_PARTIAL){
+            values += (z + 1) * ZONE_SIZE < size ? ZONE_SIZE : size - z * ZONE_SIZE;
+        }
+    }
+    return values;
+}
+
+typedef struct ZoneScanArgs {
+    ZoneMap* zm;
+    int* data;
+    Comparator* comp;
+    uint64_t* bitmap;
+    size_t* counts;
+    //zones skipped, emitted whole and scanned, per morsel
+    size_t* skipped;
+    size_t* emitted;
+    size_t* scanned;
+} ZoneScanArgs;
+
+static void zone_scan_morsel(size_t morsel_id, size_t start, size_t end, void* args){
+    ZoneScanArgs* scan = (ZoneScanArgs*) args;
+    size_t count = 0;
+    size_t zone_start, zone_end, first_word, last_word;
+    scan->skipped[morsel_id] = 0;
+    scan->emitted[morsel_id] = 0;
+    scan->scanned[morsel_id] = 0;
+    for(size_t z=start/ZONE_SIZE;z<zone_count(end);z++){
+        zone_start = z * ZONE_SIZE;
+        zone_end = zone_start + ZONE_SIZE < end ? zone_start + ZONE_SIZE : end;
+        first_word = zone_start / 64;
+        last_word = bitmap_words(zone_end);
+        ZoneMatch match = zone_map_match(scan->comp, scan->zm->min_vec[z], scan->zm->max_vec[z]);
+        if(match == ZONE_NONE){
+            memset(scan->bitmap + first_word, 0, (last_word - first_word) * sizeof(uint64_t));
+            scan->skipped[morsel_id]++;
+        }else if(match == ZONE_ALL){
+            memset(scan->bitmap + first_word, 0xff, (last_word - first_word) * sizeof(uint64_t));
+            if(zone_end % 64 != 0){
+                scan->bitmap[last_word - 1] = (UINT64_C(1) << (zone_end % 64)) - 1;
+            }
+            count += zone_end - zone_start;
+            scan->emitted[morsel_id]++;
+        }else{
+            count += scan_bitmap((void*) (scan->data + zone_start), INT, zone_end - zone_start, scan->comp, scan->bitmap + first_word);
+            scan->scanned[morsel_id]++;
+        }
+    }
+    scan->counts[morsel_id] = count;
+}
+
+size_t zone_map_scan_bitmap(ZoneMap* zm, int* data, size_t size, Comparator* comp, uint64_t* bitmap){
+    size_t morsel_num = morsel_count(size);
+    ZoneScanArgs args;
+    args.zm = zm;
+    args.data = data;
+    args.comp = comp;
+    args.bitmap = bitmap;
+    args.counts = malloc((morsel_num > 0 ? morsel_num : 1) * 4 * sizeof(size_t));
+    args.skipped = args.counts + morsel_num;
+    args.emitted = args.skipped + morsel_num;
+    args.scanned = args.emitted + morsel_num;
+    morsel_run(size, zone_scan_morsel, &args);
+    size_t index_count = 0, skipped = 0, emitted = 0, scanned = 0;
+    for(size_t m=0;m<morsel_num;m++){
+        index_count += args.counts[m];
+        skipped += args.skipped[m];
+        emitted += args.emitted[m];
+        scanned += args.scanned[m];
+    }
+    cs165_log(stdout, "zone map: %zd zones skipped, %zd emitted whole, %zd scanned\n", skipped, emitted, scanned);
+    free(args.counts);
+    return index_count;
+}